@@ -124,7 +124,7 @@ namespace pc
   template<class T>
   void hash_map<T>::clear()
   {
-    nvec_.resize( 1 );
+    node_vec_t( 1 ).swap( nvec_ );
     rhd_  = 0;
     nval_ = 0;
     __builtin_memset( htab_, 0 , sizeof( htab_ ) );
@@ -1,12 +1,403 @@
 #include "jtree.hpp"
 #include <ctype.h>
 #include <stdlib.h>
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
 
 using namespace pc;
 
+#define PC_JPATH_NONE ((uint32_t)-1)
+
+///////////////////////////////////////////////////////////////////////////
+// jpath
+
+jpath::jpath()
+: nv_( 1 )
+{
+  nv_[0].pfx_ = 0;
+  nv_[0].parent_ = nv_[0].first_ = nv_[0].next_ = nv_[0].path_ = 0;
+}
+
+static uint64_t jpath_pfx( const char *key, size_t len )
+{
+  uint64_t pfx = 0;
+  if ( len >= 8 ) {
+    __builtin_memcpy( &pfx, key, 8 );
+  } else {
+    for( size_t i = 0; i != len; ++i ) {
+      pfx |= (uint64_t)(uint8_t)key[i] << ( 8*i );
+    }
+  }
+  return pfx;
+}
+
+uint32_t jpath::find( uint32_t idx, const char *key, size_t len ) const
+{
+  return find( idx, key, len, jpath_pfx( key, len ) );
+}
+
+uint32_t jpath::find( uint32_t idx, const char *key, size_t len,
+                      uint64_t pfx ) const
+{
+  // compare key prefix as one word and the rest (if any) bytewise
+  for( uint32_t it = nv_[idx].first_; it; it = nv_[it].next_ ) {
+    const node& nd = nv_[it];
+    if ( nd.pfx_ == pfx && nd.key_.size() == len && ( len <= 8 ||
+         0 == __builtin_memcmp( &nd.key_[8], &key[8], len - 8 ) ) ) {
+      return it;
+    }
+  }
+  return 0;
+}
+
+unsigned jpath::add( str path )
+{
+  uint32_t idx = 0;
+  const char *ptr = path.str_, *end = &path.str_[path.len_];
+  while( ptr != end ) {
+    const char *nxt = ptr;
+    while( nxt != end && *nxt != '.' ) ++nxt;
+    uint32_t cidx = find( idx, ptr, nxt - ptr );
+    if ( !cidx ) {
+      cidx = nv_.size();
+      node nd;
+      nd.key_.assign( ptr, nxt - ptr );
+      nd.pfx_    = jpath_pfx( ptr, nxt - ptr );
+      nd.parent_ = idx;
+      nd.first_  = 0;
+      nd.next_   = nv_[idx].first_;
+      nd.path_   = 0;
+      nv_.push_back( nd );
+      nv_[idx].first_ = cidx;
+    }
+    idx = cidx;
+    ptr = nxt == end ? end : nxt + 1;
+  }
+  if ( !nv_[idx].path_ ) {
+    pv_.push_back( idx );
+    nv_[idx].path_ = pv_.size();
+  }
+  return nv_[idx].path_ - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// jtree
+
 jtree::jtree()
-: key_( 0 ), buf_( nullptr  )
+: key_( 0 ), buf_( nullptr  ), jp_( nullptr ), pkey_( PC_JPATH_NONE )
+{
+}
+
+void jtree::set_path( const jpath *jp )
+{
+  jp_ = jp;
+  pv_.clear();
+}
+
+uint32_t jtree::find_path( const jpath& jp, unsigned id ) const
 {
+  if ( &jp == jp_ ) {
+    return id < pv_.size() ? pv_[id] : 0;
+  }
+  if ( id >= jp.pv_.size() || nv_.size() < 2 ) {
+    return 0;
+  }
+  uint32_t key[32], nkey = 0;
+  for( uint32_t idx = jp.pv_[id]; idx && nkey != 32;
+       idx = jp.nv_[idx].parent_ ) {
+    key[nkey++] = idx;
+  }
+  uint32_t tok = 1;
+  while( nkey && tok ) {
+    tok = find_val( tok, jp.nv_[key[--nkey]].key_ );
+  }
+  return tok;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// structural index
+
+// per-block character class bitmaps (bit i for byte i of block)
+struct jtree_cls
+{
+  uint64_t quote_;  // '"'
+  uint64_t bslash_; // '\\'
+  uint64_t op_;     // '{' '}' '[' ']' ':'
+  uint64_t tok_;    // anything but the above, ',' and whitespace
+};
+
+typedef void (*jtree_cls_fn_t)( const char *, jtree_cls& );
+
+static inline bool jtree_is_space( char c )
+{
+  return c == ' ' || (unsigned char)( c - '\t' ) < 5;
+}
+
+static void jtree_cls_scalar( const char *blk, jtree_cls& cls )
+{
+  uint64_t quote = 0, bslash = 0, op = 0, other = 0;
+  for( unsigned i=0; i != 64; ++i ) {
+    uint64_t bit = 1UL << i;
+    switch( blk[i] ) {
+      case '"':  quote  |= bit; break;
+      case '\\': bslash |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': op |= bit; break;
+      case ',': other |= bit; break;
+      default: {
+        if ( jtree_is_space( blk[i] ) ) {
+          other |= bit;
+        }
+        break;
+      }
+    }
+  }
+  cls.quote_  = quote;
+  cls.bslash_ = bslash;
+  cls.op_     = op;
+  cls.tok_    = ~( quote | op | other );
+}
+
+#if defined( __x86_64__ )
+
+// '[' and ']' are '{' and '}' with bit 5 cleared
+static void jtree_cls_sse2( const char *blk, jtree_cls& cls )
+{
+  const __m128i quote = _mm_set1_epi8( '"' );
+  const __m128i bslash = _mm_set1_epi8( '\\' );
+  const __m128i lbrace = _mm_set1_epi8( '{' );
+  const __m128i rbrace = _mm_set1_epi8( '}' );
+  const __m128i colon = _mm_set1_epi8( ':' );
+  const __m128i comma = _mm_set1_epi8( ',' );
+  const __m128i space = _mm_set1_epi8( ' ' );
+  const __m128i bit5 = _mm_set1_epi8( 0x20 );
+  const __m128i tab0 = _mm_set1_epi8( '\t' - 1 );
+  const __m128i tab1 = _mm_set1_epi8( '\r' + 1 );
+  cls.quote_ = cls.bslash_ = cls.op_ = cls.tok_ = 0;
+  for( unsigned i=0; i != 64; i += 16 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i*)&blk[i] );
+    __m128i l = _mm_or_si128( v, bit5 );
+    __m128i q = _mm_cmpeq_epi8( v, quote );
+    __m128i op = _mm_or_si128(
+        _mm_or_si128( _mm_cmpeq_epi8( l, lbrace ),
+                      _mm_cmpeq_epi8( l, rbrace ) ),
+        _mm_cmpeq_epi8( v, colon ) );
+    __m128i ws = _mm_or_si128(
+        _mm_or_si128( _mm_cmpeq_epi8( v, space ),
+                      _mm_cmpeq_epi8( v, comma ) ),
+        _mm_and_si128( _mm_cmpgt_epi8( v, tab0 ),
+                       _mm_cmplt_epi8( v, tab1 ) ) );
+    __m128i nt = _mm_or_si128( _mm_or_si128( q, op ), ws );
+    cls.quote_  |= (uint64_t)(uint16_t)_mm_movemask_epi8( q ) << i;
+    cls.bslash_ |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8( v, bslash ) ) << i;
+    cls.op_     |= (uint64_t)(uint16_t)_mm_movemask_epi8( op ) << i;
+    cls.tok_    |= (uint64_t)(uint16_t)~_mm_movemask_epi8( nt ) << i;
+  }
+}
+
+__attribute__(( target( "avx2" ) ))
+static void jtree_cls_avx2( const char *blk, jtree_cls& cls )
+{
+  const __m256i quote = _mm256_set1_epi8( '"' );
+  const __m256i bslash = _mm256_set1_epi8( '\\' );
+  const __m256i lbrace = _mm256_set1_epi8( '{' );
+  const __m256i rbrace = _mm256_set1_epi8( '}' );
+  const __m256i colon = _mm256_set1_epi8( ':' );
+  const __m256i comma = _mm256_set1_epi8( ',' );
+  const __m256i space = _mm256_set1_epi8( ' ' );
+  const __m256i bit5 = _mm256_set1_epi8( 0x20 );
+  const __m256i tab0 = _mm256_set1_epi8( '\t' - 1 );
+  const __m256i tab1 = _mm256_set1_epi8( '\r' + 1 );
+  cls.quote_ = cls.bslash_ = cls.op_ = cls.tok_ = 0;
+  for( unsigned i=0; i != 64; i += 32 ) {
+    __m256i v = _mm256_loadu_si256( (const __m256i*)&blk[i] );
+    __m256i l = _mm256_or_si256( v, bit5 );
+    __m256i q = _mm256_cmpeq_epi8( v, quote );
+    __m256i op = _mm256_or_si256(
+        _mm256_or_si256( _mm256_cmpeq_epi8( l, lbrace ),
+                         _mm256_cmpeq_epi8( l, rbrace ) ),
+        _mm256_cmpeq_epi8( v, colon ) );
+    __m256i ws = _mm256_or_si256(
+        _mm256_or_si256( _mm256_cmpeq_epi8( v, space ),
+                         _mm256_cmpeq_epi8( v, comma ) ),
+        _mm256_and_si256( _mm256_cmpgt_epi8( v, tab0 ),
+                          _mm256_cmpgt_epi8( tab1, v ) ) );
+    __m256i nt = _mm256_or_si256( _mm256_or_si256( q, op ), ws );
+    cls.quote_  |= (uint64_t)(uint32_t)_mm256_movemask_epi8( q ) << i;
+    cls.bslash_ |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8( v, bslash ) ) << i;
+    cls.op_     |= (uint64_t)(uint32_t)_mm256_movemask_epi8( op ) << i;
+    cls.tok_    |= (uint64_t)(uint32_t)~_mm256_movemask_epi8( nt ) << i;
+  }
+}
+
+#endif
+
+static jtree_cls_fn_t jtree_cls_fn[jtree::e_num_impl] = {
+  jtree_cls_scalar,
+#if defined( __x86_64__ )
+  jtree_cls_sse2,
+  jtree_cls_avx2
+#else
+  nullptr,
+  nullptr
+#endif
+};
+
+static jtree::impl_t jtree_best()
+{
+#if defined( __x86_64__ )
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports( "avx2" ) ) {
+    return jtree::e_avx2;
+  }
+  return jtree::e_sse2;
+#else
+  return jtree::e_scalar;
+#endif
+}
+
+static jtree::impl_t  jtree_impl = jtree_best();
+static jtree_cls_fn_t jtree_curr = jtree_cls_fn[jtree_impl];
+
+bool jtree::get_has_impl( impl_t impl )
+{
+  return impl < e_num_impl && jtree_cls_fn[impl] && impl <= jtree_best();
+}
+
+bool jtree::set_impl( impl_t impl )
+{
+  if ( !get_has_impl( impl ) ) {
+    return false;
+  }
+  jtree_impl = impl;
+  jtree_curr = jtree_cls_fn[impl];
+  return true;
+}
+
+jtree::impl_t jtree::get_impl()
+{
+  return jtree_impl;
+}
+
+const char *jtree::get_impl_name( impl_t impl )
+{
+  static const char *name[] = { "scalar", "sse2", "avx2" };
+  return impl < e_num_impl ? name[impl] : "unknown";
+}
+
+size_t jtree::build_index( const char *buf, size_t sz )
+{
+  static const uint64_t even_bits = 0x5555555555555555UL;
+  if ( ix_.size() < sz + 64 ) {
+    ix_.resize( sz + 64 );
+  }
+  uint32_t *out = ix_.data();
+  uint64_t pesc = 0;  // next block starts with an escaped character
+  uint64_t pstr = 0;  // next block starts inside a string (all ones)
+  uint64_t ptok = 0;  // last byte of block was part of a token
+  char pad[64];
+  for( size_t off = 0; off < sz; off += 64 ) {
+    const char *blk = &buf[off];
+    if ( sz - off < 64 ) {
+      __builtin_memset( pad, ' ', sizeof( pad ) );
+      __builtin_memcpy( pad, blk, sz - off );
+      blk = pad;
+    }
+    jtree_cls cls;
+    jtree_curr( blk, cls );
+
+    // characters escaped by an odd-length run of backslashes
+    uint64_t bs = cls.bslash_ & ~pesc;
+    uint64_t follows = ( bs << 1 ) | pesc;
+    uint64_t odd_starts = bs & ~even_bits & ~follows;
+    uint64_t even_seq;
+    pesc = __builtin_add_overflow( odd_starts, bs, &even_seq );
+    uint64_t esc = ( even_bits ^ ( even_seq << 1 ) ) & follows;
+
+    // bytes from opening quote up to (not including) closing quote
+    uint64_t quote = cls.quote_ & ~esc;
+    uint64_t instr = quote;
+    instr ^= instr << 1;
+    instr ^= instr << 2;
+    instr ^= instr << 4;
+    instr ^= instr << 8;
+    instr ^= instr << 16;
+    instr ^= instr << 32;
+    instr ^= pstr;
+    pstr = (uint64_t)( (int64_t)instr >> 63 );
+
+    // first byte of each run of number or keyword characters
+    uint64_t tok = cls.tok_ & ~instr;
+    uint64_t tstart = tok & ~( ( tok << 1 ) | ptok );
+    ptok = tok >> 63;
+
+    uint64_t bits = quote | ( ( cls.op_ | tstart ) & ~instr );
+    while( bits ) {
+      *out++ = off + __builtin_ctzll( bits );
+      bits &= bits - 1;
+    }
+  }
+  return out - ix_.data();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// jtree
+
+bool jtree::parse_scalar( const char *&cptr, const char *end )
+{
+  // run of characters that are neither structural nor whitespace. may
+  // hold several tokens (e.g. 1true) and characters that are ignored
+  for(;;) {
+    if ( cptr == end ) return true;
+    char c = *cptr;
+    if ( c == '-' || c == '.' || isdigit( c ) ) {
+      const char *txt = cptr;
+      for(++cptr;;++cptr) {
+        if ( cptr == end ) return false;
+        if ( !isdigit(*cptr) && *cptr!='.' &&
+             *cptr!='-' && *cptr!='e' && *cptr!='+' ) {
+          parse_number( txt, cptr );
+          break;
+        }
+      }
+    } else if ( c == 't' || c == 'f' || c == 'n' ) {
+      const char *txt = cptr;
+      for(++cptr;;++cptr) {
+        if ( cptr == end ) return false;
+        if ( !isalpha(*cptr) ) {
+          parse_keyword( txt, cptr );
+          break;
+        }
+      }
+    } else if ( c == '"' || c == ',' || jtree_is_space( c ) ||
+                c == '{' || c == '}' || c == '[' || c == ']' || c == ':' ) {
+      return true;
+    } else {
+      ++cptr;
+    }
+  }
+}
+
+// path trie node of next value: the root for a top-level value or else
+// the child for its key of the enclosing object's node
+inline uint32_t jtree::get_val_path()
+{
+  uint32_t pidx = st_.empty() ? 0 : ( key_ ? pkey_ : PC_JPATH_NONE );
+  pkey_ = PC_JPATH_NONE;
+  return pidx;
+}
+
+// record value of path ending at trie node (first value wins)
+inline void jtree::set_val_path( uint32_t pidx, uint32_t val )
+{
+  if ( pidx != PC_JPATH_NONE ) {
+    uint32_t path = jp_->nv_[pidx].path_;
+    if ( path && !pv_[path-1] ) {
+      pv_[path-1] = val;
+    }
+  }
 }
 
 void jtree::parse( const char *cptr, size_t sz )
@@ -16,74 +407,92 @@ void jtree::parse( const char *cptr, size_t sz )
   nv_.resize(1);
   st_.clear();
 
-  typedef enum { e_start, e_string, e_number, e_keyword } state_t;
-  state_t st = e_start;
-  const char *txt=nullptr, *end = &cptr[sz];
-  for(;;) {
-    switch(st) {
-      case e_start: {
-        for(;;++cptr) {
-          if( cptr==end ) return;
-          if (*cptr == '{' ) {
-            parse_start_object();
-          } else if ( *cptr == '[' ) {
-            parse_start_array();
-          } else if (*cptr == '}' ) {
-            parse_end_object();
-          } else if ( *cptr == ']' ) {
-            parse_end_array();
-          } else if ( *cptr == '"' ) {
-            st = e_string; txt=cptr+1; break;
-          } else if ( *cptr == '-' || *cptr == '.' || isdigit(*cptr)) {
-            st = e_number; txt=cptr; break;
-          } else if ( *cptr == 't' || *cptr == 'f' || *cptr == 'n' ) {
-            st = e_keyword; txt=cptr; break;
-          }
+  // values at the end of a truncated message are dropped
+  size_t num = build_index( cptr, sz );
+  if ( jp_ ) {
+    std::fill( pv_.begin(), pv_.end(), 0 );
+    pv_.resize( jp_->get_num_path(), 0 );
+    pst_.clear();
+    pkey_ = PC_JPATH_NONE;
+    parse_index<true>( cptr, num, &cptr[sz] );
+  } else {
+    parse_index<false>( cptr, num, &cptr[sz] );
+  }
+}
+
+template<bool has_path>
+void jtree::parse_index( const char *cptr, size_t num, const char *end )
+{
+  const uint32_t *iptr = ix_.data(), *iend = &iptr[num];
+  while( iptr != iend ) {
+    const char *txt = &cptr[*iptr++];
+    switch( *txt ) {
+      case '{': {
+        if ( has_path ) {
+          uint32_t pidx = get_val_path();
+          set_val_path( pidx, nv_.size() );
+          pst_.push_back( pidx );
         }
-        ++cptr;
+        parse_start_object();
         break;
       }
-
-      case e_string: {
-        for(;;++cptr) {
-          if( cptr==end ) return;
-          if (*cptr == '"' ) {
-            st = e_start;
-            const char *etxt = cptr;
-            // peek if this is a key
-            for(++cptr;;++cptr) {
-              if( cptr==end ) return;
-              if ( *cptr == ':' ) {
-                parse_key( txt, etxt );
-                break;
-              } else if ( !isspace(*cptr) ) {
-                parse_string( txt, etxt );
-                break;
-              }
-            }
-            break;
-          }
+      case '[': {
+        if ( has_path ) {
+          set_val_path( get_val_path(), nv_.size() );
+          pst_.push_back( PC_JPATH_NONE );
         }
+        parse_start_array();
         break;
       }
-
-      case e_number: {
-        for(;;++cptr) {
-          if( cptr==end ) return;
-          if ( !isdigit(*cptr) && *cptr!='.' &&
-               *cptr!='-' && *cptr!='e' && *cptr!='+' ) {
-            st = e_start; parse_number( txt, cptr );break;
+      case '}': {
+        if ( has_path ) pst_.pop_back();
+        parse_end_object();
+        break;
+      }
+      case ']': {
+        if ( has_path ) pst_.pop_back();
+        parse_end_array();
+        break;
+      }
+      case ':': break;
+      case '"': {
+        // closing quote is the next index entry
+        if ( iptr == iend ) return;
+        const char *etxt = &cptr[*iptr++];
+        // peek if this is a key
+        const char *nxt = etxt + 1;
+        while( nxt != end && jtree_is_space( *nxt ) ) ++nxt;
+        if ( nxt == end ) return;
+        if ( *nxt == ':' ) {
+          parse_key( txt+1, etxt );
+          if ( has_path && !pst_.empty() && pst_.back() != PC_JPATH_NONE ) {
+            // key is followed by at least 8 bytes unless near the end
+            size_t len = etxt - txt - 1;
+            uint64_t pfx;
+            if ( txt + 9 <= end ) {
+              __builtin_memcpy( &pfx, txt+1, 8 );
+              pfx &= len < 8 ? ( 1UL << ( 8*len ) ) - 1UL : ~0UL;
+            } else {
+              pfx = jpath_pfx( txt+1, len );
+            }
+            uint32_t pidx = jp_->find( pst_.back(), txt+1, len, pfx );
+            pkey_ = pidx ? pidx : PC_JPATH_NONE;
+          }
+        } else {
+          if ( has_path ) {
+            set_val_path( get_val_path(), nv_.size() );
           }
+          parse_string( txt+1, etxt );
         }
         break;
       }
-
-      case e_keyword:{
-        for(;;++cptr) {
-          if ( cptr==end ) return;
-          if (!isalpha(*cptr) ) {
-            st = e_start; parse_keyword( txt, cptr ); break;
-          }
+      default: {
+        if ( has_path ) {
+          uint32_t pidx = get_val_path(), val = nv_.size();
+          if ( !parse_scalar( txt, end ) ) return;
+          set_val_path( pidx, val );
+        } else if ( !parse_scalar( txt, end ) ) {
+          return;
         }
         break;
       }
@@ -1,12 +1,53 @@
 #pragma once
 
 #include <pc/misc.hpp>
+#include <string>
 #include <vector>
 #include <stdint.h>
 
 namespace pc
 {
-  // light-weight json parse tree
+  // set of json paths compiled into a key trie. a path is a sequence of
+  // object keys separated by '.' (e.g. "params.result.context.slot").
+  // a jtree parsing with a path set records the value of every path as
+  // it is built so that values are read without scanning object keys
+  class jpath
+  {
+  public:
+    jpath();
+
+    // add path. paths are numbered from zero in order of addition
+    unsigned add( str path );
+    unsigned get_num_path() const;
+
+  private:
+    friend class jtree;
+
+    struct node {
+      std::string key_;    // object key
+      uint64_t    pfx_;    // first 8 bytes of key (zero padded)
+      uint32_t    parent_; // parent node
+      uint32_t    first_;  // first child (0 if none)
+      uint32_t    next_;   // next sibling (0 if none)
+      uint32_t    path_;   // path id + 1 (0 if no path ends here)
+    };
+
+    typedef std::vector<node>     node_vec_t;
+    typedef std::vector<uint32_t> path_vec_t;
+
+    // child of node with key (or 0)
+    uint32_t find( uint32_t, const char *, size_t ) const;
+    uint32_t find( uint32_t, const char *, size_t, uint64_t pfx ) const;
+
+    node_vec_t nv_;  // trie nodes (root at zero)
+    path_vec_t pv_;  // end node by path id
+  };
+
+  // light-weight json parse tree. parsing runs in two stages: a simd
+  // pass classifies 64 bytes at a time into an index of structural
+  // characters, string quotes and starts of numbers and keywords outside
+  // of strings, then the tree is built from the index alone so that
+  // string contents are never visited byte by byte
   class jtree
   {
   public:
@@ -18,12 +59,30 @@ namespace pc
       e_val
     } type_t;
 
+    // structural index kernels. the widest one supported by the cpu is
+    // chosen at startup
+    typedef enum { e_scalar = 0, e_sse2, e_avx2, e_num_impl } impl_t;
+
     jtree();
 
     // parse message
     void parse( const char *, size_t );
     bool is_valid() const;
 
+    // resolve paths of set while parsing (null for none). the set must
+    // outlive the tree
+    void set_path( const jpath * );
+
+    // value of path in set or 0 if not present. resolved during parse if
+    // the tree uses the set or else looked up key by key
+    uint32_t find_path( const jpath&, unsigned id ) const;
+
+    // override kernel selection. returns false if cpu lacks support
+    static bool set_impl( impl_t );
+    static impl_t get_impl();
+    static bool get_has_impl( impl_t );
+    static const char *get_impl_name( impl_t );
+
     // get first element in tree
     type_t   get_type( uint32_t ) const;
     uint32_t get_next( uint32_t ) const;
@@ -73,18 +132,35 @@ namespace pc
     void add( uint32_t );
     void add_obj( uint32_t );
     void add_arr( uint32_t );
+    size_t build_index( const char *, size_t );
+    bool parse_scalar( const char *&, const char * );
+    template<bool has_path>
+    void parse_index( const char *, size_t, const char * );
+    uint32_t get_val_path();
+    void set_val_path( uint32_t, uint32_t );
 
     typedef std::vector<node>     node_vec_t;
     typedef std::vector<uint32_t> stack_t;
+    typedef std::vector<uint32_t> index_t;
     node_vec_t nv_;
     stack_t    st_;
+    index_t    ix_;
     uint32_t   key_;
     const char*buf_;
+    const jpath *jp_;   // path set resolved during parse
+    stack_t    pst_;    // path trie node of objects in st_
+    index_t    pv_;     // value by path id
+    uint32_t   pkey_;   // path trie node of current key
   };
 
   ///////////////////////////////////////////////////////////////////////
   // inline implementation
 
+  inline unsigned jpath::get_num_path() const
+  {
+    return pv_.size();
+  }
+
   inline jtree::type_t jtree::get_type( uint32_t i ) const
   {
     return (type_t)nv_[i].type_;
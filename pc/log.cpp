@@ -82,7 +82,7 @@ void log_impl::stop()
   for( net_buf *ptr: reuse_ ) {
     while( ptr ) {
       net_buf *nxt = ptr->next_;
-      delete ptr;
+      ptr->dealloc();
       ptr = nxt;
     }
   }
@@ -176,16 +176,12 @@ static int log_pid = getpid();
 
 void log_wtr::add_i64( int64_t val )
 {
-  char *buf = reserve( 32 );
-  sprintf( buf, "%ld", val );
-  advance( __builtin_strlen( buf ) );
+  advance( int_to_buf( val, reserve( 21 ) ) );
 }
 
 void log_wtr::add_u64( uint64_t val )
 {
-  char *buf = reserve( 32 );
-  sprintf( buf, "%lu", val );
-  advance( __builtin_strlen( buf ) );
+  advance( uint_to_buf( val, reserve( 20 ) ) );
 }
 
 void log_wtr::add_f64( double val )
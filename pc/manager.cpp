@@ -1,5 +1,6 @@
 #include "manager.hpp"
 #include "log.hpp"
+#include <algorithm>
 
 using namespace pc;
 
@@ -52,20 +53,48 @@ manager::manager()
   num_sub_( 0 ),
   kidx_( (unsigned)-1 ),
   cts_( 0L ),
+  its_( 0L ),
   ctimeout_( PC_NSECS_IN_SEC ),
   slot_( 0UL ),
   slot_cnt_( 0UL ),
   curr_ts_( 0L ),
   pub_ts_( 0L ),
   pub_int_( PC_PUB_INTERVAL ),
+  zcpy_( 0 ),
+  uhwm_( user::default_send_hwm ),
+  umax_( user::default_send_max ),
+  uzlvl_( -1 ),
+  nhconn_( 1 ),
+  nwrk_( 0 ),
+  nhedge_( 0 ),
   wait_conn_( false ),
   do_cap_( false ),
   do_tx_( true ),
-  is_pub_( false )
+  is_pub_( false ),
+  uconf_( true ),
+  do_snap_( false ),
+  is_snap_( false ),
+  nsnap_( 0 )
 {
   tconn_.set_sub( this );
   breq_->set_sub( this );
   sreq_->set_sub( this );
+  prof_[net_profile::e_tx].nodelay_ = true;
+  prof_[net_profile::e_user].nodelay_ = true;
+  __builtin_memset( arr_, 0, sizeof( arr_ ) );
+  for( unsigned i=0; i != 3; ++i ) {
+    // match account header up to the account type
+    pc_acc_t hdr = { PC_MAGIC, PC_VERSION, PC_ACCTYPE_MAPPING+i, 0 };
+    greq_[i].add_filter( 0, &hdr, offsetof( pc_acc_t, size_ ) );
+    greq_[i].set_sub( this );
+  }
+  for( unsigned i=0; i != PC_RPC_MAX_HEDGE; ++i ) {
+    rpc_hedge& h = hedge_[i];
+    h.sreq_->set_sub( this );
+    h.cts_ = 0L;
+    h.ctimeout_ = PC_NSECS_IN_SEC;
+    h.is_conn_ = false;
+  }
 }
 
 manager::~manager()
@@ -90,7 +119,10 @@ void manager::del_map_sub()
 {
   if ( --num_sub_ <= 0 && !has_status( PC_PYTH_HAS_MAPPING ) ) {
     set_status( PC_PYTH_HAS_MAPPING );
-    PC_LOG_INF( "completed_mapping_init" ).end();
+    PC_LOG_INF( "completed_mapping_init" )
+      .add( "num_products", svec_.size() )
+      .add( "init_time(ms)", (get_now() - its_)/PC_NSECS_IN_MSEC )
+      .end();
     // notify user that initialization is complete
     if ( sub_ ) {
       sub_->on_init( this );
@@ -108,6 +140,67 @@ std::string manager::get_rpc_host() const
   return rhost_;
 }
 
+void manager::add_rpc_hedge_host( const std::string& rhost )
+{
+  if ( nhedge_ < PC_RPC_MAX_HEDGE ) {
+    hedge_[nhedge_++].host_ = rhost;
+  }
+}
+
+unsigned manager::get_num_rpc_hedge() const
+{
+  return nhedge_;
+}
+
+std::string manager::get_rpc_hedge_host( unsigned i ) const
+{
+  return hedge_[i].host_;
+}
+
+unsigned manager::get_num_rpc_endpoint() const
+{
+  return 1 + nhedge_;
+}
+
+void manager::get_rpc_endpoint_stats( unsigned i,
+                                      rpc_endpoint_stats& st ) const
+{
+  const rpc_arrival& a = arr_[i];
+  st.num_first_ = a.nfirst_;
+  st.num_late_  = a.nlate_;
+  st.lag_avg_   = a.nlag_ ? a.lsum_ / (int64_t)a.nlag_ : 0L;
+  st.lag_max_   = a.lmax_;
+}
+
+void manager::add_rpc_first( unsigned ep )
+{
+  arr_[ep].nfirst_++;
+}
+
+void manager::add_rpc_late( unsigned ep )
+{
+  arr_[ep].nlate_++;
+}
+
+void manager::add_rpc_late( unsigned ep, int64_t lag )
+{
+  rpc_arrival& a = arr_[ep];
+  a.nlate_++;
+  a.nlag_++;
+  a.lsum_ += lag;
+  a.lmax_ = std::max( a.lmax_, lag );
+}
+
+void manager::subscribe_hedge( price *px )
+{
+  for( unsigned i=0; i != nhedge_; ++i ) {
+    rpc_hedge& h = hedge_[i];
+    if ( h.is_conn_ ) {
+      px->subscribe_hedge( 1+i, &h.clnt_ );
+    }
+  }
+}
+
 void manager::set_tx_host( const std::string& thost )
 {
   thost_ = thost;
@@ -138,6 +231,26 @@ std::string manager::get_capture_file() const
   return cap_.get_file();
 }
 
+void manager::set_price_table_file( const std::string& file )
+{
+  ptab_.set_file( file );
+}
+
+std::string manager::get_price_table_file() const
+{
+  return ptab_.get_file();
+}
+
+void manager::set_do_snapshot( bool do_snap )
+{
+  do_snap_ = do_snap;
+}
+
+bool manager::get_do_snapshot() const
+{
+  return do_snap_;
+}
+
 void manager::set_publish_interval( int64_t pub_int )
 {
   pub_int_ = pub_int * PC_NSECS_IN_MSEC;
@@ -148,6 +261,93 @@ int64_t manager::get_publish_interval() const
   return pub_int_ / PC_NSECS_IN_MSEC;
 }
 
+void manager::set_use_uring( bool use_uring )
+{
+  nl_.set_use_uring( use_uring );
+}
+
+bool manager::get_use_uring() const
+{
+  return nl_.get_use_uring();
+}
+
+void manager::set_num_worker( unsigned nwrk )
+{
+  nwrk_ = nwrk;
+}
+
+unsigned manager::get_num_worker() const
+{
+  return nwrk_;
+}
+
+void manager::set_num_http_conn( unsigned num )
+{
+  nhconn_ = std::max( 1U, std::min( num, (unsigned)PC_RPC_HTTP_MAX_CONN ) );
+}
+
+unsigned manager::get_num_http_conn() const
+{
+  return nhconn_;
+}
+
+void manager::set_zero_copy( size_t zcpy )
+{
+  zcpy_ = zcpy;
+}
+
+size_t manager::get_zero_copy() const
+{
+  return zcpy_;
+}
+
+void manager::set_user_send_limit( size_t hwm, size_t max )
+{
+  uhwm_ = hwm;
+  umax_ = std::max( hwm, max );
+}
+
+size_t manager::get_user_send_hwm() const
+{
+  return uhwm_;
+}
+
+size_t manager::get_user_send_max() const
+{
+  return umax_;
+}
+
+void manager::set_user_conflate( bool conf )
+{
+  uconf_ = conf;
+}
+
+bool manager::get_user_conflate() const
+{
+  return uconf_;
+}
+
+void manager::set_user_deflate_level( int zlvl )
+{
+  uzlvl_ = zlvl;
+}
+
+int manager::get_user_deflate_level() const
+{
+  return uzlvl_;
+}
+
+void manager::set_net_profile( net_profile::role_t role,
+                               const net_profile& prof )
+{
+  prof_[role] = prof;
+}
+
+const net_profile& manager::get_net_profile( net_profile::role_t role ) const
+{
+  return prof_[role];
+}
+
 void manager::set_do_capture( bool do_cap )
 {
   do_cap_ = do_cap;
@@ -168,14 +368,39 @@ int manager::get_listen_port() const
   return lsvr_.get_port();
 }
 
+void manager::set_listen_path( const std::string& path )
+{
+  usvr_.set_path( path );
+}
+
+std::string manager::get_listen_path() const
+{
+  return usvr_.get_path();
+}
+
+bool manager::get_is_listen() const
+{
+  return lsvr_.get_port() > 0 || !usvr_.get_path().empty();
+}
+
 void manager::set_content_dir( const std::string& cdir )
 {
-  cdir_ = cdir;
+  wc_.set_dir( cdir );
 }
 
 std::string manager::get_content_dir() const
 {
-  return cdir_;
+  return wc_.get_dir();
+}
+
+web_content_ptr manager::get_web_content() const
+{
+  return wc_.get_content();
+}
+
+price_notify& manager::get_price_notify()
+{
+  return pnot_;
 }
 
 void manager::set_manager_sub( manager_sub *sub )
@@ -214,6 +439,13 @@ void manager::teardown()
 
   // shutdown listener
   lsvr_.close();
+  usvr_.teardown();
+  wc_.teardown();
+
+  // stop user worker threads. their users are destroyed below
+  for( user_worker *wptr: wvec_ ) {
+    wptr->teardown();
+  }
 
   // destroy any open users
   while( !olist_.empty() ) {
@@ -222,10 +454,35 @@ void manager::teardown()
     dlist_.add( usr );
   }
   teardown_users();
+  for( user_worker *wptr: wvec_ ) {
+    delete wptr;
+  }
+  wvec_.clear();
+  wk_.close();
 
   // destroy rpc connections
-  hconn_.close();
+  log_http_stats();
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    hconn_[i].close();
+  }
   wconn_.close();
+  for( unsigned i=0; i != nhedge_; ++i ) {
+    hedge_[i].wconn_.close();
+    hedge_[i].is_conn_ = false;
+  }
+
+  // buffer allocator usage
+  for( unsigned cls=0; cls != net_buf::num_class; ++cls ) {
+    net_buf_stats st;
+    net_buf::get_stats( cls, st );
+    PC_LOG_DBG( "net_buf_stats" )
+      .add( "capacity", (uint32_t)net_buf::get_class_capacity( cls ) )
+      .add( "live", st.live_ )
+      .add( "free", st.free_ )
+      .add( "peak", st.peak_ )
+      .add( "sys_bytes", st.sys_ )
+      .end();
+  }
 }
 
 bool manager::init()
@@ -254,10 +511,41 @@ bool manager::init()
     return set_err_msg( cap_.get_err_msg() );
   }
 
+  // initialize shared-memory price table
+  if ( !ptab_.get_file().empty() ) {
+    if ( !ptab_.init() ) {
+      return set_err_msg( ptab_.get_err_msg() );
+    }
+    PC_LOG_INF( "price_table" )
+      .add( "file", ptab_.get_file() )
+      .add( "num_slot", ptab_.get_num_slot() )
+      .end();
+  }
+
   // initialize net_loop
   if ( !nl_.init() ) {
     return set_err_msg( nl_.get_err_msg() );
   }
+  if ( nl_.get_use_uring() && !nl_.get_is_uring() ) {
+    PC_LOG_WRN( "io_uring unavailable - using epoll" ).end();
+  }
+
+  // start user worker threads
+  if ( nwrk_ ) {
+    wk_.set_net_loop( &nl_ );
+    wk_.set_sub( this );
+    if ( !wk_.init() ) {
+      return set_err_msg( wk_.get_err_msg() );
+    }
+    for( unsigned i=0; i != nwrk_; ++i ) {
+      user_worker *wptr = new user_worker;
+      wvec_.push_back( wptr );
+      wptr->set_use_uring( nl_.get_use_uring() );
+      if ( !wptr->init( &wk_ ) ) {
+        return set_err_msg( wptr->get_err_msg() );
+      }
+    }
+  }
 
   // decompose rpc_host into host:port
   int rport =0, wport = 0;
@@ -265,21 +553,38 @@ bool manager::init()
   if ( rport == 0 ) rport = PC_RPC_HTTP_PORT;
   if ( wport == 0 ) wport = rport+1;
 
-  // add rpc_client connection to net_loop and initialize
-  hconn_.set_port( rport );
-  hconn_.set_host( rhost );
-  hconn_.set_net_loop( &nl_ );
-  clnt_.set_http_conn( &hconn_ );
+  // add rpc_client connections to net_loop and initialize
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    tcp_connect& hconn = hconn_[i];
+    hconn.set_port( rport );
+    hconn.set_host( rhost );
+    hconn.set_net_loop( &nl_ );
+    hconn.set_net_profile( prof_[net_profile::e_rpc_http] );
+    if ( i == 0 ) {
+      clnt_.set_http_conn( &hconn );
+    } else {
+      clnt_.add_http_conn( &hconn );
+    }
+  }
   wconn_.set_port( wport );
   wconn_.set_host( rhost );
   wconn_.set_net_loop( &nl_ );
+  wconn_.set_net_profile( prof_[net_profile::e_rpc_ws] );
   clnt_.set_ws_conn( &wconn_ );
-  if ( !hconn_.init() ) {
-    return set_err_msg( hconn_.get_err_msg() );
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    if ( !hconn_[i].init() ) {
+      return set_err_msg( hconn_[i].get_err_msg() );
+    }
   }
   if ( !wconn_.init() ) {
     return set_err_msg( wconn_.get_err_msg() );
   }
+
+  // add hedge rpc node connections. these are retried in the background
+  for( unsigned i=0; i != nhedge_; ++i ) {
+    init_hedge( hedge_[i] );
+  }
+
   // connect to pyth_tx server
   if ( do_tx_ ) {
     int tport1 = 0, tport2 = 0;
@@ -287,26 +592,47 @@ bool manager::init()
     tconn_.set_port( tport1 ? tport1 : PC_TPU_PROXY_PORT );
     tconn_.set_host( thost );
     tconn_.set_net_loop( &nl_ );
+    tconn_.set_net_profile( prof_[net_profile::e_tx] );
     if ( !tconn_.init() ) {
       return set_err_msg( tconn_.get_err_msg() );
     }
   }
   wait_conn_ = true;
 
-  // initialize listening port if port defined
+  // initialize listening port and/or socket if defined
   if ( lsvr_.get_port() > 0 ) {
     lsvr_.set_net_accept( this );
     lsvr_.set_net_loop( &nl_ );
     if ( !lsvr_.init() ) {
       return set_err_msg( lsvr_.get_err_msg() );
     }
+  }
+  if ( !usvr_.get_path().empty() ) {
+    usvr_.set_net_accept( this );
+    usvr_.set_net_loop( &nl_ );
+    if ( !usvr_.init() ) {
+      return set_err_msg( usvr_.get_err_msg() );
+    }
+  }
+  if ( get_is_listen() ) {
+    // missing content is served as not found
+    wc_.set_net_loop( &nl_ );
+    if ( !wc_.init() ) {
+      PC_LOG_WRN( "failed to load content" )
+        .add( "content_dir", get_content_dir() )
+        .add( "error", wc_.get_err_msg() )
+        .end();
+    }
     PC_LOG_INF("listening").add("port",lsvr_.get_port())
+      .add( "path", usvr_.get_path() )
       .add( "content_dir", get_content_dir() )
+      .add( "user_profile", prof_[net_profile::e_user].to_str() )
       .end();
   }
   PC_LOG_INF( "initialized" )
     .add( "version", PC_VERSION )
     .add( "capture_file", get_capture_file() )
+    .add( "price_table_file", get_price_table_file() )
     .add( "publish_interval(ms)", get_publish_interval() )
     .end();
 
@@ -364,39 +690,75 @@ void manager::reset_status( int status )
   status_ &= ~status;
 }
 
+bool manager::poll_submit()
+{
+  // submit pending requests
+  bool is_sub = false;
+  for( request *rptr =plist_.first(); rptr; ) {
+    request *nxt = rptr->get_next();
+    if ( rptr->get_is_ready() ) {
+      plist_.del( rptr );
+      rptr->submit();
+      is_sub = true;
+    }
+    rptr = nxt;
+  }
+  return is_sub;
+}
+
 void manager::poll( bool do_wait )
 {
-  // poll for any socket events
+  // submit pending requests
+  poll_submit();
+
+  // poll for any socket events or timer expiry
   if ( do_wait ) {
-    nl_.poll( 1 );
+    nl_.poll( -1 );
+  } else if ( nl_.get_is_uring() ) {
+    nl_.poll( 0 );
   } else {
+    nl_.poll_timer();
     if ( has_status( PC_PYTH_RPC_CONNECTED ) ) {
-      hconn_.poll();
+      for( unsigned i=0; i != nhconn_; ++i ) {
+        hconn_[i].poll();
+      }
       wconn_.poll();
+    } else {
+      // host resolution and connect progress are only delivered by
+      // loop events
+      nl_.poll( 0 );
+    }
+    for( unsigned i=0; i != nhedge_; ++i ) {
+      if ( hedge_[i].is_conn_ ) {
+        hedge_[i].wconn_.poll();
+      }
     }
     if ( do_tx_ ) {
       tconn_.poll();
     }
-    if ( lsvr_.get_port() ) {
-      lsvr_.poll();
-      for( user *uptr = olist_.first(); uptr; ) {
-        user *nptr = uptr->get_next();
-        uptr->poll();
-        uptr = nptr;
+    if ( get_is_listen() ) {
+      if ( lsvr_.get_fd() >= 0 ) {
+        lsvr_.poll();
+      }
+      if ( usvr_.get_fd() >= 0 ) {
+        usvr_.poll();
+      }
+      wc_.poll();
+      if ( wvec_.empty() ) {
+        for( user *uptr = olist_.first(); uptr; ) {
+          user *nptr = uptr->get_next();
+          uptr->poll();
+          if ( uptr->net_connect::get_is_err() ) {
+            uptr->teardown();
+          }
+          uptr = nptr;
+        }
+      } else {
+        on_wakeup();
       }
     }
   }
 
-  // submit pending requests
-  for( request *rptr =plist_.first(); rptr; ) {
-    request *nxt = rptr->get_next();
-    if ( rptr->get_is_ready() ) {
-      plist_.del( rptr );
-      rptr->submit();
-    }
-    rptr = nxt;
-  }
-
   // destroy any users scheduled for deletion
   teardown_users();
 
@@ -410,21 +772,90 @@ void manager::poll( bool do_wait )
 
   // submit new quotes while connected
   if ( has_status( PC_PYTH_RPC_CONNECTED ) &&
-       !hconn_.get_is_err() &&
+       !get_is_http_err() &&
        !wconn_.get_is_err() ) {
     poll_schedule();
   } else {
     reconnect_rpc();
   }
+
+  // (re)connect and subscribe hedge rpc nodes
+  if ( nhedge_ ) {
+    poll_hedge();
+  }
+
+  // wake up for next scheduled event
+  arm_timer();
+
+  // hand queued responses and notifications to user workers
+  for( user_worker *wptr: wvec_ ) {
+    wptr->flush();
+  }
+}
+
+void manager::on_wakeup()
+{
+  for( user_worker *wptr: wvec_ ) {
+    wptr->poll_recv();
+  }
+}
+
+void manager::on_timer()
+{
+  // publish on time rather than on the next poll
+  curr_ts_ = get_now();
+  if ( has_status( PC_PYTH_RPC_CONNECTED ) &&
+       !get_is_http_err() &&
+       !wconn_.get_is_err() ) {
+    poll_schedule();
+  }
+}
+
+void manager::arm_timer()
+{
+  // next price to publish or rpc reconnect. connection progress is
+  // delivered by loop events so needs no timer
+  int64_t ts = 0L;
+  if ( has_status( PC_PYTH_RPC_CONNECTED ) ) {
+    if ( is_pub_ && kidx_ < kvec_.size() ) {
+      ts = get_pub_time( kvec_[kidx_] );
+    }
+  } else if ( !get_is_http_wait() && !wconn_.get_is_wait() ) {
+    ts = cts_ + ctimeout_;
+  }
+
+  // tx proxy reconnect
+  if ( do_tx_ && !tconn_.get_is_wait() &&
+       ( !tconn_.get_is_connect() || tconn_.get_is_err() ) ) {
+    int64_t tts = tconn_.get_reconnect_time();
+    ts = ts ? std::min( ts, tts ) : tts;
+  }
+
+  // hedge rpc node reconnect
+  for( unsigned i=0; i != nhedge_; ++i ) {
+    rpc_hedge& h = hedge_[i];
+    if ( h.wconn_.get_is_err() && !h.wconn_.get_is_wait() ) {
+      int64_t hts = h.cts_ + h.ctimeout_;
+      ts = ts ? std::min( ts, hts ) : hts;
+    }
+  }
+  if ( !ts ) {
+    nl_.del_timer( this );
+  } else if ( !get_is_active() || ts != get_expiry() ) {
+    nl_.add_timer( this, ts );
+  }
+}
+
+int64_t manager::get_pub_time( price_sched *kptr ) const
+{
+  return pub_ts_ + ( pub_int_ * kptr->get_hash() ) / price_sched::fraction;
 }
 
 void manager::poll_schedule()
 {
   while ( is_pub_ && kidx_ < kvec_.size() ) {
     price_sched *kptr = kvec_[kidx_];
-    int64_t pub_ts = pub_ts_ + ( pub_int_ * kptr->get_hash() ) /
-      price_sched::fraction;
-    if ( curr_ts_ > pub_ts ) {
+    if ( curr_ts_ > get_pub_time( kptr ) ) {
       kptr->schedule();
       if ( ++kidx_ >= kvec_.size() ) {
         is_pub_ = false;
@@ -438,22 +869,29 @@ void manager::poll_schedule()
 void manager::reconnect_rpc()
 {
   // check if connection process has complete
-  if ( hconn_.get_is_wait() ) {
-    hconn_.check();
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    if ( hconn_[i].get_is_wait() ) {
+      hconn_[i].check();
+    }
   }
   if ( wconn_.get_is_wait() ) {
     wconn_.check();
   }
-  if ( hconn_.get_is_wait() || wconn_.get_is_wait() ) {
+  if ( get_is_http_wait() || wconn_.get_is_wait() ) {
     return;
   }
 
   // check for successful (re)connect
-  if ( !hconn_.get_is_err() && !wconn_.get_is_err() ) {
-    PC_LOG_INF( "rpc_connected" ).end();
+  if ( !get_is_http_err() && !wconn_.get_is_err() ) {
+    PC_LOG_INF( "rpc_connected" )
+      .add( "num_http_conn", nhconn_ )
+      .add( "http_profile", hconn_[0].get_net_profile().to_str() )
+      .add( "ws_profile", wconn_.get_net_profile().to_str() )
+      .end();
     set_status( PC_PYTH_RPC_CONNECTED );
 
     // reset state
+    its_ = get_now();
     wait_conn_ = false;
     is_pub_ = false;
     kidx_ = 0;
@@ -462,6 +900,12 @@ void manager::reconnect_rpc()
     slot_cnt_ = 0UL;
     slot_ = 0L;
     num_sub_ = 0;
+    nsnap_ = 0;
+    if ( is_snap_ ) {
+      PC_LOG_WRN( "program snapshot discarded - walking mapping accounts" )
+        .end();
+    }
+    release_snapshot();
     clnt_.reset();
     plist_.clear();
 
@@ -489,7 +933,11 @@ void manager::reconnect_rpc()
     // subscribe to mapping account if not done before
     pub_key *mpub = get_mapping_pub_key();
     if ( mvec_.empty() && mpub ) {
-      add_mapping( *mpub );
+      if ( do_snap_ && get_program_pub_key() ) {
+        init_snapshot();
+      } else {
+        add_mapping( *mpub );
+      }
     }
 
     // callback user with connection status
@@ -520,25 +968,165 @@ void manager::reconnect_rpc()
   ctimeout_ += ctimeout_;
   ctimeout_ = std::min( ctimeout_, PC_RECONNECT_TIMEOUT );
   wait_conn_ = true;
-  hconn_.init();
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    hconn_[i].init();
+  }
   wconn_.init();
 }
 
-void manager::log_disconnect()
+void manager::init_hedge( rpc_hedge& h )
 {
-  if ( hconn_.get_is_err() ) {
-    PC_LOG_ERR( "rpc_http_reset")
-      .add( "error", hconn_.get_err_msg() )
-      .add( "host", rhost_ )
-      .add( "port", hconn_.get_port() )
+  int rport =0, wport = 0;
+  std::string rhost = get_host_port( h.host_, rport, wport );
+  if ( rport == 0 ) rport = PC_RPC_HTTP_PORT;
+  if ( wport == 0 ) wport = rport+1;
+  h.wconn_.set_port( wport );
+  h.wconn_.set_host( rhost );
+  h.wconn_.set_net_loop( &nl_ );
+  h.wconn_.set_net_profile( prof_[net_profile::e_rpc_ws] );
+  h.clnt_.set_ws_conn( &h.wconn_ );
+  h.cts_ = get_now();
+  if ( !h.wconn_.init() ) {
+    PC_LOG_WRN( "rpc_hedge_init_failed" )
+      .add( "host", h.host_ )
+      .add( "error", h.wconn_.get_err_msg() )
+      .end();
+  }
+}
+
+void manager::poll_hedge()
+{
+  for( unsigned i=0; i != nhedge_; ++i ) {
+    rpc_hedge& h = hedge_[i];
+    ws_connect& wconn = h.wconn_;
+
+    // back off and reconnect after error
+    if ( wconn.get_is_err() ) {
+      if ( h.is_conn_ ) {
+        h.is_conn_ = false;
+        PC_LOG_ERR( "rpc_hedge_reset" )
+          .add( "error", wconn.get_err_msg() )
+          .add( "host", h.host_ )
+          .add( "port", wconn.get_port() )
+          .end();
+      }
+      int64_t ts = get_now();
+      if ( h.ctimeout_ > (ts-h.cts_) ) {
+        continue;
+      }
+      h.cts_ = ts;
+      h.ctimeout_ += h.ctimeout_;
+      h.ctimeout_ = std::min( h.ctimeout_, PC_RECONNECT_TIMEOUT );
+      wconn.init();
+      continue;
+    }
+
+    // check if connection process has completed
+    if ( wconn.get_is_wait() ) {
+      wconn.check();
+      continue;
+    }
+
+    // subscribe to slots and all known prices once connected. prices
+    // found later subscribe as they are added
+    if ( h.is_conn_ || !has_status( PC_PYTH_RPC_CONNECTED ) ) {
+      continue;
+    }
+    h.is_conn_ = true;
+    h.ctimeout_ = PC_NSECS_IN_SEC;
+    h.clnt_.reset();
+    h.clnt_.send( h.sreq_ );
+    unsigned num_price = 0;
+    for( product *ptr: svec_ ) {
+      for( unsigned j=0; j != ptr->get_num_price(); ++j ) {
+        price *qptr = ptr->get_price( j );
+        qptr->reset_hedge( 1+i );
+        if ( qptr->get_is_done() ) {
+          qptr->subscribe_hedge( 1+i, &h.clnt_ );
+          ++num_price;
+        }
+      }
+    }
+    PC_LOG_INF( "rpc_hedge_connected" )
+      .add( "host", h.host_ )
+      .add( "port", wconn.get_port() )
+      .add( "num_price", num_price )
       .end();
-    return;
+  }
+}
+
+bool manager::get_is_http_err() const
+{
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    if ( hconn_[i].get_is_err() ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool manager::get_is_http_wait()
+{
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    if ( hconn_[i].get_is_wait() ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void manager::log_http_stats()
+{
+  for( unsigned i=0; i != clnt_.get_num_http_conn(); ++i ) {
+    rpc_http_stats st;
+    clnt_.get_http_stats( i, st );
+    PC_LOG_DBG( "rpc_http_stats" )
+      .add( "conn", i )
+      .add( "num_req", st.num_req_ )
+      .add( "num_resp", st.num_resp_ )
+      .add( "num_out", st.num_out_ )
+      .add( "lat_avg(ns)", st.lat_avg_ )
+      .add( "lat_max(ns)", st.lat_max_ )
+      .end();
+  }
+  PC_LOG_DBG( "rpc_notify_stats" )
+    .add( "num_fast", clnt_.get_num_notify_fast() )
+    .add( "num_slow", clnt_.get_num_notify_slow() )
+    .end();
+  for( unsigned i=0; nhedge_ && i != 1+nhedge_; ++i ) {
+    rpc_endpoint_stats st;
+    get_rpc_endpoint_stats( i, st );
+    PC_LOG_DBG( "rpc_endpoint_stats" )
+      .add( "host", i ? hedge_[i-1].host_ : rhost_ )
+      .add( "num_first", st.num_first_ )
+      .add( "num_late", st.num_late_ )
+      .add( "lag_avg(ns)", st.lag_avg_ )
+      .add( "lag_max(ns)", st.lag_max_ )
+      .end();
+  }
+}
+
+void manager::log_disconnect()
+{
+  for( unsigned i=0; i != nhconn_; ++i ) {
+    if ( hconn_[i].get_is_err() ) {
+      PC_LOG_ERR( "rpc_http_reset")
+        .add( "error", hconn_[i].get_err_msg() )
+        .add( "host", rhost_ )
+        .add( "port", hconn_[i].get_port() )
+        .add( "conn", i )
+        .end();
+      log_http_stats();
+      return;
+    }
   }
   if ( wconn_.get_is_err() ) {
     PC_LOG_ERR( "rpc_websocket_reset" )
       .add( "error", wconn_.get_err_msg() )
       .add( "host", rhost_ )
       .add( "port", wconn_.get_port() )
+      .add( "recv_hwm", wconn_.get_recv_hwm() )
+      .add( "recv_cap_hwm", wconn_.get_recv_cap_hwm() )
       .end();
     return;
   }
@@ -548,10 +1136,32 @@ void manager::teardown_users()
 {
   while( !dlist_.empty() ) {
     user *usr = dlist_.first();
-    PC_LOG_DBG( "delete_user" ).add("fd", usr->get_fd() ).end();
-    usr->close();
+    PC_LOG_DBG( "delete_user" )
+      .add( "fd", usr->get_fd() )
+      .add( "num_flush", usr->get_num_flush() )
+      .add( "num_send", usr->get_num_send() )
+      .add( "num_send_bytes", usr->get_num_send_bytes() )
+      .add( "recv_hwm", usr->get_recv_hwm() )
+      .add( "recv_cap_hwm", usr->get_recv_cap_hwm() )
+      .add( "num_conflated", usr->get_num_conflated() )
+      .add( "num_dropped", usr->get_num_dropped() )
+      .end();
+    ws_deflate *zp = usr->get_deflate();
+    if ( zp ) {
+      PC_LOG_DBG( "user_deflate_stats" )
+        .add( "fd", usr->get_fd() )
+        .add( "raw_bytes", zp->get_num_raw_bytes() )
+        .add( "deflate_bytes", zp->get_num_cmp_bytes() )
+        .end();
+    }
     dlist_.del( usr );
-    delete usr;
+    user_worker *wptr = usr->get_user_worker();
+    if ( wptr && wptr->get_is_run() ) {
+      wptr->del_user( usr );
+    } else {
+      usr->close();
+      delete usr;
+    }
   }
 }
 
@@ -564,6 +1174,36 @@ void manager::accept( int fd )
   usr->set_manager( this );
   usr->set_fd( fd );
   usr->set_block( false );
+  usr->set_zero_copy( zcpy_ );
+  usr->set_send_limit( uhwm_, umax_ );
+  usr->set_conflate( uconf_ );
+  usr->set_deflate_level( uzlvl_ );
+  usr->set_net_profile( prof_[net_profile::e_user] );
+  if ( !usr->apply_net_profile() ) {
+    PC_LOG_WRN( "failed to apply user net profile" )
+      .add( "fd", fd )
+      .add( "profile", prof_[net_profile::e_user].to_str() )
+      .end();
+  }
+
+  // hand connection to least loaded worker thread
+  if ( !wvec_.empty() ) {
+    unsigned widx = 0;
+    for( unsigned i=1; i != wvec_.size(); ++i ) {
+      if ( wvec_[i]->get_num_user() < wvec_[widx]->get_num_user() ) {
+        widx = i;
+      }
+    }
+    user_worker *wptr = wvec_[widx];
+    PC_LOG_DBG( "new_user" )
+      .add( "fd", fd )
+      .add( "worker", widx )
+      .end();
+    usr->set_user_worker( wptr );
+    olist_.add( usr );
+    wptr->add_user( usr );
+    return;
+  }
   if ( usr->init() ) {
     PC_LOG_DBG( "new_user" ).add("fd", fd ).end();
     olist_.add( usr );
@@ -592,10 +1232,11 @@ void manager::schedule( price_sched *kptr )
 
 void manager::on_response( rpc::slot_subscribe *res )
 {
-  // ignore slots that go back in time
+  // ignore slots that go back in time (or arrive from a hedge rpc node
+  // while disconnected from the rpc host)
   uint64_t slot = res->get_slot();
   int64_t ts = res->get_recv_time();
-  if ( slot <= slot_ ) {
+  if ( slot <= slot_ || !has_status( PC_PYTH_RPC_CONNECTED ) ) {
     return;
   }
   slot_ = slot;
@@ -619,6 +1260,91 @@ void manager::on_response( rpc::slot_subscribe *res )
   }
 }
 
+void manager::init_snapshot()
+{
+  // request all mapping, product and price accounts at once
+  PC_LOG_INF( "request_program_snapshot" ).end();
+  for( unsigned i=0; i != 3; ++i ) {
+    greq_[i].set_program( get_program_pub_key() );
+    clnt_.send( &greq_[i] );
+  }
+  nsnap_ = 3;
+}
+
+void manager::on_response( rpc::get_program_accounts *res )
+{
+  if ( res->get_is_err() ) {
+    PC_LOG_WRN( "program snapshot request failed" )
+      .add( "error", res->get_err_msg() )
+      .end();
+  }
+  if ( --nsnap_ ) {
+    return;
+  }
+  bool is_err = false;
+  for( unsigned i=0; i != 3; ++i ) {
+    is_err = is_err || greq_[i].get_is_err();
+  }
+  if ( is_err ) {
+    PC_LOG_WRN( "program snapshot unavailable - walking mapping accounts" )
+      .end();
+    release_snapshot();
+  } else {
+    PC_LOG_INF( "program_snapshot" )
+      .add( "slot", greq_[0].get_slot() )
+      .add( "num_mapping", greq_[0].get_num_account() )
+      .add( "num_product", greq_[1].get_num_account() )
+      .add( "num_price", greq_[2].get_num_account() )
+      .add( "time(ms)", (get_now() - its_)/PC_NSECS_IN_MSEC )
+      .end();
+  }
+
+  // build the product and price graph from the snapshot by walking the
+  // mapping chain locally. requests only subscribe to accounts found in
+  // the snapshot and fetch any others. the snapshot is held until the
+  // first block hash lets the walk submit
+  is_snap_ = !is_err;
+  add_mapping( *get_mapping_pub_key() );
+  poll_snapshot();
+}
+
+void manager::poll_snapshot()
+{
+  int status = PC_PYTH_RPC_CONNECTED | PC_PYTH_HAS_BLOCK_HASH;
+  if ( !is_snap_ || !has_status( status ) ) {
+    return;
+  }
+  // walk until no further requests are found in the snapshot
+  while( poll_submit() );
+  PC_LOG_INF( "program_snapshot_walked" )
+    .add( "num_mapping", mvec_.size() )
+    .add( "num_product", svec_.size() )
+    .end();
+  release_snapshot();
+}
+
+void manager::release_snapshot()
+{
+  is_snap_ = false;
+  for( unsigned i=0; i != 3; ++i ) {
+    greq_[i].release();
+  }
+}
+
+rpc::program_account *manager::get_program_account( const pub_key& acc )
+{
+  if ( !is_snap_ ) {
+    return nullptr;
+  }
+  for( unsigned i=0; i != 3; ++i ) {
+    rpc::program_account *aptr = greq_[i].get_account( acc );
+    if ( aptr ) {
+      return aptr;
+    }
+  }
+  return nullptr;
+}
+
 void manager::on_response( rpc::get_recent_block_hash *m )
 {
   if ( m->get_is_err() ) {
@@ -638,6 +1364,8 @@ void manager::on_response( rpc::get_recent_block_hash *m )
     .add( "rount_trip_time(ms)", 1e-6*ack_ts )
     .end();
 
+  // apply any program snapshot received before the block hash
+  poll_snapshot();
 }
 
 void manager::submit( request *req )
@@ -657,7 +1385,9 @@ void manager::submit( tx_request *req )
 void manager::on_connect()
 {
   // callback user with connection status
-  PC_LOG_INF( "pyth_tx_connected" ).end();
+  PC_LOG_INF( "pyth_tx_connected" )
+    .add( "profile", tconn_.get_net_profile().to_str() )
+    .end();
   if ( sub_ ) {
     sub_->on_tx_connect( this );
   }
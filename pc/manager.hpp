@@ -4,20 +4,34 @@
 #include <pc/rpc_client.hpp>
 #include <pc/request.hpp>
 #include <pc/user.hpp>
+#include <pc/web_cache.hpp>
 #include <pc/key_store.hpp>
 #include <pc/dbl_list.hpp>
 #include <pc/hash_map.hpp>
 #include <pc/capture.hpp>
+#include <pc/price_table.hpp>
 
 // status bits
 #define PC_PYTH_RPC_CONNECTED    (1<<0)
 #define PC_PYTH_HAS_BLOCK_HASH   (1<<1)
 #define PC_PYTH_HAS_MAPPING      (1<<2)
 
+// max. rpc http connection pool size
+#define PC_RPC_HTTP_MAX_CONN     8
+
 namespace pc
 {
   class manager;
 
+  // price update arrival statistics of an rpc node
+  struct rpc_endpoint_stats
+  {
+    uint64_t num_first_; // price updates delivered first
+    uint64_t num_late_;  // copies delivered after another node
+    int64_t  lag_avg_;   // mean lag of late copies of a slot (nanoseconds)
+    int64_t  lag_max_;   // worst lag of late copies of a slot (nanoseconds)
+  };
+
   // manager event notification events
   class manager_sub
   {
@@ -47,9 +61,12 @@ namespace pc
   class manager : public key_store,
                   public net_accept,
                   public tx_sub,
+                  public net_timer,
+                  public net_wakeup_sub,
                   public rpc_sub,
                   public rpc_sub_i<rpc::slot_subscribe>,
-                  public rpc_sub_i<rpc::get_recent_block_hash>
+                  public rpc_sub_i<rpc::get_recent_block_hash>,
+                  public rpc_sub_i<rpc::get_program_accounts>
   {
   public:
 
@@ -60,6 +77,19 @@ namespace pc
     void set_rpc_host( const std::string& );
     std::string get_rpc_host() const;
 
+    // additional rpc nodes (host[:rpc_port[:ws_port]]) holding duplicate
+    // slot and price account subscriptions over websocket. each price
+    // update is taken from whichever node delivers it first (max.
+    // PC_RPC_MAX_HEDGE). set before init
+    void add_rpc_hedge_host( const std::string& );
+    unsigned get_num_rpc_hedge() const;
+    std::string get_rpc_hedge_host( unsigned i ) const;
+
+    // arrival statistics by rpc node (0 is the rpc host and i+1 is hedge
+    // node i)
+    unsigned get_num_rpc_endpoint() const;
+    void get_rpc_endpoint_stats( unsigned i, rpc_endpoint_stats& ) const;
+
     // pyth transaction proxy host
     void set_tx_host( const std::string& );
     std::string get_tx_host() const;
@@ -72,10 +102,22 @@ namespace pc
     void set_listen_port( int port );
     int get_listen_port() const;
 
+    // unix domain socket path of user api (abstract if starting with '@')
+    // served alongside or instead of listening port
+    void set_listen_path( const std::string& );
+    std::string get_listen_path() const;
+
     // content directory (for http content requests if running as server)
     void set_content_dir( const std::string& );
     std::string get_content_dir() const;
 
+    // cached responses for content directory (may be called from any
+    // thread)
+    web_content_ptr get_web_content() const;
+
+    // notify_price payload shared by subscribers of an aggregate update
+    price_notify& get_price_notify();
+
     // capture flag (off by default)
     void set_do_capture( bool );
     bool get_do_capture() const;
@@ -84,6 +126,52 @@ namespace pc
     void set_capture_file( const std::string& cap_file );
     std::string get_capture_file() const;
 
+    // shared-memory price table file for local readers (off if empty)
+    void set_price_table_file( const std::string& );
+    std::string get_price_table_file() const;
+
+    // use io_uring based event loop rather than epoll (off by default)
+    void set_use_uring( bool );
+    bool get_use_uring() const;
+
+    // number of worker threads running user connections (0=off). when
+    // off users share the manager's event loop and thread
+    void set_num_worker( unsigned );
+    unsigned get_num_worker() const;
+
+    // number of pipelined rpc http connections (default 1, max.
+    // PC_RPC_HTTP_MAX_CONN). set before init
+    void set_num_http_conn( unsigned );
+    unsigned get_num_http_conn() const;
+
+    // min. message size to send to users using MSG_ZEROCOPY (0=off)
+    void set_zero_copy( size_t );
+    size_t get_zero_copy() const;
+
+    // user send queue high-water mark and disconnect limit in bytes
+    // and whether to conflate notifications above hwm (see user)
+    void set_user_send_limit( size_t hwm, size_t max );
+    size_t get_user_send_hwm() const;
+    size_t get_user_send_max() const;
+    void set_user_conflate( bool );
+    bool get_user_conflate() const;
+
+    // zlib level for permessage-deflate compression of user websocket
+    // messages when offered by the client (-1=off - the default)
+    void set_user_deflate_level( int );
+    int get_user_deflate_level() const;
+
+    // transport options by connection role (set before init). tx proxy
+    // and user connections default to nodelay
+    void set_net_profile( net_profile::role_t, const net_profile& );
+    const net_profile& get_net_profile( net_profile::role_t ) const;
+
+    // bootstrap mapping, product and price accounts from one
+    // getProgramAccounts request per account type instead of walking
+    // the mapping account chain (off by default - needs program key)
+    void set_do_snapshot( bool );
+    bool get_do_snapshot() const;
+
     // override default publish interval (in milliseconds)
     void set_publish_interval( int64_t mill_secs );
     int64_t get_publish_interval() const;
@@ -149,22 +237,60 @@ namespace pc
     // mapping subscription count tracking
     void add_map_sub();
     void del_map_sub();
+
+    // hedge rpc node subscriptions and price update arrival tracking
+    void subscribe_hedge( price * );
+    void add_rpc_first( unsigned ep );
+    void add_rpc_late( unsigned ep );
+    void add_rpc_late( unsigned ep, int64_t lag );
+
     void schedule( price_sched* );
     void write( pc_pub_key_t *, pc_acc_t *ptr );
+    void write( price *, pc_price_t *ptr );
 
     // tx_sub callbacks
     void on_connect() override;
     void on_disconnect() override;
     bool get_is_tx_connect() const;
 
+    // publish schedule and reconnect timer
+    void on_timer() override;
+
+    // user worker messages
+    void on_wakeup() override;
+
     // rpc callbacks
     void on_response( rpc::slot_subscribe * );
     void on_response( rpc::get_recent_block_hash * );
+    void on_response( rpc::get_program_accounts * );
+
+    // account from program snapshot while bootstrapping from it
+    rpc::program_account *get_program_account( const pub_key& );
     void set_status( int );
     get_mapping *get_last_mapping() const;
 
   private:
 
+    // websocket-only connection to a hedge rpc node
+    struct rpc_hedge {
+      std::string         host_;     // rpc host
+      ws_connect          wconn_;    // rpc websocket connection
+      rpc_client          clnt_;     // rpc api
+      rpc::slot_subscribe sreq_[1];  // slot subscription
+      int64_t             cts_;      // (re)connect timestamp
+      int64_t             ctimeout_; // connection timeout
+      bool                is_conn_;  // subscribed on connection
+    };
+
+    // price update arrivals by rpc node
+    struct rpc_arrival {
+      uint64_t nfirst_;   // updates delivered first
+      uint64_t nlate_;    // copies delivered late
+      uint64_t nlag_;     // late copies of the slot last delivered
+      int64_t  lsum_;     // sum of late copy lag
+      int64_t  lmax_;     // max. late copy lag
+    };
+
     struct trait_account {
       static const size_t hsize_ = 8363UL;
       typedef uint32_t        idx_t;
@@ -184,18 +310,35 @@ namespace pc
     typedef std::vector<get_mapping*> map_vec_t;
     typedef std::vector<product*>     spx_vec_t;
     typedef std::vector<price_sched*> kpx_vec_t;
+    typedef std::vector<user_worker*> wrk_vec_t;
     typedef hash_map<trait_account>   acc_map_t;
 
     void reconnect_rpc();
     void log_disconnect();
     void teardown_users();
     void poll_schedule();
+    bool poll_submit();
+    void init_snapshot();
+    void poll_snapshot();
+    void release_snapshot();
+    void arm_timer();
+    int64_t get_pub_time( price_sched * ) const;
     void reset_status( int );
+    bool get_is_listen() const;
+    bool get_is_http_err() const;
+    bool get_is_http_wait();
+    void log_http_stats();
+    void init_hedge( rpc_hedge& );
+    void poll_hedge();
 
     net_loop     nl_;       // epoll loop
-    tcp_connect  hconn_;    // rpc http connection
+    net_wakeup   wk_;       // wakeup by user workers
+    tcp_connect  hconn_[PC_RPC_HTTP_MAX_CONN]; // rpc http connections
     ws_connect   wconn_;    // rpc websocket sonnection
     tcp_listen   lsvr_;     // listening socket
+    unix_listen  usvr_;     // listening unix domain socket
+    web_cache    wc_;       // content directory cache
+    price_notify pnot_;     // shared notify_price payload
     rpc_client   clnt_;     // rpc api
     tx_connect   tconn_;    // tx proxy connection
     user_list_t  olist_;    // open users list
@@ -206,28 +349,45 @@ namespace pc
     spx_vec_t    svec_;     // symbol price subscriber/publishers
     std::string  thost_;    // tx proxy host
     std::string  rhost_;    // rpc host
-    std::string  cdir_;     // content directory
     manager_sub *sub_;      // subscription callback
     int          status_;   // status bitmap
     int          num_sub_;  // number of in-flight mapping subscriptions
     uint32_t     kidx_;     // schedule index
     int64_t      cts_;      // (re)connect timestamp
+    int64_t      its_;      // connected timestamp
     int64_t      ctimeout_; // connection timeout
     uint64_t     slot_;     // current slot
     uint64_t     slot_cnt_; // slot count
     int64_t      curr_ts_;  // current time
     int64_t      pub_ts_;   // start publish time
     int64_t      pub_int_;  // publish interval
+    size_t       zcpy_;     // user zero-copy send threshold
+    size_t       uhwm_;     // user send queue high-water mark
+    size_t       umax_;     // user send queue limit
+    net_profile  prof_[net_profile::e_num_role]; // transport options
+    int          uzlvl_;    // user websocket compression level
+    unsigned     nhconn_;   // number of rpc http connections
+    unsigned     nwrk_;     // number of user worker threads
+    unsigned     nhedge_;   // number of hedge rpc nodes
+    rpc_hedge    hedge_[PC_RPC_MAX_HEDGE]; // hedge rpc nodes
+    rpc_arrival  arr_[1+PC_RPC_MAX_HEDGE]; // arrivals by rpc node
+    wrk_vec_t    wvec_;     // user worker threads
     kpx_vec_t    kvec_;     // symbol price scheduling
     bool         wait_conn_;// waiting on connection
     bool         do_cap_;   // do capture flag
     bool         do_tx_;    // do tx proxy connectivity
     bool         is_pub_;   // is publishing mode
+    bool         uconf_;    // conflate user notifications
+    bool         do_snap_;  // bootstrap from program snapshot
+    bool         is_snap_;  // program snapshot held until walked
+    unsigned     nsnap_;    // outstanding program snapshot requests
     capture      cap_;      // aggregate price capture
+    price_table  ptab_;     // shared-memory price table
 
     // requests
     rpc::slot_subscribe        sreq_[1]; // slot subscription
     rpc::get_recent_block_hash breq_[1]; // block hash request
+    rpc::get_program_accounts  greq_[3]; // program snapshot by acc. type
   };
 
   inline bool manager::get_is_tx_connect() const
@@ -242,4 +402,11 @@ namespace pc
     }
   }
 
+  inline void manager::write( price *px, pc_price_t *ptr )
+  {
+    if ( ptab_.get_is_init() ) {
+      ptab_.write( *px->get_account(), px->get_symbol(), ptr );
+    }
+  }
+
 }
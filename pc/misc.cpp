@@ -92,19 +92,67 @@ int dec_base58( const uint8_t *str, int len, uint8_t *result)
   return resultlen;
 }
 
-char *uint_to_str( uint64_t val, char *cptr )
+// pairs of decimal digits "00" to "99"
+static const char digit_pairs[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+// write digits of val backwards from cptr two at a time
+static inline char *uint_to_str_pairs( uint64_t val, char *cptr )
 {
-  if ( val ) {
-    while( val ) {
-      *--cptr = '0' + (val%10L);
-      val /= 10L;
-    }
+  while( val >= 100UL ) {
+    const char *dp = &digit_pairs[2*(val%100UL)];
+    val /= 100UL;
+    *--cptr = dp[1];
+    *--cptr = dp[0];
+  }
+  if ( val >= 10UL ) {
+    const char *dp = &digit_pairs[2*val];
+    *--cptr = dp[1];
+    *--cptr = dp[0];
   } else {
-    *--cptr = '0';
+    *--cptr = '0' + val;
   }
   return cptr;
 }
 
+char *uint_to_str( uint64_t val, char *cptr )
+{
+  return uint_to_str_pairs( val, cptr );
+}
+
+unsigned uint_len( uint64_t val )
+{
+  static const uint64_t pow10[20] = {
+    0UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+    100000000UL, 1000000000UL, 10000000000UL, 100000000000UL,
+    1000000000000UL, 10000000000000UL, 100000000000000UL,
+    1000000000000000UL, 10000000000000000UL, 100000000000000000UL,
+    1000000000000000000UL, 10000000000000000000UL
+  };
+  // estimate from bit width then correct by at most one
+  unsigned bits = 64 - __builtin_clzl( val | 1UL );
+  unsigned len = ( bits * 1233 ) >> 12;
+  return len + ( val >= pow10[len] );
+}
+
+size_t uint_to_buf( uint64_t val, char *cptr )
+{
+  size_t len = uint_len( val );
+  uint_to_str_pairs( val, &cptr[len] );
+  return len;
+}
+
+size_t int_to_buf( int64_t val, char *cptr )
+{
+  if ( val < 0 ) {
+    *cptr = '-';
+    return 1 + uint_to_buf( -(uint64_t)val, &cptr[1] );
+  }
+  return uint_to_buf( val, cptr );
+}
+
 uint64_t str_to_uint( const char *val, int len )
 {
   uint64_t res = 0L;
@@ -125,22 +173,12 @@ uint64_t str_to_uint( const char *val, int len )
 
 char *int_to_str( int64_t val, char *cptr )
 {
-  if ( val ) {
-    bool is_neg = val<0;
-    if ( is_neg ) {
-      val = -val;
-    }
-    while( val ) {
-      *--cptr = '0' + (val%10L);
-      val /= 10L;
-    }
-    if ( is_neg ) {
-      *--cptr = '-';
-    }
-  } else {
-    *--cptr = '0';
+  if ( val < 0 ) {
+    cptr = uint_to_str_pairs( -(uint64_t)val, cptr );
+    *--cptr = '-';
+    return cptr;
   }
-  return cptr;
+  return uint_to_str_pairs( val, cptr );
 }
 
 int64_t str_to_int( const char *val, int len )
@@ -27,6 +27,12 @@ namespace pc
   char *int_to_str( int64_t val, char *end_ptr );
   int64_t str_to_int( const char *str, int len );
 
+  // number of decimal digits in val and forward formatting into at least
+  // 20 (uint) or 21 (int) bytes at ptr. returns number of bytes written
+  unsigned uint_len( uint64_t val );
+  size_t uint_to_buf( uint64_t val, char *ptr );
+  size_t int_to_buf( int64_t val, char *ptr );
+
   // string representation of decimal to integer with implied decimal places
   int64_t str_to_dec( const char *str, int len, int expo );
   int64_t str_to_dec( const char *str, int expo );
@@ -1,28 +1,93 @@
 #include "net_socket.hpp"
+#include "net_uring.hpp"
 #include <openssl/sha.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/errqueue.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <netdb.h>
 #include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
 #include <iostream>
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
 
 #define PC_EPOLL_FLAGS (EPOLLIN|EPOLLET|EPOLLRDHUP|EPOLLHUP|EPOLLERR)
+#define PC_RESOLVE_TTL     (60L*PC_NSECS_IN_SEC)
+#define PC_RESOLVE_NEG_TTL (5L*PC_NSECS_IN_SEC)
+#define PC_WS_INFLATE_MAX  (16UL<<20)
 
 namespace pc
 {
-  // net_buf allocation and caching scheme
-  struct net_buf_alloc
+  // net_buf allocation and caching scheme. each size class has a
+  // lock-free depot of free buffers shared by all threads fronted by a
+  // small per-thread magazine. new buffers are carved from slabs
+  class net_buf_alloc
   {
   public:
-    net_buf_alloc();
-    ~net_buf_alloc();
-    net_buf *alloc();
-    void dealloc( net_buf * );
+    static const unsigned mag_len  = 32;
+    static const size_t   slab_len = 2UL*1024UL*1024UL;
+    static const size_t   max_free = 8UL*1024UL*1024UL;
+
+    static net_buf *alloc( unsigned cls );
+    static void dealloc( net_buf * );
+    static void get_stats( unsigned cls, net_buf_stats& );
+    static void set_huge_pages( bool );
+    static bool get_huge_pages();
+
   private:
-    net_buf *ptr_;
+
+    // per-thread cache of free buffers
+    struct mag_t {
+      unsigned num_;
+      net_buf *buf_[mag_len];
+    };
+
+    // per-size-class shared state
+    struct alignas(64) pool_t {
+      std::atomic<uint64_t> top_;   // tagged head of depot stack
+      std::atomic<int64_t>  ndep_;  // buffers in depot
+      std::atomic<int64_t>  live_;  // buffers in use
+      std::atomic<int64_t>  free_;  // buffers in depot or magazines
+      std::atomic<int64_t>  peak_;  // peak buffers in use
+      std::atomic<uint64_t> sys_;   // bytes mapped from system
+      char    *slab_;               // current slab
+      size_t   off_;                // next offset in current slab
+    };
+
+    static void refill( unsigned cls );
+    static void flush( unsigned cls, unsigned num );
+    static void flush_all( void * );
+    static void init_key();
+    static net_buf *pop( pool_t& );
+    static void push( pool_t&, net_buf *hd, net_buf *tl );
+    static net_buf *carve( unsigned cls );
+
+    static pool_t          pool_[net_buf::num_class];
+    static std::mutex      mtx_;   // slab allocation lock
+    static pthread_key_t   key_;   // thread exit magazine flush
+    static pthread_once_t  once_;
+    static bool            huge_;  // use huge pages for slabs
+    static __thread mag_t  mag_[net_buf::num_class];
+    static __thread bool   treg_;  // thread registered for flush
   };
 
 }
@@ -32,51 +97,257 @@ using namespace pc;
 ///////////////////////////////////////////////////////////////////////////
 // net_buf_alloc
 
-net_buf_alloc::net_buf_alloc()
-: ptr_( nullptr )
+// depot stack head packs an ABA tag in the unused upper pointer bits
+#define PC_NET_BUF_PTR_MASK  0x0000ffffffffffffUL
+#define PC_NET_BUF_TAG_INC   0x0001000000000000UL
+#define PC_NET_BUF_PAGE      4096UL
+
+static const uint32_t net_buf_size[net_buf::num_class] = {
+  sizeof( net_buf ), 4096, 16384, 65536
+};
+
+net_buf_alloc::pool_t  net_buf_alloc::pool_[net_buf::num_class];
+std::mutex             net_buf_alloc::mtx_;
+pthread_key_t          net_buf_alloc::key_;
+pthread_once_t         net_buf_alloc::once_ = PTHREAD_ONCE_INIT;
+bool                   net_buf_alloc::huge_ = false;
+__thread net_buf_alloc::mag_t net_buf_alloc::mag_[net_buf::num_class];
+__thread bool          net_buf_alloc::treg_ = false;
+
+void net_buf_alloc::init_key()
 {
-  static_assert( sizeof( net_buf ) == 1280, "unexpected net_buf size");
+  pthread_key_create( &key_, &net_buf_alloc::flush_all );
+}
+
+net_buf *net_buf_alloc::pop( pool_t& pool )
+{
+  uint64_t top = pool.top_.load( std::memory_order_acquire );
+  for(;;) {
+    net_buf *ptr = (net_buf*)( top & PC_NET_BUF_PTR_MASK );
+    if ( !ptr ) {
+      return nullptr;
+    }
+    // slab memory is never unmapped so next_ is always readable even
+    // if another thread pops ptr first. the tag then fails the swap
+    uint64_t nxt = (uint64_t)ptr->next_ |
+      ( ( top + PC_NET_BUF_TAG_INC ) & ~PC_NET_BUF_PTR_MASK );
+    if ( pool.top_.compare_exchange_weak( top, nxt,
+          std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+      return ptr;
+    }
+  }
+}
+
+void net_buf_alloc::push( pool_t& pool, net_buf *hd, net_buf *tl )
+{
+  uint64_t top = pool.top_.load( std::memory_order_relaxed );
+  for(;;) {
+    tl->next_ = (net_buf*)( top & PC_NET_BUF_PTR_MASK );
+    uint64_t nxt = (uint64_t)hd |
+      ( ( top + PC_NET_BUF_TAG_INC ) & ~PC_NET_BUF_PTR_MASK );
+    if ( pool.top_.compare_exchange_weak( top, nxt,
+          std::memory_order_acq_rel, std::memory_order_relaxed ) ) {
+      return;
+    }
+  }
 }
 
-net_buf_alloc::~net_buf_alloc()
+net_buf *net_buf_alloc::carve( unsigned cls )
 {
-  while( ptr_ ) {
-    net_buf *nxt = ptr_->next_;
-    delete ptr_;
-    ptr_ = nxt;
+  pool_t& pool = pool_[cls];
+  size_t bsz = net_buf_size[cls];
+  std::lock_guard<std::mutex> lck( mtx_ );
+  if ( !pool.slab_ || pool.off_ + bsz > slab_len ) {
+    void *mem = MAP_FAILED;
+    if ( huge_ ) {
+      mem = ::mmap( nullptr, slab_len, PROT_READ|PROT_WRITE,
+          MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0 );
+    }
+    if ( mem == MAP_FAILED ) {
+      mem = ::mmap( nullptr, slab_len, PROT_READ|PROT_WRITE,
+          MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+      if ( mem == MAP_FAILED ) {
+        throw std::bad_alloc();
+      }
+      if ( huge_ ) {
+        ::madvise( mem, slab_len, MADV_HUGEPAGE );
+      }
+    }
+    pool.slab_ = (char*)mem;
+    pool.off_  = 0;
+    pool.sys_.fetch_add( slab_len, std::memory_order_relaxed );
   }
+  net_buf *ptr = (net_buf*)&pool.slab_[pool.off_];
+  pool.off_ += bsz;
+  ptr->cap_ = bsz - ( sizeof( net_buf ) - net_buf::len );
+  ptr->cls_ = cls;
+  ptr->trim_ = 0;
+  return ptr;
 }
 
-net_buf *net_buf_alloc::alloc()
+void net_buf_alloc::refill( unsigned cls )
 {
-  net_buf *res;
-  if ( ptr_ ) {
-    res  = ptr_;
-    ptr_ = res->next_;
+  if ( PC_UNLIKELY( !treg_ ) ) {
+    // flush magazines back to the depot on thread exit
+    pthread_once( &once_, &net_buf_alloc::init_key );
+    pthread_setspecific( key_, &treg_ );
+    treg_ = true;
+  }
+  pool_t& pool = pool_[cls];
+  mag_t& mag = mag_[cls];
+  while( mag.num_ != mag_len/2 ) {
+    net_buf *ptr = pop( pool );
+    if ( !ptr ) {
+      break;
+    }
+    mag.buf_[mag.num_++] = ptr;
+  }
+  if ( mag.num_ ) {
+    pool.ndep_.fetch_sub( mag.num_, std::memory_order_relaxed );
   } else {
-    res = new net_buf;
+    while( mag.num_ != mag_len/2 ) {
+      mag.buf_[mag.num_++] = carve( cls );
+    }
+    pool.free_.fetch_add( mag.num_, std::memory_order_relaxed );
+  }
+}
+
+void net_buf_alloc::flush( unsigned cls, unsigned num )
+{
+  pool_t& pool = pool_[cls];
+  mag_t& mag = mag_[cls];
+  size_t bsz = net_buf_size[cls];
+  size_t tlen = bsz - PC_NET_BUF_PAGE;
+
+  // huge page slabs are not trimmed as that would split their pages
+  bool do_trim = !huge_ && bsz > PC_NET_BUF_PAGE &&
+    ( pool.ndep_.load( std::memory_order_relaxed ) * bsz ) > max_free;
+  net_buf *hd = nullptr, *tl = nullptr;
+  for( unsigned i=0; i != num; ++i ) {
+    net_buf *ptr = mag.buf_[--mag.num_];
+    if ( do_trim && !ptr->trim_ ) {
+      // return all but the header page of surplus buffers to the system
+      ::madvise( (char*)ptr + PC_NET_BUF_PAGE, tlen, MADV_DONTNEED );
+      ptr->trim_ = 1;
+      pool.sys_.fetch_sub( tlen, std::memory_order_relaxed );
+    }
+    ptr->next_ = hd;
+    hd = ptr;
+    if ( !tl ) {
+      tl = ptr;
+    }
+  }
+  if ( hd ) {
+    push( pool, hd, tl );
+    pool.ndep_.fetch_add( num, std::memory_order_relaxed );
+  }
+}
+
+void net_buf_alloc::flush_all( void * )
+{
+  for( unsigned cls=0; cls != net_buf::num_class; ++cls ) {
+    flush( cls, mag_[cls].num_ );
+  }
+}
+
+net_buf *net_buf_alloc::alloc( unsigned cls )
+{
+  mag_t& mag = mag_[cls];
+  if ( PC_UNLIKELY( mag.num_ == 0 ) ) {
+    refill( cls );
   }
+  net_buf *res = mag.buf_[--mag.num_];
   res->next_ = nullptr;
   res->size_ = 0;
+
+  // track usage statistics. trimmed pages are faulted back in on use
+  pool_t& pool = pool_[cls];
+  if ( PC_UNLIKELY( res->trim_ ) ) {
+    res->trim_ = 0;
+    pool.sys_.fetch_add( net_buf_size[cls] - PC_NET_BUF_PAGE,
+        std::memory_order_relaxed );
+  }
+  pool.free_.fetch_sub( 1, std::memory_order_relaxed );
+  int64_t live = 1 + pool.live_.fetch_add( 1, std::memory_order_relaxed );
+  int64_t peak = pool.peak_.load( std::memory_order_relaxed );
+  while( live > peak && !pool.peak_.compare_exchange_weak(
+        peak, live, std::memory_order_relaxed ) );
   return res;
 }
 
 void net_buf_alloc::dealloc( net_buf *ptr )
 {
-  ptr->next_ = ptr_;
-  ptr_ = ptr;
+  unsigned cls = ptr->cls_;
+  mag_t& mag = mag_[cls];
+  if ( PC_UNLIKELY( mag.num_ == mag_len ) ) {
+    flush( cls, mag_len/2 );
+  }
+  mag.buf_[mag.num_++] = ptr;
+  pool_t& pool = pool_[cls];
+  pool.live_.fetch_sub( 1, std::memory_order_relaxed );
+  pool.free_.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void net_buf_alloc::get_stats( unsigned cls, net_buf_stats& res )
+{
+  pool_t& pool = pool_[cls];
+  res.live_ = pool.live_.load( std::memory_order_relaxed );
+  res.free_ = pool.free_.load( std::memory_order_relaxed );
+  res.peak_ = pool.peak_.load( std::memory_order_relaxed );
+  res.sys_  = pool.sys_.load( std::memory_order_relaxed );
+}
+
+void net_buf_alloc::set_huge_pages( bool huge )
+{
+  huge_ = huge;
+}
+
+bool net_buf_alloc::get_huge_pages()
+{
+  return huge_;
 }
 
-static net_buf_alloc mem_;
+///////////////////////////////////////////////////////////////////////////
+// net_buf
 
 net_buf *net_buf::alloc()
 {
-  return mem_.alloc();
+  static_assert( sizeof( net_buf ) == 1280, "unexpected net_buf size");
+  return net_buf_alloc::alloc( 0 );
+}
+
+net_buf *net_buf::alloc( size_t len )
+{
+  unsigned cls = 0;
+  while( cls != num_class-1 && get_class_capacity( cls ) < len ) {
+    ++cls;
+  }
+  return net_buf_alloc::alloc( cls );
 }
 
 void net_buf::dealloc()
 {
-  mem_.dealloc( this );
+  net_buf_alloc::dealloc( this );
+}
+
+uint16_t net_buf::get_class_capacity( unsigned cls )
+{
+  return net_buf_size[cls] - ( sizeof( net_buf ) - len );
+}
+
+void net_buf::get_stats( unsigned cls, net_buf_stats& res )
+{
+  net_buf_alloc::get_stats( cls, res );
+}
+
+void net_buf::set_huge_pages( bool huge )
+{
+  net_buf_alloc::set_huge_pages( huge );
+}
+
+bool net_buf::get_huge_pages()
+{
+  return net_buf_alloc::get_huge_pages();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -84,7 +355,7 @@ void net_buf::dealloc()
 
 
 net_wtr::net_wtr()
-: hd_( mem_.alloc() ),
+: hd_( net_buf::alloc() ),
   tl_( hd_ ),
   sz_( 0 )
 {
@@ -98,7 +369,7 @@ net_wtr::~net_wtr()
 void net_wtr::reset()
 {
   dealloc();
-  hd_ = tl_ = mem_.alloc();
+  hd_ = tl_ = net_buf::alloc();
   sz_ = 0;
 }
 
@@ -120,9 +391,22 @@ void net_wtr::detach( net_buf *&hd, net_buf *&tl )
   sz_ = 0UL;
 }
 
-void net_wtr::alloc()
+void net_wtr::attach( net_buf *hd, net_buf *tl )
+{
+  dealloc();
+  hd_ = hd;
+  tl_ = tl;
+  sz_ = 0UL;
+  for( net_buf *ptr = hd; ptr != tl; ptr = ptr->next_ ) {
+    sz_ += ptr->size_;
+  }
+}
+
+void net_wtr::alloc( size_t len )
 {
-  net_buf *ptr = mem_.alloc();
+  // grow buffer sizes geometrically so that large messages are held in
+  // a short chain
+  net_buf *ptr = net_buf::alloc( std::max( len, 2*(size_t)tl_->cap_ ) );
   tl_->next_ = ptr;
   sz_ += tl_->size_;
   tl_ = ptr;
@@ -131,7 +415,7 @@ void net_wtr::alloc()
 void net_wtr::add( str str )
 {
   size_t nlen = tl_->size_ + str.len_;
-  if ( nlen <= net_buf::len ) {
+  if ( nlen <= tl_->cap_ ) {
     __builtin_memcpy( &tl_->buf_[tl_->size_], str.str_, str.len_ );
     tl_->size_ = nlen;
   } else {
@@ -141,8 +425,8 @@ void net_wtr::add( str str )
 
 void net_wtr::add( char val )
 {
-  if ( PC_UNLIKELY( tl_->size_ == net_buf::len ) ) {
-    alloc();
+  if ( PC_UNLIKELY( tl_->size_ == tl_->cap_ ) ) {
+    alloc( 1 );
   }
   tl_->buf_[tl_->size_++] = val;
 }
@@ -152,7 +436,7 @@ void net_wtr::add( net_wtr& buf )
   net_buf *hd, *tl;
   sz_ += tl_->size_ + buf.size();
   buf.detach( hd, tl );
-  if ( tl_->size_ + hd->size_ <= net_buf::len ) {
+  if ( tl_->size_ + hd->size_ <= tl_->cap_ ) {
     __builtin_memcpy( &tl_->buf_[tl_->size_], hd->buf_, hd->size_ );
     tl_->next_ = hd->next_;
     tl_->size_ += hd->size_;
@@ -170,10 +454,10 @@ void net_wtr::add( net_wtr& buf )
 void net_wtr::add_alloc( str str )
 {
   while( str.len_ >0 ) {
-    if ( tl_->size_ == net_buf::len ) {
-      alloc();
+    if ( tl_->size_ == tl_->cap_ ) {
+      alloc( str.len_ );
     }
-    size_t left = net_buf::len - tl_->size_;
+    size_t left = tl_->cap_ - tl_->size_;
     size_t mlen = std::min( left, str.len_ );
     __builtin_memcpy( &tl_->buf_[tl_->size_], str.str_, mlen );
     tl_->size_ += mlen;
@@ -185,12 +469,26 @@ void net_wtr::add_alloc( str str )
 char *net_wtr::reserve( size_t len )
 {
   size_t nlen = tl_->size_ + len;
-  if ( nlen > net_buf::len ) {
-    alloc();
+  if ( nlen > tl_->cap_ ) {
+    alloc( len );
   }
   return &tl_->buf_[tl_->size_];
 }
 
+void net_wtr::prealloc( size_t len )
+{
+  if ( tl_->size_ + len <= tl_->cap_ ) {
+    return;
+  }
+  if ( hd_ == tl_ && tl_->size_ == 0 ) {
+    // nothing written yet so swap in a large enough buffer
+    hd_->dealloc();
+    hd_ = tl_ = net_buf::alloc( len );
+  } else {
+    alloc( len );
+  }
+}
+
 void net_wtr::advance( size_t len )
 {
   tl_->size_ += len;
@@ -209,11 +507,200 @@ void net_wtr::print() const
   std::cout << std::endl;
 }
 
+///////////////////////////////////////////////////////////////////////////
+// net_timer
+
+net_timer::net_timer()
+: next_( nullptr ),
+  pprev_( nullptr ),
+  exp_( 0L ),
+  lvl_( 0 ),
+  idx_( 0 )
+{
+}
+
+net_timer::~net_timer()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+// net_wheel
+
+net_wheel::net_wheel()
+: cur_( 0UL ),
+  num_( 0 ),
+  fire_( nullptr )
+{
+  __builtin_memset( occ_, 0, sizeof( occ_ ) );
+  __builtin_memset( slot_, 0, sizeof( slot_ ) );
+}
+
+void net_wheel::add( net_timer *tp, int64_t ts )
+{
+  if ( tp->pprev_ ) {
+    unlink( tp );
+  } else {
+    ++num_;
+  }
+  tp->exp_ = ts;
+  place( tp );
+}
+
+void net_wheel::del( net_timer *tp )
+{
+  if ( tp->pprev_ ) {
+    unlink( tp );
+    --num_;
+  }
+}
+
+void net_wheel::place( net_timer *tp )
+{
+  // level is that of the highest group of slot bits in which the
+  // expiry tick differs from the current tick
+  uint64_t tick = tp->exp_ > 0L ? (uint64_t)tp->exp_ >> tick_bits : 0UL;
+  tick = std::max( tick, cur_ );
+  unsigned lvl = 0;
+  uint64_t diff = tick ^ cur_;
+  if ( diff ) {
+    lvl = ( 63 - __builtin_clzl( diff ) ) / slot_bits;
+    if ( lvl >= num_level ) {
+      // park at last tick of current top level span
+      tick = cur_ | ( ( 1UL << ( num_level * slot_bits ) ) - 1UL );
+      diff = tick ^ cur_;
+      lvl = diff ? ( 63 - __builtin_clzl( diff ) ) / slot_bits : 0;
+    }
+  }
+  unsigned idx = ( tick >> ( lvl * slot_bits ) ) & slot_mask;
+  net_timer **hd = &slot_[lvl][idx];
+  tp->next_ = *hd;
+  if ( tp->next_ ) {
+    tp->next_->pprev_ = &tp->next_;
+  }
+  tp->pprev_ = hd;
+  tp->lvl_ = lvl;
+  tp->idx_ = idx;
+  *hd = tp;
+  occ_[lvl] |= 1UL << idx;
+}
+
+void net_wheel::unlink( net_timer *tp )
+{
+  *tp->pprev_ = tp->next_;
+  if ( tp->next_ ) {
+    tp->next_->pprev_ = tp->pprev_;
+  }
+  if ( tp->lvl_ >= 0 && !slot_[tp->lvl_][tp->idx_] ) {
+    occ_[tp->lvl_] &= ~( 1UL << tp->idx_ );
+  }
+  tp->next_  = nullptr;
+  tp->pprev_ = nullptr;
+}
+
+uint64_t net_wheel::get_next_tick() const
+{
+  // slots below the current slot of a level have already been fired or
+  // cascaded so the first occupied slot at or above it is the next one
+  // due. lower levels always come due before higher levels
+  for( unsigned lvl = 0; lvl != num_level; ++lvl ) {
+    unsigned sh = lvl * slot_bits;
+    unsigned idx = ( cur_ >> sh ) & slot_mask;
+    uint64_t msk = occ_[lvl] & ( ~0UL << idx );
+    if ( msk ) {
+      unsigned hi = sh + slot_bits;
+      uint64_t tick = ( ( cur_ >> hi ) << hi ) |
+        ( (uint64_t)__builtin_ctzl( msk ) << sh );
+      return std::max( tick, cur_ );
+    }
+  }
+  return ~0UL;
+}
+
+int64_t net_wheel::get_next() const
+{
+  uint64_t tick = num_ ? get_next_tick() : ~0UL;
+  return tick != ~0UL ? (int64_t)( tick << tick_bits ) : 0L;
+}
+
+void net_wheel::expire( int64_t now )
+{
+  uint64_t tgt = now > 0L ? (uint64_t)now >> tick_bits : 0UL;
+  if ( !num_ ) {
+    cur_ = std::max( cur_, tgt + 1 );
+    return;
+  }
+  for(;;) {
+    uint64_t tick = get_next_tick();
+    if ( tick > tgt ) {
+      break;
+    }
+    cur_ = tick;
+
+    // cascade higher level slots that start at this tick
+    for( unsigned lvl = num_level - 1; lvl; --lvl ) {
+      unsigned idx = ( cur_ >> ( lvl * slot_bits ) ) & slot_mask;
+      if ( occ_[lvl] & ( 1UL << idx ) ) {
+        net_timer *tp = slot_[lvl][idx];
+        slot_[lvl][idx] = nullptr;
+        occ_[lvl] &= ~( 1UL << idx );
+        while( tp ) {
+          net_timer *nxt = tp->next_;
+          place( tp );
+          tp = nxt;
+        }
+      }
+    }
+
+    // fire level zero slot. timers may add or delete other timers
+    // (including those still to be fired) from their callbacks
+    unsigned idx = cur_ & slot_mask;
+    ++cur_;
+    if ( !( occ_[0] & ( 1UL << idx ) ) ) {
+      continue;
+    }
+    fire_ = slot_[0][idx];
+    slot_[0][idx] = nullptr;
+    occ_[0] &= ~( 1UL << idx );
+    fire_->pprev_ = &fire_;
+    for( net_timer *tp = fire_; tp; tp = tp->next_ ) {
+      tp->lvl_ = -1;
+    }
+    while( fire_ ) {
+      net_timer *tp = fire_;
+      unlink( tp );
+      if ( (uint64_t)tp->exp_ >> tick_bits >= cur_ ) {
+        // parked timer not yet due
+        place( tp );
+      } else {
+        --num_;
+        tp->on_timer();
+      }
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // net_loop
 
+// timerfd driving net_loop timer wheel
+class net_loop_timer : public net_socket
+{
+public:
+  void poll() override {
+    uint64_t num = 0;
+    while( ::read( get_fd(), &num, sizeof( num ) ) > 0 );
+    get_net_loop()->poll_timer();
+  }
+};
+
 net_loop::net_loop()
-: fd_(-1)
+: fd_(-1),
+  use_uring_( false ),
+  up_( nullptr ),
+  rp_( nullptr ),
+  nwait_( 0 ),
+  tp_( nullptr ),
+  tts_( 0L )
 {
   __builtin_memset( ev_, 0, sizeof( ev_ ) );
   __builtin_memset( evarr_, 0, sizeof( evarr_ ) );
@@ -221,23 +708,71 @@ net_loop::net_loop()
 
 net_loop::~net_loop()
 {
+  delete rp_;
+  rp_ = nullptr;
+  if ( tp_ ) {
+    tp_->close();
+    delete tp_;
+    tp_ = nullptr;
+  }
   if ( fd_ > 0 ) {
     ::close( fd_ );
     fd_ = -1;
   }
+  delete up_;
+  up_ = nullptr;
+}
+
+void net_loop::set_use_uring( bool use_uring )
+{
+  use_uring_ = use_uring;
+}
+
+bool net_loop::get_use_uring() const
+{
+  return use_uring_;
+}
+
+bool net_loop::get_is_uring() const
+{
+  return up_ != nullptr;
 }
 
 bool net_loop::init()
 {
-  fd_ = ::epoll_create( 1 );
-  if ( fd_ < 0 ) {
-    return set_err_msg( "failed to create epoll", errno );
+  if ( use_uring_ ) {
+    up_ = new net_uring;
+    if ( !up_->init() ) {
+      delete up_;
+      up_ = nullptr;
+    }
+  }
+  if ( !up_ ) {
+    fd_ = ::epoll_create( 1 );
+    if ( fd_ < 0 ) {
+      return set_err_msg( "failed to create epoll", errno );
+    }
+  }
+
+  // timerfd for timer wheel
+  int tfd = ::timerfd_create( CLOCK_REALTIME, TFD_NONBLOCK|TFD_CLOEXEC );
+  if ( tfd < 0 ) {
+    return set_err_msg( "failed to create timerfd", errno );
   }
+  tp_ = new net_loop_timer;
+  tp_->set_fd( tfd );
+  tp_->set_net_loop( this );
+  tp_->init();
+  wh_.expire( get_now() );
   return true;
 }
 
 void net_loop::add( net_socket *eptr, int events )
 {
+  if ( up_ ) {
+    up_->add( eptr, events );
+    return;
+  }
   ev_->events   = events;
   ev_->data.ptr = eptr;
   int evop = EPOLL_CTL_ADD;
@@ -252,6 +787,10 @@ void net_loop::add( net_socket *eptr, int events )
 void net_loop::del( net_socket *eptr )
 {
   if ( eptr->get_in_loop() ) {
+    if ( up_ ) {
+      up_->del( eptr );
+      return;
+    }
     ev_->events   = 0;
     ev_->data.ptr = eptr;
     epoll_ctl( fd_, EPOLL_CTL_DEL, eptr->get_fd(), ev_ );
@@ -259,8 +798,70 @@ void net_loop::del( net_socket *eptr )
   }
 }
 
+void net_loop::send( net_connect *cptr )
+{
+  if ( up_ ) {
+    up_->send( cptr );
+  }
+}
+
+uint64_t net_loop::get_num_wait() const
+{
+  return up_ ? up_->get_num_enter() : nwait_;
+}
+
+void net_loop::add_timer( net_timer *tp, int64_t ts )
+{
+  wh_.add( tp, ts );
+  arm_timer();
+}
+
+void net_loop::del_timer( net_timer *tp )
+{
+  // timerfd is left armed and re-armed on its next expiry
+  wh_.del( tp );
+}
+
+void net_loop::poll_timer()
+{
+  int64_t now = get_now();
+  if ( tts_ <= now ) {
+    tts_ = 0L;
+  }
+  wh_.expire( now );
+  arm_timer();
+}
+
+net_resolver *net_loop::get_resolver()
+{
+  if ( !rp_ ) {
+    rp_ = new net_resolver;
+    rp_->init( this );
+  }
+  return rp_;
+}
+
+void net_loop::arm_timer()
+{
+  // only re-arm timerfd if earliest timer is due before it fires
+  int64_t ts = wh_.get_next();
+  if ( !tp_ || !ts || ( tts_ && tts_ <= ts ) ) {
+    return;
+  }
+  itimerspec its[1];
+  __builtin_memset( its, 0, sizeof( its ) );
+  its->it_value.tv_sec  = ts / PC_NSECS_IN_SEC;
+  its->it_value.tv_nsec = ts % PC_NSECS_IN_SEC;
+  ::timerfd_settime( tp_->get_fd(), TFD_TIMER_ABSTIME, its, nullptr );
+  tts_ = ts;
+}
+
 bool net_loop::poll( int timeout )
 {
+  if ( up_ ) {
+    return up_->poll( timeout );
+  }
+  ++nwait_;
   int nfds = epoll_wait( fd_, evarr_, max_events_, timeout );
   if ( nfds > 0 ) {
     for(int i=0; i != nfds; ++i ) {
@@ -279,74 +880,326 @@ bool net_loop::poll( int timeout )
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// net_socket
+// net_ring
 
-net_parser::~net_parser()
+net_ring::net_ring()
+: buf_( nullptr ),
+  cap_( 0 ),
+  rd_( 0 ),
+  wr_( 0 ),
+  dbl_( false )
 {
 }
 
-net_socket::~net_socket()
+net_ring::~net_ring()
 {
+  reset();
 }
 
-net_socket::net_socket()
-: fd_(-1),
-  inl_( false ),
-  lp_( nullptr )
+static char *net_ring_map( size_t cap )
 {
+  // map the same memfd pages twice in adjacent address space
+  int fd = ::memfd_create( "net_ring", MFD_CLOEXEC );
+  if ( fd < 0 ) {
+    return nullptr;
+  }
+  char *ptr = nullptr;
+  if ( 0 == ::ftruncate( fd, cap ) ) {
+    void *mem = ::mmap( nullptr, 2*cap, PROT_NONE,
+        MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+    if ( mem != MAP_FAILED ) {
+      ptr = (char*)mem;
+      if ( MAP_FAILED == ::mmap( ptr, cap, PROT_READ|PROT_WRITE,
+            MAP_SHARED|MAP_FIXED, fd, 0 ) ||
+           MAP_FAILED == ::mmap( ptr + cap, cap, PROT_READ|PROT_WRITE,
+            MAP_SHARED|MAP_FIXED, fd, 0 ) ) {
+        ::munmap( ptr, 2*cap );
+        ptr = nullptr;
+      }
+    }
+  }
+  ::close( fd );
+  return ptr;
 }
 
-int net_socket::get_fd() const
+bool net_ring::init( size_t cap )
 {
-  return fd_;
+  size_t pgsz = ::sysconf( _SC_PAGESIZE );
+  size_t ncap = pgsz;
+  while( ncap < cap ) {
+    ncap <<= 1;
+  }
+  size_t len = get_size();
+  if ( ncap < len ) {
+    return false;
+  }
+  bool dbl = true;
+  char *buf = net_ring_map( ncap );
+  if ( !buf ) {
+    // fall back to linear buffer
+    dbl = false;
+    if ( !( buf = (char*)::malloc( ncap ) ) ) {
+      return false;
+    }
+  }
+  if ( len ) {
+    __builtin_memcpy( buf, get_read(), len );
+  }
+  reset();
+  buf_ = buf;
+  cap_ = ncap;
+  dbl_ = dbl;
+  wr_  = len;
+  return true;
 }
 
-void net_socket::set_fd( int fd )
+char *net_ring::get_write()
 {
-  fd_ = fd;
+  if ( dbl_ ) {
+    return &buf_[wr_ & ( cap_ - 1 )];
+  }
+  // shuffle unread bytes to start of linear buffer
+  if ( rd_ ) {
+    size_t len = wr_ - rd_;
+    if ( len ) {
+      __builtin_memmove( buf_, &buf_[rd_], len );
+    }
+    rd_ = 0;
+    wr_ = len;
+  }
+  return &buf_[wr_];
 }
 
-void net_socket::set_net_loop( net_loop *lp )
+void net_ring::clear()
 {
-  lp_ = lp;
+  rd_ = wr_ = 0;
 }
 
-net_loop *net_socket::get_net_loop() const
+void net_ring::reset()
 {
-  return lp_;
+  if ( buf_ ) {
+    if ( dbl_ ) {
+      ::munmap( buf_, 2*cap_ );
+    } else {
+      ::free( buf_ );
+    }
+  }
+  buf_ = nullptr;
+  cap_ = rd_ = wr_ = 0;
+  dbl_ = false;
 }
 
-void net_socket::set_in_loop( bool inl )
+///////////////////////////////////////////////////////////////////////////
+// net_profile
+
+static const char *net_role_names[] = {
+  "rpc_http", "rpc_ws", "tx", "user", "udp"
+};
+
+net_profile::net_profile()
+: nodelay_( false ),
+  quickack_( false ),
+  sndbuf_( 0 ),
+  rcvbuf_( 0 ),
+  busy_poll_( 0 ),
+  prio_( -1 )
 {
-  inl_ = inl;
 }
 
-bool net_socket::get_in_loop() const
+const char *net_profile::get_role_name( role_t role )
 {
-  return inl_;
+  return role < e_num_role ? net_role_names[role] : "unknown";
 }
 
-void net_socket::close()
+bool net_profile::parse_role( const std::string& arg,
+                              role_t& role, net_profile& prof )
 {
-  if ( fd_ > 0 ) {
-    if ( lp_ ) {
-      lp_->del( this );
+  size_t i = arg.find( ':' );
+  if ( i == std::string::npos ) {
+    return false;
+  }
+  for( unsigned j=0; j != e_num_role; ++j ) {
+    if ( 0 == arg.compare( 0, i, net_role_names[j] ) ) {
+      role = (role_t)j;
+      return prof.init_from_str( arg.substr( i+1 ) );
     }
-    ::close( fd_ );
-    fd_ = -1;
   }
+  return false;
 }
 
-void net_socket::poll()
-{
-}
-
-void net_socket::teardown()
+bool net_profile::init_from_str( const std::string& opts )
 {
-  close();
+  *this = net_profile();
+  size_t pos = 0;
+  while( pos < opts.size() ) {
+    size_t end = opts.find( ',', pos );
+    if ( end == std::string::npos ) {
+      end = opts.size();
+    }
+    std::string key = opts.substr( pos, end - pos ), val;
+    pos = end + 1;
+    size_t eq = key.find( '=' );
+    if ( eq != std::string::npos ) {
+      val = key.substr( eq + 1 );
+      key.resize( eq );
+    }
+    int ival = ::atoi( val.c_str() );
+    if ( key == "nodelay" && val.empty() ) {
+      nodelay_ = true;
+    } else if ( key == "quickack" && val.empty() ) {
+      quickack_ = true;
+    } else if ( key == "sndbuf" && ival > 0 ) {
+      sndbuf_ = ival;
+    } else if ( key == "rcvbuf" && ival > 0 ) {
+      rcvbuf_ = ival;
+    } else if ( key == "busy_poll" && ival > 0 ) {
+      busy_poll_ = ival;
+    } else if ( key == "prio" && !val.empty() && ival >= 0 ) {
+      prio_ = ival;
+    } else if ( key != "default" || !val.empty() ) {
+      return false;
+    }
+  }
+  return true;
 }
 
-bool net_socket::set_block( bool block )
+std::string net_profile::to_str() const
+{
+  std::string res;
+  if ( nodelay_ ) {
+    res += ",nodelay";
+  }
+  if ( quickack_ ) {
+    res += ",quickack";
+  }
+  if ( sndbuf_ ) {
+    res += ",sndbuf=" + std::to_string( sndbuf_ );
+  }
+  if ( rcvbuf_ ) {
+    res += ",rcvbuf=" + std::to_string( rcvbuf_ );
+  }
+  if ( busy_poll_ ) {
+    res += ",busy_poll=" + std::to_string( busy_poll_ );
+  }
+  if ( prio_ >= 0 ) {
+    res += ",prio=" + std::to_string( prio_ );
+  }
+  return res.empty() ? "[default]" : "[" + res.substr( 1 ) + "]";
+}
+
+///////////////////////////////////////////////////////////////////////////
+// net_socket
+
+net_parser::~net_parser()
+{
+}
+
+net_socket::~net_socket()
+{
+}
+
+net_socket::net_socket()
+: fd_(-1),
+  inl_( false ),
+  lp_( nullptr )
+{
+}
+
+int net_socket::get_fd() const
+{
+  return fd_;
+}
+
+void net_socket::set_fd( int fd )
+{
+  fd_ = fd;
+}
+
+void net_socket::set_net_loop( net_loop *lp )
+{
+  lp_ = lp;
+}
+
+net_loop *net_socket::get_net_loop() const
+{
+  return lp_;
+}
+
+void net_socket::set_in_loop( bool inl )
+{
+  inl_ = inl;
+}
+
+bool net_socket::get_in_loop() const
+{
+  return inl_;
+}
+
+void net_socket::set_net_profile( const net_profile& prof )
+{
+  prof_ = prof;
+}
+
+const net_profile& net_socket::get_net_profile() const
+{
+  return prof_;
+}
+
+static bool set_sock_opt( int fd, int level, int opt, int val )
+{
+  return 0 == ::setsockopt( fd, level, opt, &val, sizeof( val ) );
+}
+
+bool net_socket::apply_net_profile()
+{
+  // tcp options do not apply to unix domain sockets
+  int domain = AF_UNSPEC;
+  socklen_t len = sizeof( domain );
+  ::getsockopt( fd_, SOL_SOCKET, SO_DOMAIN, &domain, &len );
+  bool is_unix = domain == AF_UNIX;
+  bool ok = true;
+  if ( prof_.nodelay_ && !is_unix ) {
+    ok &= set_sock_opt( fd_, IPPROTO_TCP, TCP_NODELAY, 1 );
+  }
+  if ( prof_.quickack_ && !is_unix ) {
+    ok &= set_sock_opt( fd_, IPPROTO_TCP, TCP_QUICKACK, 1 );
+  }
+  if ( prof_.sndbuf_ ) {
+    ok &= set_sock_opt( fd_, SOL_SOCKET, SO_SNDBUF, prof_.sndbuf_ );
+  }
+  if ( prof_.rcvbuf_ ) {
+    ok &= set_sock_opt( fd_, SOL_SOCKET, SO_RCVBUF, prof_.rcvbuf_ );
+  }
+  if ( prof_.busy_poll_ ) {
+    ok &= set_sock_opt( fd_, SOL_SOCKET, SO_BUSY_POLL, prof_.busy_poll_ );
+  }
+  if ( prof_.prio_ >= 0 ) {
+    ok &= set_sock_opt( fd_, SOL_SOCKET, SO_PRIORITY, prof_.prio_ );
+  }
+  return ok;
+}
+
+void net_socket::close()
+{
+  if ( fd_ > 0 ) {
+    if ( lp_ ) {
+      lp_->del( this );
+    }
+    ::close( fd_ );
+    fd_ = -1;
+  }
+}
+
+void net_socket::poll()
+{
+}
+
+void net_socket::teardown()
+{
+  close();
+}
+
+bool net_socket::set_block( bool block )
 {
   int flags = ::fcntl( fd_, F_GETFL, 0 );
   if ( flags < 0 ){
@@ -377,9 +1230,20 @@ bool net_socket::init()
 net_connect::net_connect()
 : whd_( nullptr ),
   wtl_( nullptr ),
-  rsz_( 0 ),
+  rhwm_( 0 ),
+  chwm_( 0 ),
   wsz_( 0 ),
-  np_( nullptr )
+  np_( nullptr ),
+  nflush_( 0 ),
+  nsend_( 0 ),
+  nbytes_( 0 ),
+  nrecv_( 0 ),
+  nqueue_( 0 ),
+  nfile_( 0 ),
+  zlen_( 0 ),
+  zseq_( 0 ),
+  wzc_( -1 ),
+  zon_( false )
 {
 }
 
@@ -398,23 +1262,134 @@ bool net_connect::get_is_send() const
   return whd_ != nullptr;
 }
 
+size_t net_connect::get_send_queue() const
+{
+  return nqueue_ - nbytes_;
+}
+
+void net_connect::on_sent()
+{
+}
+
+uint64_t net_connect::get_num_recv() const
+{
+  return nrecv_;
+}
+
+bool net_connect::get_is_uring() const
+{
+  return get_in_loop() && get_net_loop()->get_is_uring();
+}
+
+size_t net_connect::get_recv_hwm() const
+{
+  return rhwm_;
+}
+
+size_t net_connect::get_recv_cap_hwm() const
+{
+  return chwm_;
+}
+
+void net_connect::set_zero_copy( size_t min_len )
+{
+  zlen_ = min_len;
+}
+
+size_t net_connect::get_zero_copy() const
+{
+  return zlen_;
+}
+
+uint64_t net_connect::get_num_flush() const
+{
+  return nflush_;
+}
+
+uint64_t net_connect::get_num_send() const
+{
+  return nsend_;
+}
+
+uint64_t net_connect::get_num_send_bytes() const
+{
+  return nbytes_;
+}
+
+uint64_t net_connect::get_num_send_file() const
+{
+  return nfile_;
+}
+
 void net_connect::add_send( net_wtr& msg )
 {
   net_buf *hd, *tl;
   msg.detach( hd, tl );
+  add_send( hd, tl );
+}
+
+void net_connect::add_send( net_buf *hd, net_buf *tl )
+{
+  for( net_buf *ptr = hd; ptr; ptr = ptr->next_ ) {
+    nqueue_ += ptr->size_;
+  }
+  bool is_uring = get_is_uring();
   if ( wtl_ ) {
     wtl_->next_ = hd;
   } else {
     whd_ = hd;
-    if ( get_net_loop() ) {
+    // sockets not yet in the loop send on joining it
+    if ( get_in_loop() && !is_uring ) {
       get_net_loop()->add( this, PC_EPOLL_FLAGS | EPOLLOUT );
     }
   }
   wtl_ = tl;
+
+  // io_uring sends are queued now and submitted on the next loop poll
+  if ( is_uring ) {
+    get_net_loop()->send( this );
+  }
+}
+
+void net_connect::add_send_file( int fd, const char *buf, size_t len )
+{
+  // sendfile may only write ahead of the queue when it is empty and
+  // io_uring is not submitting sends on our behalf
+  size_t off = 0;
+  if ( !whd_ && !get_is_err() && !get_is_uring() ) {
+    while( off < len ) {
+      off_t foff = off;
+      ssize_t rc = ::sendfile( get_fd(), fd, &foff, len - off );
+      ++nsend_;
+      if ( rc <= 0 ) {
+        if ( rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK ) {
+          poll_error( false );
+          return;
+        }
+        break;
+      }
+      off += rc;
+    }
+    nfile_  += off;
+    nbytes_ += off;
+    nqueue_ += off;
+  }
+  if ( off < len ) {
+    net_wtr msg;
+    msg.add( str( &buf[off], len - off ) );
+    add_send( msg );
+  }
 }
 
 void net_connect::poll()
 {
+  // socket i/o is performed by the loop itself when using io_uring
+  if ( get_is_uring() ) {
+    return;
+  }
+  if ( !zq_.empty() ) {
+    poll_zero_copy();
+  }
   if ( get_is_send() ) {
     poll_send();
   }
@@ -426,69 +1401,225 @@ void net_connect::poll_send()
   if ( !whd_ || get_is_err() ) {
     return;
   }
+  if ( get_is_uring() ) {
+    get_net_loop()->send( this );
+    return;
+  }
+  ++nflush_;
+  uint64_t nbytes = nbytes_;
   for(;;) {
-    // write current buffer to ssl socket
-    char *ptr = &whd_->buf_[wsz_];
-    uint16_t len = whd_->size_ - wsz_;
-    int rc = ::send( get_fd(), ptr, len, MSG_NOSIGNAL );
-    if ( rc > 0 ) {
-      wsz_ += rc;
-
-      // advance to next buffer in list
-      if ( wsz_ == whd_->size_ ) {
-        net_buf *nxt = whd_->next_;
-        whd_->dealloc();
-        wsz_ = 0;
-        if ( ! ( whd_ = nxt ) ) {
-          wtl_ = nullptr;
-          if ( get_net_loop() ) {
-            get_net_loop()->add( this, PC_EPOLL_FLAGS );
-          }
-          break;
+    // gather as much of the writer queue as possible into one send
+    iovec iov[max_iov];
+    int niov = 0;
+    size_t len = 0;
+    uint16_t off = wsz_;
+    for( net_buf *bptr = whd_; bptr && niov != max_iov; bptr = bptr->next_ ) {
+      iov[niov].iov_base = &bptr->buf_[off];
+      iov[niov].iov_len  = bptr->size_ - off;
+      len += iov[niov++].iov_len;
+      off = 0;
+    }
+    msghdr msg;
+    __builtin_memset( &msg, 0, sizeof( msg ) );
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = niov;
+
+    // large sends can bypass the copy into kernel buffers
+    int flags = MSG_NOSIGNAL;
+    if ( zlen_ && len >= zlen_ ) {
+      if ( !zon_ ) {
+        int val = 1;
+        zon_ = 0 == ::setsockopt(
+            get_fd(), SOL_SOCKET, SO_ZEROCOPY, &val, sizeof( val ) );
+        if ( !zon_ ) {
+          zlen_ = 0;
         }
       }
+      if ( zon_ ) {
+        flags |= MSG_ZEROCOPY;
+      }
+    }
+    ssize_t rc = ::sendmsg( get_fd(), &msg, flags );
+    ++nsend_;
+    if ( rc > 0 || ( rc == 0 && len == 0 ) ) {
+      nbytes_ += rc;
+      advance_send( rc, flags & MSG_ZEROCOPY );
+      if ( !whd_ ) {
+        if ( get_net_loop() ) {
+          get_net_loop()->add( this, PC_EPOLL_FLAGS );
+        }
+        break;
+      }
+      // short write means the socket buffer is full
+      if ( (size_t)rc < len ) {
+        break;
+      }
+    } else if ( rc < 0 && errno == ENOBUFS && ( flags & MSG_ZEROCOPY ) ) {
+      // out of pinned memory so revert to copying
+      zlen_ = 0;
     } else {
-      // check if this is not a try again sort of error
+      // check if this is not a try again sort of error. send failures
+      // are reported as write errors
       if ( rc == 0 || errno != EAGAIN ) {
-        poll_error( true );
+        poll_error( false );
       }
       break;
     }
   }
+  if ( nbytes != nbytes_ ) {
+    on_sent();
+  }
+}
+
+void net_connect::advance_send( size_t len, bool is_zc )
+{
+  while( whd_ ) {
+    size_t left = whd_->size_ - wsz_;
+    if ( len < left ) {
+      if ( len && is_zc ) {
+        wzc_ = zseq_;
+      }
+      wsz_ += len;
+      break;
+    }
+    if ( left && is_zc ) {
+      wzc_ = zseq_;
+    }
+    len -= left;
+    release_send();
+  }
+  if ( !whd_ ) {
+    wtl_ = nullptr;
+  }
+  if ( is_zc ) {
+    ++zseq_;
+  }
+}
+
+void net_connect::release_send()
+{
+  // pages of zero-copy buffers are owned by the kernel until the
+  // completion notification arrives on the socket error queue
+  net_buf *nxt = whd_->next_;
+  if ( wzc_ >= 0 ) {
+    zc_buf zb;
+    zb.buf_ = whd_;
+    zb.seq_ = (uint32_t)wzc_;
+    zq_.push_back( zb );
+    wzc_ = -1;
+  } else {
+    whd_->dealloc();
+  }
+  whd_ = nxt;
+  wsz_ = 0;
+}
+
+void net_connect::poll_zero_copy()
+{
+  char cbuf[128];
+  while( !zq_.empty() ) {
+    msghdr msg;
+    __builtin_memset( &msg, 0, sizeof( msg ) );
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof( cbuf );
+    if ( ::recvmsg( get_fd(), &msg, MSG_ERRQUEUE ) < 0 ) {
+      break;
+    }
+    for( cmsghdr *cm = CMSG_FIRSTHDR( &msg ); cm;
+         cm = CMSG_NXTHDR( &msg, cm ) ) {
+      if ( !( cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR ) &&
+           !( cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      sock_extended_err *ee = (sock_extended_err*)CMSG_DATA( cm );
+      if ( ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY ) {
+        continue;
+      }
+      // completions cover the sequence range [ee_info,ee_data]
+      while( !zq_.empty() &&
+             (int32_t)( zq_.front().seq_ - ee->ee_data ) <= 0 ) {
+        zq_.front().buf_->dealloc();
+        zq_.pop_front();
+      }
+    }
+  }
 }
 
 void net_connect::poll_recv()
 {
   while( !get_is_err() ) {
-    // extend read buffer as required
-    size_t len = rdr_.size() - rsz_;
-    if ( len < buf_len ) {
-      rdr_.resize( rdr_.size() + buf_len );
+    // grow read buffer if a single message fills it
+    if ( rdr_.get_avail() == 0 &&
+         !rdr_.init( std::max( buf_len, 2*rdr_.get_capacity() ) ) ) {
+      set_err_msg( "failed to allocate read buffer" );
+      break;
     }
-    // read up to buf_len at a time
-    ssize_t rc = ::recv( get_fd(), &rdr_[rsz_], buf_len, MSG_NOSIGNAL );
+    ssize_t rc = ::recv(
+        get_fd(), rdr_.get_write(), rdr_.get_avail(), MSG_NOSIGNAL );
+    ++nrecv_;
     if ( rc > 0 ) {
-      rsz_ += rc;
+      rdr_.commit( rc );
     } else {
       if ( rc == 0 || errno != EAGAIN ) {
         poll_error( true );
       }
       break;
     }
-    // parse content
-    for( size_t idx=0; !get_is_err() && rsz_; ) {
+    parse_recv();
+  }
+  // shrink read buffer once a spike has drained
+  if ( rdr_.get_size() == 0 && rdr_.get_capacity() > buf_len ) {
+    rdr_.init( buf_len );
+  }
+}
+
+void net_connect::add_recv( const char *buf, size_t len )
+{
+  // parse straight out of the caller's buffer if nothing is pending
+  if ( rdr_.get_size() == 0 ) {
+    while( !get_is_err() && len ) {
       size_t rlen = 0;
-      if ( np_->parse( &rdr_[idx], rsz_, rlen ) ) {
-        idx  += rlen;
-        rsz_ -= rlen;
+      if ( np_->parse( buf, len, rlen ) ) {
+        buf += rlen;
+        len -= rlen;
       } else {
-        // shuffle remaining bytes to beginning of buffer
-        if ( idx ) {
-          __builtin_memmove( &rdr_[0], &rdr_[idx], rsz_ );
-        }
         break;
       }
     }
+    if ( !len || get_is_err() ) {
+      if ( rdr_.get_capacity() > buf_len ) {
+        rdr_.init( buf_len );
+      }
+      return;
+    }
+  }
+  // append remainder to read buffer
+  if ( rdr_.get_avail() < len ) {
+    size_t cap = std::max( buf_len, rdr_.get_capacity() );
+    while( cap - rdr_.get_size() < len ) {
+      cap *= 2;
+    }
+    if ( !rdr_.init( cap ) ) {
+      set_err_msg( "failed to allocate read buffer" );
+      return;
+    }
+  }
+  __builtin_memcpy( rdr_.get_write(), buf, len );
+  rdr_.commit( len );
+  parse_recv();
+}
+
+void net_connect::parse_recv()
+{
+  rhwm_ = std::max( rhwm_, rdr_.get_size() );
+  chwm_ = std::max( chwm_, rdr_.get_capacity() );
+  while( !get_is_err() && rdr_.get_size() ) {
+    size_t rlen = 0;
+    if ( np_->parse( rdr_.get_read(), rdr_.get_size(), rlen ) ) {
+      rdr_.consume( rlen );
+    } else {
+      break;
+    }
   }
 }
 
@@ -508,8 +1639,19 @@ void net_connect::teardown()
     whd_ = nxt;
   }
   wtl_ = nullptr;
+  nqueue_ = nbytes_;
+  for( zc_buf& zb: zq_ ) {
+    zb.buf_->dealloc();
+  }
+  zq_.clear();
+  zon_ = false;
+  zseq_ = 0;
+  wzc_ = -1;
   rdr_.clear();
-  rsz_ = wsz_ = 0;
+  if ( rdr_.get_capacity() > buf_len ) {
+    rdr_.reset();
+  }
+  wsz_ = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -573,12 +1715,28 @@ void net_listen::poll()
 ///////////////////////////////////////////////////////////////////////////
 // tcp_connect
 
+net_resolve_sub::~net_resolve_sub()
+{
+}
+
 tcp_connect::tcp_connect()
 : port_(-1),
   wait_( false ),
   sts_( 0L ),
   timeout_( 10000000000L )
 {
+  wt_.cp_ = this;
+  tm_.cp_ = this;
+}
+
+tcp_connect::~tcp_connect()
+{
+  net_loop *lp = get_net_loop();
+  if ( lp && wait_ ) {
+    lp->get_resolver()->cancel( this );
+    lp->del( &wt_ );
+    lp->del_timer( &tm_ );
+  }
 }
 
 void tcp_connect::set_host( const std::string& hostn )
@@ -601,20 +1759,20 @@ int tcp_connect::get_port() const
   return port_;
 }
 
-static bool get_hname_addr( const std::string& name, sockaddr *saddr )
+static bool get_hname_addr( const std::string& name, uint32_t& addr )
 {
-  memset( saddr, 0, sizeof( sockaddr ) );
   bool has_addr = false;
   addrinfo hints[1];
   memset( hints, 0, sizeof( addrinfo ) );
   hints->ai_family   = AF_INET;
+  hints->ai_socktype = SOCK_STREAM;
   addrinfo *ainfo[1] = { nullptr };
-  if ( 0 > ::getaddrinfo( name.c_str(), nullptr, nullptr, ainfo ) ) {
+  if ( 0 != ::getaddrinfo( name.c_str(), nullptr, hints, ainfo ) ) {
     return false;
   }
   for( addrinfo *aptr = ainfo[0]; aptr; aptr = aptr->ai_next ) {
     if ( aptr->ai_family == hints->ai_family ) {
-      __builtin_memcpy( saddr, aptr->ai_addr, sizeof( sockaddr ) );
+      addr = ((sockaddr_in*)aptr->ai_addr)->sin_addr.s_addr;
       has_addr = true;
       break;
     }
@@ -632,69 +1790,136 @@ bool tcp_connect::get_is_wait()
 
 bool tcp_connect::init()
 {
-  wait_ = false;
   teardown();
   reset_err();
+  sts_  = get_now();
+  wait_ = true;
+  net_loop *lp = get_net_loop();
+  if ( lp ) {
+    lp->add_timer( &tm_, sts_ + timeout_ );
+    lp->get_resolver()->resolve( host_, this );
+  } else {
+    uint32_t addr = 0;
+    bool ok = get_hname_addr( host_, addr );
+    on_resolve( ok, addr );
+  }
+  return !get_is_err();
+}
+
+void tcp_connect::on_resolve( bool ok, uint32_t addr )
+{
+  if ( !ok ) {
+    on_error( "failed to resolve host" );
+    return;
+  }
   int fd = ::socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
   if ( fd < 0 ) {
-    return set_err_msg( "failed to construct tcp socket", errno );
-  }
-  sockaddr saddr[1];
-  if ( !get_hname_addr( host_, saddr ) ) {
-    return set_err_msg( "failed to resolve host" );
+    on_error( "failed to construct tcp socket", errno );
+    return;
   }
   set_fd( fd );
   set_block( false );
-  sockaddr_in *iaddr = (sockaddr_in*)saddr;
-  iaddr->sin_port = htons( (uint16_t)port_ );
-  if ( 0 != ::connect( fd, saddr, sizeof( sockaddr ) ) ) {
-    if ( errno != EINPROGRESS ) {
-      return set_err_msg( "failed to connect", errno );
-    }
-    sts_ = get_now();
-    wait_ = true;
+  apply_net_profile();
+  sockaddr_in saddr[1];
+  __builtin_memset( saddr, 0, sizeof( saddr ) );
+  saddr->sin_family      = AF_INET;
+  saddr->sin_addr.s_addr = addr;
+  saddr->sin_port        = htons( (uint16_t)port_ );
+  if ( 0 == ::connect( fd, (sockaddr*)saddr, sizeof( saddr ) ) ) {
+    on_connect();
+  } else if ( errno != EINPROGRESS ) {
+    on_error( "failed to connect", errno );
+  } else if ( get_net_loop() ) {
+    // wait for socket to become writable
+    wt_.set_fd( fd );
+    wt_.set_net_loop( get_net_loop() );
+    get_net_loop()->add( &wt_, EPOLLOUT|EPOLLET|EPOLLHUP|EPOLLERR );
+  }
+}
+
+void tcp_connect::tcp_connect_wait::poll()
+{
+  // possibly connected or failed
+  int stat = 0;
+  socklen_t slen = sizeof( stat );
+  int rc = getsockopt( get_fd(), SOL_SOCKET, SO_ERROR, &stat, &slen );
+  if ( rc!=0 || stat!=0 ) {
+    cp_->on_error( "failed to connect tcp socket", stat?stat:errno );
+  } else {
+    cp_->on_connect();
+  }
+}
+
+void tcp_connect::tcp_connect_timer::on_timer()
+{
+  if ( cp_->wait_ ) {
+    cp_->on_error( "timeout trying to connect" );
+  }
+}
+
+void tcp_connect::on_connect()
+{
+  // hand socket over from connect waiter to the loop
+  net_loop *lp = get_net_loop();
+  wait_ = false;
+  if ( lp ) {
+    lp->del( &wt_ );
+    wt_.set_fd( -1 );
+    lp->del_timer( &tm_ );
+    lp->add( this, get_is_send() ? PC_EPOLL_FLAGS|EPOLLOUT : PC_EPOLL_FLAGS );
+  }
+}
+
+void tcp_connect::on_error( const char *msg, int err )
+{
+  teardown();
+  if ( err ) {
+    set_err_msg( msg, err );
+  } else {
+    set_err_msg( msg );
+  }
+}
+
+void tcp_connect::poll()
+{
+  if ( !wait_ ) {
+    net_connect::poll();
   }
-  return true;
 }
 
 void tcp_connect::teardown()
 {
+  net_loop *lp = get_net_loop();
+  if ( lp ) {
+    if ( wait_ ) {
+      lp->get_resolver()->cancel( this );
+    }
+    lp->del( &wt_ );
+    lp->del_timer( &tm_ );
+  }
+  wt_.set_fd( -1 );
   net_connect::teardown();
   wait_ = false;
 }
 
 void tcp_connect::check()
 {
-  if ( !wait_ ) return;
-  fd_set rfds[1], wfds[1], efds[1];
-  struct timeval tout[1];
-  tout->tv_sec  = 0;
-  tout->tv_usec = 0;
-  FD_ZERO( rfds );
-  FD_ZERO( wfds );
-  FD_ZERO( efds );
-  FD_SET( get_fd(), efds );
-  FD_SET( get_fd(), wfds );
-  int rsel = ::select( 1 + get_fd(), rfds, wfds, efds, tout );
-  if ( rsel > 0 ) {
-    // possibly connected or failed
-    wait_ = false;
-    int stat = 0;
-    socklen_t slen = sizeof( stat );
-    int rc = getsockopt( get_fd(), SOL_SOCKET, SO_ERROR, &stat, &slen );
-    if ( rc!=0 || stat!=0 ) {
-      set_err_msg( "failed to connect tcp socket", stat?stat:errno );
-    } else {
-      net_socket::init();
+  if ( !get_is_wait() ) {
+    return;
+  }
+  if ( !get_net_loop() ) {
+    // no loop to deliver writability so check socket directly
+    pollfd pfd[1];
+    pfd->fd      = get_fd();
+    pfd->events  = POLLOUT;
+    pfd->revents = 0;
+    if ( ::poll( pfd, 1, 0 ) > 0 ) {
+      wt_.set_fd( get_fd() );
+      wt_.poll();
+      wt_.set_fd( -1 );
+    } else if ( get_now() - sts_ > timeout_ ) {
+      on_error( "timeout trying to connect" );
     }
-  } else if ( rsel< 0 ) {
-    // failed to select socket
-    wait_ = false;
-    set_err_msg( "failed to construct tcp socket", errno );
-  } else if ( get_now() - sts_ > timeout_ ) {
-    // timeout waiting for connection to happen
-    wait_ = false;
-    set_err_msg( "timeout trying to connect" );
   }
 }
 
@@ -748,62 +1973,349 @@ bool tcp_listen::init()
   return net_listen::init();
 }
 
-///////////////////////////////////////////////////////////////////////////
-// udp_socket
+///////////////////////////////////////////////////////////////////////////
+// unix_listen
+
+void unix_listen::set_path( const std::string& path )
+{
+  path_ = path;
+}
+
+std::string unix_listen::get_path() const
+{
+  return path_;
+}
+
+static bool get_unix_addr( const std::string& path, sockaddr_un *uaddr,
+                           socklen_t& alen )
+{
+  __builtin_memset( uaddr, 0, sizeof( sockaddr_un ) );
+  uaddr->sun_family = AF_UNIX;
+  if ( path.empty() || path.size() >= sizeof( uaddr->sun_path ) ) {
+    return false;
+  }
+  __builtin_memcpy( uaddr->sun_path, path.c_str(), path.size() );
+  if ( path[0] == '@' ) {
+    uaddr->sun_path[0] = '\0';
+  }
+  alen = offsetof( sockaddr_un, sun_path ) + path.size();
+  return true;
+}
+
+bool unix_listen::init()
+{
+  close();
+  reset_err();
+  sockaddr_un uaddr[1];
+  socklen_t alen;
+  if ( !get_unix_addr( path_, uaddr, alen ) ) {
+    return set_err_msg( "invalid unix socket path=" + path_ );
+  }
+  int fd = ::socket( AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0 );
+  if ( fd < 0 ) {
+    return set_err_msg( "failed to construct unix socket", errno );
+  }
+  // replace socket file left behind by a previous server unless some
+  // server is still accepting on it
+  struct stat fst[1];
+  if ( path_[0] != '@' && 0 == ::stat( path_.c_str(), fst ) &&
+       S_ISSOCK( fst->st_mode ) ) {
+    if ( 0 == ::connect( fd, (sockaddr*)uaddr, alen ) ) {
+      ::close( fd );
+      return set_err_msg( "unix socket in use path=" + path_ );
+    }
+    ::close( fd );
+    ::unlink( path_.c_str() );
+    fd = ::socket( AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0 );
+    if ( fd < 0 ) {
+      return set_err_msg( "failed to construct unix socket", errno );
+    }
+  }
+  if ( 0 > ::bind( fd, (sockaddr*)uaddr, alen ) ) {
+    ::close( fd );
+    return set_err_msg( "failed to bind to unix socket path=" + path_, errno );
+  }
+  set_fd( fd );
+  return net_listen::init();
+}
+
+void unix_listen::teardown()
+{
+  if ( get_fd() >= 0 && !path_.empty() && path_[0] != '@' ) {
+    ::unlink( path_.c_str() );
+  }
+  net_listen::teardown();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// udp_socket
+
+ip_addr::ip_addr()
+{
+  i_[0] = i_[1] = 0UL;
+}
+
+ip_addr::ip_addr( const ip_addr& obj )
+{
+  i_[0] = obj.i_[0];
+  i_[1] = obj.i_[1];
+}
+
+ip_addr& ip_addr::operator=( const ip_addr& obj )
+{
+  i_[0] = obj.i_[0];
+  i_[1] = obj.i_[1];
+  return *this;
+}
+
+ip_addr::ip_addr( str ap )
+{
+  i_[0] = i_[1] = 0UL;
+  char buf[64];
+  sockaddr_in *sptr = (sockaddr_in*)buf_;
+  sptr->sin_family = AF_INET;
+  for( unsigned i=0; i != ap.len_; ++i ) {
+    buf[i] = ap.str_[i];
+    if ( buf[i] == ':' ) {
+      buf[i++] = '\0';
+      sptr->sin_addr.s_addr = ::inet_addr( buf );
+      sptr->sin_port = htons( str_to_int( &ap.str_[i], ap.len_ - i ) );
+      break;
+    }
+  }
+}
+
+bool udp_socket::init()
+{
+  teardown();
+  reset_err();
+  int fd = ::socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+  if ( fd < 0 ) {
+    return set_err_msg( "failed to construct udp socket", errno );
+  }
+  set_fd( fd );
+  set_block( false );
+  apply_net_profile();
+  return true;
+}
+
+void udp_socket::send( ip_addr *ap, const char *buf, size_t len )
+{
+  sockaddr *saddr = (sockaddr*)ap->buf_;
+  ::sendto( get_fd(), buf, len, MSG_NOSIGNAL,
+      saddr, sizeof( sockaddr_in ) );
+}
+
+///////////////////////////////////////////////////////////////////////////
+// net_wakeup
+
+net_wakeup_sub::~net_wakeup_sub()
+{
+}
+
+net_wakeup::net_wakeup()
+: sub_( nullptr )
+{
+}
+
+void net_wakeup::set_sub( net_wakeup_sub *sub )
+{
+  sub_ = sub;
+}
+
+bool net_wakeup::init()
+{
+  teardown();
+  reset_err();
+  int fd = ::eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC );
+  if ( fd < 0 ) {
+    return set_err_msg( "failed to create eventfd", errno );
+  }
+  set_fd( fd );
+  return net_socket::init();
+}
+
+void net_wakeup::signal()
+{
+  uint64_t val = 1;
+  ssize_t rc = ::write( get_fd(), &val, sizeof( val ) );
+  (void)rc;
+}
+
+void net_wakeup::poll()
+{
+  uint64_t val = 0;
+  ssize_t rc = ::read( get_fd(), &val, sizeof( val ) );
+  (void)rc;
+  if ( sub_ ) {
+    sub_->on_wakeup();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// net_resolver
+
+net_resolver::net_resolver()
+: ttl_( PC_RESOLVE_TTL ),
+  nttl_( PC_RESOLVE_NEG_TTL ),
+  nlook_( 0 ),
+  run_( false )
+{
+}
+
+net_resolver::~net_resolver()
+{
+  teardown();
+}
+
+void net_resolver::set_ttl( int64_t ttl, int64_t neg_ttl )
+{
+  ttl_  = ttl;
+  nttl_ = neg_ttl;
+}
+
+int64_t net_resolver::get_ttl() const
+{
+  return ttl_;
+}
 
-ip_addr::ip_addr()
+int64_t net_resolver::get_neg_ttl() const
 {
-  i_[0] = i_[1] = 0UL;
+  return nttl_;
 }
 
-ip_addr::ip_addr( const ip_addr& obj )
+uint64_t net_resolver::get_num_lookup() const
 {
-  i_[0] = obj.i_[0];
-  i_[1] = obj.i_[1];
+  return nlook_;
 }
 
-ip_addr& ip_addr::operator=( const ip_addr& obj )
+bool net_resolver::init( net_loop *lp )
 {
-  i_[0] = obj.i_[0];
-  i_[1] = obj.i_[1];
-  return *this;
+  teardown();
+  wk_.set_net_loop( lp );
+  wk_.set_sub( this );
+  if ( !wk_.init() ) {
+    return false;
+  }
+  run_ = true;
+  thrd_ = std::thread( &net_resolver::run, this );
+  return true;
 }
 
-ip_addr::ip_addr( str ap )
+void net_resolver::teardown()
 {
-  i_[0] = i_[1] = 0UL;
-  char buf[64];
-  sockaddr_in *sptr = (sockaddr_in*)buf_;
-  sptr->sin_family = AF_INET;
-  for( unsigned i=0; i != ap.len_; ++i ) {
-    buf[i] = ap.str_[i];
-    if ( buf[i] == ':' ) {
-      buf[i++] = '\0';
-      sptr->sin_addr.s_addr = ::inet_addr( buf );
-      sptr->sin_port = htons( str_to_int( &ap.str_[i], ap.len_ - i ) );
+  if ( thrd_.joinable() ) {
+    {
+      std::lock_guard<std::mutex> lck( mtx_ );
+      run_ = false;
+    }
+    cv_.notify_one();
+    thrd_.join();
+  }
+  wk_.close();
+  rq_.clear();
+  dq_.clear();
+  wait_.clear();
+}
+
+void net_resolver::resolve( const std::string& host, net_resolve_sub *sub )
+{
+  int64_t now = get_now();
+  cache_t::iterator it = cache_.find( host );
+  if ( it != cache_.end() && now < it->second.exp_ ) {
+    sub->on_resolve( it->second.ok_, it->second.addr_ );
+    return;
+  }
+
+  // look up in place if resolver thread failed to start
+  if ( !thrd_.joinable() ) {
+    entry& ent = cache_[host];
+    ent.addr_ = 0;
+    ent.ok_   = get_hname_addr( host, ent.addr_ );
+    ent.exp_  = now + ( ent.ok_ ? ttl_ : nttl_ );
+    ++nlook_;
+    sub->on_resolve( ent.ok_, ent.addr_ );
+    return;
+  }
+
+  // only one lookup in flight per host
+  bool has_req = false;
+  for( const waiter& w: wait_ ) {
+    if ( w.host_ == host ) {
+      has_req = true;
       break;
     }
   }
+  waiter w = { host, sub };
+  wait_.push_back( w );
+  if ( !has_req ) {
+    {
+      std::lock_guard<std::mutex> lck( mtx_ );
+      rq_.push_back( host );
+    }
+    cv_.notify_one();
+  }
 }
 
-bool udp_socket::init()
+void net_resolver::cancel( net_resolve_sub *sub )
 {
-  teardown();
-  reset_err();
-  int fd = ::socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
-  if ( fd < 0 ) {
-    return set_err_msg( "failed to construct udp socket", errno );
+  for( size_t i=0; i != wait_.size(); ) {
+    if ( wait_[i].sub_ == sub ) {
+      wait_.erase( wait_.begin() + i );
+    } else {
+      ++i;
+    }
   }
-  set_fd( fd );
-  set_block( false );
-  return true;
 }
 
-void udp_socket::send( ip_addr *ap, const char *buf, size_t len )
+void net_resolver::on_wakeup()
 {
-  sockaddr *saddr = (sockaddr*)ap->buf_;
-  ::sendto( get_fd(), buf, len, MSG_NOSIGNAL,
-      saddr, sizeof( sockaddr_in ) );
+  res_vec_t res;
+  {
+    std::lock_guard<std::mutex> lck( mtx_ );
+    res.swap( dq_ );
+  }
+  int64_t now = get_now();
+  std::vector<net_resolve_sub*> svec;
+  for( std::pair<std::string,entry>& r: res ) {
+    entry& ent = r.second;
+    ent.exp_ = now + ( ent.ok_ ? ttl_ : nttl_ );
+    cache_[r.first] = ent;
+    ++nlook_;
+
+    // detach waiters before callback as they may resolve again
+    svec.clear();
+    for( size_t i=0; i != wait_.size(); ) {
+      if ( wait_[i].host_ == r.first ) {
+        svec.push_back( wait_[i].sub_ );
+        wait_.erase( wait_.begin() + i );
+      } else {
+        ++i;
+      }
+    }
+    for( net_resolve_sub *sub: svec ) {
+      sub->on_resolve( ent.ok_, ent.addr_ );
+    }
+  }
+}
+
+void net_resolver::run()
+{
+  std::unique_lock<std::mutex> lck( mtx_ );
+  while( run_ ) {
+    if ( rq_.empty() ) {
+      cv_.wait( lck );
+      continue;
+    }
+    std::string host = rq_.front();
+    rq_.erase( rq_.begin() );
+    lck.unlock();
+    entry ent = { 0, false, 0L };
+    ent.ok_ = get_hname_addr( host, ent.addr_ );
+    lck.lock();
+    dq_.push_back( std::make_pair( host, ent ) );
+    wk_.signal();
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -832,11 +2344,7 @@ void http_request::add_hdr( const char *hdr, uint64_t ival )
   add( hdr );
   add( ':' );
   add( ' ' );
-  char *buf = reserve( 32 ), *end = &buf[31];
-  char *val = uint_to_str( ival, end );
-  size_t val_len = end - val;
-  __builtin_memmove( buf, val, val_len );
-  advance( val_len );
+  advance( uint_to_buf( ival, reserve( 20 ) ) );
   add( '\r' );
   add( '\n' );
 }
@@ -1077,6 +2585,19 @@ void http_server::upgrade_ws()
   msg.add_hdr( "Connection", "Upgrade" );
   msg.add_hdr( "Upgrade", "websocket" );
   msg.add_hdr( "Sec-WebSocket-Accept", str( bkey, blen ) );
+  str offer;
+  if ( get_header_val( "Sec-WebSocket-Extensions", offer ) ) {
+    std::string ext = wp_->negotiate_deflate( offer );
+    if ( !ext.empty() ) {
+      msg.add_hdr( "Sec-WebSocket-Extensions", ext );
+    }
+  }
+  if ( get_header_val( "Sec-WebSocket-Protocol", offer ) ) {
+    std::string proto = wp_->negotiate_protocol( offer );
+    if ( !proto.empty() ) {
+      msg.add_hdr( "Sec-WebSocket-Protocol", proto );
+    }
+  }
   msg.commit();
   np_->add_send( msg );
 
@@ -1195,14 +2716,6 @@ void ws_connect::ws_connect_init::parse_status(
   }
 }
 
-void ws_connect::check()
-{
-  tcp_connect::check();
-  if ( !tcp_connect::get_is_wait() && !get_is_err() ) {
-    poll();
-  }
-}
-
 bool ws_connect::get_is_wait()
 {
   return tcp_connect::get_is_wait() || (!get_is_err() && !init_.hs_);
@@ -1233,13 +2746,30 @@ struct PC_PACKED ws_hdr3 : public ws_hdr1
 };
 
 void ws_wtr::commit( uint8_t op_code, net_wtr& buf, bool mask )
+{
+  frame( op_code, buf, mask, false );
+}
+
+void ws_wtr::commit( uint8_t op_code, net_wtr& buf, bool mask,
+                     ws_deflate *zp )
+{
+  // messages may be sent uncompressed if compression fails
+  net_wtr cmp;
+  if ( zp && zp->deflate( buf, cmp ) ) {
+    frame( op_code, cmp, mask, true );
+  } else {
+    frame( op_code, buf, mask, false );
+  }
+}
+
+void ws_wtr::frame( uint8_t op_code, net_wtr& buf, bool mask, bool rsv1 )
 {
   size_t pay_len = buf.size();
   char *hdr = reserve( sizeof( ws_hdr3 ) + sizeof( uint32_t ) );
   size_t hdsz = 0;
   ws_hdr1 *hptr1 = (ws_hdr1*)hdr;
   hptr1->fin_  = 1;
-  hptr1->rsv1_ = 0;
+  hptr1->rsv1_ = rsv1;
   hptr1->rsv2_ = 0;
   hptr1->rsv3_ = 0;
   hptr1->mask_ = mask;
@@ -1261,17 +2791,14 @@ void ws_wtr::commit( uint8_t op_code, net_wtr& buf, bool mask )
   // generate mask
   if ( mask ) {
     uint32_t mask_key = random();
-    const char *mptr = &hdr[hdsz];
-    ((uint32_t*)mptr)[0] = mask_key;
+    __builtin_memcpy( &hdr[hdsz], &mask_key, sizeof( mask_key ) );
     hdsz += sizeof( uint32_t );
     advance( hdsz );
     add( buf );
-    unsigned i=0;
+    unsigned off = 0;
     for( net_buf *ptr = hd_; ptr; ptr = ptr->next_ ) {
-      for( char *ibuf = &ptr->buf_[hdsz], *ebuf = &ptr->buf_[ptr->size_];
-           ibuf != ebuf; ++ibuf, ++i ) {
-        *ibuf ^= mptr[i%4];
-      }
+      off = ws_mask::apply(
+          &ptr->buf_[hdsz], ptr->size_ - hdsz, mask_key, off );
       hdsz = 0;
     }
   } else {
@@ -1280,12 +2807,197 @@ void ws_wtr::commit( uint8_t op_code, net_wtr& buf, bool mask )
   }
 }
 
+///////////////////////////////////////////////////////////////////////////
+// ws_mask
+
+// rotate mask key so that its first byte applies to key byte off
+static inline uint32_t ws_mask_rot( uint32_t key, unsigned off )
+{
+  off = 8 * ( off & 3 );
+  return off ? ( key >> off ) | ( key << ( 32 - off ) ) : key;
+}
+
+static void ws_mask_scalar( char *buf, size_t len, uint32_t key )
+{
+  const char *kptr = (const char*)&key;
+  for( size_t i=0; i != len; ++i ) {
+    buf[i] ^= kptr[i&3];
+  }
+}
+
+static void ws_mask_word( char *buf, size_t len, uint32_t key )
+{
+  // 8 bytes at a time. 8 is a multiple of the key length so the key
+  // phase is unchanged for the tail
+  uint64_t key64 = ( (uint64_t)key << 32 ) | key;
+  char *ptr = buf;
+  for( size_t i = len / 8; i; --i, ptr += 8 ) {
+    uint64_t val;
+    __builtin_memcpy( &val, ptr, 8 );
+    val ^= key64;
+    __builtin_memcpy( ptr, &val, 8 );
+  }
+  ws_mask_scalar( ptr, len & 7, key );
+}
+
+#if defined( __x86_64__ )
+
+// unaligned loads and stores cost the same as aligned ones on aligned
+// data on current cpus so no alignment prologue is needed
+static void ws_mask_sse2( char *buf, size_t len, uint32_t key )
+{
+  __m128i kv = _mm_set1_epi32( (int)key );
+  __m128i *ptr = (__m128i*)buf;
+  for( size_t i = len / 16; i; --i, ++ptr ) {
+    _mm_storeu_si128( ptr, _mm_xor_si128( _mm_loadu_si128( ptr ), kv ) );
+  }
+  ws_mask_word( (char*)ptr, len & 15, key );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void ws_mask_avx2( char *buf, size_t len, uint32_t key )
+{
+  __m256i kv = _mm256_set1_epi32( (int)key );
+  __m256i *ptr = (__m256i*)buf;
+  for( size_t i = len / 64; i; --i, ptr += 2 ) {
+    __m256i v0 = _mm256_loadu_si256( ptr );
+    __m256i v1 = _mm256_loadu_si256( ptr + 1 );
+    _mm256_storeu_si256( ptr, _mm256_xor_si256( v0, kv ) );
+    _mm256_storeu_si256( ptr + 1, _mm256_xor_si256( v1, kv ) );
+  }
+  if ( len & 32 ) {
+    _mm256_storeu_si256(
+        ptr, _mm256_xor_si256( _mm256_loadu_si256( ptr ), kv ) );
+    ++ptr;
+  }
+  ws_mask_sse2( (char*)ptr, len & 31, key );
+}
+
+#endif
+
+typedef void (*ws_mask_fn_t)( char *, size_t, uint32_t );
+
+static ws_mask_fn_t ws_mask_fn[ws_mask::e_num_impl] = {
+  ws_mask_scalar,
+  ws_mask_word,
+#if defined( __x86_64__ )
+  ws_mask_sse2,
+  ws_mask_avx2
+#else
+  nullptr,
+  nullptr
+#endif
+};
+
+static ws_mask::impl_t ws_mask_best()
+{
+#if defined( __x86_64__ )
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports( "avx2" ) ) {
+    return ws_mask::e_avx2;
+  }
+  return ws_mask::e_sse2;
+#else
+  return ws_mask::e_word;
+#endif
+}
+
+static ws_mask::impl_t ws_mask_impl = ws_mask_best();
+static ws_mask_fn_t    ws_mask_curr = ws_mask_fn[ws_mask_impl];
+
+unsigned ws_mask::apply( char *buf, size_t len, uint32_t key, unsigned off )
+{
+  ws_mask_curr( buf, len, ws_mask_rot( key, off ) );
+  return ( off + len ) & 3;
+}
+
+bool ws_mask::get_has_impl( impl_t impl )
+{
+  return impl < e_num_impl && ws_mask_fn[impl] && impl <= ws_mask_best();
+}
+
+bool ws_mask::set_impl( impl_t impl )
+{
+  if ( !get_has_impl( impl ) ) {
+    return false;
+  }
+  ws_mask_impl = impl;
+  ws_mask_curr = ws_mask_fn[impl];
+  return true;
+}
+
+ws_mask::impl_t ws_mask::get_impl()
+{
+  return ws_mask_impl;
+}
+
+const char *ws_mask::get_impl_name( impl_t impl )
+{
+  static const char *name[] = { "scalar", "word", "sse2", "avx2" };
+  return impl < e_num_impl ? name[impl] : "unknown";
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // ws_parser
 
 ws_parser::ws_parser()
-: wptr_( nullptr )
+: wptr_( nullptr ),
+  zp_( nullptr ),
+  fpos_( 0 ),
+  flen_( 0 ),
+  fofs_( 0 ),
+  nfrag_( 0UL ),
+  nfcpy_( 0UL ),
+  zlvl_( -1 ),
+  zmsg_( false ),
+  mbin_( false )
+{
+}
+
+ws_parser::~ws_parser()
+{
+  delete zp_;
+}
+
+void ws_parser::set_deflate_level( int zlvl )
+{
+  zlvl_ = zlvl;
+}
+
+int ws_parser::get_deflate_level() const
+{
+  return zlvl_;
+}
+
+std::string ws_parser::negotiate_deflate( str offer )
+{
+  std::string ext;
+  if ( zlvl_ < 0 ) {
+    return ext;
+  }
+  ws_deflate *zp = new ws_deflate;
+  if ( zp->negotiate( offer, zlvl_, ext ) ) {
+    delete zp_;
+    zp_ = zp;
+  } else {
+    delete zp;
+  }
+  return ext;
+}
+
+ws_deflate *ws_parser::get_deflate() const
+{
+  return zp_;
+}
+
+std::string ws_parser::negotiate_protocol( str )
+{
+  return std::string();
+}
+
+bool ws_parser::get_is_binary() const
 {
+  return mbin_;
 }
 
 void ws_parser::set_net_connect( net_connect *wptr )
@@ -1298,43 +3010,84 @@ net_connect *ws_parser::get_net_connect() const
   return wptr_;
 }
 
-bool ws_parser::parse( const char *ptr, size_t len, size_t& res )
+// decoded websocket frame
+struct ws_frame
+{
+  char    *pay_;   // payload
+  uint64_t len_;   // payload length
+  uint64_t sz_;    // total frame length
+  uint32_t key_;   // mask key
+  bool     msk_;   // is masked
+};
+
+// decode frame header. returns false if frame is not yet complete
+static bool ws_decode( const char *ptr, size_t len, ws_frame& frm )
 {
   if ( len < sizeof( ws_hdr1 ) ) return false;
-  char *payload = (char*)ptr;
-  ws_hdr1 *hptr1 = (ws_hdr1*)ptr;
-  uint64_t pay_len = 0, msk_len = hptr1->mask_ ? 4 : 0;
+  const ws_hdr1 *hptr1 = (const ws_hdr1*)ptr;
+  size_t hdr_len;
   if ( hptr1->pay_len1_ < 126 ) {
-    pay_len = hptr1->pay_len1_;
-    payload += sizeof( ws_hdr1 );
-    if ( len < sizeof( ws_hdr1 ) + pay_len + msk_len ) return false;
+    hdr_len = sizeof( ws_hdr1 );
+    frm.len_ = hptr1->pay_len1_;
   } else if ( hptr1->pay_len1_ == 126 ) {
-    if ( len < sizeof( ws_hdr2) ) return false;
-    ws_hdr2 *hptr2 = (ws_hdr2*)ptr;
-    payload += sizeof( ws_hdr2 );
-    pay_len = __builtin_bswap16( hptr2->pay_len2_);
-    if ( len < sizeof( ws_hdr2 ) + pay_len + msk_len ) return false;
+    if ( len < sizeof( ws_hdr2 ) ) return false;
+    hdr_len = sizeof( ws_hdr2 );
+    frm.len_ = __builtin_bswap16( ((const ws_hdr2*)ptr)->pay_len2_ );
   } else {
-    if ( len < sizeof( ws_hdr3) ) return false;
-    ws_hdr3 *hptr3 = (ws_hdr3*)ptr;
-    payload += sizeof( ws_hdr3 );
-    pay_len = __builtin_bswap64( hptr3->pay_len3_ );
-    size_t tot_sz = sizeof( ws_hdr3 ) + pay_len + msk_len;
-    if ( len < tot_sz ) return false;
+    if ( len < sizeof( ws_hdr3 ) ) return false;
+    hdr_len = sizeof( ws_hdr3 );
+    frm.len_ = __builtin_bswap64( ((const ws_hdr3*)ptr)->pay_len3_ );
   }
-  if ( msk_len ) {
-    const char *mask = payload;
-    payload += msk_len;
-    for(unsigned i=0; i != pay_len;++i ) {
-      payload[i] = payload[i] ^ mask[i%4];
-    }
+  frm.key_ = 0;
+  frm.msk_ = hptr1->mask_;
+  if ( frm.msk_ ) {
+    if ( len < hdr_len + sizeof( frm.key_ ) ) return false;
+    __builtin_memcpy( &frm.key_, &ptr[hdr_len], sizeof( frm.key_ ) );
+    hdr_len += sizeof( frm.key_ );
+  }
+  frm.pay_ = (char*)&ptr[hdr_len];
+  frm.sz_  = hdr_len + frm.len_;
+  return frm.sz_ >= frm.len_ && len >= frm.sz_;
+}
+
+static inline void ws_unmask( ws_frame& frm )
+{
+  if ( frm.msk_ ) {
+    ws_mask::apply( frm.pay_, frm.len_, frm.key_ );
+  }
+}
+
+bool ws_parser::parse( const char *ptr, size_t len, size_t& res )
+{
+  // continue reassembling a fragmented message in the receive buffer
+  if ( fofs_ ) {
+    return parse_frag( (char*)ptr, len, res );
+  }
+  ws_frame frm;
+  if ( !ws_decode( ptr, len, frm ) ) return false;
+  const ws_hdr1 *hptr1 = (const ws_hdr1*)ptr;
+  char *payload = frm.pay_;
+  uint64_t pay_len = frm.len_;
+  res = frm.sz_;
+  if ( hptr1->rsv1_ && !zp_ ) {
+    set_err_msg( "unexpected compressed frame" );
+    return true;
   }
-  res = pay_len + ( payload - ptr );
+  ws_unmask( frm );
   switch( hptr1->op_code_ ) {
     case ws_wtr::text_id:
     case ws_wtr::binary_id:{
+      zmsg_ = hptr1->rsv1_;
+      mbin_ = hptr1->op_code_ == ws_wtr::binary_id;
       if ( hptr1->fin_ ) {
-        parse_msg( payload, pay_len );
+        parse_frame( payload, pay_len, zmsg_ );
+        zmsg_ = false;
+      } else if ( msg_.empty() ) {
+        // wait for the remaining fragments and join them in place
+        fpos_ = payload - ptr;
+        flen_ = pay_len;
+        fofs_ = frm.sz_;
+        return parse_frag( (char*)ptr, len, res );
       } else {
         msg_.insert( msg_.end(), payload, &payload[pay_len] );
       }
@@ -1343,8 +3096,9 @@ bool ws_parser::parse( const char *ptr, size_t len, size_t& res )
     case ws_wtr::cont_id:{
       msg_.insert( msg_.end(), payload, &payload[pay_len] );
       if ( hptr1->fin_ ) {
-        parse_msg( msg_.data(), msg_.size() );
+        parse_frame( msg_.data(), msg_.size(), zmsg_ );
         msg_.clear();
+        zmsg_ = false;
       }
       break;
     }
@@ -1352,7 +3106,7 @@ bool ws_parser::parse( const char *ptr, size_t len, size_t& res )
       net_wtr ping;
       ping.add( str( payload, pay_len ) );
       ws_wtr msg;
-      msg.commit( ws_wtr::pong_id, ping, msk_len==0 );
+      msg.commit( ws_wtr::pong_id, ping, !frm.msk_ );
       wptr_->add_send( msg );
       break;
     }
@@ -1362,7 +3116,7 @@ bool ws_parser::parse( const char *ptr, size_t len, size_t& res )
     case ws_wtr::close_id:{
       net_wtr cmsg;
       ws_wtr msg;
-      msg.commit( ws_wtr::close_id, cmsg, msk_len==0 );
+      msg.commit( ws_wtr::close_id, cmsg, !frm.msk_ );
       wptr_->add_send( msg );
       break;
     }
@@ -1375,10 +3129,258 @@ bool ws_parser::parse( const char *ptr, size_t len, size_t& res )
   return true;
 }
 
+bool ws_parser::parse_frag( char *ptr, size_t len, size_t& res )
+{
+  // continuation payloads are moved down over the preceding frame
+  // headers so that the message ends up contiguous after the first
+  // fragment's payload. frames are only consumed once the final one
+  // has arrived (the receive buffer grows as needed)
+  for(;;) {
+    ws_frame frm;
+    if ( !ws_decode( &ptr[fofs_], len - fofs_, frm ) ) {
+      return false;
+    }
+    const ws_hdr1 *hptr1 = (const ws_hdr1*)&ptr[fofs_];
+    if ( hptr1->op_code_ != ws_wtr::cont_id ) {
+      // control frame between fragments: consume the fragments so far
+      // and fall back to copying the remainder of the message
+      ++nfcpy_;
+      msg_.assign( &ptr[fpos_], &ptr[fpos_ + flen_] );
+      res = fofs_;
+      fofs_ = 0;
+      return true;
+    }
+    ws_unmask( frm );
+    __builtin_memmove( &ptr[fpos_ + flen_], frm.pay_, frm.len_ );
+    flen_ += frm.len_;
+    fofs_ += frm.sz_;
+    if ( hptr1->fin_ ) {
+      ++nfrag_;
+      res = fofs_;
+      fofs_ = 0;
+      bool is_cmp = zmsg_;
+      zmsg_ = false;
+      parse_frame( &ptr[fpos_], flen_, is_cmp );
+      return true;
+    }
+  }
+}
+
+void ws_parser::reset()
+{
+  msg_.clear();
+  fofs_ = 0;
+  zmsg_ = false;
+}
+
+uint64_t ws_parser::get_num_frag() const
+{
+  return nfrag_;
+}
+
+uint64_t ws_parser::get_num_frag_copy() const
+{
+  return nfcpy_;
+}
+
+void ws_parser::parse_frame( const char *buf, size_t len, bool is_cmp )
+{
+  if ( !is_cmp ) {
+    parse_msg( buf, len );
+    return;
+  }
+  str msg;
+  if ( zp_->inflate( buf, len, msg ) ) {
+    parse_msg( msg.str_, msg.len_ );
+  } else {
+    set_err_msg( zp_->get_err_msg() );
+  }
+}
+
 void ws_parser::parse_msg( const char *, size_t )
 {
 }
 
+///////////////////////////////////////////////////////////////////////////
+// ws_deflate
+
+ws_deflate::ws_deflate()
+: nraw_( 0UL ),
+  ncmp_( 0UL ),
+  dctx_( true ),
+  ictx_( true ),
+  init_( false )
+{
+  __builtin_memset( &dz_, 0, sizeof( dz_ ) );
+  __builtin_memset( &iz_, 0, sizeof( iz_ ) );
+}
+
+ws_deflate::~ws_deflate()
+{
+  if ( init_ ) {
+    ::deflateEnd( &dz_ );
+    ::inflateEnd( &iz_ );
+  }
+}
+
+bool ws_deflate::init( int level, int wbits )
+{
+  if ( init_ ) {
+    ::deflateEnd( &dz_ );
+    ::inflateEnd( &iz_ );
+    init_ = false;
+  }
+  // negative window bits for raw deflate streams. inflate always uses
+  // the max. window which handles any window the client deflates with
+  level = std::min( level, Z_BEST_COMPRESSION );
+  if ( Z_OK != deflateInit2(
+        &dz_, level, Z_DEFLATED, -wbits, 8, Z_DEFAULT_STRATEGY ) ) {
+    return set_err_msg( "failed to initialize deflate" );
+  }
+  if ( Z_OK != inflateInit2( &iz_, -15 ) ) {
+    ::deflateEnd( &dz_ );
+    return set_err_msg( "failed to initialize inflate" );
+  }
+  init_ = true;
+  return true;
+}
+
+static std::string ws_trim( const std::string& txt )
+{
+  size_t i = txt.find_first_not_of( " \t\"" );
+  if ( i == std::string::npos ) {
+    return std::string();
+  }
+  size_t j = txt.find_last_not_of( " \t\"" );
+  return txt.substr( i, 1 + j - i );
+}
+
+bool ws_deflate::negotiate( str offer, int level, std::string& ext )
+{
+  // accept first permessage-deflate offer with parameters we support
+  std::string txt = offer.as_string();
+  for( size_t i = 0; i < txt.size(); ) {
+    size_t j = std::min( txt.find( ',', i ), txt.size() );
+    std::string off = txt.substr( i, j - i ), resp;
+    i = j + 1;
+    bool ok = true, sctx = true, cctx = true;
+    int wbits = 15;
+    for( size_t k = 0, n = 0; ok && k <= off.size(); ++n ) {
+      size_t e = std::min( off.find( ';', k ), off.size() );
+      std::string par = off.substr( k, e - k ), val;
+      k = e + 1;
+      size_t q = par.find( '=' );
+      if ( q != std::string::npos ) {
+        val = ws_trim( par.substr( q + 1 ) );
+        par = par.substr( 0, q );
+      }
+      par = ws_trim( par );
+      if ( n == 0 ) {
+        ok = par == "permessage-deflate";
+      } else if ( par == "server_no_context_takeover" ) {
+        sctx = false;
+        resp += "; server_no_context_takeover";
+      } else if ( par == "client_no_context_takeover" ) {
+        cctx = false;
+        resp += "; client_no_context_takeover";
+      } else if ( par == "server_max_window_bits" ) {
+        // zlib cannot deflate raw streams with an 8-bit window
+        wbits = ::atoi( val.c_str() );
+        ok = wbits >= 9 && wbits <= 15;
+        resp += "; server_max_window_bits=" + std::to_string( wbits );
+      } else if ( par == "client_max_window_bits" ) {
+        ok = val.empty() || ( ::atoi( val.c_str() ) >= 8 &&
+                              ::atoi( val.c_str() ) <= 15 );
+      } else {
+        ok = false;
+      }
+    }
+    if ( ok && init( level, wbits ) ) {
+      dctx_ = sctx;
+      ictx_ = cctx;
+      ext = "permessage-deflate" + resp;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ws_deflate::deflate( const net_wtr& msg, net_wtr& out )
+{
+  // compress with a sync flush then strip the trailing empty block
+  size_t len = 0;
+  for( net_buf *ptr = msg.hd_; ptr; ptr = ptr->next_ ) {
+    dz_.next_in  = (Bytef*)ptr->buf_;
+    dz_.avail_in = ptr->size_;
+    int flush = ptr->next_ ? Z_NO_FLUSH : Z_SYNC_FLUSH;
+    do {
+      if ( dbuf_.size() - len < 64 ) {
+        dbuf_.resize( 2*dbuf_.size() + 1024 );
+      }
+      dz_.next_out  = (Bytef*)&dbuf_[len];
+      dz_.avail_out = dbuf_.size() - len;
+      if ( Z_STREAM_ERROR == ::deflate( &dz_, flush ) ) {
+        return set_err_msg( "failed to deflate message" );
+      }
+      len = dbuf_.size() - dz_.avail_out;
+    } while( dz_.avail_in || dz_.avail_out == 0 );
+  }
+  if ( len < 4 ) {
+    return set_err_msg( "failed to deflate message" );
+  }
+  len -= 4;
+  if ( !dctx_ ) {
+    ::deflateReset( &dz_ );
+  }
+  nraw_ += msg.size();
+  ncmp_ += len;
+  out.add( str( dbuf_.data(), len ) );
+  return true;
+}
+
+bool ws_deflate::inflate( const char *buf, size_t len, str& out )
+{
+  // restore the empty block trailer stripped by the sender
+  static const char tail[] = { 0, 0, (char)0xff, (char)0xff };
+  size_t olen = 0;
+  int rc = Z_OK;
+  for( unsigned n = 0; n != 2 && rc != Z_STREAM_END; ++n ) {
+    iz_.next_in  = (Bytef*)( n ? tail : buf );
+    iz_.avail_in = n ? sizeof( tail ) : len;
+    while( rc != Z_STREAM_END && ( iz_.avail_in || iz_.avail_out == 0 ) ) {
+      if ( ibuf_.size() - olen < 1024 ) {
+        if ( ibuf_.size() >= PC_WS_INFLATE_MAX ) {
+          return set_err_msg( "inflated message too large" );
+        }
+        ibuf_.resize( 2*ibuf_.size() + 4096 );
+      }
+      iz_.next_out  = (Bytef*)&ibuf_[olen];
+      iz_.avail_out = ibuf_.size() - olen;
+      rc = ::inflate( &iz_, Z_SYNC_FLUSH );
+      olen = ibuf_.size() - iz_.avail_out;
+      if ( rc != Z_OK && rc != Z_BUF_ERROR && rc != Z_STREAM_END ) {
+        ::inflateReset( &iz_ );
+        return set_err_msg( "failed to inflate message" );
+      }
+    }
+  }
+  if ( !ictx_ || rc == Z_STREAM_END ) {
+    ::inflateReset( &iz_ );
+  }
+  out = str( ibuf_.data(), olen );
+  return true;
+}
+
+uint64_t ws_deflate::get_num_raw_bytes() const
+{
+  return nraw_;
+}
+
+uint64_t ws_deflate::get_num_cmp_bytes() const
+{
+  return ncmp_;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // json_wtr
 
@@ -1547,20 +3549,12 @@ void json_wtr::add_val_enc_base64( str val )
 
 void json_wtr::add_uint( uint64_t ival )
 {
-  char *buf = reserve( 32 ), *end = &buf[31];
-  char *val = uint_to_str( ival, end );
-  size_t val_len = end - val;
-  __builtin_memmove( buf, val, val_len );
-  advance( val_len );
+  advance( uint_to_buf( ival, reserve( 20 ) ) );
 }
 
 void json_wtr::add_int( int64_t ival )
 {
-  char *buf = reserve( 32 ), *end = &buf[31];
-  char *val = int_to_str( ival, end );
-  size_t val_len = end - val;
-  __builtin_memmove( buf, val, val_len );
-  advance( val_len );
+  advance( int_to_buf( ival, reserve( 21 ) ) );
 }
 
 void json_wtr::add_enc_base58( str val )
@@ -4,20 +4,54 @@
 #include <pc/key_pair.hpp>
 #include <pc/misc.hpp>
 #include <sys/epoll.h>
+#include <zlib.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
+#include <deque>
 
 namespace pc
 {
 
-  // network message buffer
+  // net_buf allocator statistics for one size class
+  struct net_buf_stats
+  {
+    uint64_t live_; // buffers in use
+    uint64_t free_; // buffers cached for reuse
+    uint64_t peak_; // peak number of buffers in use
+    uint64_t sys_;  // bytes mapped from the system (less trimmed pages)
+  };
+
+  // network message buffer. buffers come in several size classes and
+  // buf_ extends to cap_ bytes; len is the capacity of the smallest
   struct net_buf
   {
-    static const uint16_t len = 1270;
+    static const uint16_t len = 1264;
+    static const unsigned num_class = 4;
     net_buf *next_;
-    uint16_t size_;
+    uint16_t size_;  // bytes used
+    uint16_t cap_;   // capacity of buf_
+    uint16_t cls_;   // allocator size class
+    uint16_t trim_;  // pages past the first returned to the system
     char     buf_[len];
     void dealloc();
+
+    // allocate smallest size class buffer
     static net_buf *alloc();
+
+    // allocate smallest buffer with capacity of at least len bytes
+    // (or the largest size class if none is big enough)
+    static net_buf *alloc( size_t len );
+
+    // size class capacities and allocator statistics
+    static uint16_t get_class_capacity( unsigned cls );
+    static void get_stats( unsigned cls, net_buf_stats& );
+
+    // map buffer slabs using huge pages (must be set before first alloc)
+    static void set_huge_pages( bool );
+    static bool get_huge_pages();
   };
 
   // network message writer
@@ -30,16 +64,22 @@ namespace pc
     void add( str );
     void add( net_wtr& );
     void detach( net_buf *&hd, net_buf *&tl );
+    void attach( net_buf *hd, net_buf *tl );
     size_t size() const;
     void print() const;
     void reset();
 
+    // size hint: make room for about len more bytes in the tail buffer
+    // so that a message of known size is written without chaining
+    void prealloc( size_t len );
+
   protected:
     void add_alloc( str );
-    void alloc();
+    void alloc( size_t len );
     void dealloc();
     void advance( size_t len );
     char *reserve( size_t len );
+    friend class ws_deflate;
     net_buf *hd_;
     net_buf *tl_;
     size_t   sz_;
@@ -55,15 +95,140 @@ namespace pc
     virtual bool parse( const char *buf, size_t sz, size_t& len ) = 0;
   };
 
+  // receive ring buffer mapped twice back-to-back in virtual memory so
+  // that any span of unread bytes is contiguous without copying
+  class net_ring
+  {
+  public:
+    net_ring();
+    ~net_ring();
+
+    // (re)allocate ring keeping any unread bytes. capacity is rounded
+    // up to a power-of-two number of pages
+    bool init( size_t cap );
+
+    // capacity and number of unread bytes
+    size_t get_capacity() const;
+    size_t get_size() const;
+
+    // contiguous unread bytes and space available to write
+    char *get_read() const;
+    char *get_write();
+    size_t get_avail() const;
+
+    // advance write or read positions
+    void commit( size_t len );
+    void consume( size_t len );
+
+    // discard all unread bytes
+    void clear();
+
+    // release mapping
+    void reset();
+
+  private:
+    net_ring( const net_ring& );
+    net_ring& operator=( const net_ring& );
+
+    char    *buf_; // start of (double) mapped region
+    size_t   cap_; // ring capacity
+    uint64_t rd_;  // read offset
+    uint64_t wr_;  // write offset
+    bool     dbl_; // double mapped (otherwise linear buffer)
+  };
+
+  class net_wheel;
+
+  // timer callback scheduled on a net_loop
+  class net_timer
+  {
+  public:
+    net_timer();
+    virtual ~net_timer();
+
+    // timer expired
+    virtual void on_timer() = 0;
+
+    // is timer scheduled
+    bool get_is_active() const;
+
+    // scheduled expiry time in nanoseconds (see get_now())
+    int64_t get_expiry() const;
+
+  private:
+    friend class net_wheel;
+    net_timer  *next_;  // next timer in slot
+    net_timer **pprev_; // link to this timer in slot
+    int64_t     exp_;   // expiry time
+    int         lvl_;   // wheel level (-1 = firing)
+    unsigned    idx_;   // wheel slot
+  };
+
+  // hierarchical timing wheel with ~1us resolution. each level has 64
+  // slots and covers 64 times the span of the level below, so that
+  // timers are added and removed in constant time and cascaded down a
+  // level as the wheel turns. timers beyond the top level are parked
+  // at its end and re-placed when it is cascaded
+  class net_wheel
+  {
+  public:
+    net_wheel();
+
+    // add or re-schedule timer to fire at time ts
+    void add( net_timer *, int64_t ts );
+
+    // cancel timer
+    void del( net_timer * );
+
+    // fire all timers due at or before time now. also advances an empty
+    // wheel to the current time so should be called once before use
+    void expire( int64_t now );
+
+    // start of earliest tick with timers (or cascade) due. zero if empty
+    int64_t get_next() const;
+
+    // number of scheduled timers
+    size_t get_size() const;
+
+  private:
+
+    static const unsigned tick_bits  = 10;
+    static const unsigned slot_bits  = 6;
+    static const unsigned num_slot   = 1U<<slot_bits;
+    static const unsigned slot_mask  = num_slot - 1;
+    static const unsigned num_level  = 5;
+
+    void place( net_timer * );
+    void unlink( net_timer * );
+    uint64_t get_next_tick() const;
+
+    uint64_t   cur_;                       // next unprocessed tick
+    size_t     num_;                       // number of timers
+    uint64_t   occ_[num_level];            // slot occupancy bitmaps
+    net_timer *slot_[num_level][num_slot]; // timer lists
+    net_timer *fire_;                      // timers being fired
+  };
+
   class net_socket;
+  class net_connect;
+  class net_uring;
+  class net_resolver;
 
-  // epoll-based loop
+  // epoll-based loop with optional io_uring backend
   class net_loop : public error
   {
   public:
     net_loop();
     ~net_loop();
 
+    // use io_uring rather than epoll (set before init). falls back to
+    // epoll if io_uring is unavailable
+    void set_use_uring( bool );
+    bool get_use_uring() const;
+
+    // is the io_uring backend in use
+    bool get_is_uring() const;
+
     // initialize
     bool init();
 
@@ -71,18 +236,83 @@ namespace pc
     void add( net_socket *, int events );
     void del( net_socket * );
 
+    // queue send of connection writer queue (io_uring only)
+    void send( net_connect * );
+
     // poll all connected sockets
     bool poll( int timeout );
 
+    // number of system calls waiting for or submitting events
+    uint64_t get_num_wait() const;
+
+    // schedule or cancel timer at absolute time ts (see get_now())
+    void add_timer( net_timer *, int64_t ts );
+    void del_timer( net_timer * );
+
+    // fire expired timers. called by poll but may also be called from
+    // busy-poll loops that poll their sockets directly
+    void poll_timer();
+
+    // host name resolver delivering results in this loop. the resolver
+    // thread is started on first use
+    net_resolver *get_resolver();
+
   private:
 
+    void arm_timer();
+
     static const int max_events_ = 128;
 
     int         fd_;                 // epoll file descriptor
+    bool        use_uring_;          // io_uring requested
+    net_uring  *up_;                 // io_uring backend
+    net_resolver *rp_;               // host name resolver
+    uint64_t    nwait_;              // number of epoll_wait calls
+    net_socket *tp_;                 // timerfd socket
+    int64_t     tts_;                // timerfd expiry (0 = disarmed)
+    net_wheel   wh_;                 // timer wheel
     epoll_event ev_[1];              // event used in epoll_ctl
     epoll_event evarr_[max_events_]; // receive events
   };
 
+  // socket transport options applied when a socket is created or
+  // accepted. a default profile leaves all system defaults in place
+  struct net_profile
+  {
+    // connection roles with separately configured profiles
+    typedef enum {
+      e_rpc_http = 0, // solana rpc http connection
+      e_rpc_ws,       // solana rpc websocket connection
+      e_tx,           // connection to pyth_tx proxy
+      e_user,         // accepted client connections
+      e_udp,          // udp sends to tpu leaders
+      e_num_role
+    } role_t;
+
+    net_profile();
+
+    // role name as used on the command line (e.g. "rpc_http")
+    static const char *get_role_name( role_t );
+
+    // parse <role>:<options> as given on the command line
+    static bool parse_role( const std::string&, role_t&, net_profile& );
+
+    // parse comma separated options nodelay, quickack, sndbuf=<bytes>,
+    // rcvbuf=<bytes>, busy_poll=<usecs> and prio=<0-6>. returns false
+    // on unknown options
+    bool init_from_str( const std::string& );
+
+    // options in same format enclosed in brackets for logging
+    std::string to_str() const;
+
+    bool nodelay_;   // TCP_NODELAY
+    bool quickack_;  // TCP_QUICKACK (set once at connection start)
+    int  sndbuf_;    // SO_SNDBUF (0 = system default)
+    int  rcvbuf_;    // SO_RCVBUF (0 = system default)
+    int  busy_poll_; // SO_BUSY_POLL usecs (0 = system default)
+    int  prio_;      // SO_PRIORITY (-1 = system default)
+  };
+
   // socket-based network source
   class net_socket : public error
   {
@@ -109,6 +339,15 @@ namespace pc
     void set_in_loop( bool );
     bool get_in_loop() const;
 
+    // transport options
+    void set_net_profile( const net_profile& );
+    const net_profile& get_net_profile() const;
+
+    // apply transport options to socket. tcp options are ignored for
+    // unix domain sockets. options that cannot be set are skipped and
+    // false returned
+    bool apply_net_profile();
+
     // initialize
     virtual bool init();
 
@@ -119,9 +358,10 @@ namespace pc
     virtual void teardown();
 
   private:
-    int        fd_;  // socket
-    bool       inl_; // in-loop flag
-    net_loop  *lp_;  // optional event_loop
+    int         fd_;   // socket
+    bool        inl_;  // in-loop flag
+    net_loop   *lp_;   // optional event_loop
+    net_profile prof_; // transport options
   };
 
   // read/write client connection
@@ -142,24 +382,92 @@ namespace pc
     // add message to send queue
     void add_send( net_wtr& );
 
+    // add chain of buffers hd through tl to send queue
+    void add_send( net_buf *hd, net_buf *tl );
+
+    // send len bytes of file fd whose contents are also mapped at buf.
+    // uses sendfile when nothing else is queued and queues whatever
+    // the socket does not take from the mapping
+    void add_send_file( int fd, const char *buf, size_t len );
+
     // any messages in the send queue
     bool get_is_send() const;
 
+    // bytes queued but not yet sent
+    size_t get_send_queue() const;
+
+    // called after queued messages were written to the socket
+    virtual void on_sent();
+
+    // number of recv system calls
+    uint64_t get_num_recv() const;
+
+    // receive ring statistics: high-water mark of unread bytes and
+    // of ring capacity
+    size_t get_recv_hwm() const;
+    size_t get_recv_cap_hwm() const;
+
+    // send with MSG_ZEROCOPY when at least this many bytes are pending
+    // (zero turns zero-copy off which is the default)
+    void set_zero_copy( size_t min_len );
+    size_t get_zero_copy() const;
+
+    // send statistics: number of poll_send flushes, number of send
+    // system calls and total bytes sent
+    uint64_t get_num_flush() const;
+    uint64_t get_num_send() const;
+    uint64_t get_num_send_bytes() const;
+
+    // bytes sent directly from files with sendfile
+    uint64_t get_num_send_file() const;
+
     // drop all outbound messages
     void teardown() override;
 
   protected:
 
-    typedef std::vector<char> buf_t;
-    static const size_t buf_len = 2048;
+    friend class net_uring;
+
+    static const size_t buf_len = 64*1024;
+    static const int    max_iov = 64;
     void poll_error( bool );
+    bool get_is_uring() const;
+    void add_recv( const char *buf, size_t len );
+    void parse_recv();
 
-    buf_t       rdr_; // inbound message read buffer
+    net_ring    rdr_; // inbound message read buffer
     net_buf    *whd_; // head of writer queue
     net_buf    *wtl_; // tail of writer queue
-    size_t      rsz_; // current read position
+    size_t      rhwm_;// high-water mark of unread bytes
+    size_t      chwm_;// high-water mark of read buffer capacity
     uint16_t    wsz_; // current write position
     net_parser *np_;  // message parser
+
+  private:
+
+    // buffer sent with MSG_ZEROCOPY awaiting kernel completion
+    struct zc_buf {
+      net_buf *buf_;
+      uint32_t seq_;
+    };
+
+    typedef std::deque<zc_buf> zc_que_t;
+
+    void advance_send( size_t len, bool is_zc );
+    void release_send();
+    void poll_zero_copy();
+
+    uint64_t    nflush_; // number of poll_send flushes
+    uint64_t    nsend_;  // number of send system calls
+    uint64_t    nbytes_; // number of bytes sent
+    uint64_t    nrecv_;  // number of recv system calls
+    uint64_t    nqueue_; // number of bytes queued
+    uint64_t    nfile_;  // number of bytes sent with sendfile
+    size_t      zlen_;   // min. pending bytes to send as zero-copy
+    uint32_t    zseq_;   // next zero-copy send sequence number
+    int64_t     wzc_;    // zero-copy sequence of head of writer queue
+    bool        zon_;    // zero-copy enabled on socket
+    zc_que_t    zq_;     // zero-copy buffers awaiting completion
   };
 
   // new client acceptor for net_listen
@@ -197,12 +505,24 @@ namespace pc
     net_accept *ap_;
   };
 
-  // tcp connector or client
-  class tcp_connect : public net_connect
+  // host name resolution callback
+  class net_resolve_sub
+  {
+  public:
+    virtual ~net_resolve_sub();
+
+    // ipv4 address in network byte order (if ok)
+    virtual void on_resolve( bool ok, uint32_t addr ) = 0;
+  };
+
+  // tcp connector or client. host names are resolved and connections
+  // completed asynchronously via the associated net_loop
+  class tcp_connect : public net_connect, public net_resolve_sub
   {
   public:
 
     tcp_connect();
+    ~tcp_connect();
 
     // connection host
     void set_host( const std::string& );
@@ -219,21 +539,46 @@ namespace pc
     // (re)connect to host
     bool init() override;
 
+    // ignored while waiting to connect
+    void poll() override;
+
     // teardown connection
     void teardown() override;
 
-    // check connection status
+    // check connection status. with a net_loop progress is delivered
+    // by its events alone so this only checks connections without one
     virtual void check();
 
     // are we waiting to connect
     virtual bool get_is_wait();
 
+    // resolved host address
+    void on_resolve( bool ok, uint32_t addr ) override;
+
   private:
+
+    // socket registered for writability while connecting
+    struct tcp_connect_wait : public net_socket {
+      void poll() override;
+      tcp_connect *cp_;
+    };
+
+    // connection timeout
+    struct tcp_connect_timer : public net_timer {
+      void on_timer() override;
+      tcp_connect *cp_;
+    };
+
+    void on_connect();
+    void on_error( const char *msg, int err = 0 );
+
     int         port_; // connection port
     bool        wait_; // is waiting to connect
     std::string host_; // connection host
     int64_t     sts_;  // start connect time
     int64_t     timeout_;
+    tcp_connect_wait  wt_;
+    tcp_connect_timer tm_;
   };
 
   // listening tcp server
@@ -252,6 +597,26 @@ namespace pc
     int port_; // listening port
   };
 
+  // unix domain stream socket listening server for co-located clients.
+  // a path starting with '@' names a socket in the abstract namespace
+  // which leaves nothing behind in the filesystem
+  class unix_listen : public net_listen
+  {
+  public:
+    // socket path
+    void set_path( const std::string& );
+    std::string get_path() const;
+
+    // fails if another server is accepting on the same path
+    bool init() override;
+
+    // stop listening and remove socket file
+    void teardown() override;
+
+  private:
+    std::string path_; // socket path
+  };
+
   struct ip_addr
   {
     ip_addr();
@@ -270,6 +635,104 @@ namespace pc
     void send( ip_addr *, const char *buf, size_t len );
   };
 
+  // net_wakeup notification callback
+  class net_wakeup_sub
+  {
+  public:
+    virtual ~net_wakeup_sub();
+    virtual void on_wakeup() = 0;
+  };
+
+  // eventfd used to wake up a net_loop from other threads
+  class net_wakeup : public net_socket
+  {
+  public:
+    net_wakeup();
+
+    // callback on wakeup in loop thread
+    void set_sub( net_wakeup_sub * );
+
+    // create eventfd and add to loop
+    bool init() override;
+
+    // wake up loop (may be called from any thread)
+    void signal();
+
+    // consume wakeups and call back subscriber
+    void poll() override;
+
+  private:
+    net_wakeup_sub *sub_;
+  };
+
+  // resolves host names to ipv4 addresses using getaddrinfo on a
+  // background thread so that lookups never block the loop. results
+  // are cached and delivered back in the loop thread
+  class net_resolver : public net_wakeup_sub
+  {
+  public:
+    net_resolver();
+    ~net_resolver();
+
+    // how long resolved and failed lookups are cached in nanoseconds.
+    // getaddrinfo does not report record ttls so these are fixed
+    void set_ttl( int64_t ttl, int64_t neg_ttl );
+    int64_t get_ttl() const;
+    int64_t get_neg_ttl() const;
+
+    // start resolver thread delivering results to loop
+    bool init( net_loop * );
+
+    // stop resolver thread
+    void teardown();
+
+    // resolve host. calls back immediately if cached otherwise from
+    // the loop once the lookup completes
+    void resolve( const std::string& host, net_resolve_sub * );
+
+    // cancel outstanding callbacks to subscriber
+    void cancel( net_resolve_sub * );
+
+    // number of lookups performed by the resolver thread
+    uint64_t get_num_lookup() const;
+
+    // deliver completed lookups
+    void on_wakeup() override;
+
+  private:
+
+    struct entry {
+      uint32_t addr_;    // resolved address
+      bool     ok_;      // lookup succeeded
+      int64_t  exp_;     // cache expiry time
+    };
+
+    struct waiter {
+      std::string      host_;
+      net_resolve_sub *sub_;
+    };
+
+    typedef std::unordered_map<std::string,entry> cache_t;
+    typedef std::vector<std::string>              host_vec_t;
+    typedef std::vector<std::pair<std::string,entry>> res_vec_t;
+    typedef std::vector<waiter>                   wait_vec_t;
+
+    void run();
+
+    int64_t      ttl_;   // cache time for resolved hosts
+    int64_t      nttl_;  // cache time for failed lookups
+    uint64_t     nlook_; // number of lookups
+    cache_t      cache_; // cached lookups
+    wait_vec_t   wait_;  // subscribers waiting on lookups
+    net_wakeup   wk_;    // wakeup loop with results
+    host_vec_t   rq_;    // requested lookups (guarded by mtx_)
+    res_vec_t    dq_;    // completed lookups (guarded by mtx_)
+    bool         run_;   // thread running (guarded by mtx_)
+    std::mutex   mtx_;
+    std::condition_variable cv_;
+    std::thread  thrd_;
+  };
+
   // http request message
   class http_request : public net_wtr
   {
@@ -340,6 +803,69 @@ namespace pc
     net_connect *np_;
   };
 
+  // permessage-deflate (rfc 7692) websocket compression context. the
+  // deflate and inflate streams carry their sliding window across
+  // messages unless no_context_takeover was negotiated for that side
+  class ws_deflate : public error
+  {
+  public:
+    ws_deflate();
+    ~ws_deflate();
+
+    // negotiate from Sec-WebSocket-Extensions offer header. returns
+    // false if there is no acceptable permessage-deflate offer.
+    // otherwise ext is set to the extension response header value
+    bool negotiate( str offer, int level, std::string& ext );
+
+    // compress message payload. returns false on error
+    bool deflate( const net_wtr& msg, net_wtr& out );
+
+    // decompress message payload
+    bool inflate( const char *buf, size_t len, str& out );
+
+    // uncompressed and compressed outbound message bytes
+    uint64_t get_num_raw_bytes() const;
+    uint64_t get_num_cmp_bytes() const;
+
+  private:
+    ws_deflate( const ws_deflate& );
+    ws_deflate& operator=( const ws_deflate& );
+
+    bool init( int level, int wbits );
+
+    typedef std::vector<char> buf_t;
+
+    z_stream  dz_;    // deflate stream
+    z_stream  iz_;    // inflate stream
+    buf_t     dbuf_;  // deflate output
+    buf_t     ibuf_;  // inflate output
+    uint64_t  nraw_;  // uncompressed bytes sent
+    uint64_t  ncmp_;  // compressed bytes sent
+    bool      dctx_;  // deflate context takeover
+    bool      ictx_;  // inflate context takeover
+    bool      init_;  // streams initialized
+  };
+
+  // websocket payload masking. kernels xor a buffer with the 4-byte
+  // mask key; the widest one supported by the cpu is chosen at startup
+  class ws_mask
+  {
+  public:
+    typedef enum { e_scalar = 0, e_word, e_sse2, e_avx2, e_num_impl } impl_t;
+
+    // xor len bytes with mask key (in wire byte order) starting at key
+    // byte off. returns key byte offset for the byte following buf so
+    // that a payload may be masked across a buffer chain
+    static unsigned apply( char *buf, size_t len, uint32_t key,
+                           unsigned off = 0 );
+
+    // override kernel selection. returns false if cpu lacks support
+    static bool set_impl( impl_t );
+    static impl_t get_impl();
+    static bool get_has_impl( impl_t );
+    static const char *get_impl_name( impl_t );
+  };
+
   // websocket message builder
   class ws_wtr : public net_wtr
   {
@@ -353,6 +879,12 @@ namespace pc
     static const uint8_t pong_id   = 0xa;
 
     void commit( uint8_t opcode, net_wtr&, bool mask );
+
+    // compress data frame payload if zp is not null
+    void commit( uint8_t opcode, net_wtr&, bool mask, ws_deflate *zp );
+
+  private:
+    void frame( uint8_t opcode, net_wtr&, bool mask, bool rsv1 );
   };
 
   class tx_sub
@@ -371,6 +903,9 @@ namespace pc
     bool get_is_connect() const;
     void set_sub( tx_sub* );
     void reconnect();
+
+    // time of next reconnect attempt
+    int64_t get_reconnect_time() const;
   private:
     bool    has_conn_;
     bool    wait_conn_;
@@ -385,7 +920,6 @@ namespace pc
   public:
     ws_connect();
     bool init() override;
-    void check() override;
     bool get_is_wait() override;
 
   private:
@@ -403,21 +937,61 @@ namespace pc
   {
   public:
     ws_parser();
+    ~ws_parser();
 
     // connection to send control message replies
     void set_net_connect( net_connect * );
     net_connect *get_net_connect() const;
 
+    // zlib compression level to accept permessage-deflate offers with
+    // on upgrade (-1=off - the default)
+    void set_deflate_level( int );
+    int get_deflate_level() const;
+
+    // negotiate permessage-deflate from upgrade request offer. returns
+    // extension response header value or empty if not negotiated
+    std::string negotiate_deflate( str offer );
+
+    // negotiated compression context or null if not in use
+    ws_deflate *get_deflate() const;
+
+    // select sub-protocol from Sec-WebSocket-Protocol offer on upgrade.
+    // returns protocol response header value or empty if none accepted
+    virtual std::string negotiate_protocol( str offer );
+
+    // was the current message sent as binary (rather than text) frames
+    bool get_is_binary() const;
+
     // parse websocket protocol
     bool parse( const char *buf, size_t sz, size_t& len ) override;
 
     // callback on websocket message
     virtual void parse_msg( const char *buf, size_t sz );
 
+    // discard any partial message (e.g. on reconnect)
+    void reset();
+
+    // fragmented messages reassembled in the receive buffer and those
+    // that fell back to copying (control frame between fragments)
+    uint64_t get_num_frag() const;
+    uint64_t get_num_frag_copy() const;
+
   protected:
+    void parse_frame( const char *buf, size_t sz, bool is_cmp );
+    bool parse_frag( char *buf, size_t sz, size_t& len );
+
     typedef std::vector<char> buf_t;
-    buf_t        msg_;
+    buf_t        msg_;   // fallback fragment reassembly
     net_connect *wptr_;
+    ws_deflate  *zp_;    // compression context
+    size_t       fpos_;  // in-place message payload offset
+    size_t       flen_;  // in-place message length so far
+    size_t       fofs_;  // next fragment offset (0=none pending)
+    uint64_t     nfrag_; // in-place reassembled messages
+    uint64_t     nfcpy_; // copied reassembly fallbacks
+    int          zlvl_;  // compression level
+    bool         zmsg_;  // fragmented message is compressed
+    bool         mbin_;  // current message is binary
   };
 
   class json_wtr : public net_wtr
@@ -479,6 +1053,51 @@ namespace pc
   /////////////////////////////////////////////////////////////////////////
   // inline impl.
 
+  inline size_t net_ring::get_capacity() const
+  {
+    return cap_;
+  }
+
+  inline size_t net_ring::get_size() const
+  {
+    return wr_ - rd_;
+  }
+
+  inline char *net_ring::get_read() const
+  {
+    return &buf_[rd_ & ( cap_ - 1 )];
+  }
+
+  inline size_t net_ring::get_avail() const
+  {
+    return cap_ - ( wr_ - rd_ );
+  }
+
+  inline void net_ring::commit( size_t len )
+  {
+    wr_ += len;
+  }
+
+  inline void net_ring::consume( size_t len )
+  {
+    rd_ += len;
+  }
+
+  inline bool net_timer::get_is_active() const
+  {
+    return pprev_ != nullptr;
+  }
+
+  inline int64_t net_timer::get_expiry() const
+  {
+    return exp_;
+  }
+
+  inline size_t net_wheel::get_size() const
+  {
+    return num_;
+  }
+
   inline bool ip_addr::operator==( const ip_addr& obj ) const
   {
     return i_[0] == obj.i_[0] && i_[1] == obj.i_[1];
@@ -489,6 +1108,11 @@ namespace pc
     return has_conn_;
   }
 
+  inline int64_t tx_connect::get_reconnect_time() const
+  {
+    return cts_ + ctimeout_;
+  }
+
   inline unsigned http_server::get_num_header() const
   {
     return hnms_.size();
@@ -0,0 +1,519 @@
+#include "net_uring.hpp"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+
+#define PC_URING_LOAD(X)     __atomic_load_n( X, __ATOMIC_ACQUIRE )
+#define PC_URING_STORE(X,Y)  __atomic_store_n( X, Y, __ATOMIC_RELEASE )
+
+// io_uring_buf_ring::bufs is declared as a flexible array member which
+// gets padded in c++ so index the ring directly
+#define PC_URING_BUF(R,I)    ( ((io_uring_buf*)(R)) + (I) )
+
+using namespace pc;
+
+net_uring::net_uring()
+: fd_( -1 ),
+  rmem_( nullptr ),
+  rlen_( 0 ),
+  sqes_( nullptr ),
+  slen_( 0 ),
+  sqhd_( nullptr ),
+  sqtl_( nullptr ),
+  sqfl_( nullptr ),
+  sqmk_( 0 ),
+  sqnm_( 0 ),
+  cqhd_( nullptr ),
+  cqtl_( nullptr ),
+  cqmk_( 0 ),
+  cqes_( nullptr ),
+  nsub_( 0 ),
+  br_( nullptr ),
+  rbuf_( nullptr ),
+  brtl_( 0 ),
+  nent_( 0 )
+{
+}
+
+net_uring::~net_uring()
+{
+  if ( rbuf_ ) {
+    ::munmap( rbuf_, num_rbuf * rbuf_len );
+  }
+  if ( br_ ) {
+    ::munmap( br_, num_rbuf * sizeof( io_uring_buf ) );
+  }
+  if ( sqes_ ) {
+    ::munmap( sqes_, slen_ );
+  }
+  if ( rmem_ ) {
+    ::munmap( rmem_, rlen_ );
+  }
+  if ( fd_ >= 0 ) {
+    ::close( fd_ );
+  }
+  for( op_t *op: ofree_ ) {
+    delete op;
+  }
+}
+
+bool net_uring::init()
+{
+  // prefer deferring completion work to our own calls into the kernel
+  io_uring_params prm;
+  __builtin_memset( &prm, 0, sizeof( prm ) );
+  prm.flags = IORING_SETUP_SUBMIT_ALL |
+              IORING_SETUP_COOP_TASKRUN |
+              IORING_SETUP_TASKRUN_FLAG;
+  fd_ = ::syscall( __NR_io_uring_setup, num_entries, &prm );
+  if ( fd_ < 0 ) {
+    __builtin_memset( &prm, 0, sizeof( prm ) );
+    fd_ = ::syscall( __NR_io_uring_setup, num_entries, &prm );
+  }
+  if ( fd_ < 0 ) {
+    return set_err_msg( "failed to create io_uring", errno );
+  }
+  unsigned feat = IORING_FEAT_SINGLE_MMAP |
+                  IORING_FEAT_NODROP |
+                  IORING_FEAT_EXT_ARG;
+  if ( ( prm.features & feat ) != feat ) {
+    return set_err_msg( "unsupported io_uring version" );
+  }
+
+  // map submission and completion rings
+  size_t sqsz = prm.sq_off.array + prm.sq_entries * sizeof( unsigned );
+  size_t cqsz = prm.cq_off.cqes + prm.cq_entries * sizeof( io_uring_cqe );
+  rlen_ = std::max( sqsz, cqsz );
+  void *mem = ::mmap( nullptr, rlen_, PROT_READ|PROT_WRITE,
+      MAP_SHARED|MAP_POPULATE, fd_, IORING_OFF_SQ_RING );
+  if ( mem == MAP_FAILED ) {
+    return set_err_msg( "failed to map io_uring", errno );
+  }
+  rmem_ = (char*)mem;
+  slen_ = prm.sq_entries * sizeof( io_uring_sqe );
+  mem = ::mmap( nullptr, slen_, PROT_READ|PROT_WRITE,
+      MAP_SHARED|MAP_POPULATE, fd_, IORING_OFF_SQES );
+  if ( mem == MAP_FAILED ) {
+    return set_err_msg( "failed to map io_uring", errno );
+  }
+  sqes_ = (io_uring_sqe*)mem;
+  sqhd_ = (unsigned*)( rmem_ + prm.sq_off.head );
+  sqtl_ = (unsigned*)( rmem_ + prm.sq_off.tail );
+  sqfl_ = (unsigned*)( rmem_ + prm.sq_off.flags );
+  sqmk_ = *(unsigned*)( rmem_ + prm.sq_off.ring_mask );
+  sqnm_ = prm.sq_entries;
+  cqhd_ = (unsigned*)( rmem_ + prm.cq_off.head );
+  cqtl_ = (unsigned*)( rmem_ + prm.cq_off.tail );
+  cqmk_ = *(unsigned*)( rmem_ + prm.cq_off.ring_mask );
+  cqes_ = (io_uring_cqe*)( rmem_ + prm.cq_off.cqes );
+
+  // submission queue entries are always used in ring order
+  unsigned *sqar = (unsigned*)( rmem_ + prm.sq_off.array );
+  for( unsigned i=0; i != sqnm_; ++i ) {
+    sqar[i] = i;
+  }
+
+  // register ring of provided buffers for multishot recv
+  mem = ::mmap( nullptr, num_rbuf * sizeof( io_uring_buf ),
+      PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+  if ( mem == MAP_FAILED ) {
+    return set_err_msg( "failed to map buffer ring", errno );
+  }
+  br_ = (io_uring_buf_ring*)mem;
+  mem = ::mmap( nullptr, num_rbuf * rbuf_len,
+      PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+  if ( mem == MAP_FAILED ) {
+    return set_err_msg( "failed to map receive buffers", errno );
+  }
+  rbuf_ = (char*)mem;
+  io_uring_buf_reg reg;
+  __builtin_memset( &reg, 0, sizeof( reg ) );
+  reg.ring_addr    = (uint64_t)br_;
+  reg.ring_entries = num_rbuf;
+  reg.bgid         = 0;
+  if ( 0 > ::syscall( __NR_io_uring_register,
+        fd_, IORING_REGISTER_PBUF_RING, &reg, 1 ) ) {
+    return set_err_msg( "failed to register buffer ring", errno );
+  }
+  for( unsigned i=0; i != num_rbuf; ++i ) {
+    io_uring_buf *bptr = PC_URING_BUF( br_, i );
+    bptr->addr = (uint64_t)&rbuf_[i*rbuf_len];
+    bptr->len  = rbuf_len;
+    bptr->bid  = i;
+  }
+  brtl_ = num_rbuf;
+  PC_URING_STORE( &br_->tail, brtl_ );
+
+  // provided buffer rings (5.19) predate multishot recv (6.0)
+  if ( !check_recv() ) {
+    return set_err_msg( "io_uring multishot recv unsupported" );
+  }
+  return true;
+}
+
+bool net_uring::check_recv()
+{
+  // older kernels fail multishot recv with EINVAL so try one on a
+  // socketpair. completions have no op and are skipped by poll
+  int sv[2];
+  if ( 0 > ::socketpair( AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, sv ) ) {
+    return false;
+  }
+  char ch = 0;
+  bool is_ok = 1 == ::write( sv[1], &ch, 1 );
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode    = IORING_OP_RECV;
+  sqe->fd        = sv[0];
+  sqe->ioprio    = IORING_RECV_MULTISHOT;
+  sqe->flags     = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = 0;
+  sqe->user_data = 0;
+  is_ok = is_ok && enter( 1, 1000 );
+  unsigned head = *cqhd_;
+  unsigned tail = PC_URING_LOAD( cqtl_ );
+  is_ok = is_ok && head != tail;
+  for( ; head != tail; ++head ) {
+    io_uring_cqe cqe = cqes_[head & cqmk_];
+    PC_URING_STORE( cqhd_, head + 1 );
+    is_ok = is_ok && cqe.res == 1 && ( cqe.flags & IORING_CQE_F_MORE );
+    if ( cqe.flags & IORING_CQE_F_BUFFER ) {
+      unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+      io_uring_buf *bptr = PC_URING_BUF( br_, brtl_ & (num_rbuf-1) );
+      bptr->addr = (uint64_t)&rbuf_[bid*rbuf_len];
+      bptr->len  = rbuf_len;
+      bptr->bid  = bid;
+      PC_URING_STORE( &br_->tail, ++brtl_ );
+    }
+  }
+
+  // closing the peer ends the multishot recv without using a buffer
+  ::close( sv[1] );
+  ::close( sv[0] );
+  return is_ok;
+}
+
+uint64_t net_uring::get_num_enter() const
+{
+  return nent_;
+}
+
+void net_uring::reserve( unsigned num )
+{
+  // submit pending entries if there is not enough room
+  unsigned used = *sqtl_ - PC_URING_LOAD( sqhd_ );
+  if ( PC_UNLIKELY( sqnm_ - used < num ) ) {
+    enter( 0, 0 );
+  }
+}
+
+io_uring_sqe *net_uring::get_sqe()
+{
+  reserve( 1 );
+  unsigned tail = *sqtl_;
+  io_uring_sqe *sqe = &sqes_[tail & sqmk_];
+  __builtin_memset( sqe, 0, sizeof( io_uring_sqe ) );
+  PC_URING_STORE( sqtl_, tail + 1 );
+  ++nsub_;
+  return sqe;
+}
+
+bool net_uring::enter( unsigned min_complete, int timeout )
+{
+  unsigned flags = 0;
+  io_uring_getevents_arg arg;
+  __builtin_memset( &arg, 0, sizeof( arg ) );
+  __kernel_timespec ts;
+  if ( min_complete ) {
+    flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    if ( timeout >= 0 ) {
+      ts.tv_sec  = timeout / 1000;
+      ts.tv_nsec = ( timeout % 1000 ) * PC_NSECS_IN_MSEC;
+      arg.ts = (uint64_t)&ts;
+    }
+  } else if ( PC_URING_LOAD( sqfl_ ) &
+      ( IORING_SQ_TASKRUN | IORING_SQ_CQ_OVERFLOW ) ) {
+    flags = IORING_ENTER_GETEVENTS;
+  }
+  ++nent_;
+  int rc = ::syscall( __NR_io_uring_enter, fd_, nsub_, min_complete,
+      flags, flags & IORING_ENTER_EXT_ARG ? &arg : nullptr, sizeof( arg ) );
+  if ( rc > 0 ) {
+    nsub_ -= std::min( (unsigned)rc, nsub_ );
+  }
+  return rc >= 0 || errno == ETIME || errno == EINTR;
+}
+
+bool net_uring::poll( int timeout )
+{
+  unsigned head = *cqhd_;
+  unsigned tail = PC_URING_LOAD( cqtl_ );
+  bool is_wait = head == tail && timeout != 0;
+  if ( nsub_ || is_wait || ( PC_URING_LOAD( sqfl_ ) &
+        ( IORING_SQ_TASKRUN | IORING_SQ_CQ_OVERFLOW ) ) ) {
+    enter( is_wait ? 1 : 0, timeout );
+    tail = PC_URING_LOAD( cqtl_ );
+  }
+  bool has_cqe = head != tail;
+  for( ; head != tail; ++head ) {
+    io_uring_cqe cqe = cqes_[head & cqmk_];
+    PC_URING_STORE( cqhd_, head + 1 );
+    op_t *op = (op_t*)cqe.user_data;
+    if ( !op ) {
+      continue;
+    }
+    switch( op->type_ ) {
+      case e_recv: on_recv( op, &cqe ); break;
+      case e_send: on_send( op, &cqe ); break;
+      case e_poll: on_poll( op, &cqe ); break;
+    }
+  }
+  return has_cqe;
+}
+
+void net_uring::add( net_socket *sp, int events )
+{
+  // only the first add arms a request. later calls toggle EPOLLOUT
+  // which is not needed as sends complete asynchronously
+  int fd = sp->get_fd();
+  if ( sp->get_in_loop() || fd < 0 ) {
+    return;
+  }
+  if ( (size_t)fd >= svec_.size() ) {
+    sock_t st = { nullptr, nullptr, nullptr };
+    svec_.resize( fd + 1, st );
+  }
+  sock_t& st = svec_[fd];
+  net_connect *cp = dynamic_cast<net_connect*>( sp );
+  st.sp_  = sp;
+  st.wop_ = nullptr;
+  st.rop_ = alloc_op( sp, cp ? e_recv : e_poll );
+  st.rop_->evt_ = events;
+  sp->set_in_loop( true );
+  arm( st.rop_ );
+
+  // send anything queued before joining the loop
+  if ( cp && cp->whd_ ) {
+    send( cp );
+  }
+}
+
+void net_uring::del( net_socket *sp )
+{
+  int fd = sp->get_fd();
+  if ( fd >= 0 && (size_t)fd < svec_.size() && svec_[fd].sp_ == sp ) {
+    sock_t& st = svec_[fd];
+    if ( st.rop_ ) {
+      cancel( st.rop_ );
+    }
+    if ( st.wop_ ) {
+      cancel( st.wop_ );
+    }
+    st.sp_ = nullptr;
+    st.rop_ = st.wop_ = nullptr;
+  }
+  sp->set_in_loop( false );
+}
+
+void net_uring::teardown( net_socket *sp )
+{
+  del( sp );
+  sp->teardown();
+}
+
+void net_uring::send( net_connect *cp )
+{
+  int fd = cp->get_fd();
+  if ( fd < 0 || (size_t)fd >= svec_.size() || svec_[fd].sp_ != cp ) {
+    return;
+  }
+  sock_t& st = svec_[fd];
+  if ( st.wop_ || !cp->whd_ || cp->get_is_err() ) {
+    return;
+  }
+  ++cp->nflush_;
+
+  // detach head of writer queue. only one chain is in flight at a time
+  // as separate chains are not ordered with respect to each other
+  unsigned num = 0;
+  net_buf *tl = nullptr;
+  for( net_buf *ptr = cp->whd_; ptr && num != max_chain; ptr = ptr->next_ ) {
+    tl = ptr;
+    ++num;
+  }
+  op_t *op = alloc_op( cp, e_send );
+  op->hd_  = cp->whd_;
+  op->num_ = num;
+  cp->whd_ = tl->next_;
+  tl->next_ = nullptr;
+  if ( !cp->whd_ ) {
+    cp->wtl_ = nullptr;
+  }
+  uint16_t off = cp->wsz_;
+  cp->wsz_ = 0;
+  st.wop_ = op;
+
+  // link sends so they are written in order. the whole chain has to
+  // go into the same submission
+  reserve( num );
+  for( net_buf *ptr = op->hd_; ptr; ptr = ptr->next_ ) {
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)&ptr->buf_[off];
+    sqe->len       = ptr->size_ - off;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->flags     = ptr->next_ ? IOSQE_IO_LINK : 0;
+    sqe->user_data = (uint64_t)op;
+    off = 0;
+  }
+}
+
+void net_uring::arm( op_t *op )
+{
+  io_uring_sqe *sqe = get_sqe();
+  sqe->fd = op->sp_->get_fd();
+  sqe->user_data = (uint64_t)op;
+  if ( op->type_ == e_recv ) {
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+  } else {
+    sqe->opcode        = IORING_OP_POLL_ADD;
+    sqe->len           = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = op->evt_;
+  }
+}
+
+void net_uring::cancel( op_t *op )
+{
+  op->sp_ = nullptr;
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+  sqe->fd           = -1;
+  sqe->addr         = (uint64_t)op;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+  sqe->user_data    = 0;
+}
+
+void net_uring::on_recv( op_t *op, io_uring_cqe *cqe )
+{
+  if ( cqe->flags & IORING_CQE_F_BUFFER ) {
+    unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    char *buf = &rbuf_[bid*rbuf_len];
+    if ( op->sp_ && cqe->res > 0 ) {
+      static_cast<net_connect*>( op->sp_ )->add_recv( buf, cqe->res );
+    }
+    // hand buffer back to kernel
+    io_uring_buf *bptr = PC_URING_BUF( br_, brtl_ & (num_rbuf-1) );
+    bptr->addr = (uint64_t)buf;
+    bptr->len  = rbuf_len;
+    bptr->bid  = bid;
+    PC_URING_STORE( &br_->tail, ++brtl_ );
+  }
+  if ( op->sp_ ) {
+    net_connect *cp = static_cast<net_connect*>( op->sp_ );
+    if ( cqe->res <= 0 && cqe->res != -ENOBUFS ) {
+      errno = cqe->res ? -cqe->res : ECONNRESET;
+      cp->poll_error( true );
+    }
+    if ( cp->get_is_err() ) {
+      teardown( cp );
+    }
+  }
+  // re-arm recv once multishot terminates
+  if ( !( cqe->flags & IORING_CQE_F_MORE ) ) {
+    if ( op->sp_ ) {
+      arm( op );
+    } else {
+      free_op( op );
+    }
+  }
+}
+
+void net_uring::on_send( op_t *op, io_uring_cqe *cqe )
+{
+  if ( cqe->res < 0 ) {
+    if ( !op->err_ ) {
+      op->err_ = -cqe->res;
+    }
+  } else {
+    op->len_ += cqe->res;
+  }
+  if ( --op->num_ ) {
+    return;
+  }
+  for( net_buf *ptr = op->hd_; ptr; ) {
+    net_buf *nxt = ptr->next_;
+    ptr->dealloc();
+    ptr = nxt;
+  }
+  net_connect *cp = static_cast<net_connect*>( op->sp_ );
+  size_t len = op->len_;
+  int err = op->err_;
+  free_op( op );
+  if ( cp ) {
+    svec_[cp->get_fd()].wop_ = nullptr;
+    cp->nbytes_ += len;
+    if ( err ) {
+      errno = err;
+      cp->poll_error( false );
+      teardown( cp );
+    } else {
+      cp->on_sent();
+      if ( cp->whd_ ) {
+        send( cp );
+      }
+    }
+  }
+}
+
+void net_uring::on_poll( op_t *op, io_uring_cqe *cqe )
+{
+  if ( op->sp_ ) {
+    net_socket *sp = op->sp_;
+    if ( cqe->res >= 0 ) {
+      sp->poll();
+    } else if ( cqe->res != -ECANCELED ) {
+      sp->set_err_msg( "failed to poll socket", -cqe->res );
+    }
+    if ( sp->get_is_err() ) {
+      teardown( sp );
+    }
+  }
+  if ( !( cqe->flags & IORING_CQE_F_MORE ) ) {
+    if ( op->sp_ ) {
+      arm( op );
+    } else {
+      free_op( op );
+    }
+  }
+}
+
+net_uring::op_t *net_uring::alloc_op( net_socket *sp, op_type_t type )
+{
+  op_t *op;
+  if ( !ofree_.empty() ) {
+    op = ofree_.back();
+    ofree_.pop_back();
+  } else {
+    op = new op_t;
+  }
+  op->sp_   = sp;
+  op->hd_   = nullptr;
+  op->len_  = 0;
+  op->num_  = 0;
+  op->err_  = 0;
+  op->type_ = type;
+  op->evt_  = 0;
+  return op;
+}
+
+void net_uring::free_op( op_t *op )
+{
+  ofree_.push_back( op );
+}
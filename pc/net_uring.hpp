@@ -0,0 +1,108 @@
+#pragma once
+
+#include <pc/net_socket.hpp>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace pc
+{
+
+  // io_uring backend for net_loop. net_connect sockets receive via
+  // multishot recv into a ring of provided buffers and send their writer
+  // queue as chains of linked send requests. all other sockets are
+  // driven by multishot poll requests. submissions are batched and
+  // flushed together with waiting for completions in net_loop::poll
+  class net_uring : public error
+  {
+  public:
+    net_uring();
+    ~net_uring();
+
+    // set up ring, returns false if io_uring is not supported
+    bool init();
+
+    // add/delete socket
+    void add( net_socket *, int events );
+    void del( net_socket * );
+
+    // send writer queue of connection
+    void send( net_connect * );
+
+    // submit pending requests and process completions
+    bool poll( int timeout );
+
+    // number of io_uring_enter calls
+    uint64_t get_num_enter() const;
+
+  private:
+
+    typedef enum { e_poll, e_recv, e_send } op_type_t;
+
+    // in-flight request
+    struct op_t {
+      net_socket *sp_;   // socket or null once deleted
+      net_buf    *hd_;   // send buffers
+      size_t      len_;  // bytes sent
+      uint32_t    num_;  // outstanding send completions
+      int         err_;  // first send error
+      op_type_t   type_; // request type
+      int         evt_;  // poll events
+    };
+
+    // per socket state indexed by file descriptor
+    struct sock_t {
+      net_socket *sp_;   // socket
+      op_t       *rop_;  // recv or poll request
+      op_t       *wop_;  // in-flight send chain
+    };
+
+    typedef std::vector<sock_t> sock_vec_t;
+    typedef std::vector<op_t*>  op_vec_t;
+
+    static const unsigned num_entries = 256;
+    static const unsigned num_rbuf    = 128;
+    static const unsigned rbuf_len    = 16384;
+    static const unsigned max_chain   = 32;
+
+    net_uring( const net_uring& );
+    net_uring& operator=( const net_uring& );
+
+    void reserve( unsigned num );
+    io_uring_sqe *get_sqe();
+    bool enter( unsigned min_complete, int timeout );
+    bool check_recv();
+    void arm( op_t * );
+    void cancel( op_t * );
+    void teardown( net_socket * );
+    void on_recv( op_t *, io_uring_cqe * );
+    void on_send( op_t *, io_uring_cqe * );
+    void on_poll( op_t *, io_uring_cqe * );
+    op_t *alloc_op( net_socket *, op_type_t );
+    void free_op( op_t * );
+
+    int                fd_;     // io_uring file descriptor
+    char              *rmem_;   // mapped sq/cq rings
+    size_t             rlen_;   // length of rmem_
+    io_uring_sqe      *sqes_;   // submission queue entries
+    size_t             slen_;   // length of sqes_
+    unsigned          *sqhd_;   // submission queue head
+    unsigned          *sqtl_;   // submission queue tail
+    unsigned          *sqfl_;   // submission queue flags
+    unsigned           sqmk_;   // submission queue mask
+    unsigned           sqnm_;   // submission queue entries
+    unsigned          *cqhd_;   // completion queue head
+    unsigned          *cqtl_;   // completion queue tail
+    unsigned           cqmk_;   // completion queue mask
+    io_uring_cqe      *cqes_;   // completion queue entries
+    unsigned           nsub_;   // entries not yet submitted
+    io_uring_buf_ring *br_;     // provided receive buffer ring
+    char              *rbuf_;   // provided receive buffers
+    uint16_t           brtl_;   // buffer ring tail
+    uint64_t           nent_;   // number of io_uring_enter calls
+    sock_vec_t         svec_;   // sockets by file descriptor
+    op_vec_t           ofree_;  // free request list
+  };
+
+}
@@ -0,0 +1,363 @@
+#include "price_table.hpp"
+#include "log.hpp"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace pc;
+
+static size_t ptab_slot_size()
+{
+  return ( sizeof( ptab_slot ) + 63UL ) & ~63UL;
+}
+
+static size_t ptab_size( const ptab_hdr *hdr )
+{
+  return hdr->slot_off_ + (size_t)hdr->num_slot_ * hdr->slot_size_;
+}
+
+static bool ptab_is_valid( const ptab_hdr *hdr, size_t len )
+{
+  // directory and slots lie within the file
+  size_t dlen = (size_t)hdr->num_slot_ * sizeof( ptab_dir );
+  size_t slen = (size_t)hdr->num_slot_ * hdr->slot_size_;
+  uint32_t num_used = hdr->num_used_.load( std::memory_order_relaxed );
+  return hdr->magic_ == PC_PTAB_MAGIC &&
+         hdr->ver_ == PC_PTAB_VERSION &&
+         hdr->slot_size_ >= sizeof( ptab_slot ) &&
+         num_used <= hdr->num_slot_ &&
+         hdr->dir_off_ >= sizeof( ptab_hdr ) &&
+         hdr->dir_off_ <= len && dlen <= len - hdr->dir_off_ &&
+         hdr->slot_off_ >= sizeof( ptab_hdr ) &&
+         hdr->slot_off_ <= len && slen <= len - hdr->slot_off_;
+}
+
+static inline void ptab_pause()
+{
+#if defined( __x86_64__ )
+  __builtin_ia32_pause();
+#endif
+}
+
+static ptab_dir *ptab_get_dir( const char *buf, unsigned idx )
+{
+  const ptab_hdr *hdr = (const ptab_hdr*)buf;
+  return (ptab_dir*)&buf[hdr->dir_off_ + idx*sizeof( ptab_dir )];
+}
+
+static ptab_slot *ptab_get_slot( const char *buf, unsigned idx )
+{
+  const ptab_hdr *hdr = (const ptab_hdr*)buf;
+  return (ptab_slot*)&buf[hdr->slot_off_ + (size_t)idx*hdr->slot_size_];
+}
+
+///////////////////////////////////////////////////////////////////////////
+// price_table
+
+size_t price_table::key_hash::operator()( const pub_key& acc ) const
+{
+  uint64_t val;
+  __builtin_memcpy( &val, acc.data(), sizeof( val ) );
+  return val;
+}
+
+price_table::price_table()
+: buf_( nullptr ),
+  len_( 0 ),
+  nslot_( default_num_slot ),
+  full_( false )
+{
+}
+
+price_table::~price_table()
+{
+  close();
+}
+
+void price_table::close()
+{
+  if ( buf_ ) {
+    ::munmap( buf_, len_ );
+    buf_ = nullptr;
+    len_ = 0;
+  }
+  smap_.clear();
+  full_ = false;
+}
+
+void price_table::set_file( const std::string& file )
+{
+  file_ = file;
+}
+
+std::string price_table::get_file() const
+{
+  return file_;
+}
+
+void price_table::set_num_slot( unsigned num_slot )
+{
+  nslot_ = num_slot;
+}
+
+unsigned price_table::get_num_slot() const
+{
+  return nslot_;
+}
+
+bool price_table::get_is_init() const
+{
+  return buf_ != nullptr;
+}
+
+unsigned price_table::get_num_used() const
+{
+  return buf_ ? ((const ptab_hdr*)buf_)->num_used_.load() : 0;
+}
+
+bool price_table::init()
+{
+  close();
+  ptab_hdr hdr;
+  __builtin_memset( (void*)&hdr, 0, sizeof( hdr ) );
+  hdr.num_slot_  = nslot_;
+  hdr.slot_size_ = ptab_slot_size();
+  hdr.dir_off_   = sizeof( ptab_hdr );
+  hdr.slot_off_  = ( hdr.dir_off_ + nslot_ * sizeof( ptab_dir ) + 4095UL )
+    & ~4095UL;
+  size_t len = ptab_size( &hdr );
+
+  // build new table aside so readers never see a partial one
+  std::string tmp = file_ + ".tmp";
+  int fd = ::open( tmp.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644 );
+  if ( fd < 0 ) {
+    return set_err_msg( "failed to create price table file=" + tmp, errno );
+  }
+  if ( 0 != ::ftruncate( fd, len ) ) {
+    ::close( fd );
+    return set_err_msg( "failed to size price table file=" + tmp, errno );
+  }
+  void *buf = ::mmap( NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0 );
+  ::close( fd );
+  if ( buf == MAP_FAILED ) {
+    return set_err_msg( "failed to map price table file=" + tmp, errno );
+  }
+  buf_ = (char*)buf;
+  len_ = len;
+  ptab_hdr *hptr = (ptab_hdr*)buf_;
+  __builtin_memcpy( (void*)hptr, &hdr, sizeof( hdr ) );
+  hptr->ver_ = PC_PTAB_VERSION;
+  std::atomic_thread_fence( std::memory_order_release );
+  hptr->magic_ = PC_PTAB_MAGIC;
+  if ( 0 != ::rename( tmp.c_str(), file_.c_str() ) ) {
+    close();
+    return set_err_msg( "failed to rename price table file=" + tmp, errno );
+  }
+  return true;
+}
+
+bool price_table::add_slot( const pub_key& acc, str sym, uint32_t& idx )
+{
+  ptab_hdr *hdr = (ptab_hdr*)buf_;
+  idx = hdr->num_used_.load( std::memory_order_relaxed );
+  if ( PC_UNLIKELY( idx == hdr->num_slot_ ) ) {
+    if ( !full_ ) {
+      PC_LOG_WRN( "price table full" )
+        .add( "file", file_ )
+        .add( "num_slot", hdr->num_slot_ )
+        .end();
+      full_ = true;
+    }
+    return false;
+  }
+  // directory entry is complete before it becomes visible
+  ptab_dir *dptr = ptab_get_dir( buf_, idx );
+  __builtin_memcpy( &dptr->acc_, acc.data(), sizeof( dptr->acc_ ) );
+  size_t len = std::min( sym.len_, (size_t)PC_PTAB_SYM_LEN - 1 );
+  __builtin_memcpy( dptr->sym_, sym.str_, len );
+  hdr->num_used_.store( idx + 1, std::memory_order_release );
+  smap_[acc] = idx;
+  return true;
+}
+
+void price_table::write( const pub_key& acc, str sym, const pc_price_t *pupd )
+{
+  uint32_t idx;
+  slot_map_t::iterator it = smap_.find( acc );
+  if ( it != smap_.end() ) {
+    idx = it->second;
+  } else if ( !add_slot( acc, sym, idx ) ) {
+    return;
+  }
+
+  // odd sequence number marks update in progress
+  ptab_slot *sptr = ptab_get_slot( buf_, idx );
+  uint64_t seq = sptr->seq_.load( std::memory_order_relaxed );
+  sptr->seq_.store( seq + 1, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+  ptab_price& px = sptr->px_;
+  px.price_      = pupd->agg_.price_;
+  px.conf_       = pupd->agg_.conf_;
+  px.valid_slot_ = pupd->valid_slot_;
+  px.pub_slot_   = pupd->agg_.pub_slot_;
+  px.expo_       = pupd->expo_;
+  px.status_     = pupd->agg_.status_;
+  px.ptype_      = pupd->ptype_;
+  px.num_comp_   = std::min( pupd->num_, (uint32_t)PC_COMP_SIZE );
+  for( unsigned i=0; i != px.num_comp_; ++i ) {
+    const pc_price_comp_t& cptr = pupd->comp_[i];
+    ptab_comp& comp = px.comp_[i];
+    pc_pub_key_assign( &comp.pub_, (pc_pub_key_t*)&cptr.pub_ );
+    comp.price_    = cptr.agg_.price_;
+    comp.conf_     = cptr.agg_.conf_;
+    comp.status_   = cptr.agg_.status_;
+    comp.pub_slot_ = cptr.agg_.pub_slot_;
+  }
+  sptr->seq_.store( seq + 2, std::memory_order_release );
+}
+
+///////////////////////////////////////////////////////////////////////////
+// price_table_reader
+
+price_table_reader::price_table_reader()
+: buf_( nullptr ),
+  len_( 0 ),
+  ino_( 0 )
+{
+}
+
+price_table_reader::~price_table_reader()
+{
+  close();
+}
+
+void price_table_reader::close()
+{
+  if ( buf_ ) {
+    ::munmap( (void*)buf_, len_ );
+    buf_ = nullptr;
+    len_ = 0;
+  }
+}
+
+void price_table_reader::set_file( const std::string& file )
+{
+  file_ = file;
+}
+
+std::string price_table_reader::get_file() const
+{
+  return file_;
+}
+
+bool price_table_reader::init()
+{
+  close();
+  reset_err();
+  int fd = ::open( file_.c_str(), O_RDONLY );
+  if ( fd < 0 ) {
+    return set_err_msg( "failed to open price table file=" + file_, errno );
+  }
+  struct stat fst[1];
+  void *buf = MAP_FAILED;
+  if ( 0 == ::fstat( fd, fst ) && (size_t)fst->st_size >= sizeof( ptab_hdr ) ) {
+    buf = ::mmap( NULL, fst->st_size, PROT_READ, MAP_SHARED, fd, 0 );
+  }
+  ::close( fd );
+  if ( buf == MAP_FAILED ) {
+    return set_err_msg( "failed to map price table file=" + file_, errno );
+  }
+  buf_ = (const char*)buf;
+  len_ = fst->st_size;
+  ino_ = fst->st_ino;
+  const ptab_hdr *hdr = (const ptab_hdr*)buf_;
+  if ( !ptab_is_valid( hdr, len_ ) ) {
+    close();
+    return set_err_msg( "invalid price table file=" + file_ );
+  }
+  return true;
+}
+
+bool price_table_reader::get_is_stale() const
+{
+  struct stat fst[1];
+  return 0 != ::stat( file_.c_str(), fst ) || fst->st_ino != ino_;
+}
+
+unsigned price_table_reader::get_num_price() const
+{
+  if ( !buf_ ) {
+    return 0;
+  }
+  const ptab_hdr *hdr = (const ptab_hdr*)buf_;
+  return std::min( hdr->num_used_.load( std::memory_order_acquire ),
+                   hdr->num_slot_ );
+}
+
+const pub_key *price_table_reader::get_account( unsigned idx ) const
+{
+  return (const pub_key*)&ptab_get_dir( buf_, idx )->acc_;
+}
+
+str price_table_reader::get_symbol( unsigned idx ) const
+{
+  const char *sym = ptab_get_dir( buf_, idx )->sym_;
+  return str( sym, ::strnlen( sym, PC_PTAB_SYM_LEN ) );
+}
+
+bool price_table_reader::find( const pub_key& acc, unsigned& idx ) const
+{
+  unsigned num = get_num_price();
+  for( idx = 0; idx != num; ++idx ) {
+    if ( *get_account( idx ) == acc ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool price_table_reader::find( str sym, unsigned& idx ) const
+{
+  unsigned num = get_num_price();
+  for( idx = 0; idx != num; ++idx ) {
+    if ( get_symbol( idx ) == sym ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool price_table_reader::read( unsigned idx, ptab_price& px,
+                               bool with_comp ) const
+{
+  if ( idx >= get_num_price() ) {
+    return false;
+  }
+  // retry until the same even sequence number brackets the copy. give
+  // up on a slot left locked by a writer that died mid-update
+  const ptab_slot *sptr = ptab_get_slot( buf_, idx );
+  for( unsigned i=0; i != max_retry; ++i ) {
+    uint64_t seq = sptr->seq_.load( std::memory_order_acquire );
+    if ( PC_UNLIKELY( seq & 1UL ) ) {
+      ptab_pause();
+      continue;
+    }
+    __builtin_memcpy( &px, &sptr->px_, offsetof( ptab_price, comp_ ) );
+    if ( with_comp ) {
+      unsigned num = std::min( px.num_comp_, (uint32_t)PC_COMP_SIZE );
+      __builtin_memcpy( px.comp_, sptr->px_.comp_, num*sizeof( ptab_comp ) );
+    }
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if ( seq == sptr->seq_.load( std::memory_order_relaxed ) ) {
+      return true;
+    }
+  }
+  return false;
+}
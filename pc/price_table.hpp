@@ -0,0 +1,166 @@
+#pragma once
+
+#include <pc/error.hpp>
+#include <pc/key_pair.hpp>
+#include <pc/misc.hpp>
+#include <oracle/oracle.h>
+#include <unordered_map>
+#include <atomic>
+
+#define PC_PTAB_MAGIC     0x3162617468747970UL  // "pythtab1"
+#define PC_PTAB_VERSION   1
+#define PC_PTAB_SYM_LEN   32
+
+namespace pc
+{
+
+  // memory-mapped table of the latest aggregate and component prices of
+  // every price account known to pythd, for co-located readers. the
+  // file holds a ptab_hdr, a directory of ptab_dir entries and one
+  // cache-line aligned ptab_slot per price account. slots are written
+  // under a sequence lock so any number of reader processes can copy a
+  // consistent price without a socket hop or blocking the writer
+
+  struct ptab_hdr
+  {
+    uint64_t              magic_;     // PC_PTAB_MAGIC
+    uint32_t              ver_;       // PC_PTAB_VERSION
+    uint32_t              num_slot_;  // slot capacity
+    std::atomic<uint32_t> num_used_;  // directory entries and slots in use
+    uint32_t              slot_size_; // bytes per slot
+    uint64_t              dir_off_;   // file offset of directory
+    uint64_t              slot_off_;  // file offset of slots
+    uint64_t              unused_[3];
+  };
+
+  // directory entry of slot with same index
+  struct ptab_dir
+  {
+    pc_pub_key_t acc_;                 // price account
+    char         sym_[PC_PTAB_SYM_LEN];// product symbol (nul-padded)
+  };
+
+  // component price of publisher
+  struct ptab_comp
+  {
+    pc_pub_key_t pub_;        // publisher key
+    int64_t      price_;      // price used in aggregate
+    uint64_t     conf_;       // confidence interval
+    uint32_t     status_;     // symbol_status
+    uint32_t     unused_;
+    uint64_t     pub_slot_;   // publish slot of price
+  };
+
+  // price account contents as copied out of a slot
+  struct ptab_price
+  {
+    int64_t      price_;      // aggregate price
+    uint64_t     conf_;       // aggregate confidence interval
+    uint64_t     valid_slot_; // slot of aggregate price
+    uint64_t     pub_slot_;   // publish slot of aggregate price
+    int32_t      expo_;       // price exponent
+    uint32_t     status_;     // aggregate symbol_status
+    uint32_t     ptype_;      // price_type
+    uint32_t     num_comp_;   // number of component prices
+    ptab_comp    comp_[PC_COMP_SIZE];
+  };
+
+  // sequence-locked slot. seq_ is odd while an update is in progress
+  struct ptab_slot
+  {
+    std::atomic<uint64_t> seq_;
+    ptab_price            px_;
+  };
+
+  // pythd side: creates the table and updates it from price accounts
+  class price_table : public error
+  {
+  public:
+    static const unsigned default_num_slot = 4096;
+
+    price_table();
+    ~price_table();
+
+    // table file. a new table is created next to it and renamed over it
+    // so that readers of a previous table are unaffected
+    void set_file( const std::string& );
+    std::string get_file() const;
+
+    // max number of price accounts
+    void set_num_slot( unsigned );
+    unsigned get_num_slot() const;
+
+    // create and map table file
+    bool init();
+    bool get_is_init() const;
+
+    // publish price account contents. sym is only used on first update
+    // of an account when its slot is assigned
+    void write( const pub_key& acc, str sym, const pc_price_t * );
+
+    // number of accounts in table
+    unsigned get_num_used() const;
+
+  private:
+
+    struct key_hash {
+      size_t operator()( const pub_key& ) const;
+    };
+
+    typedef std::unordered_map<pub_key,uint32_t,key_hash> slot_map_t;
+
+    void close();
+    bool add_slot( const pub_key& acc, str sym, uint32_t& idx );
+
+    std::string file_;  // table file
+    char       *buf_;   // table mapping
+    size_t      len_;   // mapping length
+    unsigned    nslot_; // slot capacity
+    bool        full_;  // table full (logged once)
+    slot_map_t  smap_;  // slot index by account
+  };
+
+  // reader side: maps an existing table read-only
+  class price_table_reader : public error
+  {
+  public:
+    price_table_reader();
+    ~price_table_reader();
+
+    // table file written by pythd
+    void set_file( const std::string& );
+    std::string get_file() const;
+
+    // map table file
+    bool init();
+
+    // has pythd replaced the table (on restart) since init
+    bool get_is_stale() const;
+
+    // number of price accounts in table
+    unsigned get_num_price() const;
+
+    // account and symbol of slot
+    const pub_key *get_account( unsigned ) const;
+    str get_symbol( unsigned ) const;
+
+    // find slot by price account or by (first price of) symbol
+    bool find( const pub_key&, unsigned& idx ) const;
+    bool find( str sym, unsigned& idx ) const;
+
+    // copy consistent price out of slot, optionally with its component
+    // prices. returns false if slot is not in use or stays locked for
+    // max_retry attempts (writer died mid-update - see get_is_stale)
+    static const unsigned max_retry = 1U << 20;
+    bool read( unsigned idx, ptab_price&, bool with_comp = false ) const;
+
+  private:
+    void close();
+
+    std::string file_;  // table file
+    const char *buf_;   // table mapping
+    size_t      len_;   // mapping length
+    uint64_t    ino_;   // inode of mapped file
+  };
+
+}
@@ -281,7 +281,12 @@ void get_mapping::submit()
   sreq_->set_sub( this );
   // submit subscription first
   get_rpc_client()->send( sreq_ );
-  get_rpc_client()->send( areq_ );
+  rpc::program_account *aptr = get_manager()->get_program_account( mkey_ );
+  if ( aptr ) {
+    update( aptr );
+  } else {
+    get_rpc_client()->send( areq_ );
+  }
 }
 
 void get_mapping::on_response( rpc::get_account_info *res )
@@ -1397,7 +1402,12 @@ void product::submit()
   rpc_client  *cptr = get_rpc_client();
   st_ = e_subscribe;
   cptr->send( sreq_ );
-  cptr->send( areq_ );
+  rpc::program_account *aptr = get_manager()->get_program_account( acc_ );
+  if ( aptr ) {
+    update( aptr );
+  } else {
+    cptr->send( areq_ );
+  }
 }
 
 void product::on_response( rpc::get_account_info *res )
@@ -1513,14 +1523,20 @@ price::price( const pub_key& acc, product *prod )
   cnum_( 0 ),
   pkey_( nullptr ),
   prod_( prod ),
-  sched_( this )
+  sched_( this ),
+  rslot_( 0UL ),
+  rts_( 0L ),
+  rep_( 0 ),
+  hsub_( 0 )
 {
   __builtin_memset( &cpub_, 0, sizeof( cpub_ ) );
   areq_->set_account( &apub_ );
-  sreq_->set_account( &apub_ );
   preq_->set_account( &apub_ );
   areq_->set_sub( this );
-  sreq_->set_sub( this );
+  for( unsigned i=0; i != 1+PC_RPC_MAX_HEDGE; ++i ) {
+    sreq_[i].set_account( &apub_ );
+    sreq_[i].set_sub( this );
+  }
 }
 
 bool price::init_publish()
@@ -1609,6 +1625,21 @@ uint64_t price::get_pub_slot() const
   return pub_slot_;
 }
 
+void price::set_price( int64_t px )
+{
+  apx_ = px;
+}
+
+void price::set_conf( int64_t conf )
+{
+  aconf_ = conf;
+}
+
+void price::set_symbol_status( symbol_status st )
+{
+  sym_st_ = st;
+}
+
 bool price::get_is_ready_publish() const
 {
   return st_ == e_publish && get_manager()->get_is_tx_connect();
@@ -1617,9 +1648,23 @@ bool price::get_is_ready_publish() const
 void price::reset()
 {
   st_ = e_subscribe;
+  rslot_ = 0UL;
   reset_err();
 }
 
+void price::subscribe_hedge( unsigned i, rpc_client *clnt )
+{
+  if ( !( hsub_ & ( 1U << i ) ) ) {
+    hsub_ |= 1U << i;
+    clnt->send( &sreq_[i] );
+  }
+}
+
+void price::reset_hedge( unsigned i )
+{
+  hsub_ &= ~( 1U << i );
+}
+
 bool price::has_publisher()
 {
   if ( pkey_ ) {
@@ -1686,21 +1731,62 @@ void price::submit()
   if ( st_ == e_subscribe ) {
     // subscribe first
     rpc_client  *cptr = get_rpc_client();
+    manager *mgr = get_manager();
     cptr->send( sreq_ );
-    cptr->send( areq_ );
-    pkey_ = get_manager()->get_publish_pub_key();
+    pkey_ = mgr->get_publish_pub_key();
     st_ = e_sent_subscribe;
+    rpc::program_account *aptr = mgr->get_program_account( apub_ );
+    if ( aptr ) {
+      update( aptr, 0 );
+    } else {
+      cptr->send( areq_ );
+    }
   }
 }
 
 void price::on_response( rpc::get_account_info *res )
 {
-  update( res );
+  update( res, 0 );
 }
 
 void price::on_response( rpc::account_subscribe *res )
 {
-  update( res );
+  update( res, res - sreq_ );
+}
+
+bool price::get_is_first( unsigned ep, uint64_t slot, uint64_t valid_slot,
+                          int64_t ts )
+{
+  // take the first copy of each slot from any rpc node. a node may
+  // update an account more than once per slot but only repeats from
+  // the node that won the slot (or with a newer aggregate) are taken
+  manager *mgr = get_manager();
+  if ( PC_UNLIKELY( st_ == e_sent_subscribe ) ) {
+    // always take the first update after (re)subscribing
+    if ( slot >= rslot_ ) {
+      rslot_ = slot;
+      rts_   = ts;
+      rep_   = ep;
+    }
+    return true;
+  }
+  if ( slot > rslot_ ) {
+    rslot_ = slot;
+    rts_   = ts;
+    rep_   = ep;
+    mgr->add_rpc_first( ep );
+    return true;
+  }
+  if ( slot < rslot_ ) {
+    // older slot than last taken so there is no arrival to compare to
+    mgr->add_rpc_late( ep );
+    return false;
+  }
+  if ( ep == rep_ || valid_slot > valid_slot_ ) {
+    return true;
+  }
+  mgr->add_rpc_late( ep, ts - rts_ );
+  return false;
 }
 
 void price::log_update( const char *title )
@@ -1774,6 +1860,9 @@ void price::init_subscribe( pc_price_t *pupd )
   // log new price object
   log_update( "add_price" );
 
+  // duplicate subscription on any hedge rpc nodes
+  cptr->subscribe_hedge( this );
+
   // callback users on new symbol update
   manager_sub *sub = cptr->get_manager_sub();
   if ( sub ) {
@@ -1786,7 +1875,7 @@ void price::init_subscribe( pc_price_t *pupd )
 }
 
 template<class T>
-void price::update( T *res )
+void price::update( T *res, unsigned ep )
 {
   // check for errors
   if ( res->get_is_err() ) {
@@ -1804,6 +1893,12 @@ void price::update( T *res )
     return;
   }
 
+  // drop copies of an update already delivered by another rpc node
+  if ( !get_is_first( ep, res->get_slot(), pupd->valid_slot_,
+                      res->get_recv_time() ) ) {
+    return;
+  }
+
   // price account was (re) initialized
   if ( PC_UNLIKELY( pupd->valid_slot_ == 0L ) ) {
     init_price( pupd );
@@ -1852,6 +1947,9 @@ void price::update( T *res )
     // ping subscribers with new aggregate price
     on_response_sub( this );
   }
+
+  // local readers see component price changes too
+  mgr->write( this, pupd );
 }
 
 bool price::get_is_done() const
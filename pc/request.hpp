@@ -6,6 +6,9 @@
 #include <pc/pub_stats.hpp>
 #include <oracle/oracle.h>
 
+// max. number of additional rpc nodes holding price subscriptions
+#define PC_RPC_MAX_HEDGE         3
+
 namespace pc
 {
   class manager;
@@ -620,12 +623,19 @@ namespace pc
     void on_response( rpc::account_subscribe * ) override;
     bool get_is_done() const override;
 
+    // duplicate account subscription on hedge rpc node i (1-based) and
+    // forget it after that node reconnects
+    void subscribe_hedge( unsigned i, rpc_client * );
+    void reset_hedge( unsigned i );
+
   private:
 
     typedef enum {
       e_subscribe, e_sent_subscribe, e_publish, e_error } state_t;
 
-    template<class T> void update( T *res );
+    template<class T> void update( T *res, unsigned ep );
+    bool get_is_first( unsigned ep, uint64_t slot, uint64_t valid_slot,
+                       int64_t ts );
 
     bool init_publish();
     void init_subscribe( pc_price_t * );
@@ -653,8 +663,12 @@ namespace pc
     price_sched            sched_;
     pc_pub_key_t           cpub_[PC_COMP_SIZE];
     pc_price_info_t        cprice_[PC_COMP_SIZE];
+    uint64_t               rslot_;  // slot of last accepted update
+    int64_t                rts_;    // arrival time of last accepted update
+    uint32_t               rep_;    // rpc node of last accepted update
+    uint32_t               hsub_;   // hedge rpc nodes subscribed (bitmap)
     rpc::get_account_info  areq_[1];
-    rpc::account_subscribe sreq_[1];
+    rpc::account_subscribe sreq_[1+PC_RPC_MAX_HEDGE]; // by rpc node
     rpc::upd_price         preq_[1];
   };
 
@@ -35,6 +35,62 @@ const char *symbol_status_str[] = {
   "halted"
 };
 
+// json paths of rpc responses and notifications resolved while parsing
+enum rpc_path_id : unsigned
+{
+  e_id,
+  e_error,
+  e_error_code,
+  e_error_message,
+  e_result,
+  e_result_slot,
+  e_result_executable,
+  e_result_lamports,
+  e_result_data,
+  e_result_owner,
+  e_result_rent_epoch,
+  e_result_blockhash,
+  e_result_fee_per_sig,
+  e_result_value,
+  e_params_subscription,
+  e_params_slot,
+  e_params_value_data,
+  e_params_value_lamports,
+  e_params_result_slot
+};
+
+static const jpath& rpc_path()
+{
+  static const char *path[] = {
+    "id",
+    "error",
+    "error.code",
+    "error.message",
+    "result",
+    "result.context.slot",
+    "result.value.executable",
+    "result.value.lamports",
+    "result.value.data",
+    "result.value.owner",
+    "result.value.rentEpoch",
+    "result.value.blockhash",
+    "result.value.feeCalculator.lamportsPerSignature",
+    "result.value",
+    "params.subscription",
+    "params.result.context.slot",
+    "params.result.value.data",
+    "params.result.value.lamports",
+    "params.result.slot"
+  };
+  struct rpc_jpath : public jpath {
+    rpc_jpath() {
+      for( const char *p: path ) add( p );
+    }
+  };
+  static const rpc_jpath jp;
+  return jp;
+}
+
 // block(slot) commitment
 static const char *commitment_str[] = {
   "unknown",
@@ -109,6 +165,7 @@ static hash sys_id = gen_sys_id();
 // generate json for sendTransaction
 static void send_transaction( json_wtr& msg, bincode& tx )
 {
+  msg.prealloc( enc_base64_len( tx.size() ) + 96 );
   msg.add_key( "method", "sendTransaction" );
   msg.add_key( "params", json_wtr::e_arr );
   msg.add_val_enc_base64( str( tx.get_buf(), tx.size() ) );
@@ -118,27 +175,256 @@ static void send_transaction( json_wtr& msg, bincode& tx )
   msg.pop();
 }
 
+///////////////////////////////////////////////////////////////////////////
+// rpc_notify
+
+// single-pass reader of compact json notification text. any escape,
+// unexpected character or truncation fails the scan
+class rpc_scan
+{
+public:
+  rpc_scan( const char *ptr, size_t len )
+  : ptr_( ptr ), end_( &ptr[len] ) {}
+
+  bool lit( str txt ) {
+    if ( (size_t)( end_ - ptr_ ) < txt.len_ ||
+         0 != __builtin_memcmp( ptr_, txt.str_, txt.len_ ) ) {
+      return false;
+    }
+    ptr_ += txt.len_;
+    return true;
+  }
+
+  bool chr( char ch ) {
+    if ( ptr_ == end_ || *ptr_ != ch ) return false;
+    ++ptr_;
+    return true;
+  }
+
+  bool uint( uint64_t& val ) {
+    const char *beg = ptr_;
+    val = 0;
+    for( ; ptr_ != end_ && *ptr_ >= '0' && *ptr_ <= '9'; ++ptr_ ) {
+      val = val*10UL + ( *ptr_ - '0' );
+    }
+    return ptr_ != beg && ptr_ - beg < 20;
+  }
+
+  bool text( str& val ) {
+    if ( !chr( '"' ) ) return false;
+    const char *eptr = (const char*)__builtin_memchr(
+        ptr_, '"', end_ - ptr_ );
+    if ( !eptr || __builtin_memchr( ptr_, '\\', eptr - ptr_ ) ) {
+      return false;
+    }
+    val = str( ptr_, eptr - ptr_ );
+    ptr_ = eptr + 1;
+    return true;
+  }
+
+  // skip over value of any type
+  bool skip() {
+    if ( ptr_ == end_ ) return false;
+    str val;
+    switch( *ptr_ ) {
+      case '"': return text( val );
+      case '{':
+      case '[': {
+        unsigned depth = 0;
+        do {
+          if ( ptr_ == end_ ) return false;
+          switch( *ptr_ ) {
+            case '"': if ( !text( val ) ) return false; continue;
+            case '{': case '[': ++depth; break;
+            case '}': case ']': --depth; break;
+          }
+          ++ptr_;
+        } while( depth );
+        return true;
+      }
+      default: {
+        const char *beg = ptr_;
+        while( ptr_ != end_ && *ptr_ != ',' && *ptr_ != '}' &&
+               *ptr_ != ']' ) {
+          ++ptr_;
+        }
+        return ptr_ != beg;
+      }
+    }
+  }
+
+  // next key of object or false at its end
+  bool key( str& val, bool first, bool& err ) {
+    if ( chr( '}' ) ) return false;
+    err = ( !first && !chr( ',' ) ) || !text( val ) || !chr( ':' );
+    return !err;
+  }
+
+private:
+  const char *ptr_;
+  const char *end_;
+};
+
+// slot of context object
+static bool rpc_scan_context( rpc_scan& sc, rpc_notify& nt, bool& has_slot )
+{
+  str key;
+  bool err = !sc.chr( '{' );
+  for( bool first = true; !err && sc.key( key, first, err ); first = false ) {
+    if ( key == "slot" ) {
+      err = !sc.uint( nt.slot_ );
+      has_slot = true;
+    } else {
+      err = !sc.skip();
+    }
+  }
+  return !err;
+}
+
+// data and lamports of account value object
+static bool rpc_scan_account( rpc_scan& sc, rpc_notify& nt,
+                              bool& has_data, bool& has_lamports )
+{
+  str key, val;
+  bool err = !sc.chr( '{' );
+  for( bool first = true; !err && sc.key( key, first, err ); first = false ) {
+    if ( key == "data" ) {
+      // [ "<base64>", "base64" ]
+      err = !sc.chr( '[' ) || !sc.text( val ) || !sc.chr( ',' ) ||
+            !sc.lit( "\"base64\"]" );
+      nt.dptr_ = val.str_;
+      nt.dlen_ = val.len_;
+      has_data = true;
+    } else if ( key == "lamports" ) {
+      err = !sc.uint( nt.lamports_ );
+      has_lamports = true;
+    } else {
+      err = !sc.skip();
+    }
+  }
+  return !err;
+}
+
+bool rpc_notify::scan( const char *msg, size_t msg_len )
+{
+  rpc_scan sc( msg, msg_len );
+  if ( !sc.lit( "{\"jsonrpc\":\"2.0\",\"method\":\"" ) ) {
+    return false;
+  }
+  if ( sc.lit( "accountNotification\"" ) ) {
+    type_ = e_account;
+  } else if ( sc.lit( "slotNotification\"" ) ) {
+    type_ = e_slot;
+  } else if ( sc.lit( "signatureNotification\"" ) ) {
+    type_ = e_signature;
+  } else {
+    return false;
+  }
+  if ( !sc.lit( ",\"params\":{\"result\":{" ) ) {
+    return false;
+  }
+
+  // fields of result object in any order
+  bool has_slot = false, has_data = false, has_lamports = false;
+  bool err = false;
+  str key;
+  for( bool first = true; !err && sc.key( key, first, err ); first = false ) {
+    if ( type_ != e_slot && key == "context" ) {
+      err = !rpc_scan_context( sc, *this, has_slot );
+    } else if ( type_ == e_account && key == "value" ) {
+      err = !rpc_scan_account( sc, *this, has_data, has_lamports );
+    } else if ( type_ == e_slot && key == "slot" ) {
+      err = !sc.uint( slot_ );
+      has_slot = true;
+    } else {
+      err = !sc.skip();
+    }
+  }
+  if ( err || !has_slot ||
+       ( type_ == e_account && !( has_data && has_lamports ) ) ) {
+    return false;
+  }
+  return sc.lit( ",\"subscription\":" ) && sc.uint( sub_ ) &&
+         sc.lit( "}}" );
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // rpc_client
 
 rpc_client::rpc_client()
-: hptr_( nullptr ),
-  wptr_( nullptr ),
-  id_( 0UL )
+: wptr_( nullptr ),
+  id_( 0UL ),
+  nfast_( 0UL ),
+  nslow_( 0UL )
 {
-  hp_.cp_ = this;
   wp_.cp_ = this;
+  jp_.set_path( &rpc_path() );
+}
+
+rpc_client::~rpc_client()
+{
+  for( rpc_http *hp: hv_ ) {
+    delete hp;
+  }
 }
 
 void rpc_client::set_http_conn( net_connect *hptr )
 {
-  hptr_ = hptr;
-  hptr_->set_net_parser( &hp_ );
+  for( rpc_http *hp: hv_ ) {
+    delete hp;
+  }
+  hv_.clear();
+  add_http_conn( hptr );
 }
 
 net_connect *rpc_client::get_http_conn() const
 {
-  return hptr_;
+  return hv_.empty() ? nullptr : hv_[0]->hptr_;
+}
+
+void rpc_client::add_http_conn( net_connect *hptr )
+{
+  rpc_http *hp = new rpc_http;
+  hp->cp_   = this;
+  hp->hptr_ = hptr;
+  hp->nreq_ = hp->nrsp_ = 0UL;
+  hp->lsum_ = hp->lmax_ = 0L;
+  hptr->set_net_parser( hp );
+  hv_.push_back( hp );
+}
+
+unsigned rpc_client::get_num_http_conn() const
+{
+  return hv_.size();
+}
+
+net_connect *rpc_client::get_http_conn( unsigned i ) const
+{
+  return hv_[i]->hptr_;
+}
+
+void rpc_client::get_http_stats( unsigned i, rpc_http_stats& st ) const
+{
+  const rpc_http *hp = hv_[i];
+  st.num_req_  = hp->nreq_;
+  st.num_resp_ = hp->nrsp_;
+  st.num_out_  = hp->sent_.size();
+  st.lat_avg_  = hp->nrsp_ ? hp->lsum_ / (int64_t)hp->nrsp_ : 0L;
+  st.lat_max_  = hp->lmax_;
+}
+
+rpc_client::rpc_http *rpc_client::get_http()
+{
+  // healthy connection with fewest outstanding requests
+  rpc_http *best = hv_[0];
+  for( rpc_http *hp: hv_ ) {
+    if ( !hp->hptr_->get_is_err() &&
+         ( best->hptr_->get_is_err() ||
+           hp->sent_.size() < best->sent_.size() ) ) {
+      best = hp;
+    }
+  }
+  return best;
 }
 
 void rpc_client::set_ws_conn( net_connect *wptr )
@@ -155,6 +441,10 @@ net_connect *rpc_client::get_ws_conn() const
 
 void rpc_client::reset()
 {
+  for( rpc_http *hp: hv_ ) {
+    hp->sent_.clear();
+  }
+  wp_.reset();
   rv_.clear();
   smap_.clear();
   reuse_.clear();
@@ -177,6 +467,11 @@ void rpc_client::send( rpc_request *rptr )
   rptr->set_sent_time( get_now() );
   rv_[id] = rptr;
 
+  // repeat requests are copied from their pre-framed template
+  if ( rptr->get_is_cacheable() && send_tmpl( rptr, id ) ) {
+    return;
+  }
+
   // construct json message
   json_wtr jw;
   jw.add_val( json_wtr::e_obj );
@@ -191,7 +486,10 @@ void rpc_client::send( rpc_request *rptr )
     msg.init( "POST", "/" );
     msg.add_hdr( "Content-Type", "application/json" );
     msg.commit( jw );
-    hptr_->add_send( msg );
+    rpc_http *hp = get_http();
+    hp->sent_.push_back( rptr->get_sent_time() );
+    hp->nreq_++;
+    hp->hptr_->add_send( msg );
   } else {
     // submit websocket message
     ws_wtr msg;
@@ -200,8 +498,93 @@ void rpc_client::send( rpc_request *rptr )
   }
 }
 
+// copy writer contents to string
+static void rpc_flatten( net_wtr& wtr, std::string& res )
+{
+  net_buf *hd, *tl;
+  wtr.detach( hd, tl );
+  while( hd ) {
+    net_buf *nxt = hd->next_;
+    res.append( hd->buf_, hd->size_ );
+    hd->dealloc();
+    hd = nxt;
+  }
+}
+
+bool rpc_client::send_tmpl( rpc_request *rptr, uint64_t id )
+{
+  static const size_t id_len = 20;
+  static const size_t max_len = net_buf::get_class_capacity(
+      net_buf::num_class - 1 );
+  rpc_tmpl& tp = rptr->get_tmpl();
+  bool is_http = rptr->get_is_http();
+  if ( tp.buf_.empty() ) {
+    // serialize body with an id slot wide enough for any id. whitespace
+    // left after the id digits is valid json
+    json_wtr jw;
+    jw.add_val( json_wtr::e_obj );
+    jw.add_key( "jsonrpc", "2.0" );
+    jw.add_key_verbatim( "id", str( std::string( id_len, ' ' ) ) );
+    rptr->request( jw );
+    jw.pop();
+    std::string body;
+    rpc_flatten( jw, body );
+    size_t id_off = body.find( "\"id\":" ) + 5;
+
+    // frame a copy of the body and then restore the unmasked payload
+    net_wtr pw;
+    pw.add( body );
+    if ( is_http ) {
+      http_request msg;
+      msg.init( "POST", "/" );
+      msg.add_hdr( "Content-Type", "application/json" );
+      msg.commit( pw );
+      rpc_flatten( msg, tp.buf_ );
+    } else {
+      ws_wtr msg;
+      msg.commit( ws_wtr::text_id, pw, true );
+      rpc_flatten( msg, tp.buf_ );
+    }
+    size_t hdr_len = tp.buf_.size() - body.size();
+    tp.buf_.replace( hdr_len, body.size(), body );
+    tp.id_   = hdr_len + id_off;
+    tp.mask_ = is_http ? 0 : hdr_len - sizeof( uint32_t );
+    if ( tp.buf_.size() > max_len ) {
+      tp.buf_.clear();
+      return false;
+    }
+  }
+
+  // copy template and patch id (and websocket mask)
+  size_t sz = tp.buf_.size();
+  net_buf *bp = net_buf::alloc( sz );
+  __builtin_memcpy( bp->buf_, tp.buf_.data(), sz );
+  bp->size_ = sz;
+  uint_to_buf( id, &bp->buf_[tp.id_] );
+  if ( is_http ) {
+    rpc_http *hp = get_http();
+    hp->sent_.push_back( rptr->get_sent_time() );
+    hp->nreq_++;
+    hp->hptr_->add_send( bp, bp );
+  } else {
+    uint32_t mask_key = random();
+    __builtin_memcpy( &bp->buf_[tp.mask_], &mask_key, sizeof( mask_key ) );
+    size_t pay_off = tp.mask_ + sizeof( mask_key );
+    ws_mask::apply( &bp->buf_[pay_off], sz - pay_off, mask_key, 0 );
+    wptr_->add_send( bp, bp );
+  }
+  return true;
+}
+
 void rpc_client::rpc_http::parse_content( const char *txt, size_t len )
 {
+  if ( !sent_.empty() ) {
+    int64_t lat = get_now() - sent_.front();
+    sent_.pop_front();
+    lsum_ += lat;
+    lmax_ = std::max( lmax_, lat );
+    nrsp_++;
+  }
   cp_->parse_response( txt, len );
 }
 
@@ -210,11 +593,35 @@ void rpc_client::rpc_ws::parse_msg( const char *txt, size_t len )
   cp_->parse_response( txt, len );
 }
 
+uint64_t rpc_client::get_num_notify_fast() const
+{
+  return nfast_;
+}
+
+uint64_t rpc_client::get_num_notify_slow() const
+{
+  return nslow_;
+}
+
 void rpc_client::parse_response( const char *txt, size_t len )
 {
+  // notifications of known shape skip building a parse tree
+  rpc_notify nt;
+  if ( nt.scan( txt, len ) ) {
+    sub_map_t::iter_t i = smap_.find( nt.sub_ );
+    if ( i && smap_.obj(i)->get_notify_type() == nt.type_ ) {
+      ++nfast_;
+      if ( smap_.obj(i)->notify( nt ) ) {
+        smap_.del( i );
+      }
+      return;
+    }
+  }
+
   // parse and redirect response to corresponding request
   jp_.parse( txt, len );
-  uint32_t idtok = jp_.find_val( 1, "id" );
+  const jpath& path = rpc_path();
+  uint32_t idtok = jp_.find_path( path, e_id );
   if ( idtok ) {
     // response to http request
     uint64_t id = jp_.get_uint( idtok );
@@ -228,13 +635,15 @@ void rpc_client::parse_response( const char *txt, size_t len )
     }
   } else {
     // websocket notification
-    uint32_t ptok = jp_.find_val( 1, "params" );
-    uint32_t stok = jp_.find_val( ptok, "subscription" );
+    uint32_t stok = jp_.find_path( path, e_params_subscription );
     if ( stok ) {
       uint64_t id = jp_.get_uint( stok );
       sub_map_t::iter_t i = smap_.find( id );
-      if ( i  && smap_.obj(i)->notify( jp_ ) ) {
-        smap_.del( i );
+      if ( i ) {
+        ++nslow_;
+        if ( smap_.obj(i)->notify( jp_ ) ) {
+          smap_.del( i );
+        }
       }
     }
   }
@@ -344,11 +753,36 @@ bool rpc_request::get_is_http() const
   return true;
 }
 
+bool rpc_request::get_is_cacheable() const
+{
+  return false;
+}
+
+rpc_tmpl& rpc_request::get_tmpl()
+{
+  return tmpl_;
+}
+
+void rpc_request::reset_tmpl()
+{
+  tmpl_.buf_.clear();
+}
+
 bool rpc_request::notify( const jtree& )
 {
   return true;
 }
 
+rpc_notify::type_t rpc_request::get_notify_type() const
+{
+  return rpc_notify::e_none;
+}
+
+bool rpc_request::notify( const rpc_notify& )
+{
+  return true;
+}
+
 bool rpc_subscription::get_is_http() const
 {
   return false;
@@ -356,7 +790,7 @@ bool rpc_subscription::get_is_http() const
 
 void rpc_subscription::add_notify( const jtree& jp )
 {
-  uint32_t rtok  = jp.find_val( 1, "result" );
+  uint32_t rtok  = jp.find_path( rpc_path(), e_result );
   if ( rtok ) {
     uint64_t subid = jp.get_uint( rtok );
     set_id( subid );
@@ -382,15 +816,16 @@ void rpc_request::on_response( T *req )
 template<class T>
 bool rpc_request::on_error( const jtree& jt, T *req )
 {
-  uint32_t etok = jt.find_val( 1, "error" );
+  const jpath& path = rpc_path();
+  uint32_t etok = jt.find_path( path, e_error );
   if ( etok == 0 ) return false;
   const char *txt = nullptr;
   size_t txt_len = 0;
   std::string emsg;
-  jt.get_text( jt.find_val( etok, "message" ), txt, txt_len );
+  jt.get_text( jt.find_path( path, e_error_message ), txt, txt_len );
   emsg.assign( txt, txt_len );
   set_err_msg( emsg );
-  set_err_code( jt.get_int( jt.find_val( etok, "code" ) ) );
+  set_err_code( jt.get_int( jt.find_path( path, e_error_code ) ) );
   on_response( req );
   return true;
 }
@@ -401,11 +836,13 @@ bool rpc_request::on_error( const jtree& jt, T *req )
 void rpc::get_account_info::set_account( pub_key *acc )
 {
   acc_ = acc;
+  reset_tmpl();
 }
 
 void rpc::get_account_info::set_commitment( commitment val )
 {
   cmt_ = val;
+  reset_tmpl();
 }
 
 uint64_t rpc::get_account_info::get_slot() const
@@ -447,6 +884,11 @@ rpc::get_account_info::get_account_info()
 {
 }
 
+bool rpc::get_account_info::get_is_cacheable() const
+{
+  return true;
+}
+
 void rpc::get_account_info::request( json_wtr& msg )
 {
   msg.add_key( "method", "getAccountInfo" );
@@ -462,16 +904,14 @@ void rpc::get_account_info::request( json_wtr& msg )
 void rpc::get_account_info::response( const jtree& jt )
 {
   if ( on_error( jt, this ) ) return;
-  uint32_t rtok = jt.find_val( 1, "result" );
-  uint32_t ctok = jt.find_val( rtok, "context" );
-  slot_ = jt.get_uint( jt.find_val( ctok, "slot" ) );
-  uint32_t vtok = jt.find_val( rtok, "value" );
-  is_exec_ = jt.get_bool( jt.find_val( vtok, "executable" ) );
-  lamports_ = jt.get_uint( jt.find_val( vtok, "lamports" ) );
-  uint32_t dtok = jt.find_val( vtok, "data" );
+  const jpath& path = rpc_path();
+  slot_ = jt.get_uint( jt.find_path( path, e_result_slot ) );
+  is_exec_ = jt.get_bool( jt.find_path( path, e_result_executable ) );
+  lamports_ = jt.get_uint( jt.find_path( path, e_result_lamports ) );
+  uint32_t dtok = jt.find_path( path, e_result_data );
   jt.get_text( jt.get_first( dtok ), dptr_, dlen_ );
-  jt.get_text( jt.find_val( vtok, "owner" ), optr_, olen_ );
-  rent_epoch_ = jt.get_uint( jt.find_val( vtok, "rentEpoch" ) );
+  jt.get_text( jt.find_path( path, e_result_owner ), optr_, olen_ );
+  rent_epoch_ = jt.get_uint( jt.find_path( path, e_result_rent_epoch ) );
   on_response( this );
 }
 
@@ -500,6 +940,11 @@ rpc::get_recent_block_hash::get_recent_block_hash()
   bhash_.zero();
 }
 
+bool rpc::get_recent_block_hash::get_is_cacheable() const
+{
+  return true;
+}
+
 void rpc::get_recent_block_hash::request( json_wtr& msg )
 {
   msg.add_key( "method", "getRecentBlockhash" );
@@ -508,22 +953,24 @@ void rpc::get_recent_block_hash::request( json_wtr& msg )
 void rpc::get_recent_block_hash::response( const jtree& jt )
 {
   if ( on_error( jt, this ) ) return;
-  uint32_t rtok = jt.find_val( 1, "result" );
-  uint32_t ctok = jt.find_val( rtok, "context" );
-  slot_ = jt.get_uint( jt.find_val( ctok, "slot" ) );
-  uint32_t vtok = jt.find_val( rtok, "value" );
+  const jpath& path = rpc_path();
+  slot_ = jt.get_uint( jt.find_path( path, e_result_slot ) );
   size_t txt_len = 0;
   const char *txt;
-  jt.get_text( jt.find_val( vtok, "blockhash" ), txt, txt_len );
+  jt.get_text( jt.find_path( path, e_result_blockhash ), txt, txt_len );
   bhash_.dec_base58( (const uint8_t*)txt, txt_len );
-  uint32_t ftok = jt.find_val( vtok, "feeCalculator" );
-  fee_per_sig_ = jt.get_uint( jt.find_val( ftok, "lamportsPerSignature" ) );
+  fee_per_sig_ = jt.get_uint( jt.find_path( path, e_result_fee_per_sig ) );
   on_response( this );
 }
 
 ///////////////////////////////////////////////////////////////////////////
 // get_health
 
+bool rpc::get_health::get_is_cacheable() const
+{
+  return true;
+}
+
 void rpc::get_health::request( json_wtr& msg )
 {
   msg.add_key( "method", "getHealth" );
@@ -662,6 +1109,149 @@ void rpc::get_slot_leaders::response( const jtree& jt )
   on_response( this );
 }
 
+///////////////////////////////////////////////////////////////////////////
+// program_account
+
+rpc::program_account::program_account()
+: slot_( 0UL ),
+  lamports_( 0UL ),
+  recv_ts_( 0L )
+{
+}
+
+pub_key *rpc::program_account::get_account()
+{
+  return &acc_;
+}
+
+uint64_t rpc::program_account::get_slot() const
+{
+  return slot_;
+}
+
+uint64_t rpc::program_account::get_lamports() const
+{
+  return lamports_;
+}
+
+int64_t rpc::program_account::get_recv_time() const
+{
+  return recv_ts_;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// get_program_accounts
+
+rpc::get_program_accounts::get_program_accounts()
+: prog_( nullptr ),
+  slot_( 0UL ),
+  cmt_( commitment::e_confirmed )
+{
+}
+
+void rpc::get_program_accounts::set_program( pub_key *prog )
+{
+  prog_ = prog;
+}
+
+void rpc::get_program_accounts::set_commitment( commitment val )
+{
+  cmt_ = val;
+}
+
+void rpc::get_program_accounts::add_filter(
+    uint32_t offset, const void *buf, size_t len )
+{
+  filter flt;
+  flt.off_ = offset;
+  flt.buf_.resize( 2*len + 1 );
+  int n = enc_base58( (const uint8_t*)buf, len,
+                      (uint8_t*)&flt.buf_[0], flt.buf_.size() );
+  flt.buf_.resize( n );
+  fvec_.push_back( flt );
+}
+
+uint64_t rpc::get_program_accounts::get_slot() const
+{
+  return slot_;
+}
+
+unsigned rpc::get_program_accounts::get_num_account() const
+{
+  return avec_.size();
+}
+
+rpc::program_account *rpc::get_program_accounts::get_account( unsigned i )
+{
+  return &avec_[i];
+}
+
+rpc::program_account *rpc::get_program_accounts::get_account(
+    const pub_key& acc )
+{
+  acc_map_t::iter_t it = amap_.find( acc );
+  return it ? &avec_[amap_.obj( it )] : nullptr;
+}
+
+void rpc::get_program_accounts::release()
+{
+  acc_vec_t().swap( avec_ );
+  amap_.clear();
+}
+
+void rpc::get_program_accounts::request( json_wtr& msg )
+{
+  msg.add_key( "method", "getProgramAccounts" );
+  msg.add_key( "params", json_wtr::e_arr );
+  msg.add_val( *prog_ );
+  msg.add_val( json_wtr::e_obj );
+  msg.add_key( "encoding", "base64" );
+  msg.add_key( "commitment", commitment_to_str( cmt_ ) );
+  msg.add_key( "withContext", json_wtr::jtrue() );
+  if ( !fvec_.empty() ) {
+    msg.add_key( "filters", json_wtr::e_arr );
+    for( const filter& flt: fvec_ ) {
+      msg.add_val( json_wtr::e_obj );
+      msg.add_key( "memcmp", json_wtr::e_obj );
+      msg.add_key( "offset", (uint64_t)flt.off_ );
+      msg.add_key( "bytes", flt.buf_ );
+      msg.pop();
+      msg.pop();
+    }
+    msg.pop();
+  }
+  msg.pop();
+  msg.pop();
+}
+
+void rpc::get_program_accounts::response( const jtree& jt )
+{
+  avec_.clear();
+  amap_.clear();
+  if ( on_error( jt, this ) ) return;
+  const jpath& path = rpc_path();
+  slot_ = jt.get_uint( jt.find_path( path, e_result_slot ) );
+  int64_t ts = get_now();
+  uint32_t rtok = jt.find_path( path, e_result_value );
+  for( uint32_t tok = jt.get_first( rtok ); tok; tok = jt.get_next( tok ) ) {
+    uint32_t atok = jt.find_val( tok, "account" );
+    const char *dptr;
+    size_t dlen;
+    jt.get_text( jt.get_first( jt.find_val( atok, "data" ) ), dptr, dlen );
+    avec_.resize( avec_.size() + 1 );
+    program_account& acc = avec_.back();
+    acc.acc_.init_from_text( jt.get_str( jt.find_val( tok, "pubkey" ) ) );
+    acc.slot_ = slot_;
+    acc.lamports_ = jt.get_uint( jt.find_val( atok, "lamports" ) );
+    acc.recv_ts_ = ts;
+    acc.data_.resize( dlen );
+    acc.data_.resize( dec_base64( (const uint8_t*)dptr, dlen,
+                                  (uint8_t*)&acc.data_[0] ) );
+    amap_.ref( amap_.add( acc.acc_ ) ) = avec_.size() - 1;
+  }
+  on_response( this );
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // transfer
 
@@ -768,11 +1358,13 @@ rpc::account_subscribe::account_subscribe()
 void rpc::account_subscribe::set_account( pub_key *pkey )
 {
   acc_ = pkey;
+  reset_tmpl();
 }
 
 void rpc::account_subscribe::set_commitment( commitment val )
 {
   cmt_ = val;
+  reset_tmpl();
 }
 
 uint64_t rpc::account_subscribe::get_slot() const
@@ -785,6 +1377,11 @@ uint64_t rpc::account_subscribe::get_lamports() const
   return lamports_;
 }
 
+bool rpc::account_subscribe::get_is_cacheable() const
+{
+  return true;
+}
+
 void rpc::account_subscribe::request( json_wtr& msg )
 {
   msg.add_key( "method", "accountSubscribe" );
@@ -809,19 +1406,31 @@ bool rpc::account_subscribe::notify( const jtree& jt )
 {
   if ( on_error( jt, this ) ) return true;
 
-  uint32_t ptok = jt.find_val( 1, "params" );
-  uint32_t rtok = jt.find_val( ptok, "result" );
-  uint32_t ctok = jt.find_val( rtok, "context" );
-  slot_ = jt.get_uint( jt.find_val( ctok, "slot" ) );
-  uint32_t vtok = jt.find_val( rtok, "value" );
-  uint32_t dtok = jt.find_val( vtok, "data" );
+  const jpath& path = rpc_path();
+  slot_ = jt.get_uint( jt.find_path( path, e_params_slot ) );
+  uint32_t dtok = jt.find_path( path, e_params_value_data );
   jt.get_text( jt.get_first( dtok ), dptr_, dlen_ );
-  lamports_ = jt.get_uint( jt.find_val( vtok, "lamports" ) );
+  lamports_ = jt.get_uint( jt.find_path( path, e_params_value_lamports ) );
 
   on_response( this );
   return false;  // keep notification
 }
 
+rpc_notify::type_t rpc::account_subscribe::get_notify_type() const
+{
+  return rpc_notify::e_account;
+}
+
+bool rpc::account_subscribe::notify( const rpc_notify& nt )
+{
+  slot_ = nt.slot_;
+  dptr_ = nt.dptr_;
+  dlen_ = nt.dlen_;
+  lamports_ = nt.lamports_;
+  on_response( this );
+  return false;  // keep notification
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // slot_subscribe
 
@@ -830,6 +1439,11 @@ uint64_t rpc::slot_subscribe::get_slot() const
   return slot_;
 }
 
+bool rpc::slot_subscribe::get_is_cacheable() const
+{
+  return true;
+}
+
 void rpc::slot_subscribe::request( json_wtr& msg )
 {
   msg.add_key( "method", "slotSubscribe" );
@@ -845,9 +1459,19 @@ void rpc::slot_subscribe::response( const jtree& jt )
 bool rpc::slot_subscribe::notify( const jtree& jt )
 {
   if ( on_error( jt, this ) ) return true;
-  uint32_t ptok = jt.find_val( 1, "params" );
-  uint32_t rtok = jt.find_val( ptok, "result" );
-  slot_ = jt.get_uint( jt.find_val( rtok, "slot" ) );
+  slot_ = jt.get_uint( jt.find_path( rpc_path(), e_params_result_slot ) );
+  on_response( this );
+  return false; // keep notification
+}
+
+rpc_notify::type_t rpc::slot_subscribe::get_notify_type() const
+{
+  return rpc_notify::e_slot;
+}
+
+bool rpc::slot_subscribe::notify( const rpc_notify& nt )
+{
+  slot_ = nt.slot_;
   on_response( this );
   return false; // keep notification
 }
@@ -899,15 +1523,24 @@ bool rpc::signature_subscribe::notify( const jtree& jt )
 {
   if ( on_error( jt, this ) ) return true;
 
-  uint32_t ptok = jt.find_val( 1, "params" );
-  uint32_t rtok = jt.find_val( ptok, "result" );
-  uint32_t ctok = jt.find_val( rtok, "context" );
-  slot_ = jt.get_uint( jt.find_val( ctok, "slot" ) );
+  slot_ = jt.get_uint( jt.find_path( rpc_path(), e_params_slot ) );
 
   on_response( this );
   return true;  // remove notification
 }
 
+rpc_notify::type_t rpc::signature_subscribe::get_notify_type() const
+{
+  return rpc_notify::e_signature;
+}
+
+bool rpc::signature_subscribe::notify( const rpc_notify& nt )
+{
+  slot_ = nt.slot_;
+  on_response( this );
+  return true;  // remove notification
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // create_account
 
@@ -6,6 +6,7 @@
 #include <pc/attr_id.hpp>
 #include <oracle/oracle.h>
 #include <pc/hash_map.hpp>
+#include <deque>
 
 #define PC_RPC_ERROR_BLOCK_CLEANED_UP          -32001
 #define PC_RPC_ERROR_SEND_TX_PREFLIGHT_FAIL    -32002
@@ -63,17 +64,57 @@ namespace pc
 
   class rpc_request;
 
+  // per-connection rpc http request statistics
+  struct rpc_http_stats
+  {
+    uint64_t num_req_;  // requests sent
+    uint64_t num_resp_; // responses received
+    uint32_t num_out_;  // requests awaiting response
+    int64_t  lat_avg_;  // mean response latency (nanoseconds)
+    int64_t  lat_max_;  // worst response latency (nanoseconds)
+  };
+
+  // fields of a websocket account, slot or signature notification
+  // extracted without building a parse tree
+  struct rpc_notify
+  {
+    enum type_t {
+      e_none = 0,
+      e_account,
+      e_slot,
+      e_signature
+    };
+    type_t      type_;
+    uint64_t    sub_;      // subscription id
+    uint64_t    slot_;     // context slot (or slot of slot notification)
+    uint64_t    lamports_; // account balance
+    const char *dptr_;     // base64 account data
+    size_t      dlen_;
+
+    // scan notification of expected shape. returns false on anything
+    // else so that the message is parsed as a jtree
+    bool scan( const char *msg, size_t msg_len );
+  };
+
   // solana rpc REST API client
   class rpc_client : public error
   {
   public:
 
     rpc_client();
+    ~rpc_client();
 
-    // rpc http connection
+    // rpc http connection (replaces any existing connection pool)
     void set_http_conn( net_connect * );
     net_connect *get_http_conn() const;
 
+    // add keep-alive http connection to pool. requests are pipelined
+    // on the connection with the fewest outstanding requests
+    void add_http_conn( net_connect * );
+    unsigned get_num_http_conn() const;
+    net_connect *get_http_conn( unsigned i ) const;
+    void get_http_stats( unsigned i, rpc_http_stats& ) const;
+
     // rpc web socket connection
     void set_ws_conn( net_connect * );
     net_connect *get_ws_conn() const;
@@ -94,14 +135,27 @@ namespace pc
     template<class T>
     size_t get_data( const char *dptr, size_t dlen, T *&ptr );
 
+    // notifications dispatched from the field scanner and from jtree
+    uint64_t get_num_notify_fast() const;
+    uint64_t get_num_notify_slow() const;
+
     // reset state
     void reset();
 
   private:
 
+    // http responses arrive in request order on each connection so
+    // latency is tracked using a queue of send times
     struct rpc_http : public http_client {
       void parse_content( const char *, size_t ) override;
-      rpc_client *cp_;
+      typedef std::deque<int64_t> ts_que_t;
+      rpc_client  *cp_;
+      net_connect *hptr_;
+      ts_que_t     sent_;   // send time of outstanding requests
+      uint64_t     nreq_;   // requests sent
+      uint64_t     nrsp_;   // responses received
+      int64_t      lsum_;   // sum of response latencies
+      int64_t      lmax_;   // worst response latency
     };
 
     struct rpc_ws : public ws_parser {
@@ -120,14 +174,17 @@ namespace pc
       };
     };
 
+    rpc_http *get_http();
+    bool send_tmpl( rpc_request *, uint64_t id );
+
+    typedef std::vector<rpc_http*>    http_vec_t;
     typedef std::vector<rpc_request*> request_t;
     typedef std::vector<uint64_t>     id_vec_t;
     typedef std::vector<char>         acc_buf_t;
     typedef hash_map<trait>           sub_map_t;
 
-    net_connect *hptr_;
     net_connect *wptr_;
-    rpc_http     hp_;    // http parser wrapper
+    http_vec_t   hv_;    // http connection pool and parser wrappers
     rpc_ws       wp_;    // websocket parser wrapper
     jtree        jp_;    // json parser
     request_t    rv_;    // waiting requests by id
@@ -135,6 +192,8 @@ namespace pc
     sub_map_t    smap_;  // subscription map
     acc_buf_t    abuf_;  // account decode buffer
     uint64_t     id_;    // next request id
+    uint64_t     nfast_; // notifications handled by field scanner
+    uint64_t     nslow_; // notifications handled by jtree
   };
 
   // rpc response or subscrption callback
@@ -153,6 +212,16 @@ namespace pc
     virtual void on_response( T * ) = 0;
   };
 
+  // pre-framed http request or websocket frame of a cacheable request.
+  // the id is written into a space-padded slot and websocket frames are
+  // re-masked on each send
+  struct rpc_tmpl
+  {
+    std::string buf_;  // framed request (unmasked)
+    uint32_t    id_;   // offset of id slot
+    uint32_t    mask_; // offset of websocket mask key (0 for http)
+  };
+
   // base-class rpc request message
   class rpc_request : public error
   {
@@ -190,6 +259,11 @@ namespace pc
     // is this message http or websocket bound
     virtual bool get_is_http() const;
 
+    // does the request serialize identically on every send (other than
+    // its id) so that rpc_client may resend a cached template
+    virtual bool get_is_cacheable() const;
+    rpc_tmpl& get_tmpl();
+
     // request builder
     virtual void request( json_wtr& ) = 0;
 
@@ -199,12 +273,21 @@ namespace pc
     // notification subscription update
     virtual bool notify( const jtree& );
 
+    // notification type handled by notify( const rpc_notify& ) instead
+    // of parsing a jtree (e_none if not supported)
+    virtual rpc_notify::type_t get_notify_type() const;
+    virtual bool notify( const rpc_notify& );
+
   protected:
 
     template<class T> void on_response( T * );
     template<class T> bool on_error( const jtree&, T * );
 
+    // discard cached template after a change of request parameters
+    void reset_tmpl();
+
   private:
+    rpc_tmpl    tmpl_;
     rpc_sub    *cb_;
     rpc_client *cp_;
     uint64_t    id_;
@@ -271,6 +354,7 @@ namespace pc
 
       get_account_info();
       void request( json_wtr& ) override;
+      bool get_is_cacheable() const override;
       void response( const jtree& ) override;
 
     private:
@@ -302,6 +386,7 @@ namespace pc
 
       get_recent_block_hash();
       void request( json_wtr& ) override;
+      bool get_is_cacheable() const override;
       void response( const jtree& ) override;
 
     private:
@@ -315,6 +400,7 @@ namespace pc
     {
     public:
       void request( json_wtr& ) override;
+      bool get_is_cacheable() const override;
       void response( const jtree& ) override;
     };
 
@@ -376,6 +462,86 @@ namespace pc
       ldr_vec_t lvec_;
     };
 
+    // account from a get_program_accounts reply. has the accessors of
+    // get_account_info so it can be applied as an account update
+    class program_account : public error
+    {
+    public:
+      program_account();
+      pub_key *get_account();
+      uint64_t get_slot() const;
+      uint64_t get_lamports() const;
+      int64_t  get_recv_time() const;
+      template<class T> size_t get_data( T *& );
+
+    private:
+      friend class get_program_accounts;
+      pub_key     acc_;
+      uint64_t    slot_;
+      uint64_t    lamports_;
+      int64_t     recv_ts_;
+      std::string data_;   // decoded account data
+    };
+
+    template<class T> size_t program_account::get_data( T *&res )
+    {
+      if ( data_.size() < sizeof( T ) ) {
+        data_.resize( sizeof( T ) );
+      }
+      res = (T*)&data_[0];
+      return data_.size();
+    }
+
+    // get all accounts owned by a program that match the memcmp filters
+    class get_program_accounts : public rpc_request
+    {
+    public:
+      // parameters
+      void set_program( pub_key * );
+      void set_commitment( commitment );
+      void add_filter( uint32_t offset, const void *buf, size_t len );
+
+      // results
+      uint64_t get_slot() const;
+      unsigned get_num_account() const;
+      program_account *get_account( unsigned i );
+      program_account *get_account( const pub_key& );
+
+      // release decoded accounts once no longer needed
+      void release();
+
+      get_program_accounts();
+      void request( json_wtr& ) override;
+      void response( const jtree& ) override;
+
+    private:
+      struct trait_account {
+        static const size_t hsize_ = 8363UL;
+        typedef uint32_t        idx_t;
+        typedef pub_key         key_t;
+        typedef const pub_key&  keyref_t;
+        typedef uint32_t        val_t;
+        struct hash_t {
+          idx_t operator() ( keyref_t a ) {
+            uint64_t *i = (uint64_t*)a.data();
+            return i[0];
+          }
+        };
+      };
+      struct filter {
+        uint32_t    off_;
+        std::string buf_;  // base58 encoded bytes
+      };
+      typedef hash_map<trait_account>      acc_map_t;
+      typedef std::vector<program_account> acc_vec_t;
+      typedef std::vector<filter>          filter_vec_t;
+      pub_key     *prog_;
+      uint64_t     slot_;
+      commitment   cmt_;
+      filter_vec_t fvec_;
+      acc_vec_t    avec_;
+      acc_map_t    amap_;
+    };
 
     // find out when slots update
     class slot_subscribe : public rpc_subscription
@@ -383,8 +549,11 @@ namespace pc
     public:
       uint64_t get_slot() const;
       void request( json_wtr& ) override;
+      bool get_is_cacheable() const override;
       void response( const jtree& ) override;
       bool notify( const jtree& ) override;
+      bool notify( const rpc_notify& ) override;
+      rpc_notify::type_t get_notify_type() const override;
     private:
       uint64_t slot_;
     };
@@ -404,6 +573,8 @@ namespace pc
       void request( json_wtr& ) override;
       void response( const jtree& ) override;
       bool notify( const jtree& ) override;
+      bool notify( const rpc_notify& ) override;
+      rpc_notify::type_t get_notify_type() const override;
 
     private:
       signature  *sig_;
@@ -426,8 +597,11 @@ namespace pc
 
       account_subscribe();
       void request( json_wtr& ) override;
+      bool get_is_cacheable() const override;
       void response( const jtree& ) override;
       bool notify( const jtree& ) override;
+      bool notify( const rpc_notify& ) override;
+      rpc_notify::type_t get_notify_type() const override;
 
     private:
       pub_key    *acc_;
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace pc
+{
+
+  // bounded lock-free single-producer single-consumer queue. capacity is
+  // rounded up to a power of two. push and pop never block
+  template<class T>
+  class spsc_queue
+  {
+  public:
+    spsc_queue();
+    ~spsc_queue();
+
+    // allocate queue (before use by either thread)
+    void init( unsigned cap );
+
+    // producer: returns false if queue is full
+    bool push( const T& );
+
+    // consumer: returns false if queue is empty
+    bool pop( T& );
+
+    // approximate number of queued items
+    unsigned size() const;
+
+  private:
+    spsc_queue( const spsc_queue& );
+    spsc_queue& operator=( const spsc_queue& );
+
+    typedef std::atomic<uint64_t> atomic_t;
+
+    // producer and consumer indices padded onto separate cache lines
+    T        *buf_;      // item storage
+    uint64_t  msk_;      // capacity - 1
+    char      pad0_[48];
+    atomic_t  hd_;       // consumer read index
+    uint64_t  tlc_;      // consumer cached tail
+    char      pad1_[48];
+    atomic_t  tl_;       // producer write index
+    uint64_t  hdc_;      // producer cached head
+    char      pad2_[48];
+  };
+
+  template<class T>
+  spsc_queue<T>::spsc_queue()
+  : buf_( nullptr ),
+    msk_( 0 ),
+    hd_( 0 ),
+    tlc_( 0 ),
+    tl_( 0 ),
+    hdc_( 0 )
+  {
+  }
+
+  template<class T>
+  spsc_queue<T>::~spsc_queue()
+  {
+    delete [] buf_;
+  }
+
+  template<class T>
+  void spsc_queue<T>::init( unsigned cap )
+  {
+    uint64_t num = 2;
+    while( num < cap ) {
+      num += num;
+    }
+    delete [] buf_;
+    buf_ = new T[num];
+    msk_ = num - 1;
+    hd_  = tl_ = 0;
+    tlc_ = hdc_ = 0;
+  }
+
+  template<class T>
+  bool spsc_queue<T>::push( const T& val )
+  {
+    uint64_t tl = tl_.load( std::memory_order_relaxed );
+    if ( tl - hdc_ > msk_ ) {
+      hdc_ = hd_.load( std::memory_order_acquire );
+      if ( tl - hdc_ > msk_ ) {
+        return false;
+      }
+    }
+    buf_[tl & msk_] = val;
+    tl_.store( tl + 1, std::memory_order_release );
+    return true;
+  }
+
+  template<class T>
+  bool spsc_queue<T>::pop( T& val )
+  {
+    uint64_t hd = hd_.load( std::memory_order_relaxed );
+    if ( hd == tlc_ ) {
+      tlc_ = tl_.load( std::memory_order_acquire );
+      if ( hd == tlc_ ) {
+        return false;
+      }
+    }
+    val = buf_[hd & msk_];
+    hd_.store( hd + 1, std::memory_order_release );
+    return true;
+  }
+
+  template<class T>
+  unsigned spsc_queue<T>::size() const
+  {
+    return tl_.load( std::memory_order_relaxed ) -
+           hd_.load( std::memory_order_relaxed );
+  }
+
+}
@@ -1,7 +1,8 @@
 #include "user.hpp"
 #include "manager.hpp"
 #include "log.hpp"
-#include "mem_map.hpp"
+#include <sys/socket.h>
+#include <algorithm>
 
 #define PC_JSON_RPC_VER         "2.0"
 #define PC_JSON_PARSE_ERROR     -32700
@@ -25,7 +26,14 @@ void user::user_http::parse_content( const char *txt, size_t len )
 user::user()
 : rptr_( nullptr ),
   sptr_( nullptr ),
-  psub_( this )
+  wptr_( nullptr ),
+  psub_( this ),
+  hwm_( default_send_hwm ),
+  max_( default_send_max ),
+  nconf_( 0 ),
+  ndrop_( 0 ),
+  conf_( true ),
+  bin_( false )
 {
   // setup the plumbing
   hsvr_.ptr_ = this;
@@ -44,62 +52,243 @@ void user::set_manager( manager *sptr )
   sptr_ = sptr;
 }
 
+void user::set_user_worker( user_worker *wptr )
+{
+  wptr_ = wptr;
+}
+
+user_worker *user::get_user_worker() const
+{
+  return wptr_;
+}
+
+void user::set_send_limit( size_t hwm, size_t max )
+{
+  hwm_ = hwm;
+  max_ = std::max( hwm, max );
+}
+
+size_t user::get_send_hwm() const
+{
+  return hwm_;
+}
+
+size_t user::get_send_max() const
+{
+  return max_;
+}
+
+void user::set_conflate( bool conf )
+{
+  conf_ = conf;
+}
+
+bool user::get_conflate() const
+{
+  return conf_;
+}
+
+uint64_t user::get_num_conflated() const
+{
+  return nconf_;
+}
+
+uint64_t user::get_num_dropped() const
+{
+  return ndrop_;
+}
+
+static void release_bufs( net_buf *ptr )
+{
+  while( ptr ) {
+    net_buf *nxt = ptr->next_;
+    ptr->dealloc();
+    ptr = nxt;
+  }
+}
+
+void user::queue_send( net_buf *hd, net_buf *tl, bool is_bin )
+{
+  if ( PC_UNLIKELY( net_connect::get_is_err() ) ) {
+    release_bufs( hd );
+    ++ndrop_;
+    return;
+  }
+  add_ws_send( hd, tl, is_bin );
+  if ( PC_UNLIKELY( get_send_queue() > max_ ) ) {
+    drop_slow();
+  }
+}
+
+void user::add_ws_send( net_buf *hd, net_buf *tl, bool is_bin )
+{
+  net_wtr pay;
+  pay.attach( hd, tl );
+  ws_wtr msg;
+  msg.commit( is_bin ? ws_wtr::binary_id : ws_wtr::text_id,
+              pay, false, get_deflate() );
+  add_send( msg );
+}
+
+void user::queue_notify( uint64_t sid, net_buf *hd, net_buf *tl,
+                         bool is_bin )
+{
+  if ( pend_.empty() && get_send_queue() < hwm_ ) {
+    queue_send( hd, tl, is_bin );
+    return;
+  }
+  if ( PC_UNLIKELY( net_connect::get_is_err() ) || !conf_ ) {
+    release_bufs( hd );
+    ++ndrop_;
+    return;
+  }
+  // replace any held back notification for the same subscription
+  pend_msg& msg = pend_[sid];
+  if ( msg.hd_ ) {
+    release_bufs( msg.hd_ );
+    ++nconf_;
+  }
+  msg.hd_  = hd;
+  msg.tl_  = tl;
+  msg.bin_ = is_bin;
+}
+
+void user::on_sent()
+{
+  if ( PC_UNLIKELY( !pend_.empty() ) && get_send_queue() < hwm_ ) {
+    flush_pend();
+  }
+}
+
+void user::flush_pend()
+{
+  for( pend_map_t::value_type& it: pend_ ) {
+    add_ws_send( it.second.hd_, it.second.tl_, it.second.bin_ );
+  }
+  pend_.clear();
+}
+
+void user::drop_slow()
+{
+  // shut down socket so that the loop tears down the connection
+  PC_LOG_WRN( "slow_user_disconnect" )
+    .add( "fd", get_fd() )
+    .add( "send_queue", get_send_queue() )
+    .add( "num_conflated", nconf_ )
+    .add( "num_dropped", ndrop_ + pend_.size() )
+    .end();
+  net_connect::set_err_msg( "send queue limit exceeded" );
+  if ( get_fd() >= 0 ) {
+    ::shutdown( get_fd(), SHUT_RDWR );
+  }
+}
+
 void user::teardown()
 {
   net_connect::teardown();
+  for( pend_map_t::value_type& it: pend_ ) {
+    release_bufs( it.second.hd_ );
+    ++ndrop_;
+  }
+  pend_.clear();
 
+  // manager state may only be changed from manager thread
+  if ( wptr_ ) {
+    wptr_->on_close( this );
+  } else {
+    detach();
+  }
+}
+
+void user::detach()
+{
   // remove self from server list
-  sptr_->del_user( this );
+  if ( sptr_ ) {
+    sptr_->del_user( this );
+  }
 
   // remove all symbol subscriptions
   psub_.teardown();
 }
 
-static str get_content_type( const std::string & filen )
+void user::send( net_wtr& msg, bool is_bin )
 {
-  size_t i = filen.find_last_of( '.' );
-  if ( i != std::string::npos ) {
-    std::string ext = filen.substr( i );
-    if ( ext == ".html" ) {
-      return "text/html";
-    } else if ( ext == ".css" ) {
-      return "text/css";
-    } else if ( ext == ".js" ) {
-      return "application/javascript";
-    }
+  if ( wptr_ ) {
+    wptr_->send( this, msg, is_bin );
+  } else {
+    net_buf *hd, *tl;
+    msg.detach( hd, tl );
+    queue_send( hd, tl, is_bin );
+  }
+}
+
+void user::notify( uint64_t sid, net_wtr& msg, bool is_bin )
+{
+  if ( wptr_ ) {
+    wptr_->notify( this, sid, msg, is_bin );
+  } else {
+    net_buf *hd, *tl;
+    msg.detach( hd, tl );
+    queue_notify( sid, hd, tl, is_bin );
   }
-  return "text/html";
 }
 
 void user::parse_content( const char *, size_t )
 {
-  str path;
+  // responses are pre-built by the manager's content cache
+  str path, enc, etag;
   hsvr_.get_path( path );
-  std::string cfile = sptr_->get_content_dir();
-  if ( cfile.empty() ) {
-    cfile += ".";
-  }
-  cfile += std::string( path.str_, path.len_ );
-  if ( path == str( "/" ) ) {
-    cfile += "index.html";
-  }
-  mem_map mf;
-  mf.set_file( cfile );
-  http_response msg;
-  if ( mf.init() ) {
-    msg.init( "200", "OK" );
-    msg.add_hdr( "Content-Type", get_content_type( cfile ) );
-    net_wtr mfb;
-    mfb.add( str( mf.data(), mf.size() ) );
-    msg.commit( mfb );
+  hsvr_.get_header_val( "Accept-Encoding", enc );
+  hsvr_.get_header_val( "If-None-Match", etag );
+  web_content_ptr cptr = sptr_->get_web_content();
+  const web_resp *rptr = cptr->get( path, enc, etag );
+  if ( rptr->get_fd() >= 0 ) {
+    add_send_file( rptr->get_fd(), rptr->data(), rptr->size() );
   } else {
-    msg.init( "404", "Not Found" );
-    msg.commit();
+    net_wtr msg;
+    msg.add( str( rptr->data(), rptr->size() ) );
+    add_send( msg );
   }
-  add_send( msg );
 }
 
 void user::parse_msg( const char *txt, size_t len )
+{
+  // binary frames are json unless the binary protocol was negotiated
+  bool is_bin = bin_ && get_is_binary();
+  if ( wptr_ ) {
+    wptr_->on_recv( this, txt, len, is_bin );
+  } else if ( is_bin ) {
+    process_bin( txt, len );
+  } else {
+    process_msg( txt, len );
+  }
+}
+
+std::string user::negotiate_protocol( str offer )
+{
+  // offer is a comma-separated list of protocol names
+  const char *ptr = offer.str_, *end = &offer.str_[offer.len_];
+  while( ptr != end ) {
+    const char *nxt = ptr;
+    while( nxt != end && *nxt != ',' ) ++nxt;
+    str tok( ptr, nxt - ptr );
+    while( tok.len_ && tok.str_[0] == ' ' ) { ++tok.str_; --tok.len_; }
+    while( tok.len_ && tok.str_[tok.len_-1] == ' ' ) --tok.len_;
+    if ( tok == PC_BIN_PROTOCOL ) {
+      bin_ = true;
+      return PC_BIN_PROTOCOL;
+    }
+    ptr = nxt == end ? end : nxt + 1;
+  }
+  return std::string();
+}
+
+bool user::get_is_bin_protocol() const
+{
+  return bin_;
+}
+
+void user::process_msg( const char *txt, size_t len )
 {
   jw_.reset();
   jp_.parse( txt, len );
@@ -128,18 +317,177 @@ void user::parse_msg( const char *txt, size_t len )
   } else {
     add_parse_error();
   }
-  // wrap in websockets header and submit
-  ws_wtr msg;
-  msg.commit( ws_wtr::text_id, jw_, false );
-  add_send( msg );
+  // submit (websocket framing is added on the connection thread)
+  send( jw_ );
 
   // process any deferred subscriptions
   if ( PC_UNLIKELY( !dvec_.empty() ) ) {
-    for( deferred_sub& dsub: dvec_ ) {
-      on_response( dsub.sptr_, dsub.sid_ );
+    add_deferred();
+  }
+}
+
+void user::add_deferred()
+{
+  for( deferred_sub& dsub: dvec_ ) {
+    on_response( dsub.sptr_, dsub.sid_ );
+  }
+  dvec_.clear();
+}
+
+void user::process_bin( const char *buf, size_t len )
+{
+  // frame may hold several requests whose acks are sent in one frame
+  bw_.reset();
+  while( len ) {
+    bin_hdr hdr;
+    __builtin_memset( &hdr, 0, sizeof( hdr ) );
+    __builtin_memcpy( &hdr, buf, std::min( len, sizeof( hdr ) ) );
+    if ( len < sizeof( hdr ) || hdr.size_ < sizeof( hdr ) ||
+         hdr.size_ > len ) {
+      add_bin_ack( hdr, PC_JSON_PARSE_ERROR );
+      break;
     }
-    dvec_.clear();
+    switch( hdr.type_ ) {
+      case bin_msg::e_update_price: {
+        parse_bin_upd_price( buf, hdr );
+        break;
+      }
+      case bin_msg::e_get_handle: {
+        parse_bin_get_handle( buf, hdr );
+        break;
+      }
+      case bin_msg::e_subscribe_price:
+      case bin_msg::e_subscribe_price_sched: {
+        parse_bin_sub( buf, hdr );
+        break;
+      }
+      default: {
+        add_bin_ack( hdr, PC_JSON_UNKNOWN_METHOD );
+        break;
+      }
+    }
+    buf += hdr.size_;
+    len -= hdr.size_;
   }
+  send( bw_, true );
+
+  // process any deferred subscriptions
+  if ( PC_UNLIKELY( !dvec_.empty() ) ) {
+    add_deferred();
+  }
+}
+
+template<class T>
+static inline bool get_bin( const char *buf, const bin_hdr& hdr, T& msg )
+{
+  if ( PC_UNLIKELY( hdr.size_ != sizeof( T ) ) ) {
+    return false;
+  }
+  __builtin_memcpy( &msg, buf, sizeof( T ) );
+  return true;
+}
+
+price *user::get_bin_price( uint32_t hdl ) const
+{
+  return hdl && hdl <= hvec_.size() ? hvec_[hdl-1] : nullptr;
+}
+
+void user::parse_bin_get_handle( const char *buf, const bin_hdr& hdr )
+{
+  bin_get_handle req;
+  if ( !get_bin( buf, hdr, req ) ) {
+    add_bin_ack( hdr, PC_JSON_INVALID_PARAMS );
+    return;
+  }
+  pub_key pkey;
+  pkey.init_from_buf( req.acc_ );
+  price *sptr = sptr_->get_price( pkey );
+  if ( !sptr ) {
+    add_bin_ack( hdr, PC_JSON_UNKNOWN_SYMBOL );
+    return;
+  }
+  uint32_t& hdl = hmap_[sptr];
+  if ( !hdl ) {
+    hvec_.push_back( sptr );
+    hdl = hvec_.size();
+  }
+  add_bin_ack( hdr, 0, hdl, sptr->get_price_exponent() );
+}
+
+void user::parse_bin_upd_price( const char *buf, const bin_hdr& hdr )
+{
+  bin_update_price req;
+  if ( !get_bin( buf, hdr, req ) ||
+       req.status_ >= (uint32_t)symbol_status::e_last_symbol_status ) {
+    add_bin_ack( hdr, PC_JSON_INVALID_PARAMS );
+    return;
+  }
+  price *sptr = get_bin_price( req.handle_ );
+  if ( PC_UNLIKELY( !sptr ) ) {
+    add_bin_ack( hdr, PC_JSON_UNKNOWN_SYMBOL, req.handle_ );
+    return;
+  }
+  int err = 0;
+  if ( sptr->update( req.price_, req.conf_,
+                     (symbol_status)req.status_ ) ) {
+    err = 0;
+  } else if ( !sptr->get_is_ready_publish() ) {
+    err = PC_JSON_NOT_READY;
+  } else if ( !sptr->has_publisher() ) {
+    err = PC_JSON_MISSING_PERMS;
+  } else {
+    err = PC_JSON_INVALID_REQUEST;
+  }
+  add_bin_ack( hdr, err, req.handle_ );
+}
+
+void user::parse_bin_sub( const char *buf, const bin_hdr& hdr )
+{
+  bin_subscribe req;
+  if ( !get_bin( buf, hdr, req ) ) {
+    add_bin_ack( hdr, PC_JSON_INVALID_PARAMS );
+    return;
+  }
+  price *sptr = get_bin_price( req.handle_ );
+  if ( !sptr ) {
+    add_bin_ack( hdr, PC_JSON_UNKNOWN_SYMBOL, req.handle_ );
+    return;
+  }
+  uint64_t sub_id;
+  if ( hdr.type_ == bin_msg::e_subscribe_price ) {
+    sub_id = psub_.add( sptr );
+    deferred_sub dsub{ sptr, sub_id };
+    dvec_.push_back( dsub );
+  } else {
+    sub_id = psub_.add( sptr->get_sched() );
+  }
+  add_bin_sub( sub_id, req.handle_ );
+  add_bin_ack( hdr, 0, req.handle_, sub_id );
+}
+
+void user::add_bin_sub( uint64_t sid, uint32_t hdl )
+{
+  // remember which subscriptions are notified in binary
+  if ( sid >= shdl_.size() ) {
+    if ( !hdl ) {
+      return;
+    }
+    shdl_.resize( sid + 1, 0 );
+  }
+  shdl_[sid] = hdl;
+}
+
+void user::add_bin_ack( const bin_hdr& hdr, int err, uint32_t hdl,
+                        int64_t val )
+{
+  bin_ack ack;
+  ack.hdr_.type_ = bin_msg::e_ack;
+  ack.hdr_.size_ = sizeof( ack );
+  ack.hdr_.id_   = hdr.id_;
+  ack.err_       = err;
+  ack.handle_    = hdl;
+  ack.val_       = val;
+  bw_.add( str( (const char*)&ack, sizeof( ack ) ) );
 }
 
 void user::parse_request( uint32_t tok )
@@ -218,6 +566,7 @@ void user::parse_sub_price( uint32_t tok, uint32_t itok )
 
     // add subscription
     uint64_t sub_id = psub_.add( sptr );
+    add_bin_sub( sub_id, 0 );
 
     // create result
     add_header();
@@ -248,6 +597,7 @@ void user::parse_sub_price_sched( uint32_t tok, uint32_t itok )
 
     // add subscription
     uint64_t sub_id = psub_.add( sptr->get_sched() );
+    add_bin_sub( sub_id, 0 );
 
     // create result
     add_header();
@@ -345,30 +695,48 @@ void user::add_error( uint32_t id, int err, str emsg )
 
 void user::on_response( price *rptr, uint64_t idx )
 {
-  // construct notify response
+  if ( idx < shdl_.size() && shdl_[idx] ) {
+    bin_notify_price msg;
+    bw_.reset();
+    msg.hdr_.type_   = bin_msg::e_notify_price;
+    msg.hdr_.size_   = sizeof( msg );
+    msg.hdr_.id_     = 0;
+    msg.handle_      = shdl_[idx];
+    msg.status_      = (uint32_t)rptr->get_status();
+    msg.sub_         = idx;
+    msg.price_       = rptr->get_price();
+    msg.conf_        = rptr->get_conf();
+    msg.valid_slot_  = rptr->get_valid_slot();
+    msg.pub_slot_    = rptr->get_pub_slot();
+    bw_.add( str( (const char*)&msg, sizeof( msg ) ) );
+    notify( idx, bw_, true );
+    return;
+  }
+
+  // copy notification shared by all subscribers of this update
   jw_.reset();
-  add_header();
-  jw_.add_key( "method", "notify_price" );
-  jw_.add_key( "params", json_wtr::e_obj );
-  jw_.add_key( "result", json_wtr::e_obj );
-  jw_.add_key( "price", rptr->get_price() );
-  jw_.add_key( "conf", rptr->get_conf() );
-  jw_.add_key( "status", symbol_status_to_str( rptr->get_status() ) );
-  jw_.add_key( "valid_slot", rptr->get_valid_slot() );
-  jw_.add_key( "pub_slot", rptr->get_pub_slot() );
-  jw_.pop();
-  jw_.add_key( "subscription", idx );
-  jw_.pop();
-  jw_.pop();
+  sptr_->get_price_notify().add( jw_, rptr, idx );
 
-  // wrap in websockets header and submit
-  ws_wtr msg;
-  msg.commit( ws_wtr::text_id, jw_, false );
-  add_send( msg );
+  // submit (websocket framing is added on the connection thread)
+  notify( idx, jw_ );
 }
 
 void user::on_response( price_sched *, uint64_t idx )
 {
+  if ( idx < shdl_.size() && shdl_[idx] ) {
+    bin_notify_price_sched msg;
+    bw_.reset();
+    msg.hdr_.type_ = bin_msg::e_notify_price_sched;
+    msg.hdr_.size_ = sizeof( msg );
+    msg.hdr_.id_   = 0;
+    msg.handle_    = shdl_[idx];
+    msg.unused_    = 0;
+    msg.sub_       = idx;
+    bw_.add( str( (const char*)&msg, sizeof( msg ) ) );
+    notify( idx, bw_, true );
+    return;
+  }
+
   // construct notify response
   jw_.reset();
   add_header();
@@ -378,8 +746,334 @@ void user::on_response( price_sched *, uint64_t idx )
   jw_.pop();
   jw_.pop();
 
-  // wrap in websockets header and submit
-  ws_wtr msg;
-  msg.commit( ws_wtr::text_id, jw_, false );
-  add_send( msg );
+  // submit (websocket framing is added on the connection thread)
+  notify( idx, jw_ );
+}
+
+///////////////////////////////////////////////////////////////////////////
+// price_notify
+
+price_notify::price_notify()
+: ptr_( nullptr ),
+  px_( 0 ),
+  conf_( 0 ),
+  vslot_( 0 ),
+  pslot_( 0 ),
+  st_( symbol_status::e_unknown ),
+  nbld_( 0 )
+{
+}
+
+uint64_t price_notify::get_num_build() const
+{
+  return nbld_;
+}
+
+bool price_notify::get_is_match( price *ptr ) const
+{
+  return ptr == ptr_ &&
+         ptr->get_price() == px_ &&
+         ptr->get_conf() == conf_ &&
+         ptr->get_valid_slot() == vslot_ &&
+         ptr->get_pub_slot() == pslot_ &&
+         ptr->get_status() == st_;
+}
+
+void price_notify::build( price *ptr )
+{
+  ptr_   = ptr;
+  px_    = ptr->get_price();
+  conf_  = ptr->get_conf();
+  vslot_ = ptr->get_valid_slot();
+  pslot_ = ptr->get_pub_slot();
+  st_    = ptr->get_status();
+  ++nbld_;
+
+  // serialize everything up to the subscription id value
+  json_wtr jw;
+  jw.prealloc( 256 );
+  jw.add_val( json_wtr::e_obj );
+  jw.add_key( "jsonrpc", str( PC_JSON_RPC_VER ) );
+  jw.add_key( "method", "notify_price" );
+  jw.add_key( "params", json_wtr::e_obj );
+  jw.add_key( "result", json_wtr::e_obj );
+  jw.add_key( "price", px_ );
+  jw.add_key( "conf", conf_ );
+  jw.add_key( "status", symbol_status_to_str( st_ ) );
+  jw.add_key( "valid_slot", vslot_ );
+  jw.add_key( "pub_slot", pslot_ );
+  jw.pop();
+  jw.add( str( ",\"subscription\":" ) );
+  net_buf *hd, *tl;
+  pfx_.clear();
+  jw.detach( hd, tl );
+  while( hd ) {
+    net_buf *nxt = hd->next_;
+    pfx_.append( hd->buf_, hd->size_ );
+    hd->dealloc();
+    hd = nxt;
+  }
+}
+
+void price_notify::add( net_wtr& msg, price *ptr, uint64_t sid )
+{
+  if ( !get_is_match( ptr ) ) {
+    build( ptr );
+  }
+  char buf[24];
+  size_t len = uint_to_buf( sid, buf );
+  buf[len++] = '}';
+  buf[len++] = '}';
+  msg.prealloc( pfx_.size() + len );
+  msg.add( pfx_ );
+  msg.add( str( buf, len ) );
+}
+
+///////////////////////////////////////////////////////////////////////////
+// user_worker
+
+user_worker::user_worker()
+: mwk_( nullptr ),
+  nusr_( 0 ),
+  wsig_( false ),
+  msig_( false ),
+  run_( false )
+{
+}
+
+user_worker::~user_worker()
+{
+  teardown();
+}
+
+void user_worker::set_use_uring( bool use_uring )
+{
+  nl_.set_use_uring( use_uring );
+}
+
+bool user_worker::init( net_wakeup *mwk )
+{
+  mwk_ = mwk;
+  wq_.init( queue_len );
+  mq_.init( queue_len );
+  if ( !nl_.init() ) {
+    return set_err_msg( nl_.get_err_msg() );
+  }
+  wk_.set_net_loop( &nl_ );
+  wk_.set_sub( this );
+  if ( !wk_.init() ) {
+    return set_err_msg( wk_.get_err_msg() );
+  }
+  run_ = true;
+  thrd_ = std::thread( &user_worker::run, this );
+  return true;
+}
+
+void user_worker::teardown()
+{
+  if ( !thrd_.joinable() ) {
+    return;
+  }
+  run_ = false;
+  wk_.signal();
+  thrd_.join();
+
+  // closed users are deleted here. users still open remain owned by
+  // the manager which closes them while this worker's loop exists
+  user_msg msg;
+  while( wq_.pop( msg ) ) {
+    release( msg );
+  }
+  for( user_msg& m: wpend_ ) {
+    release( m );
+  }
+  while( mq_.pop( msg ) ) {
+    release( msg );
+  }
+  for( user_msg& m: mpend_ ) {
+    release( m );
+  }
+  wpend_.clear();
+  mpend_.clear();
+  wk_.close();
+}
+
+bool user_worker::get_is_run() const
+{
+  return thrd_.joinable();
+}
+
+unsigned user_worker::get_num_user() const
+{
+  return nusr_;
+}
+
+void user_worker::release( user_msg& msg )
+{
+  for( net_buf *ptr = msg.hd_; ptr; ) {
+    net_buf *nxt = ptr->next_;
+    ptr->dealloc();
+    ptr = nxt;
+  }
+  if ( msg.type_ == user_msg::e_del ) {
+    msg.usr_->close();
+    delete msg.usr_;
+  }
+}
+
+void user_worker::post( msg_queue_t& q, msg_vec_t& pend, const user_msg& m )
+{
+  // preserve ordering behind any messages that did not fit the queue
+  if ( !pend.empty() || !q.push( m ) ) {
+    pend.push_back( m );
+  }
+}
+
+void user_worker::repost( msg_queue_t& q, msg_vec_t& pend )
+{
+  size_t i = 0;
+  for( ; i != pend.size() && q.push( pend[i] ); ++i );
+  pend.erase( pend.begin(), pend.begin() + i );
+}
+
+void user_worker::add_user( user *usr )
+{
+  user_msg m = { user_msg::e_add, usr, nullptr, nullptr, 0, false };
+  post( wq_, wpend_, m );
+  wsig_ = true;
+  ++nusr_;
+}
+
+void user_worker::del_user( user *usr )
+{
+  user_msg m = { user_msg::e_del, usr, nullptr, nullptr, 0, false };
+  post( wq_, wpend_, m );
+  wsig_ = true;
+  --nusr_;
+}
+
+void user_worker::send( user *usr, net_wtr& msg, bool is_bin )
+{
+  user_msg m = { user_msg::e_send, usr, nullptr, nullptr, 0, is_bin };
+  msg.detach( m.hd_, m.tl_ );
+  post( wq_, wpend_, m );
+  wsig_ = true;
+}
+
+void user_worker::notify( user *usr, uint64_t sid, net_wtr& msg,
+                          bool is_bin )
+{
+  user_msg m = { user_msg::e_notify, usr, nullptr, nullptr, sid, is_bin };
+  msg.detach( m.hd_, m.tl_ );
+  post( wq_, wpend_, m );
+  wsig_ = true;
+}
+
+void user_worker::flush()
+{
+  if ( wsig_ ) {
+    repost( wq_, wpend_ );
+    wsig_ = !wpend_.empty();
+    wk_.signal();
+  }
+}
+
+static void process_recv( user *usr, const char *buf, size_t len,
+                          bool is_bin )
+{
+  if ( is_bin ) {
+    usr->process_bin( buf, len );
+  } else {
+    usr->process_msg( buf, len );
+  }
+}
+
+void user_worker::poll_recv()
+{
+  user_msg m;
+  while( mq_.pop( m ) ) {
+    if ( m.type_ == user_msg::e_recv ) {
+      user *usr = m.usr_;
+      if ( m.hd_ == m.tl_ ) {
+        process_recv( usr, m.hd_->buf_, m.hd_->size_, m.bin_ );
+      } else {
+        std::string txt;
+        for( net_buf *ptr = m.hd_; ptr; ptr = ptr->next_ ) {
+          txt.append( ptr->buf_, ptr->size_ );
+        }
+        process_recv( usr, txt.c_str(), txt.size(), m.bin_ );
+      }
+      release( m );
+    } else if ( m.type_ == user_msg::e_close ) {
+      m.usr_->detach();
+    }
+  }
+}
+
+void user_worker::on_recv( user *usr, const char *buf, size_t sz,
+                           bool is_bin )
+{
+  net_wtr wtr;
+  wtr.add( str( buf, sz ) );
+  user_msg m = { user_msg::e_recv, usr, nullptr, nullptr, 0, is_bin };
+  wtr.detach( m.hd_, m.tl_ );
+  post( mq_, mpend_, m );
+  msig_ = true;
+}
+
+void user_worker::on_close( user *usr )
+{
+  user_msg m = { user_msg::e_close, usr, nullptr, nullptr, 0, false };
+  post( mq_, mpend_, m );
+  msig_ = true;
+}
+
+void user_worker::on_wakeup()
+{
+  user_msg m;
+  while( wq_.pop( m ) ) {
+    user *usr = m.usr_;
+    switch( m.type_ ) {
+      case user_msg::e_add: {
+        usr->set_net_loop( &nl_ );
+        if ( !usr->init() ) {
+          usr->teardown();
+        }
+        break;
+      }
+      case user_msg::e_send: {
+        if ( usr->get_fd() >= 0 && m.hd_ ) {
+          usr->queue_send( m.hd_, m.tl_, m.bin_ );
+        } else {
+          release( m );
+        }
+        break;
+      }
+      case user_msg::e_notify: {
+        if ( usr->get_fd() >= 0 && m.hd_ ) {
+          usr->queue_notify( m.sid_, m.hd_, m.tl_, m.bin_ );
+        } else {
+          release( m );
+        }
+        break;
+      }
+      case user_msg::e_del: {
+        release( m );
+        break;
+      }
+      default: break;
+    }
+  }
+}
+
+void user_worker::run()
+{
+  while( run_.load( std::memory_order_relaxed ) ) {
+    nl_.poll( -1 );
+    if ( msig_ ) {
+      repost( mq_, mpend_ );
+      msig_ = !mpend_.empty();
+      mwk_->signal();
+    }
+  }
 }
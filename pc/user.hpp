@@ -5,11 +5,46 @@
 #include <pc/request.hpp>
 #include <pc/key_store.hpp>
 #include <pc/dbl_list.hpp>
+#include <pc/spsc_queue.hpp>
+#include <pc/user_bin.hpp>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 
 namespace pc
 {
 
   class manager;
+  class user_worker;
+
+  // notify_price json payload of the latest aggregate of a price. it is
+  // serialized once per aggregate update and then copied for every
+  // subscriber with just the trailing subscription id spliced in
+  class price_notify
+  {
+  public:
+    price_notify();
+
+    // append notification for subscription to msg. payload is rebuilt
+    // only if price or its aggregate differ from the previous call
+    void add( net_wtr& msg, price *, uint64_t sid );
+
+    // number of payload serializations
+    uint64_t get_num_build() const;
+
+  private:
+    bool get_is_match( price * ) const;
+    void build( price * );
+
+    price        *ptr_;   // price of payload
+    int64_t       px_;    // aggregate price
+    uint64_t      conf_;  // aggregate confidence
+    uint64_t      vslot_; // valid slot
+    uint64_t      pslot_; // publish slot
+    symbol_status st_;    // aggregate status
+    std::string   pfx_;   // payload up to subscription id
+    uint64_t      nbld_;  // number of serializations
+  };
 
   // pyth daemon web-socket user connection
   class user : public prev_next<user>,
@@ -20,6 +55,9 @@ namespace pc
                public request_sub_i<price_sched>
   {
   public:
+    static const size_t default_send_hwm = 1UL<<20;
+    static const size_t default_send_max = 64UL<<20;
+
     user();
 
     // associated rpc connection
@@ -28,15 +66,61 @@ namespace pc
     // associated pyth server
     void set_manager( manager * );
 
+    // worker thread performing connection i/o (null if none)
+    void set_user_worker( user_worker * );
+    user_worker *get_user_worker() const;
+
+    // send queue limits in bytes. above hwm subscription notifications
+    // are conflated to the latest per subscription (or dropped if not
+    // conflating) until the queue drains. users whose queue exceeds max
+    // are disconnected as slow consumers
+    void set_send_limit( size_t hwm, size_t max );
+    size_t get_send_hwm() const;
+    size_t get_send_max() const;
+
+    // conflate rather than drop notifications above hwm (default on)
+    void set_conflate( bool );
+    bool get_conflate() const;
+
+    // number of notifications replaced by a newer one or dropped
+    uint64_t get_num_conflated() const;
+    uint64_t get_num_dropped() const;
+
+    // connection thread: queue response or subscription notification
+    // json (or binary protocol) payload. messages are framed (and
+    // compressed if negotiated) here so that compression context
+    // follows the order sent
+    void queue_send( net_buf *hd, net_buf *tl, bool is_bin = false );
+    void queue_notify( uint64_t sid, net_buf *hd, net_buf *tl,
+                       bool is_bin = false );
+
+    // flush conflated notifications once send queue has drained
+    void on_sent() override;
+
     // http request message parsing
     void parse_content( const char *, size_t );
 
     // websocket message parsing
     void parse_msg( const char *buf, size_t sz ) override;
 
+    // accept binary protocol (PC_BIN_PROTOCOL) if offered on upgrade
+    std::string negotiate_protocol( str offer ) override;
+
+    // was the binary protocol negotiated
+    bool get_is_bin_protocol() const;
+
+    // process json-rpc request message in manager thread
+    void process_msg( const char *buf, size_t sz );
+
+    // process binary protocol request message in manager thread
+    void process_bin( const char *buf, size_t sz );
+
     // manager disconnected
     void teardown() override;
 
+    // remove from manager and drop subscriptions in manager thread
+    void detach();
+
     // symbol update callback
     void on_response( price *, uint64_t ) override;
 
@@ -56,13 +140,36 @@ namespace pc
       uint64_t sid_;
     };
 
+    // notification held back while over send queue hwm
+    struct pend_msg {
+      net_buf *hd_;
+      net_buf *tl_;
+      bool     bin_;
+    };
+
     typedef std::vector<deferred_sub> def_vec_t;
+    typedef std::unordered_map<uint64_t,pend_msg> pend_map_t;
+    typedef std::vector<price*>   hdl_vec_t;
+    typedef std::unordered_map<price*,uint32_t> hdl_map_t;
+    typedef std::vector<uint32_t> sub_hdl_t;
 
     void parse_request( uint32_t );
     void parse_get_product_list( uint32_t );
     void parse_upd_price( uint32_t,  uint32_t );
     void parse_sub_price( uint32_t,  uint32_t );
     void parse_sub_price_sched( uint32_t,  uint32_t );
+    void parse_bin_get_handle( const char *, const bin_hdr& );
+    void parse_bin_upd_price( const char *, const bin_hdr& );
+    void parse_bin_sub( const char *, const bin_hdr& );
+    void add_bin_ack( const bin_hdr&, int err, uint32_t hdl=0, int64_t val=0 );
+    void add_bin_sub( uint64_t sid, uint32_t hdl );
+    price *get_bin_price( uint32_t hdl ) const;
+    void send( net_wtr&, bool is_bin = false );
+    void notify( uint64_t sid, net_wtr&, bool is_bin = false );
+    void add_deferred();
+    void add_ws_send( net_buf *hd, net_buf *tl, bool is_bin );
+    void flush_pend();
+    void drop_slow();
     void add_header();
     void add_tail( uint32_t id );
     void add_parse_error();
@@ -73,11 +180,108 @@ namespace pc
 
     rpc_client     *rptr_;    // rpc manager api
     manager        *sptr_;    // manager collection
+    user_worker    *wptr_;    // connection worker thread
     user_http       hsvr_;    // http parser
     jtree           jp_;      // json parser
     json_wtr        jw_;      // json writer
+    net_wtr         bw_;      // binary protocol writer
     def_vec_t       dvec_;    // deferred subscriptions
     request_sub_set psub_;    // price subscriptions
+    pend_map_t      pend_;    // conflated notifications by subscription
+    hdl_vec_t       hvec_;    // binary protocol price by handle - 1
+    hdl_map_t       hmap_;    // binary protocol handle by price
+    sub_hdl_t       shdl_;    // binary protocol handle by subscription
+    size_t          hwm_;     // send queue high-water mark
+    size_t          max_;     // send queue limit
+    uint64_t        nconf_;   // number of conflated notifications
+    uint64_t        ndrop_;   // number of dropped messages
+    bool            conf_;    // conflate notifications above hwm
+    bool            bin_;     // binary protocol negotiated
+  };
+
+  // message between manager and user worker threads
+  struct user_msg
+  {
+    typedef enum { e_add, e_send, e_notify, e_del, e_recv, e_close } type_t;
+
+    type_t   type_; // message type
+    user    *usr_;  // user connection
+    net_buf *hd_;   // message buffers (e_send, e_notify, e_recv)
+    net_buf *tl_;   // last message buffer
+    uint64_t sid_;  // subscription id (e_notify)
+    bool     bin_;  // binary protocol message (e_send, e_notify, e_recv)
+  };
+
+  // worker thread running the connection i/o of a subset of users in
+  // its own net_loop. websocket requests are passed to the manager
+  // thread for processing and responses and notifications passed back
+  // over a pair of lock-free queues, so that the manager never blocks
+  // on or performs user i/o
+  class user_worker : public error,
+                      public net_wakeup_sub
+  {
+  public:
+    user_worker();
+    ~user_worker();
+
+    // use io_uring based event loop
+    void set_use_uring( bool );
+
+    // start worker thread. mgr is woken up when messages are queued
+    bool init( net_wakeup *mgr );
+
+    // stop worker thread and release any queued messages
+    void teardown();
+
+    // is worker thread running
+    bool get_is_run() const;
+
+    // number of users assigned to worker
+    unsigned get_num_user() const;
+
+    // manager thread: hand over new user, delete closed user, send
+    // message to user and wake up worker if anything was queued
+    void add_user( user * );
+    void del_user( user * );
+    void send( user *, net_wtr&, bool is_bin );
+    void notify( user *, uint64_t sid, net_wtr&, bool is_bin );
+    void flush();
+
+    // manager thread: process requests and closed users
+    void poll_recv();
+
+    // worker thread: user request received or user closed
+    void on_recv( user *, const char *buf, size_t sz, bool is_bin );
+    void on_close( user * );
+
+    // worker thread: process messages from manager
+    void on_wakeup() override;
+
+  private:
+
+    typedef spsc_queue<user_msg>  msg_queue_t;
+    typedef std::vector<user_msg> msg_vec_t;
+    typedef std::atomic<bool>     atomic_t;
+
+    static const unsigned queue_len = 1U<<16;
+
+    void run();
+    void post( msg_queue_t&, msg_vec_t&, const user_msg& );
+    void repost( msg_queue_t&, msg_vec_t& );
+    void release( user_msg& );
+
+    net_loop     nl_;    // worker event loop
+    net_wakeup   wk_;    // worker wakeup
+    net_wakeup  *mwk_;   // manager wakeup
+    msg_queue_t  wq_;    // manager to worker messages
+    msg_queue_t  mq_;    // worker to manager messages
+    msg_vec_t    wpend_; // overflow of wq_
+    msg_vec_t    mpend_; // overflow of mq_
+    unsigned     nusr_;  // number of users
+    bool         wsig_;  // manager queued messages since flush
+    bool         msig_;  // worker queued messages since flush
+    atomic_t     run_;   // run flag
+    std::thread  thrd_;  // worker thread
   };
 
 }
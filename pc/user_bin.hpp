@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+// websocket sub-protocol name of the pythd binary protocol
+#define PC_BIN_PROTOCOL "pyth-bin-v1"
+
+namespace pc
+{
+
+  // pythd binary websocket protocol. negotiated via Sec-WebSocket-Protocol
+  // on upgrade after which binary frames carry one or more fixed-layout
+  // little-endian messages each (text frames remain json-rpc). price
+  // accounts are referred to by per-connection numeric handles obtained
+  // with e_get_handle
+  struct bin_msg
+  {
+    typedef enum {
+      e_get_handle = 1,           // bin_get_handle -> bin_ack
+      e_update_price,             // bin_update_price -> bin_ack
+      e_subscribe_price,          // bin_subscribe -> bin_ack
+      e_subscribe_price_sched,    // bin_subscribe -> bin_ack
+      e_ack = 128,                // response to request
+      e_notify_price,             // bin_notify_price
+      e_notify_price_sched        // bin_notify_price_sched
+    } type_t;
+  };
+
+  // header common to all messages
+  struct bin_hdr
+  {
+    uint16_t type_;     // bin_msg::type_t
+    uint16_t size_;     // message size including header
+    uint32_t id_;       // request id echoed in ack (0 in notifications)
+  };
+
+  // request handle for price account
+  struct bin_get_handle
+  {
+    bin_hdr  hdr_;
+    uint8_t  acc_[32];  // price account public key
+  };
+
+  // publish new component price
+  struct bin_update_price
+  {
+    bin_hdr  hdr_;
+    uint32_t handle_;   // price account handle
+    uint32_t status_;   // symbol_status
+    int64_t  price_;    // price in units of price exponent
+    uint64_t conf_;     // confidence interval
+  };
+
+  // subscribe to price or price schedule updates
+  struct bin_subscribe
+  {
+    bin_hdr  hdr_;
+    uint32_t handle_;   // price account handle
+    uint32_t unused_;
+  };
+
+  // request result. err_ is zero on success or else one of the json-rpc
+  // error codes. val_ is the subscription id for subscriptions or the
+  // price exponent for e_get_handle
+  struct bin_ack
+  {
+    bin_hdr  hdr_;
+    int32_t  err_;      // error code
+    uint32_t handle_;   // price account handle (if known)
+    int64_t  val_;      // request specific result
+  };
+
+  // aggregate price update
+  struct bin_notify_price
+  {
+    bin_hdr  hdr_;
+    uint32_t handle_;     // price account handle
+    uint32_t status_;     // symbol_status
+    uint64_t sub_;        // subscription id
+    int64_t  price_;      // aggregate price
+    uint64_t conf_;       // aggregate confidence interval
+    uint64_t valid_slot_; // slot of aggregate price
+    uint64_t pub_slot_;   // slot to publish for
+  };
+
+  // time to publish next price
+  struct bin_notify_price_sched
+  {
+    bin_hdr  hdr_;
+    uint32_t handle_;   // price account handle
+    uint32_t unused_;
+    uint64_t sub_;      // subscription id
+  };
+
+}
@@ -0,0 +1,518 @@
+#include "web_cache.hpp"
+#include "mem_map.hpp"
+#include "log.hpp"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <zlib.h>
+#include <errno.h>
+#include <algorithm>
+#include <vector>
+
+#define PC_WEB_GZIP_MIN     256
+#define PC_WEB_WATCH_MASK   (IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|\
+  IN_MOVED_FROM|IN_MOVED_TO|IN_DELETE_SELF|IN_MOVE_SELF)
+
+using namespace pc;
+
+///////////////////////////////////////////////////////////////////////////
+// web_resp
+
+web_resp::web_resp()
+: map_( nullptr ),
+  len_( 0 ),
+  fd_( -1 )
+{
+}
+
+web_resp::~web_resp()
+{
+  if ( map_ ) {
+    ::munmap( (void*)map_, len_ );
+  }
+  if ( fd_ >= 0 ) {
+    ::close( fd_ );
+  }
+}
+
+void web_resp::init( net_wtr& msg, size_t file_min )
+{
+  net_buf *hd, *tl;
+  buf_.reserve( msg.size() );
+  msg.detach( hd, tl );
+  while( hd ) {
+    net_buf *nxt = hd->next_;
+    buf_.append( hd->buf_, hd->size_ );
+    hd->dealloc();
+    hd = nxt;
+  }
+  if ( !file_min || buf_.size() < file_min ) {
+    return;
+  }
+
+  // seal response in memory file so that sendfile reads it straight
+  // out of the page cache and nothing can change it underneath us
+  int fd = ::memfd_create( "pythd_web", MFD_CLOEXEC|MFD_ALLOW_SEALING );
+  if ( fd < 0 ) {
+    return;
+  }
+  size_t len = buf_.size();
+  for( size_t i = 0; i != len; ) {
+    ssize_t rc = ::write( fd, &buf_[i], len - i );
+    if ( rc <= 0 ) {
+      ::close( fd );
+      return;
+    }
+    i += rc;
+  }
+  ::fcntl( fd, F_ADD_SEALS,
+      F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_WRITE|F_SEAL_SEAL );
+  void *buf = ::mmap( NULL, len, PROT_READ, MAP_SHARED, fd, 0 );
+  if ( buf == MAP_FAILED ) {
+    ::close( fd );
+    return;
+  }
+  map_ = (const char*)buf;
+  len_ = len;
+  fd_  = fd;
+  std::string().swap( buf_ );
+}
+
+///////////////////////////////////////////////////////////////////////////
+// web_content
+
+web_content::web_content()
+: nbyte_( 0 )
+{
+  http_response msg;
+  msg.init( "404", "Not Found" );
+  msg.commit();
+  nf_.init( msg, 0 );
+}
+
+web_content::~web_content()
+{
+  for( file_map_t::value_type& v: fmap_ ) {
+    delete v.second;
+  }
+}
+
+static bool has_token( str val, str tok )
+{
+  for( size_t i = 0; i + tok.len_ <= val.len_; ++i ) {
+    if ( 0 == __builtin_memcmp( &val.str_[i], tok.str_, tok.len_ ) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const web_resp *web_content::get( str path, str enc, str etag ) const
+{
+  // ignore query string and map directories to their index page
+  size_t len = 0;
+  while( len != path.len_ && path.str_[len] != '?' ) {
+    ++len;
+  }
+  std::string key( path.str_, len );
+  if ( key.empty() || key.back() == '/' ) {
+    key += "index.html";
+  }
+  const web_file *fptr = get_file( key );
+  if ( !fptr ) {
+    return &nf_;
+  }
+  if ( etag.len_ && ( has_token( etag, fptr->etag_ ) || etag == "*" ) ) {
+    return &fptr->nm_;
+  }
+  if ( fptr->gz_.size() && has_token( enc, "gzip" ) ) {
+    return &fptr->gz_;
+  }
+  return &fptr->raw_;
+}
+
+const web_file *web_content::get_file( const std::string& path ) const
+{
+  file_map_t::const_iterator i = fmap_.find( path );
+  return i != fmap_.end() ? i->second : nullptr;
+}
+
+unsigned web_content::get_num_file() const
+{
+  return fmap_.size();
+}
+
+size_t web_content::get_num_bytes() const
+{
+  return nbyte_;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// web_cache
+
+web_cache::web_cache()
+: cptr_( std::make_shared<web_content>() ),
+  fmin_( default_file_min ),
+  dbnc_( default_debounce ),
+  cts_( 0 ),
+  nrld_( 0 ),
+  rld_( false ),
+  run_( false )
+{
+}
+
+web_cache::~web_cache()
+{
+  teardown();
+}
+
+void web_cache::set_dir( const std::string& dir )
+{
+  dir_ = dir;
+}
+
+std::string web_cache::get_dir() const
+{
+  return dir_;
+}
+
+void web_cache::set_file_min( size_t file_min )
+{
+  fmin_ = file_min;
+}
+
+size_t web_cache::get_file_min() const
+{
+  return fmin_;
+}
+
+void web_cache::set_debounce( int64_t dbnc )
+{
+  dbnc_ = dbnc;
+}
+
+int64_t web_cache::get_debounce() const
+{
+  return dbnc_;
+}
+
+uint64_t web_cache::get_num_reload() const
+{
+  return nrld_;
+}
+
+web_content_ptr web_cache::get_content() const
+{
+  return std::atomic_load( &cptr_ );
+}
+
+bool web_cache::init()
+{
+  teardown();
+  reset_err();
+  if ( dir_.empty() ) {
+    // nothing to serve (every request is not found)
+    return true;
+  }
+  int fd = ::inotify_init1( IN_NONBLOCK|IN_CLOEXEC );
+  if ( fd < 0 ) {
+    return set_err_msg( "failed to create inotify", errno );
+  }
+  set_fd( fd );
+
+  // first load is synchronous so that content is served from the start
+  if ( !reload() || !net_socket::init() ) {
+    return false;
+  }
+  run_ = true;
+  thrd_ = std::thread( &web_cache::run, this );
+  return true;
+}
+
+void web_cache::teardown()
+{
+  net_loop *lp = get_net_loop();
+  if ( lp && get_is_active() ) {
+    lp->del_timer( this );
+  }
+  if ( thrd_.joinable() ) {
+    {
+      std::lock_guard<std::mutex> lck( mtx_ );
+      run_ = false;
+    }
+    cv_.notify_one();
+    thrd_.join();
+  }
+  close();
+  wmap_.clear();
+  wdel_.clear();
+  rld_ = false;
+  cts_ = 0;
+}
+
+void web_cache::poll()
+{
+  // drain change events noting watches removed with their directory
+  alignas( inotify_event ) char buf[4096];
+  bool is_chg = false;
+  for(;;) {
+    ssize_t rc = ::read( get_fd(), buf, sizeof( buf ) );
+    if ( rc <= 0 ) {
+      break;
+    }
+    is_chg = true;
+    for( ssize_t i = 0; i < rc; ) {
+      const inotify_event *ev = (const inotify_event*)&buf[i];
+      if ( ev->mask & IN_IGNORED ) {
+        std::lock_guard<std::mutex> lck( mtx_ );
+        wdel_.push_back( ev->wd );
+      }
+      i += sizeof( inotify_event ) + ev->len;
+    }
+  }
+  if ( !is_chg ) {
+    return;
+  }
+
+  // reload once the tree has been quiet for a debounce period but do
+  // not let a steady stream of changes hold off a reload indefinitely
+  net_loop *lp = get_net_loop();
+  if ( !lp ) {
+    on_timer();
+    return;
+  }
+  int64_t now = get_now();
+  if ( !cts_ ) {
+    cts_ = now;
+  }
+  lp->add_timer( this, std::min( now + dbnc_, cts_ + 10*dbnc_ ) );
+}
+
+void web_cache::on_timer()
+{
+  cts_ = 0;
+  {
+    std::lock_guard<std::mutex> lck( mtx_ );
+    rld_ = true;
+  }
+  cv_.notify_one();
+}
+
+void web_cache::run()
+{
+  std::unique_lock<std::mutex> lck( mtx_ );
+  while( run_ ) {
+    if ( !rld_ ) {
+      cv_.wait( lck );
+      continue;
+    }
+    rld_ = false;
+    lck.unlock();
+    if ( !reload() ) {
+      PC_LOG_WRN( "failed to reload content" )
+        .add( "content_dir", get_dir() )
+        .add( "error", get_err_msg() )
+        .end();
+    }
+    lck.lock();
+  }
+}
+
+bool web_cache::reload()
+{
+  // forget watches removed by the kernel so that their directories are
+  // watched again if they reappear
+  wd_vec_t wdel;
+  {
+    std::lock_guard<std::mutex> lck( mtx_ );
+    wdel.swap( wdel_ );
+  }
+  for( int wd: wdel ) {
+    for( watch_map_t::iterator it = wmap_.begin(); it != wmap_.end(); ) {
+      if ( it->second == wd ) {
+        it = wmap_.erase( it );
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // watches of directories no longer in the tree are removed
+  watch_map_t wmap;
+  std::shared_ptr<web_content> cptr = std::make_shared<web_content>();
+  if ( !load( "/", cptr.get(), wmap ) ) {
+    wmap_.insert( wmap.begin(), wmap.end() );
+    return false;
+  }
+  for( watch_map_t::value_type& v: wmap_ ) {
+    ::inotify_rm_watch( get_fd(), v.second );
+  }
+  wmap_.swap( wmap );
+  std::atomic_store( &cptr_, web_content_ptr( cptr ) );
+  uint64_t nrld = ++nrld_;
+  PC_LOG_INF( "content_loaded" )
+    .add( "content_dir", get_dir() )
+    .add( "num_file", cptr->get_num_file() )
+    .add( "num_bytes", cptr->get_num_bytes() )
+    .add( "num_reload", nrld )
+    .end();
+  return true;
+}
+
+bool web_cache::load( const std::string& path, web_content *cptr,
+                      watch_map_t& wmap )
+{
+  // watch new directories before reading them so no change is missed
+  std::string dir = dir_ + path;
+  watch_map_t::iterator it = wmap_.find( dir );
+  if ( it != wmap_.end() ) {
+    wmap[dir] = it->second;
+    wmap_.erase( it );
+  } else if ( get_fd() >= 0 ) {
+    int wd = ::inotify_add_watch( get_fd(), dir.c_str(), PC_WEB_WATCH_MASK );
+    if ( wd >= 0 ) {
+      wmap[dir] = wd;
+    }
+  }
+  DIR *dp = ::opendir( dir.c_str() );
+  if ( !dp ) {
+    return set_err_msg( "failed to open content directory " + dir, errno );
+  }
+  std::vector<std::string> sub;
+  for( dirent *ep = ::readdir( dp ); ep; ep = ::readdir( dp ) ) {
+    if ( ep->d_name[0] == '.' ) {
+      continue;
+    }
+    std::string name = ep->d_name;
+    struct stat fst[1];
+    if ( 0 != ::stat( ( dir + name ).c_str(), fst ) ) {
+      continue;
+    }
+    if ( S_ISDIR( fst->st_mode ) ) {
+      sub.push_back( path + name + "/" );
+    } else if ( S_ISREG( fst->st_mode ) ) {
+      mem_map mf;
+      mf.set_file( dir + name );
+      if ( mf.init() ) {
+        add_file( path + name, mf.data(), mf.size(), cptr );
+      } else if ( fst->st_size == 0 ) {
+        add_file( path + name, "", 0, cptr );
+      }
+    }
+  }
+  ::closedir( dp );
+  for( const std::string& spath: sub ) {
+    if ( !load( spath, cptr, wmap ) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static str get_content_type( const std::string& filen, bool& is_txt )
+{
+  is_txt = true;
+  size_t i = filen.find_last_of( '.' );
+  if ( i != std::string::npos ) {
+    std::string ext = filen.substr( i );
+    if ( ext == ".html" ) {
+      return "text/html";
+    } else if ( ext == ".css" ) {
+      return "text/css";
+    } else if ( ext == ".js" ) {
+      return "application/javascript";
+    } else if ( ext == ".json" ) {
+      return "application/json";
+    } else if ( ext == ".svg" ) {
+      return "image/svg+xml";
+    } else if ( ext == ".txt" ) {
+      return "text/plain";
+    }
+    is_txt = false;
+    if ( ext == ".png" ) {
+      return "image/png";
+    } else if ( ext == ".ico" ) {
+      return "image/x-icon";
+    } else if ( ext == ".woff2" ) {
+      return "font/woff2";
+    }
+    return "application/octet-stream";
+  }
+  return "text/html";
+}
+
+static bool gzip( const char *buf, size_t len, std::string& out )
+{
+  z_stream zs;
+  __builtin_memset( &zs, 0, sizeof( zs ) );
+  if ( Z_OK != deflateInit2( &zs, Z_BEST_COMPRESSION, Z_DEFLATED,
+                             15+16, 9, Z_DEFAULT_STRATEGY ) ) {
+    return false;
+  }
+  out.resize( deflateBound( &zs, len ) );
+  zs.next_in   = (Bytef*)buf;
+  zs.avail_in  = len;
+  zs.next_out  = (Bytef*)&out[0];
+  zs.avail_out = out.size();
+  int rc = deflate( &zs, Z_FINISH );
+  out.resize( zs.total_out );
+  deflateEnd( &zs );
+  return rc == Z_STREAM_END;
+}
+
+void web_cache::add_file( const std::string& path, const char *buf,
+                          size_t len, web_content *cptr )
+{
+  web_file *fptr = new web_file;
+  cptr->fmap_[path] = fptr;
+  cptr->nbyte_ += len;
+
+  // entity tag is the fnv-1a hash of the contents
+  uint64_t hash = 0xcbf29ce484222325UL;
+  for( size_t i = 0; i != len; ++i ) {
+    hash = ( hash ^ (uint8_t)buf[i] ) * 0x100000001b3UL;
+  }
+  static const char hex[] = "0123456789abcdef";
+  fptr->etag_ = "\"";
+  for( int i = 60; i >= 0; i -= 4 ) {
+    fptr->etag_ += hex[( hash >> i ) & 0xf];
+  }
+  fptr->etag_ += '"';
+
+  // compress text content if it is worth it
+  bool is_txt;
+  str ctype = get_content_type( path, is_txt );
+  std::string zbuf;
+  bool has_gz = is_txt && len >= PC_WEB_GZIP_MIN &&
+    gzip( buf, len, zbuf ) && zbuf.size() < len;
+
+  for( unsigned i = 0; i != ( has_gz ? 2 : 1 ); ++i ) {
+    http_response msg;
+    msg.init( "200", "OK" );
+    msg.add_hdr( "Content-Type", ctype );
+    msg.add_hdr( "ETag", fptr->etag_ );
+    msg.add_hdr( "Cache-Control", "no-cache" );
+    if ( has_gz ) {
+      msg.add_hdr( "Vary", "Accept-Encoding" );
+    }
+    net_wtr body;
+    if ( i ) {
+      msg.add_hdr( "Content-Encoding", "gzip" );
+      body.add( zbuf );
+    } else {
+      body.add( str( buf, len ) );
+    }
+    msg.commit( body );
+    ( i ? fptr->gz_ : fptr->raw_ ).init( msg, fmin_ );
+  }
+  http_response msg;
+  msg.init( "304", "Not Modified" );
+  msg.add_hdr( "ETag", fptr->etag_ );
+  msg.add_hdr( "Cache-Control", "no-cache" );
+  msg.add( "\r\n" );
+  fptr->nm_.init( msg, 0 );
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <pc/net_socket.hpp>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace pc
+{
+
+  // pre-built http response. large responses are kept in a sealed memory
+  // file so that they can be sent with sendfile as well as copied from
+  // its read-only mapping
+  class web_resp
+  {
+  public:
+    web_resp();
+    ~web_resp();
+
+    // take ownership of message. moved to a memory file if at least
+    // file_min bytes long (zero keeps every response in memory)
+    void init( net_wtr& msg, size_t file_min );
+
+    // response bytes
+    const char *data() const;
+    size_t size() const;
+
+    // memory file holding response or -1 if only held in memory
+    int get_fd() const;
+
+  private:
+    web_resp( const web_resp& );
+    web_resp& operator=( const web_resp& );
+
+    std::string  buf_;  // response if held in memory
+    const char  *map_;  // mapping of memory file
+    size_t       len_;  // length of mapping
+    int          fd_;   // memory file
+  };
+
+  // cached content file with its response variants
+  class web_file
+  {
+  public:
+    std::string etag_;  // entity tag of file contents
+    web_resp    raw_;   // 200 response with identity encoding
+    web_resp    gz_;    // 200 response with gzip encoding (may be empty)
+    web_resp    nm_;    // 304 response on matching If-None-Match
+  };
+
+  // immutable snapshot of a content directory
+  class web_content
+  {
+  public:
+    web_content();
+    ~web_content();
+
+    // response for request path given the Accept-Encoding and
+    // If-None-Match header values of the request
+    const web_resp *get( str path, str enc, str etag ) const;
+
+    // cached file for path relative to content directory (or null)
+    const web_file *get_file( const std::string& path ) const;
+
+    // number of cached files and their content size in bytes
+    unsigned get_num_file() const;
+    size_t get_num_bytes() const;
+
+  private:
+    friend class web_cache;
+
+    typedef std::unordered_map<std::string,web_file*> file_map_t;
+
+    web_content( const web_content& );
+    web_content& operator=( const web_content& );
+
+    file_map_t fmap_;  // files by request path
+    web_resp   nf_;    // 404 response
+    size_t     nbyte_; // bytes of file content
+  };
+
+  typedef std::shared_ptr<const web_content> web_content_ptr;
+
+  // http content directory served as an in-memory cache of fully formed
+  // responses. the directory tree is watched with inotify and bursts of
+  // changes are debounced on the loop timer wheel. new snapshots are
+  // built on a background thread and published atomically so that the
+  // loop never stalls on a rebuild. snapshots may be read from any thread
+  class web_cache : public net_socket, public net_timer
+  {
+  public:
+    static const size_t  default_file_min = 256*1024;
+    static const int64_t default_debounce = 100*PC_NSECS_IN_MSEC;
+
+    web_cache();
+    ~web_cache();
+
+    // content directory (none served if empty)
+    void set_dir( const std::string& );
+    std::string get_dir() const;
+
+    // responses of at least this many bytes are sent with sendfile
+    void set_file_min( size_t );
+    size_t get_file_min() const;
+
+    // quiet period in nanoseconds after a change before reloading. a
+    // steady stream of changes still reloads every ten periods
+    void set_debounce( int64_t );
+    int64_t get_debounce() const;
+
+    // start watching and load content directory
+    bool init() override;
+
+    // rebuild and publish content snapshot
+    bool reload();
+
+    // consume directory change events and schedule reload
+    void poll() override;
+
+    // stop reload thread and watching
+    void teardown() override;
+
+    // debounce period expired: hand reload to background thread
+    void on_timer() override;
+
+    // current content snapshot (never null)
+    web_content_ptr get_content() const;
+
+    // number of completed reloads
+    uint64_t get_num_reload() const;
+
+  private:
+    typedef std::unordered_map<std::string,int> watch_map_t;
+    typedef std::vector<int>                    wd_vec_t;
+
+    void run();
+    bool load( const std::string& path, web_content *, watch_map_t& );
+    void add_file( const std::string& path, const char *buf, size_t len,
+                   web_content * );
+
+    std::string     dir_;   // content directory
+    web_content_ptr cptr_;  // published snapshot
+    size_t          fmin_;  // min. response size for sendfile
+    int64_t         dbnc_;  // debounce period
+    int64_t         cts_;   // time of first unhandled change (0 = none)
+    std::atomic<uint64_t> nrld_; // number of reloads
+    watch_map_t     wmap_;  // watch descriptor by directory (reload only)
+    wd_vec_t        wdel_;  // removed watches (guarded by mtx_)
+    bool            rld_;   // reload requested (guarded by mtx_)
+    bool            run_;   // thread running (guarded by mtx_)
+    std::mutex      mtx_;
+    std::condition_variable cv_;
+    std::thread     thrd_;
+  };
+
+  inline const char *web_resp::data() const
+  {
+    return map_ ? map_ : buf_.c_str();
+  }
+
+  inline size_t web_resp::size() const
+  {
+    return map_ ? len_ : buf_.size();
+  }
+
+  inline int web_resp::get_fd() const
+  {
+    return fd_;
+  }
+
+}
@@ -35,9 +35,19 @@ int usage()
   std::cerr << "  -l <log_file>" << std::endl;
   std::cerr << "     Optional log file - uses stderr if not provided\n"
             << std::endl;
+  std::cerr << "  -P <role>:<options>" << std::endl;
+  std::cerr << "     Socket options for connections of given role. role is "
+               "one of rpc_http,\n     rpc_ws, user or udp (user defaults to nodelay). options are\n"
+               "     comma separated from nodelay, quickack, sndbuf=<bytes>, "
+               "rcvbuf=<bytes>,\n"
+               "     busy_poll=<usecs>, prio=<0-6> or default. May be "
+               "repeated for each role\n" << std::endl;
   std::cerr << "  -n" << std::endl;
   std::cerr << "     No wait mode - i.e. run using busy poll loop\n"
             << std::endl;
+  std::cerr << "  -U" << std::endl;
+  std::cerr << "     Use io_uring based event loop instead of epoll (falls "
+               "back to epoll if unsupported)\n" << std::endl;
   std::cerr << "  -d" << std::endl;
   std::cerr << "     Turn on debug logging. Can also toggle this on/off via "
                "kill -s SIGUSR1 <pid>\n" << std::endl;
@@ -66,15 +76,28 @@ int main(int argc, char **argv)
   // command-line parsing
   std::string log_file;
   std::string rpc_host = get_rpc_host();
+  net_profile nprof[net_profile::e_num_role];
+  bool has_prof[net_profile::e_num_role] = {};
   int opt = 0, pyth_port = get_port();
-  bool do_wait = true, do_debug = false;
-  while( (opt = ::getopt(argc,argv, "r:p:l:dnh" )) != -1 ) {
+  bool do_wait = true, do_debug = false, do_uring = false;
+  while( (opt = ::getopt(argc,argv, "r:p:l:P:dnUh" )) != -1 ) {
     switch(opt) {
       case 'r': rpc_host = optarg; break;
       case 'p': pyth_port = ::atoi(optarg); break;
       case 'd': do_debug = true; break;
       case 'l': log_file = optarg; break;
       case 'n': do_wait = false; break;
+      case 'U': do_uring = true; break;
+      case 'P': {
+        net_profile::role_t role;
+        net_profile prof;
+        if ( !net_profile::parse_role( optarg, role, prof ) ) {
+          return usage();
+        }
+        nprof[role] = prof;
+        has_prof[role] = true;
+        break;
+      }
       default: return usage();
     }
   }
@@ -92,6 +115,12 @@ int main(int argc, char **argv)
   tx_svr mgr;
   mgr.set_rpc_host( rpc_host );
   mgr.set_listen_port( pyth_port );
+  mgr.set_use_uring( do_uring );
+  for( unsigned i=0; i != net_profile::e_num_role; ++i ) {
+    if ( has_prof[i] ) {
+      mgr.set_net_profile( (net_profile::role_t)i, nprof[i] );
+    }
+  }
   if ( !mgr.init() ) {
     std::cerr << "pyth_tx: " << mgr.get_err_msg() << std::endl;
     return 1;
@@ -32,25 +32,76 @@ int usage()
             << std::endl;
   std::cerr << "     Host name or IP address of solana rpc node in the form "
                "host_name[:rpc_port[:ws_port]]\n" << std::endl;
+  std::cerr << "  -R <hedge_rpc_host>" << std::endl;
+  std::cerr << "     Additional solana rpc node also subscribed to price "
+               "accounts over websocket.\n     Each price update is taken "
+               "from whichever node delivers it first.\n     May be repeated"
+               " (max " << PC_RPC_MAX_HEDGE << ")\n" << std::endl;
+  std::cerr << "  -g" << std::endl;
+  std::cerr << "     Bootstrap mapping, product and price accounts from one "
+               "getProgramAccounts\n     request per account type rather "
+               "than walking the mapping chain\n" << std::endl;
   std::cerr << "  -t <tx proxy host (default " << get_rpc_host() << ")>"
             << std::endl;
   std::cerr << "     Host name or IP address of running pyth_tx server\n"
             << std::endl;
+  std::cerr << "  -H <num_http_conn (default 1)>" << std::endl;
+  std::cerr << "     Number of keep-alive http connections to the rpc node "
+               "(max " << PC_RPC_HTTP_MAX_CONN << ")\n" << std::endl;
   std::cerr << "  -k <key_store_directory (default " << get_key_store()
             << ")>]" << std::endl;
   std::cerr << "     Directory name housing publishing, mapping and program"
                " key files\n" << std::endl;
   std::cerr << "  -p <listening_port (default " << get_port() << ">"
             << std::endl;
-  std::cerr << "     Websocket port number for clients to connect to\n"
-            << std::endl;
+  std::cerr << "     Websocket port number for clients to connect to "
+               "(0 to disable)\n" << std::endl;
+  std::cerr << "  -s <unix socket path>" << std::endl;
+  std::cerr << "     Optional unix domain socket for local clients to "
+               "connect to. A leading\n     '@' selects the abstract "
+               "namespace\n" << std::endl;
   std::cerr << "  -w <web content directory>" << std::endl;
   std::cerr << "     Directory containing dashboard/ content\n" << std::endl;
   std::cerr << "  -c <capture file>" << std::endl;
   std::cerr << "     Optional capture will get compressed\n" << std::endl;
+  std::cerr << "  -m <price table file>" << std::endl;
+  std::cerr << "     Optional memory-mapped table of the latest aggregate and "
+               "component prices\n     for local readers (see "
+               "pc/price_table.hpp)\n" << std::endl;
   std::cerr << "  -l <log_file>" << std::endl;
   std::cerr << "     Optional log file - uses stderr if not provided\n"
             << std::endl;
+  std::cerr << "  -z <zero_copy_bytes>" << std::endl;
+  std::cerr << "     Send client messages of at least this size using "
+               "MSG_ZEROCOPY (default off)\n" << std::endl;
+  std::cerr << "  -P <role>:<options>" << std::endl;
+  std::cerr << "     Socket options for connections of given role. role is "
+               "one of rpc_http,\n     rpc_ws, tx or user (tx and user default to nodelay). options are\n"
+               "     comma separated from nodelay, quickack, sndbuf=<bytes>, "
+               "rcvbuf=<bytes>,\n"
+               "     busy_poll=<usecs>, prio=<0-6> or default. May be "
+               "repeated for each role\n" << std::endl;
+  std::cerr << "  -Q <user_send_hwm_bytes>" << std::endl;
+  std::cerr << "     Hold back price notifications to a client once this "
+               "many bytes are queued\n     to it (default 1MB). Slow "
+               "clients are disconnected at 64x this amount\n" << std::endl;
+  std::cerr << "  -D" << std::endl;
+  std::cerr << "     Drop held back price notifications instead of "
+               "conflating to the latest\n     update per subscription\n"
+            << std::endl;
+  std::cerr << "  -Z <compression_level>" << std::endl;
+  std::cerr << "     Accept permessage-deflate websocket compression offered "
+               "by clients using\n     this zlib level 0-9 (default off)\n"
+            << std::endl;
+  std::cerr << "  -u" << std::endl;
+  std::cerr << "     Allocate network buffers using huge pages\n"
+            << std::endl;
+  std::cerr << "  -W <num_worker_threads>" << std::endl;
+  std::cerr << "     Run user connections on this many worker threads "
+               "(default 0 - i.e. on the main thread)\n" << std::endl;
+  std::cerr << "  -U" << std::endl;
+  std::cerr << "     Use io_uring based event loop instead of epoll (falls "
+               "back to epoll if unsupported)\n" << std::endl;
   std::cerr << "  -n" << std::endl;
   std::cerr << "     No wait mode - i.e. run using busy poll loop\n"
             << std::endl;
@@ -83,28 +134,62 @@ void sig_toggle( int )
 int main(int argc, char **argv)
 {
   // command-line parsing
-  std::string cnt_dir, cap_file, log_file;
+  std::string cnt_dir, cap_file, ptab_file, sock_path, log_file;
+  std::vector<std::string> hedge_host;
   std::string rpc_host = get_rpc_host();
   std::string key_dir  = get_key_store();
   std::string tx_host  = get_rpc_host();
   int pyth_port = get_port();
-  int opt = 0;
-  bool do_wait = true, do_tx = true, do_debug = false;
-  while( (opt = ::getopt(argc,argv, "r:t:p:k:w:c:l:dnxh" )) != -1 ) {
+  size_t zero_copy = 0;
+  size_t send_hwm = user::default_send_hwm;
+  net_profile nprof[net_profile::e_num_role];
+  bool has_prof[net_profile::e_num_role] = {};
+  int opt = 0, num_worker = 0, num_http = 1, zlvl = -1;
+  bool do_wait = true, do_tx = true, do_debug = false, do_huge = false;
+  bool do_uring = false, do_conflate = true, do_snap = false;
+  while( (opt = ::getopt(argc,argv, "r:R:t:p:s:k:w:c:m:l:z:W:H:P:Q:Z:DdgnuUxh" )) != -1 ) {
     switch(opt) {
       case 'r': rpc_host = optarg; break;
+      case 'R': hedge_host.push_back( optarg ); break;
       case 't': tx_host = optarg; break;
       case 'p': pyth_port = ::atoi(optarg); break;
+      case 's': sock_path = optarg; break;
       case 'k': key_dir = optarg; break;
       case 'c': cap_file = optarg; break;
+      case 'm': ptab_file = optarg; break;
       case 'w': cnt_dir = optarg; break;
       case 'l': log_file = optarg; break;
+      case 'z': zero_copy = ::atoi(optarg); break;
+      case 'W': num_worker = ::atoi(optarg); break;
+      case 'H': num_http = ::atoi(optarg); break;
+      case 'Q': send_hwm = ::atol(optarg); break;
+      case 'D': do_conflate = false; break;
+      case 'Z': zlvl = ::atoi(optarg); break;
       case 'n': do_wait = false; break;
+      case 'u': do_huge = true; break;
+      case 'U': do_uring = true; break;
       case 'x': do_tx = false; break;
       case 'd': do_debug = true; break;
+      case 'g': do_snap = true; break;
+      case 'P': {
+        net_profile::role_t role;
+        net_profile prof;
+        if ( !net_profile::parse_role( optarg, role, prof ) ) {
+          return usage();
+        }
+        nprof[role] = prof;
+        has_prof[role] = true;
+        break;
+      }
       default: return usage();
     }
   }
+  if ( hedge_host.size() > PC_RPC_MAX_HEDGE ) {
+    return usage();
+  }
+
+  // network buffers need to be configured before logging starts
+  net_buf::set_huge_pages( do_huge );
 
   // set up logging and disable SIGPIPE
   signal( SIGPIPE, SIG_IGN );
@@ -119,12 +204,30 @@ int main(int argc, char **argv)
   manager mgr;
   mgr.set_dir( key_dir );
   mgr.set_rpc_host( rpc_host );
+  for( const std::string& host: hedge_host ) {
+    mgr.add_rpc_hedge_host( host );
+  }
   mgr.set_tx_host( tx_host );
   mgr.set_listen_port( pyth_port );
+  mgr.set_listen_path( sock_path );
   mgr.set_content_dir( cnt_dir );
   mgr.set_capture_file( cap_file );
+  mgr.set_price_table_file( ptab_file );
   mgr.set_do_tx( do_tx );
+  mgr.set_do_snapshot( do_snap );
+  mgr.set_zero_copy( zero_copy );
+  mgr.set_use_uring( do_uring );
+  mgr.set_num_worker( num_worker );
+  mgr.set_num_http_conn( num_http );
+  mgr.set_user_send_limit( send_hwm, 64*send_hwm );
+  mgr.set_user_conflate( do_conflate );
+  mgr.set_user_deflate_level( zlvl );
   mgr.set_do_capture( !cap_file.empty() );
+  for( unsigned i=0; i != net_profile::e_num_role; ++i ) {
+    if ( has_prof[i] ) {
+      mgr.set_net_profile( (net_profile::role_t)i, nprof[i] );
+    }
+  }
   if ( !mgr.init() ) {
     std::cerr << "pythd: " << mgr.get_err_msg() << std::endl;
     return 1;
@@ -63,6 +63,7 @@ tx_svr::tx_svr()
   creq_->set_sub( this );
   lreq_->set_sub( this );
   lreq_->set_limit( PC_LEADER_MAX );
+  prof_[net_profile::e_user].nodelay_ = true;
 }
 
 tx_svr::~tx_svr()
@@ -92,12 +93,36 @@ int tx_svr::get_listen_port() const
   return tsvr_.get_port();
 }
 
+void tx_svr::set_use_uring( bool use_uring )
+{
+  nl_.set_use_uring( use_uring );
+}
+
+bool tx_svr::get_use_uring() const
+{
+  return nl_.get_use_uring();
+}
+
+void tx_svr::set_net_profile( net_profile::role_t role,
+                              const net_profile& prof )
+{
+  prof_[role] = prof;
+}
+
+const net_profile& tx_svr::get_net_profile( net_profile::role_t role ) const
+{
+  return prof_[role];
+}
+
 bool tx_svr::init()
 {
   // initialize net_loop
   if ( !nl_.init() ) {
     return set_err_msg( nl_.get_err_msg() );
   }
+  if ( nl_.get_use_uring() && !nl_.get_is_uring() ) {
+    PC_LOG_WRN( "io_uring unavailable - using epoll" ).end();
+  }
 
   // decompose rpc_host into host:port[:port2]
   int rport =0, wport = 0;
@@ -109,10 +134,12 @@ bool tx_svr::init()
   hconn_.set_port( rport );
   hconn_.set_host( rhost );
   hconn_.set_net_loop( &nl_ );
+  hconn_.set_net_profile( prof_[net_profile::e_rpc_http] );
   clnt_.set_http_conn( &hconn_ );
   wconn_.set_port( wport );
   wconn_.set_host( rhost );
   wconn_.set_net_loop( &nl_ );
+  wconn_.set_net_profile( prof_[net_profile::e_rpc_ws] );
   clnt_.set_ws_conn( &wconn_ );
   if ( !hconn_.init() ) {
     return set_err_msg( hconn_.get_err_msg() );
@@ -120,6 +147,7 @@ bool tx_svr::init()
   if ( !wconn_.init() ) {
     return set_err_msg( wconn_.get_err_msg() );
   }
+  tconn_.set_net_profile( prof_[net_profile::e_udp] );
   if ( !tconn_.init() ) {
     return set_err_msg( tconn_.get_err_msg() );
   }
@@ -128,7 +156,10 @@ bool tx_svr::init()
   if ( !tsvr_.init() ) {
     return set_err_msg( tsvr_.get_err_msg() );
   }
-  PC_LOG_INF("listening").add("port",tsvr_.get_port()).end();
+  PC_LOG_INF("listening").add("port",tsvr_.get_port())
+    .add( "user_profile", prof_[net_profile::e_user].to_str() )
+    .add( "udp_profile", tconn_.get_net_profile().to_str() )
+    .end();
   wait_conn_ = true;
   return true;
 }
@@ -137,8 +168,11 @@ void tx_svr::poll( bool do_wait )
 {
   // epoll loop
   if ( do_wait ) {
-    nl_.poll( 1 );
+    nl_.poll( -1 );
+  } else if ( nl_.get_is_uring() ) {
+    nl_.poll( 0 );
   } else {
+    nl_.poll_timer();
     if ( has_conn_ ) {
       hconn_.poll();
       wconn_.poll();
@@ -159,6 +193,28 @@ void tx_svr::poll( bool do_wait )
         hconn_.get_is_err() || wconn_.get_is_err() ) ) {
     reconnect_rpc();
   }
+
+  // wake up for next reconnect check
+  arm_timer();
+}
+
+void tx_svr::on_timer()
+{
+  // reconnect handled by poll once woken up
+}
+
+void tx_svr::arm_timer()
+{
+  // connection progress is delivered by loop events
+  if ( ( has_conn_ && !hconn_.get_is_err() && !wconn_.get_is_err() ) ||
+       hconn_.get_is_wait() || wconn_.get_is_wait() ) {
+    nl_.del_timer( this );
+    return;
+  }
+  int64_t ts = cts_ + ctimeout_;
+  if ( !get_is_active() || ts != get_expiry() ) {
+    nl_.add_timer( this, ts );
+  }
 }
 
 void tx_svr::del_user( tx_user *usr )
@@ -187,6 +243,8 @@ void tx_svr::accept( int fd )
   usr->set_tx_svr( this );
   usr->set_fd( fd );
   usr->set_block( false );
+  usr->set_net_profile( prof_[net_profile::e_user] );
+  usr->apply_net_profile();
   if ( usr->init() ) {
     PC_LOG_DBG( "new_user" ).add("fd", fd ).end();
     olist_.add( usr );
@@ -305,7 +363,10 @@ void tx_svr::reconnect_rpc()
 
   // check for successful (re)connect
   if ( !hconn_.get_is_err() && !wconn_.get_is_err() ) {
-    PC_LOG_INF( "rpc_connected" ).end();
+    PC_LOG_INF( "rpc_connected" )
+      .add( "http_profile", hconn_.get_net_profile().to_str() )
+      .add( "ws_profile", wconn_.get_net_profile().to_str() )
+      .end();
 
     // reset state
     has_conn_  = true;
@@ -27,6 +27,7 @@ namespace pc
   // tx_svr server run as a busy loop
   class tx_svr : public error,
                  public net_accept,
+                 public net_timer,
                  public rpc_sub,
                  public rpc_sub_i<rpc::get_health>,
                  public rpc_sub_i<rpc::slot_subscribe>,
@@ -46,6 +47,15 @@ namespace pc
     void set_listen_port( int port );
     int get_listen_port() const;
 
+    // use io_uring based event loop rather than epoll
+    void set_use_uring( bool );
+    bool get_use_uring() const;
+
+    // transport options by connection role (set before init). user
+    // connections default to nodelay
+    void set_net_profile( net_profile::role_t, const net_profile& );
+    const net_profile& get_net_profile( net_profile::role_t ) const;
+
     // initialize
     bool init();
 
@@ -58,6 +68,9 @@ namespace pc
     // net_accept callback
     void accept( int ) override;
 
+    // rpc reconnect timer
+    void on_timer() override;
+
     // move user to teardown list
     void del_user( tx_user *usr );
 
@@ -76,6 +89,7 @@ namespace pc
     typedef std::vector<ip_addr> addr_vec_t;
 
     void reconnect_rpc();
+    void arm_timer();
     void log_disconnect();
     void teardown_users();
     void add_addr( const ip_addr& );
@@ -100,6 +114,7 @@ namespace pc
     int64_t      cts_;         // (re)connect timestamp
     int64_t      ctimeout_;    // connection timeout
     std::string  rhost_;       // rpc host
+    net_profile  prof_[net_profile::e_num_role]; // transport options
 
     // rpc subscription info
     rpc::slot_subscribe    sreq_[1];
@@ -1,7 +1,25 @@
 #include "test_error.hpp"
 #include <pc/net_socket.hpp>
 #include <pc/net_socket.hpp>
+#include <pc/spsc_queue.hpp>
+#include <pc/user.hpp>
+#include <pc/manager.hpp>
+#include <pc/web_cache.hpp>
+#include <pc/replay.hpp>
 #include <pc/misc.hpp>
+#include <pc/jtree.hpp>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+#include <atomic>
 #include <iostream>
 
 using namespace pc;
@@ -58,6 +76,94 @@ void test_net_buf()
   }
 }
 
+void test_net_buf_alloc()
+{
+  {
+    // size classes
+    net_buf *ptr = net_buf::alloc();
+    PC_TEST_CHECK( ptr->cap_ == net_buf::len );
+    ptr->dealloc();
+    ptr = net_buf::alloc( 10000 );
+    PC_TEST_CHECK( ptr->cap_ >= 10000 );
+    PC_TEST_CHECK( ptr->cls_ == 2 );
+    ptr->dealloc();
+    ptr = net_buf::alloc( 1000000 );
+    PC_TEST_CHECK( ptr->cls_ == net_buf::num_class-1 );
+    ptr->dealloc();
+  }
+  {
+    // surplus free buffers give back all but their first page and are
+    // counted again once reused
+    unsigned cls = net_buf::num_class-1;
+    std::vector<net_buf*> bvec( 256 );
+    for( net_buf *&ptr: bvec ) {
+      ptr = net_buf::alloc( 1000000 );
+    }
+    net_buf_stats st0, st1, st2;
+    net_buf::get_stats( cls, st0 );
+    for( net_buf *ptr: bvec ) {
+      ptr->dealloc();
+    }
+    net_buf::get_stats( cls, st1 );
+    PC_TEST_CHECK( st1.sys_ < st0.sys_ );
+    for( net_buf *&ptr: bvec ) {
+      ptr = net_buf::alloc( 1000000 );
+    }
+    net_buf::get_stats( cls, st2 );
+    PC_TEST_CHECK( st2.sys_ == st0.sys_ );
+    for( net_buf *ptr: bvec ) {
+      ptr->dealloc();
+    }
+  }
+  {
+    // large messages use short chains
+    net_wtr msg;
+    std::string txt( 100000, 'x' );
+    msg.add( txt );
+    PC_TEST_CHECK( msg.size() == txt.size() );
+    net_buf *hd, *tl;
+    msg.detach( hd, tl );
+    unsigned num = 0;
+    size_t len = 0;
+    for( net_buf *ptr = hd; ptr; ) {
+      net_buf *nxt = ptr->next_;
+      ++num;
+      len += ptr->size_;
+      ptr->dealloc();
+      ptr = nxt;
+    }
+    PC_TEST_CHECK( len == txt.size() );
+    PC_TEST_CHECK( num <= 5 );
+  }
+  {
+    // buffers allocated in one thread and freed in another
+    net_buf_stats st0;
+    net_buf::get_stats( 0, st0 );
+    static const unsigned num_buf = 10000;
+    std::vector<net_buf*> bvec( num_buf, nullptr );
+    std::atomic<unsigned> idx( 0 );
+    std::thread thrd( [&]() {
+      for( unsigned i=0; i != num_buf; ++i ) {
+        net_buf *ptr = net_buf::alloc();
+        ptr->size_ = i % net_buf::len;
+        bvec[i] = ptr;
+        idx.store( i+1, std::memory_order_release );
+      }
+    } );
+    for( unsigned i=0; i != num_buf; ++i ) {
+      while( idx.load( std::memory_order_acquire ) <= i );
+      PC_TEST_CHECK( bvec[i]->size_ == i % net_buf::len );
+      bvec[i]->dealloc();
+    }
+    thrd.join();
+    net_buf_stats st1;
+    net_buf::get_stats( 0, st1 );
+    PC_TEST_CHECK( st1.live_ == st0.live_ );
+    PC_TEST_CHECK( st1.peak_ >= st0.peak_ );
+    PC_TEST_CHECK( st1.sys_ > 0 );
+  }
+}
+
 void test_json_wtr()
 {
   {
@@ -112,6 +218,176 @@ void test_json_wtr()
     PC_TEST_CHECK( 0==__builtin_strncmp( kptxt, hd->buf_, hd->size_ ));
     hd->dealloc();
   }
+  {
+    // size hint before writing keeps a long message in one buffer
+    json_wtr wtr;
+    wtr.prealloc( 8000 );
+    wtr.add_val( json_wtr::e_arr );
+    std::string exp = "[";
+    for( int64_t i=0; i != 400; ++i ) {
+      int64_t val = ( i & 1 ? -i : i ) * 1000003L;
+      wtr.add_val( val );
+      exp += ( i ? "," : "" ) + std::to_string( val );
+    }
+    wtr.pop();
+    exp += "]";
+    size_t wsize = wtr.size();
+    net_buf *hd, *tl;
+    wtr.detach(hd,tl);
+    PC_TEST_CHECK( hd == tl );
+    PC_TEST_CHECK( wsize == exp.size() && hd->size_ == exp.size() );
+    PC_TEST_CHECK( str( hd->buf_, hd->size_ ) == exp );
+    hd->dealloc();
+  }
+}
+
+// canonical text of parse tree below node
+static void test_jtree_dump( const jtree& jt, uint32_t i, std::string& out )
+{
+  switch( jt.get_type( i ) ) {
+    case jtree::e_obj:
+    case jtree::e_arr: {
+      out += jt.get_type( i ) == jtree::e_obj ? '{' : '[';
+      for( uint32_t it = jt.get_first( i ); it; it = jt.get_next( it ) ) {
+        test_jtree_dump( jt, it, out );
+        out += ';';
+      }
+      out += jt.get_type( i ) == jtree::e_obj ? '}' : ']';
+      break;
+    }
+    case jtree::e_keyval: {
+      test_jtree_dump( jt, jt.get_key( i ), out );
+      out += '=';
+      test_jtree_dump( jt, jt.get_val( i ), out );
+      break;
+    }
+    default: {
+      out += '<' + jt.get_str( i ).as_string() + '>';
+      break;
+    }
+  }
+}
+
+static std::string test_jtree_parse( jtree& jt, const std::string& txt )
+{
+  jt.parse( txt.c_str(), txt.size() );
+  std::string out = jt.is_valid() ? "" : "!";
+  if ( jt.is_valid() ) {
+    test_jtree_dump( jt, 1, out );
+  }
+  return out;
+}
+
+void test_jtree()
+{
+  static const char *doc[][2] = {
+    { "{\"a\":1,\"b\":[true,false,null,\"x\"],\"c\":{\"d\":-1.5e+3}}",
+      "{<a>=<1>;<b>=[<true>;<false>;<null>;<x>;];<c>={<d>=<-1.5e+3>;};}" },
+    { " { \"k\" :\t\"v\" ,\n\"n\"\r\n: [ 1 , 2 ] } ",
+      "{<k>=<v>;<n>=[<1>;<2>;];}" },
+    { "[\"a,b:{}[]\",\"\",{}]", "[<a,b:{}[]>;<>;{};]" },
+    // escaped quotes and backslashes stay part of the raw string
+    { "{\"k\\\\\":\"v\\\"w\",\"e\":\"\\\\\\\\\",\"f\":\"\\\\\\\"\"}",
+      "{<k\\\\>=<v\\\"w>;<e>=<\\\\\\\\>;<f>=<\\\\\\\">;}" },
+    // adjacent scalars are split as before
+    { "[1true,tx1,-2]", "[<1>;<true>;<tx>;<1>;<-2>;]" },
+    // truncated messages
+    { "{\"a\":1", "!" },
+    { "{\"a\":\"xyz", "!" },
+    { "[12", "!" },
+  };
+  jtree::impl_t impl = jtree::get_impl();
+  PC_TEST_CHECK( jtree::get_has_impl( jtree::e_scalar ) );
+  PC_TEST_CHECK( jtree::get_has_impl( impl ) );
+  jtree jt;
+  for( unsigned k=0; k != jtree::e_num_impl; ++k ) {
+    if ( !jtree::set_impl( (jtree::impl_t)k ) ) {
+      continue;
+    }
+    for( unsigned i=0; i != sizeof( doc ) / sizeof( doc[0] ); ++i ) {
+      // shift message across 64-byte block boundaries
+      for( unsigned pad=0; pad < 70; pad += 3 ) {
+        std::string txt = std::string( pad, ' ' ) + doc[i][0];
+        PC_TEST_CHECK( test_jtree_parse( jt, txt ) == doc[i][1] );
+      }
+    }
+  }
+
+  // long strings with random backslash runs and escaped quotes
+  uint64_t seed = 1;
+  for( unsigned n=0; n != 200; ++n ) {
+    std::vector<std::string> val;
+    std::string txt = "{";
+    for( unsigned i=0; i != 20; ++i ) {
+      std::string v;
+      unsigned len = ( seed = seed * 6364136223846793005UL + 1 ) >> 58;
+      for( unsigned j=0; j != len; ++j ) {
+        seed = seed * 6364136223846793005UL + 1;
+        switch( seed >> 62 ) {
+          case 0: v += "\\\\"; break;
+          case 1: v += "\\\""; break;
+          default: v += 'a' + ( ( seed >> 40 ) % 26 ); break;
+        }
+      }
+      txt += std::string( i ? "," : "" ) + "\"k" + std::to_string( i ) +
+        "\":\"" + v + "\"";
+      val.push_back( v );
+    }
+    txt += "}";
+    std::string exp;
+    for( unsigned k=0; k != jtree::e_num_impl; ++k ) {
+      if ( !jtree::set_impl( (jtree::impl_t)k ) ) {
+        continue;
+      }
+      std::string out = test_jtree_parse( jt, txt );
+      PC_TEST_CHECK( exp.empty() || exp == out );
+      exp = out;
+      bool is_ok = jt.is_valid();
+      for( unsigned i=0; is_ok && i != val.size(); ++i ) {
+        uint32_t vi = jt.find_val( 1, "k" + std::to_string( i ) );
+        is_ok = vi && jt.get_str( vi ) == val[i];
+      }
+      PC_TEST_CHECK( is_ok );
+    }
+  }
+  PC_TEST_CHECK( jtree::set_impl( impl ) );
+}
+
+void test_jpath()
+{
+  jpath jp;
+  unsigned id_a  = jp.add( "a" );
+  unsigned id_bc = jp.add( "b.c" );
+  unsigned id_bd = jp.add( "b.d.e" );
+  unsigned id_ar = jp.add( "f.g" );
+  unsigned id_no = jp.add( "b.x" );
+  PC_TEST_CHECK( id_a == 0 && id_bc == 1 && id_bd == 2 );
+  PC_TEST_CHECK( jp.add( "b.c" ) == id_bc );
+  PC_TEST_CHECK( jp.get_num_path() == 5 );
+
+  // nested values, a duplicate key (first wins) and a key matching a
+  // path below an array
+  std::string txt = "{\"b\":{\"d\":{\"e\":\"de\"},\"c\":7,\"c\":8},"
+    "\"f\":[{\"g\":1}],\"a\":[1,2],\"g\":{\"c\":3}}";
+  jtree jt, jf;
+  jt.set_path( &jp );
+  jt.parse( txt.c_str(), txt.size() );
+  jf.parse( txt.c_str(), txt.size() );
+  PC_TEST_CHECK( jt.is_valid() && jf.is_valid() );
+  for( jtree *tp: { &jt, &jf } ) {
+    PC_TEST_CHECK( tp->get_type( tp->find_path( jp, id_a ) ) == jtree::e_arr );
+    PC_TEST_CHECK( tp->get_uint( tp->find_path( jp, id_bc ) ) == 7 );
+    PC_TEST_CHECK( tp->get_str( tp->find_path( jp, id_bd ) ) == "de" );
+    PC_TEST_CHECK( tp->find_path( jp, id_ar ) == 0 );
+    PC_TEST_CHECK( tp->find_path( jp, id_no ) == 0 );
+  }
+  PC_TEST_CHECK( jt.find_path( jp, id_bc ) == jf.find_path( jp, id_bc ) );
+
+  // values are reset by every parse
+  txt = "{\"a\":1}";
+  jt.parse( txt.c_str(), txt.size() );
+  PC_TEST_CHECK( jt.get_uint( jt.find_path( jp, id_a ) ) == 1 );
+  PC_TEST_CHECK( jt.find_path( jp, id_bc ) == 0 );
 }
 
 void test_enc()
@@ -122,14 +398,2084 @@ void test_enc()
   PC_TEST_CHECK( 300L == str_to_dec( "0.03", -4 ) );
   PC_TEST_CHECK( 18L == str_to_dec( "1.83", -1 ) );
   PC_TEST_CHECK( -954 == str_to_dec( "-0.000954000", -6 ) );
+
+  // integer formatting at every digit count and the int64 extremes
+  char buf[32], *end = &buf[sizeof( buf )];
+  uint64_t uval = 0;
+  for( unsigned i=1; i != 21; ++i ) {
+    uval = uval * 10UL + ( i % 10 );
+    for( uint64_t v: { uval, uval - 1UL } ) {
+      std::string exp = std::to_string( v );
+      PC_TEST_CHECK( uint_len( v ) == exp.size() );
+      PC_TEST_CHECK( str( buf, uint_to_buf( v, buf ) ) == exp );
+      char *val = uint_to_str( v, end );
+      PC_TEST_CHECK( str( val, end - val ) == exp );
+    }
+  }
+  PC_TEST_CHECK( str( buf, uint_to_buf( 0, buf ) ) == "0" );
+  PC_TEST_CHECK( str( buf, uint_to_buf( UINT64_MAX, buf ) ) ==
+                 "18446744073709551615" );
+  for( int64_t v: { (int64_t)0, (int64_t)-7, (int64_t)-1234500,
+                    INT64_MAX, INT64_MIN } ) {
+    std::string exp = std::to_string( v );
+    PC_TEST_CHECK( str( buf, int_to_buf( v, buf ) ) == exp );
+    char *val = int_to_str( v, end );
+    PC_TEST_CHECK( str( val, end - val ) == exp );
+  }
+}
+
+void test_send_msgs( net_connect& conn, int rfd )
+{
+  // queue multi-buffer messages and flush using a single send
+  static const size_t num_msg = 16, msg_len = 1000;
+  for( size_t i=0; i != num_msg; ++i ) {
+    char buf[msg_len];
+    __builtin_memset( buf, 'a' + i, msg_len );
+    net_wtr msg;
+    msg.add( str( buf, msg_len ) );
+    conn.add_send( msg );
+  }
+  conn.poll_send();
+  PC_TEST_CHECK( !conn.get_is_err() );
+  PC_TEST_CHECK( !conn.get_is_send() );
+  PC_TEST_CHECK( conn.get_num_flush() == 1 );
+  PC_TEST_CHECK( conn.get_num_send() == 1 );
+  PC_TEST_CHECK( conn.get_num_send_bytes() == num_msg * msg_len );
+
+  // verify contents in order
+  char rbuf[num_msg*msg_len];
+  size_t rlen = 0;
+  while( rlen != sizeof( rbuf ) ) {
+    ssize_t rc = ::recv( rfd, &rbuf[rlen], sizeof( rbuf ) - rlen, 0 );
+    PC_TEST_CHECK( rc > 0 );
+    rlen += rc;
+  }
+  for( size_t i=0; i != num_msg; ++i ) {
+    PC_TEST_CHECK( rbuf[i*msg_len] == (char)('a' + i) );
+    PC_TEST_CHECK( rbuf[i*msg_len+msg_len-1] == (char)('a' + i) );
+  }
+}
+
+void test_net_send()
+{
+  {
+    int fd[2];
+    PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+    net_connect conn;
+    conn.set_fd( fd[0] );
+    conn.set_block( false );
+    // zero-copy is unsupported on unix sockets and falls back to copy
+    conn.set_zero_copy( 1 );
+    test_send_msgs( conn, fd[1] );
+    PC_TEST_CHECK( conn.get_zero_copy() == 0 );
+    conn.teardown();
+    ::close( fd[1] );
+  }
+  {
+    // zero-copy over tcp loopback
+    int lfd = ::socket( AF_INET, SOCK_STREAM, 0 );
+    sockaddr_in addr;
+    socklen_t alen = sizeof( addr );
+    __builtin_memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    PC_TEST_CHECK( 0 == ::bind( lfd, (sockaddr*)&addr, alen ) );
+    PC_TEST_CHECK( 0 == ::listen( lfd, 1 ) );
+    PC_TEST_CHECK( 0 == ::getsockname( lfd, (sockaddr*)&addr, &alen ) );
+    int cfd = ::socket( AF_INET, SOCK_STREAM, 0 );
+    PC_TEST_CHECK( 0 == ::connect( cfd, (sockaddr*)&addr, alen ) );
+    int rfd = ::accept( lfd, nullptr, nullptr );
+    PC_TEST_CHECK( rfd > 0 );
+    net_connect conn;
+    conn.set_fd( cfd );
+    conn.set_block( false );
+    conn.set_zero_copy( 1 );
+    test_send_msgs( conn, rfd );
+    conn.teardown();
+    ::close( rfd );
+    ::close( lfd );
+  }
+}
+
+// newline-delimited message parser
+class test_line_parser : public net_parser
+{
+public:
+  bool parse( const char *buf, size_t sz, size_t& len ) override {
+    const char *end = (const char*)__builtin_memchr( buf, '\n', sz );
+    if ( !end ) {
+      return false;
+    }
+    len = 1 + end - buf;
+    msg_.push_back( std::string( buf, len - 1 ) );
+    return true;
+  }
+  std::vector<std::string> msg_;
+};
+
+void test_net_ring()
+{
+  {
+    // spans across the end of the ring are contiguous
+    net_ring rng;
+    PC_TEST_CHECK( rng.init( 1 ) );
+    size_t cap = rng.get_capacity();
+    PC_TEST_CHECK( cap >= 4096 );
+    PC_TEST_CHECK( rng.get_avail() == cap );
+    rng.commit( cap - 3 );
+    rng.consume( cap - 3 );
+    __builtin_memcpy( rng.get_write(), "abcdefgh", 8 );
+    rng.commit( 8 );
+    PC_TEST_CHECK( rng.get_size() == 8 );
+    PC_TEST_CHECK( 0 == __builtin_memcmp( rng.get_read(), "abcdefgh", 8 ) );
+
+    // grow keeping unread bytes
+    PC_TEST_CHECK( rng.init( 2*cap ) );
+    PC_TEST_CHECK( rng.get_capacity() == 2*cap );
+    PC_TEST_CHECK( rng.get_size() == 8 );
+    PC_TEST_CHECK( 0 == __builtin_memcmp( rng.get_read(), "abcdefgh", 8 ) );
+  }
+  {
+    // messages larger than the read buffer grow then shrink it
+    int fd[2];
+    PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+    test_line_parser lp;
+    net_connect conn;
+    conn.set_fd( fd[1] );
+    conn.set_block( false );
+    conn.set_net_parser( &lp );
+    std::string big( 100000, 'x' );
+    big += '\n';
+    for( size_t i=0; i != big.size(); ) {
+      ssize_t rc = ::send( fd[0], &big[i], big.size() - i, 0 );
+      PC_TEST_CHECK( rc > 0 );
+      i += rc;
+      conn.poll_recv();
+    }
+    PC_TEST_CHECK( ::send( fd[0], "ab\ncd\n", 6, 0 ) == 6 );
+    conn.poll_recv();
+    PC_TEST_CHECK( !conn.get_is_err() );
+    PC_TEST_CHECK( lp.msg_.size() == 3 );
+    PC_TEST_CHECK( lp.msg_[0].size() == 100000 );
+    PC_TEST_CHECK( lp.msg_[1] == "ab" );
+    PC_TEST_CHECK( lp.msg_[2] == "cd" );
+    PC_TEST_CHECK( conn.get_recv_hwm() >= 100000 );
+    PC_TEST_CHECK( conn.get_recv_cap_hwm() >= 100001 );
+    conn.teardown();
+    ::close( fd[0] );
+  }
+}
+
+void test_net_loop( bool use_uring )
+{
+  net_loop nl;
+  nl.set_use_uring( use_uring );
+  PC_TEST_CHECK( nl.init() );
+  int fd[2];
+  PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+  test_line_parser lp[2];
+  net_connect conn[2];
+  for( unsigned i=0; i != 2; ++i ) {
+    conn[i].set_fd( fd[i] );
+    conn[i].set_block( false );
+    conn[i].set_net_parser( &lp[i] );
+    conn[i].set_net_loop( &nl );
+    PC_TEST_CHECK( conn[i].init() );
+  }
+
+  // messages of increasing size in both directions
+  static const unsigned num_msg = 64;
+  for( unsigned i=0; i != num_msg; ++i ) {
+    net_wtr msg;
+    msg.add( std::string( 1 + i*500, 'a' + (i%26) ) );
+    msg.add( '\n' );
+    conn[i%2].add_send( msg );
+  }
+  for( unsigned i=0; i != 1000 &&
+       lp[0].msg_.size() + lp[1].msg_.size() != num_msg; ++i ) {
+    nl.poll( 1 );
+  }
+  PC_TEST_CHECK( !conn[0].get_is_err() );
+  PC_TEST_CHECK( !conn[1].get_is_err() );
+  PC_TEST_CHECK( lp[0].msg_.size() == num_msg/2 );
+  PC_TEST_CHECK( lp[1].msg_.size() == num_msg/2 );
+  for( unsigned i=0; i != num_msg; ++i ) {
+    const std::string& txt = lp[1-i%2].msg_[i/2];
+    PC_TEST_CHECK( txt.size() == 1 + i*500 );
+    PC_TEST_CHECK( txt[0] == (char)('a' + (i%26)) );
+    PC_TEST_CHECK( txt[txt.size()-1] == (char)('a' + (i%26)) );
+  }
+  PC_TEST_CHECK( conn[0].get_num_send_bytes() ==
+      conn[1].get_num_send_bytes() - num_msg/2*500 );
+
+  // peer disconnect tears down connection
+  conn[1].close();
+  for( unsigned i=0; i != 1000 && !conn[0].get_is_err(); ++i ) {
+    nl.poll( 1 );
+  }
+  PC_TEST_CHECK( conn[0].get_is_err() );
+  PC_TEST_CHECK( !conn[0].get_in_loop() );
+}
+
+// timer recording when it fired relative to wheel time
+class test_timer : public net_timer
+{
+public:
+  test_timer() : wh_( nullptr ), num_( 0 ), ts_( 0L ), again_( 0L ) {}
+  void on_timer() override {
+    PC_TEST_CHECK( ( get_expiry() >> 10 ) <= ( now_ >> 10 ) );
+    PC_TEST_CHECK( ( get_expiry() >> 10 ) > ( prev_ >> 10 ) );
+    ++num_;
+    ts_ = now_;
+    if ( again_ ) {
+      wh_->add( this, now_ + again_ );
+      again_ = 0L;
+    }
+  }
+  static int64_t now_;
+  static int64_t prev_;
+  net_wheel *wh_;
+  unsigned   num_;
+  int64_t    ts_;
+  int64_t    again_;
+};
+
+int64_t test_timer::now_  = 0L;
+int64_t test_timer::prev_ = 0L;
+
+void test_net_wheel()
+{
+  // timers spread from microseconds to beyond the top level span
+  static const unsigned num_timer = 2048;
+  static const int64_t max_ts = 40L*60L*PC_NSECS_IN_SEC;
+  net_wheel wh;
+  int64_t t0 = 1600000000L * PC_NSECS_IN_SEC + 12345L;
+  test_timer::now_ = test_timer::prev_ = t0;
+  wh.expire( t0 );
+  PC_TEST_CHECK( wh.get_next() == 0L );
+  std::vector<test_timer> tvec( num_timer );
+  uint64_t seed = 42;
+  for( unsigned i=0; i != num_timer; ++i ) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    int64_t ts = t0 + 1024L +
+      (int64_t)( ( seed >> 20 ) % ( 1UL << ( i % 42 ) ) );
+    tvec[i].wh_ = &wh;
+    if ( i % 5 == 0 ) {
+      tvec[i].again_ = 1024L + ( i * 7919L ) % PC_NSECS_IN_SEC;
+    }
+    wh.add( &tvec[i], std::min( ts, t0 + max_ts ) );
+  }
+  // re-scheduled and cancelled timers
+  wh.add( &tvec[1], t0 + 3*PC_NSECS_IN_MSEC );
+  for( unsigned i=3; i < num_timer; i += 7 ) {
+    wh.del( &tvec[i] );
+    PC_TEST_CHECK( !tvec[i].get_is_active() );
+  }
+  PC_TEST_CHECK( wh.get_next() > t0 && wh.get_next() <= t0 + 2048L );
+
+  // advance time in irregular steps
+  while( wh.get_size() ) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    int64_t step = 1 + ( seed >> 20 ) % ( 1UL << ( ( seed >> 8 ) % 27 ) );
+    test_timer::prev_ = test_timer::now_;
+    test_timer::now_ += step;
+    wh.expire( test_timer::now_ );
+    PC_TEST_CHECK( test_timer::now_ < t0 + 2*max_ts );
+  }
+  for( unsigned i=0; i != num_timer; ++i ) {
+    unsigned num = i >= 3 && ( i - 3 ) % 7 == 0 ? 0 : ( i % 5 == 0 ? 2 : 1 );
+    PC_TEST_CHECK( tvec[i].num_ == num );
+    PC_TEST_CHECK( !tvec[i].get_is_active() );
+  }
+  PC_TEST_CHECK( tvec[1].ts_ >= t0 + 3*PC_NSECS_IN_MSEC - 1024L );
+  PC_TEST_CHECK( wh.get_next() == 0L );
+}
+
+// timer recording wall-clock time it fired
+class test_loop_timer : public net_timer
+{
+public:
+  test_loop_timer() : ts_( 0L ) {}
+  void on_timer() override {
+    ts_ = get_now();
+  }
+  int64_t ts_;
+};
+
+void test_net_timer( bool use_uring )
+{
+  net_loop nl;
+  nl.set_use_uring( use_uring );
+  PC_TEST_CHECK( nl.init() );
+  test_loop_timer tm[4];
+  int64_t now = get_now();
+  nl.add_timer( &tm[0], now + 5*PC_NSECS_IN_MSEC );
+  nl.add_timer( &tm[1], now + 200000L );
+  nl.add_timer( &tm[2], now + 2*PC_NSECS_IN_MSEC );
+  nl.add_timer( &tm[3], now + 1*PC_NSECS_IN_MSEC );
+  nl.del_timer( &tm[3] );
+  for( unsigned i=0; i != 100 && !tm[0].ts_; ++i ) {
+    nl.poll( 100 );
+  }
+  for( unsigned i=0; i != 3; ++i ) {
+    PC_TEST_CHECK( tm[i].ts_ >= tm[i].get_expiry() - 1024L );
+    PC_TEST_CHECK( !tm[i].get_is_active() );
+  }
+  PC_TEST_CHECK( tm[1].ts_ <= tm[2].ts_ && tm[2].ts_ <= tm[0].ts_ );
+  PC_TEST_CHECK( tm[3].ts_ == 0L );
+}
+
+void test_spsc_queue()
+{
+  // small queue so that producer regularly finds it full
+  static const uint64_t num_msg = 1000000;
+  spsc_queue<uint64_t> q;
+  q.init( 100 );
+  uint64_t val = 0;
+  PC_TEST_CHECK( !q.pop( val ) );
+  std::thread thrd( [&q]() {
+    for( uint64_t i=1; i <= num_msg; ) {
+      if ( q.push( i ) ) {
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  } );
+  uint64_t exp = 1;
+  while( exp <= num_msg ) {
+    if ( q.pop( val ) ) {
+      PC_TEST_CHECK( val == exp );
+      ++exp;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  thrd.join();
+  PC_TEST_CHECK( !q.pop( val ) );
+  PC_TEST_CHECK( q.size() == 0 );
+}
+
+class test_wakeup : public net_wakeup_sub
+{
+public:
+  test_wakeup() : num_( 0 ) {}
+  void on_wakeup() override {
+    ++num_;
+  }
+  unsigned num_;
+};
+
+void test_net_wakeup( bool use_uring )
+{
+  // wake up loop blocked in poll from another thread
+  net_loop nl;
+  nl.set_use_uring( use_uring );
+  PC_TEST_CHECK( nl.init() );
+  test_wakeup sub;
+  net_wakeup wk;
+  wk.set_net_loop( &nl );
+  wk.set_sub( &sub );
+  PC_TEST_CHECK( wk.init() );
+  std::atomic<bool> done( false );
+  std::thread thrd( [&wk,&done]() {
+    wk.signal();
+    wk.signal();
+    done = true;
+  } );
+  while( !sub.num_ ) {
+    nl.poll( -1 );
+  }
+  thrd.join();
+  PC_TEST_CHECK( done );
+  nl.poll( 0 );
+  PC_TEST_CHECK( sub.num_ <= 2 );
+  wk.close();
+}
+
+class test_resolve : public net_resolve_sub
+{
+public:
+  test_resolve() : num_( 0 ), ok_( false ), addr_( 0 ) {}
+  void on_resolve( bool ok, uint32_t addr ) override {
+    ++num_;
+    ok_ = ok;
+    addr_ = addr;
+  }
+  unsigned num_;
+  bool     ok_;
+  uint32_t addr_;
+};
+
+void test_net_resolve()
+{
+  net_loop nl;
+  PC_TEST_CHECK( nl.init() );
+  net_resolver *rp = nl.get_resolver();
+  PC_TEST_CHECK( rp == nl.get_resolver() );
+  rp->set_ttl( 100*PC_NSECS_IN_MSEC, 0L );
+
+  // concurrent requests for the same host share one lookup
+  test_resolve sub[3];
+  for( unsigned i=0; i != 3; ++i ) {
+    rp->resolve( "localhost", &sub[i] );
+  }
+  rp->cancel( &sub[2] );
+  for( unsigned i=0; i != 1000 && !sub[0].num_; ++i ) {
+    nl.poll( 1 );
+  }
+  PC_TEST_CHECK( sub[0].num_ == 1 );
+  PC_TEST_CHECK( sub[1].num_ == 1 );
+  PC_TEST_CHECK( sub[2].num_ == 0 );
+  PC_TEST_CHECK( sub[0].ok_ );
+  PC_TEST_CHECK( sub[0].addr_ == htonl( INADDR_LOOPBACK ) );
+  PC_TEST_CHECK( rp->get_num_lookup() == 1 );
+
+  // cached lookup is delivered immediately
+  rp->resolve( "localhost", &sub[2] );
+  PC_TEST_CHECK( sub[2].num_ == 1 );
+  PC_TEST_CHECK( sub[2].addr_ == htonl( INADDR_LOOPBACK ) );
+  PC_TEST_CHECK( rp->get_num_lookup() == 1 );
+
+  // expired entries are looked up again
+  std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+  rp->resolve( "localhost", &sub[2] );
+  rp->resolve( "localhost", &sub[2] );
+  PC_TEST_CHECK( sub[2].num_ == 1 );
+  for( unsigned i=0; i != 1000 && sub[2].num_ != 3; ++i ) {
+    nl.poll( 1 );
+  }
+  PC_TEST_CHECK( sub[2].num_ == 3 );
+  PC_TEST_CHECK( rp->get_num_lookup() == 2 );
+}
+
+void test_tcp_connect( bool use_uring )
+{
+  net_loop nl;
+  nl.set_use_uring( use_uring );
+  PC_TEST_CHECK( nl.init() );
+  int lfd = ::socket( AF_INET, SOCK_STREAM, 0 );
+  sockaddr_in addr;
+  socklen_t alen = sizeof( addr );
+  __builtin_memset( &addr, 0, sizeof( addr ) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  PC_TEST_CHECK( 0 == ::bind( lfd, (sockaddr*)&addr, alen ) );
+  PC_TEST_CHECK( 0 == ::listen( lfd, 1 ) );
+  PC_TEST_CHECK( 0 == ::getsockname( lfd, (sockaddr*)&addr, &alen ) );
+
+  // messages queued while connecting are sent once connected
+  tcp_connect conn;
+  conn.set_host( "localhost" );
+  conn.set_port( ntohs( addr.sin_port ) );
+  conn.set_net_loop( &nl );
+  PC_TEST_CHECK( conn.init() );
+  PC_TEST_CHECK( conn.get_is_wait() );
+  net_wtr msg;
+  msg.add( "hello\n" );
+  conn.add_send( msg );
+  for( unsigned i=0; i != 1000 &&
+       conn.get_num_send_bytes() != 6; ++i ) {
+    nl.poll( 1 );
+  }
+  PC_TEST_CHECK( !conn.get_is_wait() );
+  PC_TEST_CHECK( !conn.get_is_err() );
+  PC_TEST_CHECK( !conn.get_is_send() );
+  int rfd = ::accept( lfd, nullptr, nullptr );
+  PC_TEST_CHECK( rfd > 0 );
+  char buf[8];
+  PC_TEST_CHECK( 6 == ::recv( rfd, buf, sizeof( buf ), 0 ) );
+  PC_TEST_CHECK( 0 == __builtin_strncmp( buf, "hello\n", 6 ) );
+  ::close( rfd );
+  ::close( lfd );
+
+  // refused connection reported via the loop. check does not dispatch
+  // loop events itself so it is safe to call from within a callback
+  PC_TEST_CHECK( conn.init() );
+  conn.check();
+  for( unsigned i=0; i != 1000 && conn.get_is_wait(); ++i ) {
+    nl.poll( 1 );
+  }
+  PC_TEST_CHECK( !conn.get_is_wait() );
+  PC_TEST_CHECK( conn.get_is_err() );
+  PC_TEST_CHECK( nl.get_resolver()->get_num_lookup() == 1 );
+  conn.close();
+}
+
+class test_accept : public net_accept
+{
+public:
+  void accept( int fd ) override { fds_.push_back( fd ); }
+  std::vector<int> fds_;
+};
+
+static int test_unix_connect( const std::string& path )
+{
+  sockaddr_un addr;
+  __builtin_memset( &addr, 0, sizeof( addr ) );
+  addr.sun_family = AF_UNIX;
+  __builtin_memcpy( addr.sun_path, path.c_str(), path.size() );
+  if ( path[0] == '@' ) {
+    addr.sun_path[0] = '\0';
+  }
+  int fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+  socklen_t alen = offsetof( sockaddr_un, sun_path ) + path.size();
+  if ( 0 != ::connect( fd, (sockaddr*)&addr, alen ) ) {
+    ::close( fd );
+    return -1;
+  }
+  return fd;
+}
+
+void test_unix_listen()
+{
+  std::string fpath = "/tmp/pc_test_" + std::to_string( ::getpid() );
+  std::string apath = "@pc_test_" + std::to_string( ::getpid() );
+  for( const std::string& path: { fpath, apath } ) {
+    test_accept ap;
+    unix_listen lsvr;
+    lsvr.set_path( path );
+    lsvr.set_net_accept( &ap );
+    PC_TEST_CHECK( lsvr.init() );
+    struct stat fst[1];
+    PC_TEST_CHECK( ( path == fpath ) == ( 0 == ::stat( path.c_str(), fst ) ) );
+
+    // second server on same path is refused. probing a socket file for
+    // a live server leaves behind a connection that is closed at once
+    unix_listen lsvr2;
+    lsvr2.set_path( path );
+    lsvr2.set_net_accept( &ap );
+    PC_TEST_CHECK( !lsvr2.init() );
+
+    // accepted connection carries data both ways
+    int cfd = test_unix_connect( path );
+    PC_TEST_CHECK( cfd >= 0 );
+    lsvr.poll();
+    PC_TEST_CHECK( !lsvr.get_is_err() );
+    PC_TEST_CHECK( ap.fds_.size() == ( path == fpath ? 2 : 1 ) );
+    int afd = ap.fds_.back();
+    char buf[8];
+    PC_TEST_CHECK( 6 == ::send( cfd, "hello\n", 6, 0 ) );
+    PC_TEST_CHECK( 6 == ::recv( afd, buf, sizeof( buf ), 0 ) );
+    PC_TEST_CHECK( 3 == ::send( afd, "ok\n", 3, 0 ) );
+    PC_TEST_CHECK( 3 == ::recv( cfd, buf, sizeof( buf ), 0 ) );
+    ::close( cfd );
+    for( int fd: ap.fds_ ) {
+      ::close( fd );
+    }
+    lsvr.teardown();
+    PC_TEST_CHECK( 0 != ::stat( path.c_str(), fst ) );
+  }
+
+  // stale socket file left behind by a dead server is replaced
+  int sfd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+  sockaddr_un addr;
+  __builtin_memset( &addr, 0, sizeof( addr ) );
+  addr.sun_family = AF_UNIX;
+  __builtin_strcpy( addr.sun_path, fpath.c_str() );
+  PC_TEST_CHECK( 0 == ::bind( sfd, (sockaddr*)&addr, sizeof( addr ) ) );
+  ::close( sfd );
+  unix_listen lsvr;
+  lsvr.set_path( fpath );
+  PC_TEST_CHECK( lsvr.init() );
+  lsvr.teardown();
+
+  // invalid paths
+  lsvr.set_path( "" );
+  PC_TEST_CHECK( !lsvr.init() );
+  lsvr.set_path( "/tmp/" + std::string( 200, 'x' ) );
+  PC_TEST_CHECK( !lsvr.init() );
+}
+
+void test_net_profile()
+{
+  net_profile prof;
+  PC_TEST_CHECK( prof.to_str() == "[default]" );
+  PC_TEST_CHECK( prof.init_from_str( "nodelay,sndbuf=65536,prio=6" ) );
+  PC_TEST_CHECK( prof.nodelay_ );
+  PC_TEST_CHECK( !prof.quickack_ );
+  PC_TEST_CHECK( prof.sndbuf_ == 65536 );
+  PC_TEST_CHECK( prof.prio_ == 6 );
+  PC_TEST_CHECK( prof.to_str() == "[nodelay,sndbuf=65536,prio=6]" );
+  PC_TEST_CHECK( !prof.init_from_str( "nodelay,bogus" ) );
+  PC_TEST_CHECK( !prof.init_from_str( "sndbuf" ) );
+  PC_TEST_CHECK( prof.init_from_str( "default" ) );
+  PC_TEST_CHECK( prof.to_str() == "[default]" );
+
+  net_profile::role_t role;
+  PC_TEST_CHECK( net_profile::parse_role( "tx:quickack,busy_poll=50",
+        role, prof ) );
+  PC_TEST_CHECK( role == net_profile::e_tx );
+  PC_TEST_CHECK( prof.quickack_ && prof.busy_poll_ == 50 );
+  PC_TEST_CHECK( !net_profile::parse_role( "nodelay", role, prof ) );
+  PC_TEST_CHECK( !net_profile::parse_role( "rpc:nodelay", role, prof ) );
+  PC_TEST_CHECK( 0 == __builtin_strcmp( "rpc_ws",
+        net_profile::get_role_name( net_profile::e_rpc_ws ) ) );
+
+  // options are applied to the socket
+  net_socket sock;
+  sock.set_fd( ::socket( AF_INET, SOCK_STREAM, 0 ) );
+  PC_TEST_CHECK( prof.init_from_str( "nodelay,sndbuf=65536,prio=3" ) );
+  sock.set_net_profile( prof );
+  PC_TEST_CHECK( sock.apply_net_profile() );
+  int val = 0;
+  socklen_t len = sizeof( val );
+  PC_TEST_CHECK( 0 == ::getsockopt( sock.get_fd(), IPPROTO_TCP,
+        TCP_NODELAY, &val, &len ) );
+  PC_TEST_CHECK( val == 1 );
+  PC_TEST_CHECK( 0 == ::getsockopt( sock.get_fd(), SOL_SOCKET,
+        SO_SNDBUF, &val, &len ) );
+  PC_TEST_CHECK( val >= 65536 );
+  PC_TEST_CHECK( 0 == ::getsockopt( sock.get_fd(), SOL_SOCKET,
+        SO_PRIORITY, &val, &len ) );
+  PC_TEST_CHECK( val == 3 );
+  sock.close();
+
+  // tcp options do not apply to udp sockets
+  udp_socket usock;
+  PC_TEST_CHECK( prof.init_from_str( "nodelay" ) );
+  usock.set_net_profile( prof );
+  PC_TEST_CHECK( usock.init() );
+  PC_TEST_CHECK( !usock.apply_net_profile() );
+  usock.close();
+
+  // nor to unix domain sockets where only socket options are applied
+  int fd[2];
+  PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+  PC_TEST_CHECK( prof.init_from_str( "nodelay,quickack,sndbuf=65536" ) );
+  sock.set_fd( fd[0] );
+  sock.set_net_profile( prof );
+  PC_TEST_CHECK( sock.apply_net_profile() );
+  PC_TEST_CHECK( 0 == ::getsockopt( sock.get_fd(), SOL_SOCKET,
+        SO_SNDBUF, &val, &len ) );
+  PC_TEST_CHECK( val >= 65536 );
+  sock.close();
+  ::close( fd[1] );
+}
+
+void test_user_msg( user& usr, uint64_t sid, char ch, bool is_notify=true )
+{
+  char buf[600];
+  __builtin_memset( buf, ch, sizeof( buf ) );
+  net_wtr msg;
+  msg.add( str( buf, sizeof( buf ) ) );
+  net_buf *hd, *tl;
+  msg.detach( hd, tl );
+  if ( is_notify ) {
+    usr.queue_notify( sid, hd, tl );
+  } else {
+    usr.queue_send( hd, tl );
+  }
+}
+
+void test_user_conflate()
+{
+  int fd[2];
+  PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+  user usr;
+  usr.set_fd( fd[0] );
+  usr.set_block( false );
+  usr.set_send_limit( 1000, 1UL<<20 );
+
+  // 600 byte payloads plus websocket header
+  static const size_t frm = 604;
+
+  // notifications below the hwm are queued directly
+  test_user_msg( usr, 1, 'a' );
+  test_user_msg( usr, 1, 'b' );
+  PC_TEST_CHECK( usr.get_send_queue() == 2*frm );
+
+  // above the hwm only the latest per subscription is held back
+  test_user_msg( usr, 1, 'c' );
+  test_user_msg( usr, 1, 'd' );
+  test_user_msg( usr, 2, 'e' );
+  PC_TEST_CHECK( usr.get_send_queue() == 2*frm );
+  PC_TEST_CHECK( usr.get_num_conflated() == 1 );
+  usr.poll_send();
+  usr.poll_send();
+  PC_TEST_CHECK( usr.get_send_queue() == 0 );
+  PC_TEST_CHECK( usr.get_num_send_bytes() == 4*frm );
+  char rbuf[4*frm];
+  size_t rlen = 0;
+  while( rlen != sizeof( rbuf ) ) {
+    ssize_t rc = ::recv( fd[1], &rbuf[rlen], sizeof( rbuf ) - rlen, 0 );
+    PC_TEST_CHECK( rc > 0 );
+    rlen += rc;
+  }
+  PC_TEST_CHECK( rbuf[4] == 'a' && rbuf[frm+4] == 'b' );
+  PC_TEST_CHECK( ( rbuf[2*frm+4] == 'd' && rbuf[3*frm+4] == 'e' ) ||
+                 ( rbuf[2*frm+4] == 'e' && rbuf[3*frm+4] == 'd' ) );
+
+  // without conflation held back notifications are dropped
+  usr.set_conflate( false );
+  test_user_msg( usr, 1, 'f' );
+  test_user_msg( usr, 1, 'g' );
+  test_user_msg( usr, 1, 'h' );
+  PC_TEST_CHECK( usr.get_send_queue() == 2*frm );
+  PC_TEST_CHECK( usr.get_num_dropped() == 1 );
+
+  // slow consumers are disconnected beyond the max
+  usr.set_send_limit( 1000, 2000 );
+  test_user_msg( usr, 0, 'i', false );
+  PC_TEST_CHECK( !usr.net_connect::get_is_err() );
+  test_user_msg( usr, 0, 'j', false );
+  PC_TEST_CHECK( usr.net_connect::get_is_err() );
+  usr.teardown();
+  ::close( fd[1] );
+}
+
+// websocket parser collecting messages
+class test_ws_parser : public ws_parser
+{
+public:
+  void parse_msg( const char *buf, size_t sz ) override {
+    msg_.push_back( std::string( buf, sz ) );
+  }
+  std::vector<std::string> msg_;
+};
+
+size_t test_ws_parse( ws_wtr& msg, test_ws_parser& wp )
+{
+  std::vector<char> buf;
+  net_buf *hd, *tl;
+  msg.detach( hd, tl );
+  for( net_buf *ptr = hd; ptr; ) {
+    net_buf *nxt = ptr->next_;
+    buf.insert( buf.end(), ptr->buf_, &ptr->buf_[ptr->size_] );
+    ptr->dealloc();
+    ptr = nxt;
+  }
+  size_t len = 0;
+  PC_TEST_CHECK( wp.parse( buf.data(), buf.size(), len ) );
+  PC_TEST_CHECK( len == buf.size() );
+  PC_TEST_CHECK( !wp.get_is_err() );
+  return len;
+}
+
+void test_ws_deflate()
+{
+  // negotiation
+  std::string ext;
+  {
+    ws_deflate zp;
+    PC_TEST_CHECK( zp.negotiate( "x-webkit-deflate-frame, permessage-deflate;"
+          " client_max_window_bits", 6, ext ) );
+    PC_TEST_CHECK( ext == "permessage-deflate" );
+    PC_TEST_CHECK( !zp.negotiate(
+          "permessage-deflate; server_max_window_bits=8", 6, ext ) );
+    PC_TEST_CHECK( !zp.negotiate( "permessage-deflate; bogus", 6, ext ) );
+    PC_TEST_CHECK( zp.negotiate( "permessage-deflate; server_max_window_bits"
+          "=10; server_no_context_takeover", 6, ext ) );
+    PC_TEST_CHECK( ext == "permessage-deflate; server_max_window_bits=10;"
+          " server_no_context_takeover" );
+  }
+  test_ws_parser wp;
+  PC_TEST_CHECK( wp.negotiate_deflate( "permessage-deflate" ).empty() );
+  PC_TEST_CHECK( wp.get_deflate() == nullptr );
+  wp.set_deflate_level( 1 );
+  PC_TEST_CHECK( wp.negotiate_deflate( "permessage-deflate" ) ==
+                 "permessage-deflate" );
+  PC_TEST_CHECK( wp.get_deflate() != nullptr );
+
+  // repeated messages compress better with context takeover
+  ws_deflate zp;
+  PC_TEST_CHECK( zp.negotiate( "permessage-deflate", 6, ext ) );
+  std::string txt = "{\"jsonrpc\":\"2.0\",\"method\":\"notify_price\","
+    "\"params\":{\"result\":{\"price\":1234500,\"conf\":100,"
+    "\"status\":\"trading\"},\"subscription\":1}}";
+  size_t flen[3];
+  for( unsigned i=0; i != 3; ++i ) {
+    net_wtr pay;
+    pay.add( txt );
+    ws_wtr msg;
+    msg.commit( ws_wtr::text_id, pay, false, &zp );
+    flen[i] = test_ws_parse( msg, wp );
+  }
+  PC_TEST_CHECK( wp.msg_.size() == 3 );
+  PC_TEST_CHECK( wp.msg_[0] == txt && wp.msg_[2] == txt );
+  PC_TEST_CHECK( flen[0] < txt.size() );
+  PC_TEST_CHECK( flen[1] < flen[0] && flen[2] < flen[0] );
+  PC_TEST_CHECK( zp.get_num_raw_bytes() == 3*txt.size() );
+  PC_TEST_CHECK( zp.get_num_cmp_bytes() < txt.size() );
+
+  // uncompressed frames still accepted
+  net_wtr pay;
+  pay.add( txt );
+  ws_wtr msg;
+  msg.commit( ws_wtr::text_id, pay, false );
+  test_ws_parse( msg, wp );
+  PC_TEST_CHECK( wp.msg_.size() == 4 && wp.msg_[3] == txt );
+}
+
+void test_ws_mask()
+{
+  // every kernel matches the byte-wise definition for all lengths,
+  // alignments and starting key offsets
+  const char kbuf[] = { 0x12, 0x34, 0x56, 0x78 };
+  uint32_t key;
+  __builtin_memcpy( &key, kbuf, sizeof( key ) );
+  ws_mask::impl_t impl = ws_mask::get_impl();
+  PC_TEST_CHECK( ws_mask::get_has_impl( ws_mask::e_scalar ) );
+  PC_TEST_CHECK( ws_mask::get_has_impl( impl ) );
+  char src[256], buf[256+32];
+  for( unsigned i=0; i != sizeof( src ); ++i ) {
+    src[i] = (char)( i * 7 + 3 );
+  }
+  for( unsigned k=0; k != ws_mask::e_num_impl; ++k ) {
+    if ( !ws_mask::set_impl( (ws_mask::impl_t)k ) ) {
+      continue;
+    }
+    for( unsigned len=0; len < 200; len += 1 + len/16 ) {
+      for( unsigned algn=0; algn != 32; ++algn ) {
+        for( unsigned off=0; off != 4; ++off ) {
+          char *ptr = &buf[algn];
+          __builtin_memcpy( ptr, src, len );
+          PC_TEST_CHECK( ws_mask::apply( ptr, len, key, off ) ==
+                         ( off + len ) % 4 );
+          bool is_ok = true;
+          for( unsigned i=0; i != len; ++i ) {
+            is_ok = is_ok && ptr[i] == ( src[i] ^ kbuf[(off+i)%4] );
+          }
+          PC_TEST_CHECK( is_ok );
+        }
+      }
+    }
+  }
+  PC_TEST_CHECK( ws_mask::set_impl( impl ) );
+
+  // masked multi-buffer frame round trip
+  std::string txt( 5000, 'x' );
+  for( unsigned i=0; i != txt.size(); ++i ) {
+    txt[i] = 'a' + i % 26;
+  }
+  net_wtr pay;
+  pay.add( txt );
+  ws_wtr msg;
+  msg.commit( ws_wtr::text_id, pay, true );
+  test_ws_parser wp;
+  test_ws_parse( msg, wp );
+  PC_TEST_CHECK( wp.msg_.size() == 1 && wp.msg_[0] == txt );
+}
+
+// append raw websocket frame
+void test_ws_frame( std::string& buf, uint8_t op, bool fin,
+                    const std::string& pay, bool mask )
+{
+  buf += (char)( ( fin ? 0x80 : 0 ) | op );
+  const char key[] = { 0x11, 0x22, 0x33, 0x44 };
+  if ( pay.size() < 126 ) {
+    buf += (char)( ( mask ? 0x80 : 0 ) | pay.size() );
+  } else {
+    buf += (char)( ( mask ? 0x80 : 0 ) | 126 );
+    buf += (char)( pay.size() >> 8 );
+    buf += (char)( pay.size() & 0xff );
+  }
+  if ( mask ) {
+    buf.append( key, 4 );
+  }
+  for( unsigned i=0; i != pay.size(); ++i ) {
+    buf += mask ? (char)( pay[i] ^ key[i%4] ) : pay[i];
+  }
+}
+
+void test_ws_frag()
+{
+  for( unsigned m=0; m != 2; ++m ) {
+    std::string part[3] = { "hello", std::string( 300, 'w' ), "orld" };
+    std::string buf;
+    test_ws_frame( buf, ws_wtr::text_id, false, part[0], m );
+    test_ws_frame( buf, ws_wtr::cont_id, false, part[1], m );
+    test_ws_frame( buf, ws_wtr::cont_id, true, part[2], m );
+    test_ws_frame( buf, ws_wtr::text_id, true, "next", m );
+
+    // incomplete message is not consumed until final fragment arrives
+    test_ws_parser wp;
+    std::vector<char> rbuf( buf.begin(), buf.end() );
+    size_t len = 0, flen = buf.size() - ( m ? 10 : 6 );
+    PC_TEST_CHECK( !wp.parse( rbuf.data(), 10, len ) );
+    PC_TEST_CHECK( !wp.parse( rbuf.data(), flen - 1, len ) );
+    PC_TEST_CHECK( wp.parse( rbuf.data(), rbuf.size(), len ) );
+    PC_TEST_CHECK( len == flen );
+    PC_TEST_CHECK( wp.msg_.size() == 1 );
+    PC_TEST_CHECK( wp.msg_[0] == part[0] + part[1] + part[2] );
+    PC_TEST_CHECK( wp.parse( &rbuf[len], rbuf.size() - len, len ) );
+    PC_TEST_CHECK( wp.msg_.size() == 2 && wp.msg_[1] == "next" );
+    PC_TEST_CHECK( wp.get_num_frag() == 1 );
+    PC_TEST_CHECK( wp.get_num_frag_copy() == 0 );
+  }
+
+  // control frame between fragments falls back to copying
+  std::string buf;
+  test_ws_frame( buf, ws_wtr::text_id, false, "abc", true );
+  test_ws_frame( buf, ws_wtr::cont_id, false, "def", true );
+  test_ws_frame( buf, ws_wtr::ping_id, true, "p", true );
+  test_ws_frame( buf, ws_wtr::cont_id, true, "ghi", true );
+  net_connect conn;
+  test_ws_parser wp;
+  wp.set_net_connect( &conn );
+  std::vector<char> rbuf( buf.begin(), buf.end() );
+  for( size_t len = 0, pos = 0; pos != rbuf.size(); pos += len ) {
+    PC_TEST_CHECK( wp.parse( &rbuf[pos], rbuf.size() - pos, len ) );
+  }
+  PC_TEST_CHECK( wp.msg_.size() == 1 && wp.msg_[0] == "abcdefghi" );
+  PC_TEST_CHECK( wp.get_num_frag() == 0 );
+  PC_TEST_CHECK( wp.get_num_frag_copy() == 1 );
+  PC_TEST_CHECK( conn.get_is_send() );
+}
+
+void test_rpc_reply( int fd, uint64_t id )
+{
+  char body[64], msg[128];
+  int blen = ::snprintf( body, sizeof( body ),
+      "{\"jsonrpc\":\"2.0\",\"result\":\"ok\",\"id\":%lu}", id );
+  int mlen = ::snprintf( msg, sizeof( msg ),
+      "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n%s", blen, body );
+  PC_TEST_CHECK( mlen == ::send( fd, msg, mlen, 0 ) );
+}
+
+void test_rpc_http_pool()
+{
+  int fd[2][2];
+  net_connect conn[2];
+  rpc_client clnt;
+  for( unsigned i=0; i != 2; ++i ) {
+    PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd[i] ) );
+    conn[i].set_fd( fd[i][0] );
+    conn[i].set_block( false );
+    if ( i == 0 ) {
+      clnt.set_http_conn( &conn[i] );
+    } else {
+      clnt.add_http_conn( &conn[i] );
+    }
+  }
+  PC_TEST_CHECK( clnt.get_num_http_conn() == 2 );
+  PC_TEST_CHECK( clnt.get_http_conn() == &conn[0] );
+
+  // requests go to connection with fewest outstanding requests
+  rpc::get_health req[3];
+  for( unsigned i=0; i != 3; ++i ) {
+    clnt.send( &req[i] );
+  }
+  rpc_http_stats st[2];
+  clnt.get_http_stats( 0, st[0] );
+  clnt.get_http_stats( 1, st[1] );
+  PC_TEST_CHECK( st[0].num_req_ == 2 && st[0].num_out_ == 2 );
+  PC_TEST_CHECK( st[1].num_req_ == 1 && st[1].num_out_ == 1 );
+
+  // pipelined responses matched back to requests by id
+  test_rpc_reply( fd[1][1], req[1].get_id() );
+  conn[1].poll();
+  PC_TEST_CHECK( req[1].get_is_recv() );
+  PC_TEST_CHECK( !req[0].get_is_recv() && !req[2].get_is_recv() );
+  test_rpc_reply( fd[0][1], req[0].get_id() );
+  test_rpc_reply( fd[0][1], req[2].get_id() );
+  conn[0].poll();
+  PC_TEST_CHECK( req[0].get_is_recv() && req[2].get_is_recv() );
+  clnt.get_http_stats( 0, st[0] );
+  clnt.get_http_stats( 1, st[1] );
+  PC_TEST_CHECK( st[0].num_resp_ == 2 && st[0].num_out_ == 0 );
+  PC_TEST_CHECK( st[1].num_resp_ == 1 && st[1].num_out_ == 0 );
+  PC_TEST_CHECK( st[0].lat_max_ >= st[0].lat_avg_ && st[0].lat_avg_ > 0 );
+
+  // connections in error are avoided
+  conn[0].set_err_msg( "test" );
+  clnt.send( &req[0] );
+  clnt.get_http_stats( 1, st[1] );
+  PC_TEST_CHECK( st[1].num_out_ == 1 );
+  for( unsigned i=0; i != 2; ++i ) {
+    conn[i].close();
+    ::close( fd[i][1] );
+  }
+}
+
+// read everything sent on socket so far
+static std::string test_rpc_read( net_connect& conn, int fd )
+{
+  conn.poll();
+  char buf[4096];
+  ssize_t len = ::recv( fd, buf, sizeof( buf ), MSG_DONTWAIT );
+  return std::string( buf, len > 0 ? len : 0 );
+}
+
+static std::string test_ws_unmask( const std::string& frm )
+{
+  // unmask payload of client websocket frame
+  PC_TEST_CHECK( frm.size() > 8 && ( frm[1] & 0x80 ) );
+  size_t hlen = ( frm[1] & 0x7f ) == 126 ? 4 : 2;
+  const char *key = &frm[hlen];
+  std::string pay;
+  for( size_t j = hlen + 4; j < frm.size(); ++j ) {
+    pay += frm[j] ^ key[(j-hlen-4)%4];
+  }
+  return pay;
+}
+
+static std::string test_ws_read( net_connect& conn, int fd )
+{
+  return test_ws_unmask( test_rpc_read( conn, fd ) );
+}
+
+void test_rpc_tmpl()
+{
+  int fd[2][2];
+  net_connect conn[2];
+  rpc_client clnt;
+  for( unsigned i=0; i != 2; ++i ) {
+    PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd[i] ) );
+    conn[i].set_fd( fd[i][0] );
+    conn[i].set_block( false );
+  }
+  clnt.set_http_conn( &conn[0] );
+  clnt.set_ws_conn( &conn[1] );
+
+  // http requests resent from template with only the id patched
+  pub_key acc;
+  acc.init_from_text( str( "9xQeWvG816bUx9EPjHmaT23yvVM2ZWbrrpZb9PusVFin" ) );
+  rpc::get_account_info req;
+  req.set_account( &acc );
+  std::string msg[3];
+  for( unsigned i=0; i != 3; ++i ) {
+    clnt.send( &req );
+    msg[i] = test_rpc_read( conn[0], fd[0][1] );
+  }
+  size_t bpos = msg[0].find( "\r\n\r\n" ) + 4;
+  PC_TEST_CHECK( msg[0].find( "POST / HTTP/1.1\r\n" ) == 0 );
+  std::string clen = std::to_string( msg[0].size() - bpos );
+  PC_TEST_CHECK( msg[0].find( "Content-Length: " + clen ) !=
+                 std::string::npos );
+  PC_TEST_CHECK( msg[0].size() == msg[1].size() );
+  jtree jt;
+  for( unsigned i=0; i != 3; ++i ) {
+    jt.parse( &msg[i][bpos], msg[i].size() - bpos );
+    PC_TEST_CHECK( jt.is_valid() );
+    PC_TEST_CHECK( jt.get_str( jt.find_val( 1, "method" ) ) ==
+                   "getAccountInfo" );
+    PC_TEST_CHECK( jt.get_uint( jt.find_val( 1, "id" ) ) == 1 + i );
+  }
+
+  // parameter change rebuilds template
+  pub_key acc2;
+  acc2.init_from_text( str( "So11111111111111111111111111111111111111112" ) );
+  req.set_account( &acc2 );
+  clnt.send( &req );
+  std::string rmsg = test_rpc_read( conn[0], fd[0][1] );
+  PC_TEST_CHECK( rmsg.find( "So1111" ) != std::string::npos );
+
+  // websocket frames are re-masked on each send
+  rpc::account_subscribe sub;
+  sub.set_account( &acc );
+  std::string pay[2];
+  for( unsigned i=0; i != 2; ++i ) {
+    clnt.send( &sub );
+    pay[i] = test_ws_read( conn[1], fd[1][1] );
+    jt.parse( pay[i].c_str(), pay[i].size() );
+    PC_TEST_CHECK( jt.is_valid() );
+    PC_TEST_CHECK( jt.get_str( jt.find_val( 1, "method" ) ) ==
+                   "accountSubscribe" );
+    PC_TEST_CHECK( jt.get_uint( jt.find_val( 1, "id" ) ) ==
+                   sub.get_id() );
+  }
+  PC_TEST_CHECK( pay[0].size() == pay[1].size() );
+  for( unsigned i=0; i != 2; ++i ) {
+    conn[i].close();
+    ::close( fd[i][1] );
+  }
+}
+
+void test_rpc_notify()
+{
+  std::string acc = "{\"jsonrpc\":\"2.0\",\"method\":\"accountNotification\","
+    "\"params\":{\"result\":{\"context\":{\"slot\":5199307},\"value\":"
+    "{\"data\":[\"AAECAw==\",\"base64\"],\"executable\":false,"
+    "\"lamports\":33594,\"owner\":\"11111111111111111111111111111111\","
+    "\"rentEpoch\":635}},\"subscription\":7}}";
+  rpc_notify nt;
+  PC_TEST_CHECK( nt.scan( acc.c_str(), acc.size() ) );
+  PC_TEST_CHECK( nt.type_ == rpc_notify::e_account );
+  PC_TEST_CHECK( nt.sub_ == 7 && nt.slot_ == 5199307 );
+  PC_TEST_CHECK( nt.lamports_ == 33594 );
+  PC_TEST_CHECK( str( nt.dptr_, nt.dlen_ ) == "AAECAw==" );
+
+  std::string slot = "{\"jsonrpc\":\"2.0\",\"method\":\"slotNotification\","
+    "\"params\":{\"result\":{\"parent\":75,\"root\":44,\"slot\":76},"
+    "\"subscription\":0}}";
+  PC_TEST_CHECK( nt.scan( slot.c_str(), slot.size() ) );
+  PC_TEST_CHECK( nt.type_ == rpc_notify::e_slot );
+  PC_TEST_CHECK( nt.sub_ == 0 && nt.slot_ == 76 );
+
+  std::string sig = "{\"jsonrpc\":\"2.0\",\"method\":\"signatureNotification\","
+    "\"params\":{\"result\":{\"context\":{\"slot\":5207624},\"value\":"
+    "{\"err\":{\"a\":[1,\"}\"]}}},\"subscription\":24006}}";
+  PC_TEST_CHECK( nt.scan( sig.c_str(), sig.size() ) );
+  PC_TEST_CHECK( nt.type_ == rpc_notify::e_signature );
+  PC_TEST_CHECK( nt.sub_ == 24006 && nt.slot_ == 5207624 );
+
+  // anything unexpected is left to jtree
+  const char *bad[] = {
+    "{\"jsonrpc\":\"2.0\",\"result\":7,\"id\":1}",
+    "{\"jsonrpc\":\"2.0\",\"method\":\"rootNotification\","
+      "\"params\":{\"result\":4,\"subscription\":0}}",
+    "{\"jsonrpc\":\"2.0\",\"method\":\"accountNotification\","
+      "\"params\":{\"result\":{\"context\":{\"slot\":1},\"value\":null},"
+      "\"subscription\":7}}",
+    "{\"jsonrpc\":\"2.0\",\"method\":\"accountNotification\","
+      "\"params\":{\"result\":{\"context\":{\"slot\":1},\"value\":"
+      "{\"data\":[\"A\\\"B\",\"base64\"],\"lamports\":1}},\"subscription\":7}}",
+    "{\"jsonrpc\":\"2.0\",\"method\":\"slotNotification\","
+      "\"params\":{\"result\":{\"parent\":75 \"slot\":76},"
+      "\"subscription\":0}}",
+    "{\"jsonrpc\":\"2.0\",\"method\":\"slotNotification\","
+      "\"params\":{\"result\":{\"parent\":75,\"slot\":76},"
+      "\"subscription\":"
+  };
+  for( const char *txt: bad ) {
+    PC_TEST_CHECK( !nt.scan( txt, __builtin_strlen( txt ) ) );
+  }
+  for( size_t len = 0; len < acc.size(); len += 7 ) {
+    PC_TEST_CHECK( !nt.scan( acc.c_str(), len ) );
+  }
+
+  // subscription notified from scanned fields
+  int fd[2];
+  net_connect conn;
+  rpc_client clnt;
+  PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+  conn.set_fd( fd[0] );
+  conn.set_block( false );
+  clnt.set_ws_conn( &conn );
+  pub_key pk;
+  rpc::account_subscribe sub;
+  sub.set_account( &pk );
+  clnt.send( &sub );
+  std::string rsp = "{\"jsonrpc\":\"2.0\",\"result\":7,\"id\":" +
+    std::to_string( sub.get_id() ) + "}";
+  clnt.parse_response( rsp.c_str(), rsp.size() );
+  clnt.parse_response( acc.c_str(), acc.size() );
+  PC_TEST_CHECK( sub.get_slot() == 5199307 );
+  PC_TEST_CHECK( sub.get_lamports() == 33594 );
+  PC_TEST_CHECK( clnt.get_num_notify_fast() == 1 );
+  PC_TEST_CHECK( clnt.get_num_notify_slow() == 0 );
+  std::string slow = acc;
+  slow.insert( slow.find( "\"context\"" ), " " );
+  clnt.parse_response( slow.c_str(), slow.size() );
+  PC_TEST_CHECK( clnt.get_num_notify_fast() == 1 );
+  PC_TEST_CHECK( clnt.get_num_notify_slow() == 1 );
+  PC_TEST_CHECK( sub.get_slot() == 5199307 );
+
+  // signature notifications are scanned too and end the subscription
+  uint8_t sbuf[signature::len] = { 1 };
+  signature sg;
+  sg.init_from_buf( sbuf );
+  rpc::signature_subscribe ssub;
+  ssub.set_signature( &sg );
+  clnt.send( &ssub );
+  rsp = "{\"jsonrpc\":\"2.0\",\"result\":24006,\"id\":" +
+    std::to_string( ssub.get_id() ) + "}";
+  clnt.parse_response( rsp.c_str(), rsp.size() );
+  clnt.parse_response( sig.c_str(), sig.size() );
+  PC_TEST_CHECK( ssub.get_slot() == 5207624 );
+  PC_TEST_CHECK( clnt.get_num_notify_fast() == 2 );
+  PC_TEST_CHECK( clnt.get_num_notify_slow() == 1 );
+  clnt.parse_response( sig.c_str(), sig.size() );
+  PC_TEST_CHECK( clnt.get_num_notify_fast() == 2 );
+  PC_TEST_CHECK( clnt.get_num_notify_slow() == 1 );
+  conn.close();
+  ::close( fd[1] );
+}
+
+void test_program_accounts()
+{
+  int fd[2];
+  net_connect conn;
+  rpc_client clnt;
+  PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+  conn.set_fd( fd[0] );
+  conn.set_block( false );
+  clnt.set_http_conn( &conn );
+
+  // request filtered by account header
+  pub_key prog;
+  prog.init_from_text( str( "SysvarC1ock11111111111111111111111111111111" ) );
+  pc_acc_t hdr = { PC_MAGIC, PC_VERSION, PC_ACCTYPE_PRICE, 48 };
+  rpc::get_program_accounts req;
+  req.set_program( &prog );
+  req.add_filter( 0, &hdr, offsetof( pc_acc_t, size_ ) );
+  clnt.send( &req );
+  std::string msg = test_rpc_read( conn, fd[1] );
+  char b58[64];
+  int n = enc_base58( (const uint8_t*)&hdr, offsetof( pc_acc_t, size_ ),
+                      (uint8_t*)b58, sizeof( b58 ) );
+  std::string flt = "\"filters\":[{\"memcmp\":{\"offset\":0,\"bytes\":\"" +
+    std::string( b58, n ) + "\"}}]";
+  PC_TEST_CHECK( msg.find( "\"getProgramAccounts\"" ) != std::string::npos );
+  PC_TEST_CHECK( msg.find( "\"withContext\":true" ) != std::string::npos );
+  PC_TEST_CHECK( msg.find( flt ) != std::string::npos );
+
+  // accounts indexed by key
+  char b64[64];
+  n = enc_base64( (const uint8_t*)&hdr, sizeof( hdr ), (uint8_t*)b64 );
+  std::string acc = "{\"account\":{\"data\":[\"" + std::string( b64, n ) +
+    "\",\"base64\"],\"executable\":false,\"lamports\":LAM,"
+    "\"owner\":\"SysvarC1ock11111111111111111111111111111111\","
+    "\"rentEpoch\":0},\"pubkey\":\"KEY\"}";
+  std::string acc1 = acc, acc2 = acc;
+  acc1.replace( acc1.find( "LAM" ), 3, "17" );
+  acc1.replace( acc1.find( "KEY" ), 3, "11111111111111111111111111111111" );
+  acc2.replace( acc2.find( "LAM" ), 3, "23" );
+  acc2.replace( acc2.find( "KEY" ), 3,
+                "SysvarRent111111111111111111111111111111111" );
+  std::string rsp = "{\"jsonrpc\":\"2.0\",\"result\":{\"context\":"
+    "{\"slot\":4242},\"value\":[" + acc1 + "," + acc2 + "]},\"id\":" +
+    std::to_string( req.get_id() ) + "}";
+  clnt.parse_response( rsp.c_str(), rsp.size() );
+  PC_TEST_CHECK( !req.get_is_err() );
+  PC_TEST_CHECK( req.get_slot() == 4242 );
+  PC_TEST_CHECK( req.get_num_account() == 2 );
+  pub_key key;
+  key.init_from_text( str( "SysvarRent111111111111111111111111111111111" ) );
+  rpc::program_account *aptr = req.get_account( key );
+  PC_TEST_CHECK( aptr == req.get_account( 1 ) );
+  PC_TEST_CHECK( *aptr->get_account() == key );
+  PC_TEST_CHECK( aptr->get_lamports() == 23 && aptr->get_slot() == 4242 );
+  pc_acc_t *dptr;
+  aptr->get_data( dptr );
+  PC_TEST_CHECK( dptr->magic_ == PC_MAGIC );
+  PC_TEST_CHECK( dptr->type_ == PC_ACCTYPE_PRICE && dptr->size_ == 48 );
+  PC_TEST_CHECK( req.get_account( 0 )->get_lamports() == 17 );
+  PC_TEST_CHECK( req.get_account( prog ) == nullptr );
+  conn.close();
+  ::close( fd[1] );
+}
+
+// loopback listener standing in for an rpc node
+static int test_rpc_listen( int& port )
+{
+  int lfd = ::socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0 );
+  sockaddr_in addr;
+  socklen_t alen = sizeof( addr );
+  __builtin_memset( &addr, 0, sizeof( addr ) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  PC_TEST_CHECK( 0 == ::bind( lfd, (sockaddr*)&addr, alen ) );
+  PC_TEST_CHECK( 0 == ::listen( lfd, 1 ) );
+  PC_TEST_CHECK( 0 == ::getsockname( lfd, (sockaddr*)&addr, &alen ) );
+  port = ntohs( addr.sin_port );
+  return lfd;
+}
+
+static int test_rpc_accept( manager& mgr, int lfd )
+{
+  int fd = -1;
+  for( unsigned i=0; fd < 0 && i != 1000; ++i ) {
+    mgr.poll( false );
+    fd = ::accept( lfd, nullptr, nullptr );
+    ::usleep( 1000 );
+  }
+  PC_TEST_CHECK( fd >= 0 );
+  return fd;
+}
+
+// everything the manager sends to the rpc node while polling it
+static std::string test_rpc_recv( manager& mgr, int fd )
+{
+  std::string res;
+  char buf[16384];
+  for( unsigned i=0; i != 100; ++i ) {
+    mgr.poll( false );
+    ssize_t len = ::recv( fd, buf, sizeof( buf ), MSG_DONTWAIT );
+    if ( len > 0 ) {
+      res.append( buf, len );
+    } else if ( !res.empty() ) {
+      break;
+    }
+    ::usleep( 1000 );
+  }
+  return res;
+}
+
+// ids of the json rpc requests with given method in http requests
+static std::vector<uint64_t> test_rpc_ids( const std::string& msg,
+                                           const std::string& method )
+{
+  std::vector<uint64_t> res;
+  for( size_t pos = 0; ( pos = msg.find( "\r\n\r\n", pos ) ) !=
+       std::string::npos; ) {
+    size_t hpos = msg.rfind( "Content-Length: ", pos );
+    size_t len = std::stoul( msg.substr( hpos + 16 ) );
+    jtree jt;
+    jt.parse( &msg[pos+4], len );
+    if ( jt.get_str( jt.find_val( 1, "method" ) ) == str( method ) ) {
+      res.push_back( jt.get_uint( jt.find_val( 1, "id" ) ) );
+    }
+    pos += 4 + len;
+  }
+  return res;
+}
+
+static void test_rpc_send( int fd, const std::string& body )
+{
+  std::string msg = "HTTP/1.1 200 OK\r\nContent-Length: " +
+    std::to_string( body.size() ) + "\r\n\r\n" + body;
+  PC_TEST_CHECK( (ssize_t)msg.size() ==
+                 ::send( fd, msg.c_str(), msg.size(), 0 ) );
+}
+
+static std::string test_snapshot_reply( uint64_t id, const pub_key& key,
+                                        const void *buf, size_t len )
+{
+  std::string b64( enc_base64_len( len ), '\0' );
+  b64.resize( enc_base64( (const uint8_t*)buf, len, (uint8_t*)&b64[0] ) );
+  std::string acc;
+  key.enc_base58( acc );
+  return "{\"jsonrpc\":\"2.0\",\"result\":{\"context\":{\"slot\":76},"
+    "\"value\":[{\"account\":{\"data\":[\"" + b64 + "\",\"base64\"],"
+    "\"executable\":false,\"lamports\":1,"
+    "\"owner\":\"11111111111111111111111111111111\",\"rentEpoch\":0},"
+    "\"pubkey\":\"" + acc + "\"}]},\"id\":" + std::to_string( id ) + "}";
+}
+
+void test_snapshot_walk()
+{
+  char tmpl[] = "/tmp/pc_snapshot_XXXXXX";
+  PC_TEST_CHECK( ::mkdtemp( tmpl ) );
+  std::string dir = tmpl + std::string( "/" );
+  int hport, wport;
+  int hlfd = test_rpc_listen( hport );
+  int wlfd = test_rpc_listen( wport );
+  manager mgr;
+  mgr.set_dir( dir );
+  PC_TEST_CHECK( mgr.create_program_key_pair() );
+  PC_TEST_CHECK( mgr.create_mapping_key_pair() );
+  mgr.set_rpc_host( "127.0.0.1:" + std::to_string( hport ) + ":" +
+                    std::to_string( wport ) );
+  mgr.set_do_snapshot( true );
+  PC_TEST_CHECK( mgr.init() );
+  int hfd = test_rpc_accept( mgr, hlfd );
+  int wfd = test_rpc_accept( mgr, wlfd );
+  std::string msg = test_rpc_recv( mgr, wfd );
+  PC_TEST_CHECK( msg.find( "Upgrade: websocket" ) != std::string::npos );
+  msg = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n\r\n";
+  PC_TEST_CHECK( (ssize_t)msg.size() ==
+                 ::send( wfd, msg.c_str(), msg.size(), 0 ) );
+  std::string sub = test_ws_unmask( test_rpc_recv( mgr, wfd ) );
+  PC_TEST_CHECK( mgr.has_status( PC_PYTH_RPC_CONNECTED ) );
+  PC_TEST_CHECK( sub.find( "\"slotSubscribe\"" ) != std::string::npos );
+  std::vector<uint64_t> gid = test_rpc_ids(
+      test_rpc_recv( mgr, hfd ), "getProgramAccounts" );
+  PC_TEST_CHECK( gid.size() == 3 );
+
+  // snapshot of one mapping, product and price account arrives before
+  // the first block hash
+  pub_key prod, px;
+  prod.init_from_text( str( "9xQeWvG816bUx9EPjHmaT23yvVM2ZWbrrpZb9PusVFin" ) );
+  px.init_from_text( str( "SysvarRent111111111111111111111111111111111" ) );
+  pc_map_table_t mtab[1];
+  __builtin_memset( mtab, 0, sizeof( mtab ) );
+  mtab->magic_ = PC_MAGIC;
+  mtab->ver_ = PC_VERSION;
+  mtab->type_ = PC_ACCTYPE_MAPPING;
+  mtab->size_ = sizeof( pc_map_table_t );
+  mtab->num_ = 1;
+  pc_pub_key_assign( &mtab->prod_[0], (pc_pub_key_t*)prod.data() );
+  pc_prod_t ptab[1];
+  __builtin_memset( ptab, 0, sizeof( ptab ) );
+  ptab->magic_ = PC_MAGIC;
+  ptab->ver_ = PC_VERSION;
+  ptab->type_ = PC_ACCTYPE_PRODUCT;
+  ptab->size_ = sizeof( pc_prod_t );
+  pc_pub_key_assign( &ptab->px_acc_, (pc_pub_key_t*)px.data() );
+  pc_price_t xtab[1];
+  __builtin_memset( xtab, 0, sizeof( xtab ) );
+  xtab->magic_ = PC_MAGIC;
+  xtab->ver_ = PC_VERSION;
+  xtab->type_ = PC_ACCTYPE_PRICE;
+  xtab->size_ = sizeof( pc_price_t );
+  pc_pub_key_assign( &xtab->prod_, (pc_pub_key_t*)prod.data() );
+  test_rpc_send( hfd, test_snapshot_reply(
+        gid[0], *mgr.get_mapping_pub_key(), mtab, sizeof( mtab ) ) );
+  test_rpc_send( hfd, test_snapshot_reply(
+        gid[1], prod, ptab, sizeof( ptab ) ) );
+  test_rpc_send( hfd, test_snapshot_reply(
+        gid[2], px, xtab, sizeof( xtab ) ) );
+  PC_TEST_CHECK( test_rpc_recv( mgr, hfd ).empty() );
+  PC_TEST_CHECK( mgr.get_num_product() == 0 );
+
+  // first slot fetches the block hash
+  jtree jt;
+  jt.parse( sub.c_str(), sub.size() );
+  std::string frm;
+  test_ws_frame( frm, ws_wtr::text_id, true,
+      "{\"jsonrpc\":\"2.0\",\"result\":0,\"id\":" +
+      std::to_string( jt.get_uint( jt.find_val( 1, "id" ) ) ) + "}", false );
+  test_ws_frame( frm, ws_wtr::text_id, true,
+      "{\"jsonrpc\":\"2.0\",\"method\":\"slotNotification\","
+      "\"params\":{\"result\":{\"parent\":76,\"root\":44,\"slot\":77},"
+      "\"subscription\":0}}", false );
+  PC_TEST_CHECK( (ssize_t)frm.size() ==
+                 ::send( wfd, frm.c_str(), frm.size(), 0 ) );
+  std::vector<uint64_t> bid = test_rpc_ids(
+      test_rpc_recv( mgr, hfd ), "getRecentBlockhash" );
+  PC_TEST_CHECK( bid.size() == 1 );
+  test_rpc_send( hfd, "{\"jsonrpc\":\"2.0\",\"result\":{\"context\":"
+      "{\"slot\":77},\"value\":{\"blockhash\":"
+      "\"11111111111111111111111111111111\",\"feeCalculator\":"
+      "{\"lamportsPerSignature\":5000}}},\"id\":" +
+      std::to_string( bid[0] ) + "}" );
+
+  // mapping graph is walked from the snapshot without fetching any of
+  // its accounts
+  msg = test_rpc_recv( mgr, hfd );
+  PC_TEST_CHECK( mgr.has_status( PC_PYTH_HAS_BLOCK_HASH ) );
+  PC_TEST_CHECK( test_rpc_ids( msg, "getAccountInfo" ).empty() );
+  PC_TEST_CHECK( mgr.get_num_product() == 1 );
+  PC_TEST_CHECK( mgr.get_product( prod ) != nullptr );
+  PC_TEST_CHECK( mgr.get_price( px ) != nullptr );
+  PC_TEST_CHECK( !mgr.get_is_err() );
+
+  // and released once walked
+  PC_TEST_CHECK( mgr.get_program_account( px ) == nullptr );
+  mgr.teardown();
+  ::close( hfd );
+  ::close( wfd );
+  ::close( hlfd );
+  ::close( wlfd );
+  ::unlink( ( dir + "program_key_pair.json" ).c_str() );
+  ::unlink( ( dir + "mapping_key_pair.json" ).c_str() );
+  ::rmdir( tmpl );
+}
+
+void test_rpc_hedge()
+{
+  // hedge hosts beyond PC_RPC_MAX_HEDGE are ignored
+  manager mgr;
+  PC_TEST_CHECK( mgr.get_num_rpc_endpoint() == 1 );
+  for( unsigned i=0; i != 1+PC_RPC_MAX_HEDGE; ++i ) {
+    mgr.add_rpc_hedge_host( "host" + std::to_string( i ) );
+  }
+  PC_TEST_CHECK( mgr.get_num_rpc_hedge() == PC_RPC_MAX_HEDGE );
+  PC_TEST_CHECK( mgr.get_num_rpc_endpoint() == 1+PC_RPC_MAX_HEDGE );
+  PC_TEST_CHECK( mgr.get_rpc_hedge_host( 1 ) == "host1" );
+
+  // first arrivals and late copies are counted by rpc node
+  mgr.add_rpc_first( 0 );
+  mgr.add_rpc_first( 0 );
+  mgr.add_rpc_first( 2 );
+  mgr.add_rpc_late( 2, 100 );
+  mgr.add_rpc_late( 2, 300 );
+  mgr.add_rpc_late( 0, 50 );
+  mgr.add_rpc_late( 0 );
+  rpc_endpoint_stats st;
+  mgr.get_rpc_endpoint_stats( 0, st );
+  PC_TEST_CHECK( st.num_first_ == 2 && st.num_late_ == 2 );
+  PC_TEST_CHECK( st.lag_avg_ == 50 && st.lag_max_ == 50 );
+  mgr.get_rpc_endpoint_stats( 1, st );
+  PC_TEST_CHECK( st.num_first_ == 0 && st.num_late_ == 0 );
+  PC_TEST_CHECK( st.lag_avg_ == 0 && st.lag_max_ == 0 );
+  mgr.get_rpc_endpoint_stats( 2, st );
+  PC_TEST_CHECK( st.num_first_ == 1 && st.num_late_ == 2 );
+  PC_TEST_CHECK( st.lag_avg_ == 200 && st.lag_max_ == 300 );
+}
+
+class test_price_sub : public request_sub,
+                       public request_sub_i<price>
+{
+public:
+  test_price_sub() : num_( 0 ) {}
+  void on_response( price *, uint64_t ) override { ++num_; }
+  unsigned num_;
+};
+
+static void test_price_account( rpc_client& clnt, uint64_t sub,
+                                uint64_t slot, uint64_t valid_slot,
+                                int64_t px )
+{
+  pc_price_t acc;
+  __builtin_memset( &acc, 0, sizeof( acc ) );
+  acc.magic_ = PC_MAGIC;
+  acc.ver_   = PC_VERSION;
+  acc.type_  = PC_ACCTYPE_PRICE;
+  acc.size_  = sizeof( acc );
+  acc.valid_slot_  = valid_slot;
+  acc.agg_.price_  = px;
+  acc.agg_.status_ = PC_STATUS_TRADING;
+  std::vector<char> b64( enc_base64_len( sizeof( acc ) ) );
+  int n = enc_base64( (const uint8_t*)&acc, sizeof( acc ),
+                      (uint8_t*)b64.data() );
+  std::string msg = "{\"jsonrpc\":\"2.0\",\"method\":"
+    "\"accountNotification\",\"params\":{\"result\":{\"context\":"
+    "{\"slot\":" + std::to_string( slot ) + "},\"value\":{\"data\":[\"" +
+    std::string( b64.data(), n ) + "\",\"base64\"],\"executable\":false,"
+    "\"lamports\":1,\"owner\":\"11111111111111111111111111111111\","
+    "\"rentEpoch\":0}},\"subscription\":" + std::to_string( sub ) + "}}";
+  clnt.parse_response( msg.c_str(), msg.size() );
+}
+
+void test_rpc_dedupe()
+{
+  char tmpl[] = "/tmp/pc_dedupe_XXXXXX";
+  PC_TEST_CHECK( ::mkdtemp( tmpl ) );
+  std::string dir = tmpl;
+  std::string cap = dir + "/cap.gz";
+  pub_key acc;
+  acc.init_from_text( str( "9xQeWvG816bUx9EPjHmaT23yvVM2ZWbrrpZb9PusVFin" ) );
+  {
+    manager mgr;
+    mgr.set_dir( dir );
+    mgr.set_rpc_host( "127.0.0.1:1" );
+    mgr.set_capture_file( cap );
+    mgr.set_do_capture( true );
+    PC_TEST_CHECK( mgr.init() );
+
+    // same price subscribed on the primary and one hedge rpc node
+    product prod( acc );
+    price px( acc, &prod );
+    px.set_manager( &mgr );
+    test_price_sub sub;
+    request_sub_set sset( &sub );
+    sset.add( &px );
+    int fd[2][2];
+    net_connect conn[2];
+    rpc_client clnt[2];
+    for( unsigned i=0; i != 2; ++i ) {
+      PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd[i] ) );
+      conn[i].set_fd( fd[i][0] );
+      conn[i].set_block( false );
+      clnt[i].set_ws_conn( &conn[i] );
+      px.subscribe_hedge( i, &clnt[i] );
+      std::string pay = test_ws_read( conn[i], fd[i][1] );
+      jtree jt;
+      jt.parse( pay.c_str(), pay.size() );
+      std::string rsp = "{\"jsonrpc\":\"2.0\",\"result\":" +
+        std::to_string( 10 + i ) + ",\"id\":" +
+        std::to_string( jt.get_uint( jt.find_val( 1, "id" ) ) ) + "}";
+      clnt[i].parse_response( rsp.c_str(), rsp.size() );
+    }
+
+    // first copy of each slot wins and copies from the other node are
+    // dropped whichever node is ahead
+    test_price_account( clnt[0], 10, 100, 99, 1000 );
+    PC_TEST_CHECK( px.get_price() == 1000 && sub.num_ == 1 );
+    test_price_account( clnt[1], 11, 100, 99, 1000 );
+    test_price_account( clnt[1], 11, 101, 100, 2000 );
+    PC_TEST_CHECK( px.get_price() == 2000 && sub.num_ == 2 );
+    test_price_account( clnt[0], 10, 101, 100, 2000 );
+    PC_TEST_CHECK( px.get_valid_slot() == 100 && sub.num_ == 2 );
+
+    // out of order slot is late but has no arrival to measure lag from
+    ::usleep( 20000 );
+    test_price_account( clnt[0], 10, 100, 99, 1000 );
+    PC_TEST_CHECK( px.get_price() == 2000 && sub.num_ == 2 );
+    rpc_endpoint_stats st;
+    mgr.get_rpc_endpoint_stats( 0, st );
+    PC_TEST_CHECK( st.num_first_ == 1 && st.num_late_ == 2 );
+    PC_TEST_CHECK( st.lag_max_ < 20*PC_NSECS_IN_MSEC );
+    mgr.get_rpc_endpoint_stats( 1, st );
+    PC_TEST_CHECK( st.num_first_ == 1 && st.num_late_ == 1 );
+    PC_TEST_CHECK( st.lag_max_ < 20*PC_NSECS_IN_MSEC );
+
+    // repeats are only taken from the node that won the slot or when
+    // they carry a newer aggregate
+    test_price_account( clnt[1], 11, 101, 100, 2000 );
+    test_price_account( clnt[0], 10, 101, 100, 2000 );
+    PC_TEST_CHECK( sub.num_ == 2 );
+    test_price_account( clnt[0], 10, 101, 101, 3000 );
+    PC_TEST_CHECK( px.get_price() == 3000 && sub.num_ == 3 );
+    mgr.get_rpc_endpoint_stats( 0, st );
+    PC_TEST_CHECK( st.num_first_ == 1 && st.num_late_ == 3 );
+    mgr.get_rpc_endpoint_stats( 1, st );
+    PC_TEST_CHECK( st.num_first_ == 1 && st.num_late_ == 1 );
+    for( unsigned i=0; i != 2; ++i ) {
+      conn[i].close();
+      ::close( fd[i][1] );
+    }
+  }
+
+  // each aggregate captured once
+  replay rep;
+  rep.set_file( cap );
+  PC_TEST_CHECK( rep.init() );
+  std::vector<int64_t> cpx;
+  while( rep.get_next() ) {
+    PC_TEST_CHECK( *(pub_key*)rep.get_account() == acc );
+    cpx.push_back( ((pc_price_t*)rep.get_update())->agg_.price_ );
+  }
+  PC_TEST_CHECK( cpx == std::vector<int64_t>( { 1000, 2000, 3000 } ) );
+  ::unlink( cap.c_str() );
+  ::rmdir( dir.c_str() );
+}
+
+static void test_web_write( const std::string& file, const std::string& txt )
+{
+  int fd = ::open( file.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644 );
+  PC_TEST_CHECK( fd >= 0 );
+  PC_TEST_CHECK( (ssize_t)txt.size() == ::write( fd, txt.c_str(), txt.size() ) );
+  ::close( fd );
+}
+
+static std::string test_web_resp( const web_resp *rptr )
+{
+  return std::string( rptr->data(), rptr->size() );
+}
+
+static void test_web_reload( net_loop& nl, web_cache& wc, uint64_t num )
+{
+  int64_t ts = get_now() + PC_NSECS_IN_SEC;
+  while( wc.get_num_reload() < num && get_now() < ts ) {
+    nl.poll( 10 );
+  }
+  PC_TEST_CHECK( wc.get_num_reload() == num );
+}
+
+void test_web_cache()
+{
+  char tmpl[] = "/tmp/pc_web_XXXXXX";
+  PC_TEST_CHECK( ::mkdtemp( tmpl ) );
+  std::string dir = tmpl;
+  std::string page( "<html>" );
+  for( unsigned i=0; i != 100; ++i ) {
+    page += "<p>pyth</p>";
+  }
+  page += "</html>";
+  std::string big( 20000, 'b' );
+  PC_TEST_CHECK( 0 == ::mkdir( ( dir + "/js" ).c_str(), 0755 ) );
+  test_web_write( dir + "/index.html", page );
+  test_web_write( dir + "/js/app.js", "var x=1;" );
+  test_web_write( dir + "/big.bin", big );
+
+  // no content directory serves nothing
+  web_cache wc;
+  PC_TEST_CHECK( wc.init() );
+  PC_TEST_CHECK( wc.get_content()->get_num_file() == 0 );
+  PC_TEST_CHECK( wc.get_content()->get( "/", "", "" )->size() > 0 );
+
+  wc.set_dir( dir );
+  wc.set_file_min( 10000 );
+  PC_TEST_CHECK( wc.init() );
+  web_content_ptr cptr = wc.get_content();
+  PC_TEST_CHECK( cptr->get_num_file() == 3 );
+  PC_TEST_CHECK( cptr->get_num_bytes() == page.size() + 8 + big.size() );
+
+  // directories map to index page and query strings are ignored
+  const web_file *fptr = cptr->get_file( "/index.html" );
+  PC_TEST_CHECK( fptr != nullptr );
+  PC_TEST_CHECK( cptr->get( "/", str(), str() ) == &fptr->raw_ );
+  PC_TEST_CHECK( cptr->get( "/index.html?a=1", str(), str() ) ==
+                 &fptr->raw_ );
+  std::string resp = test_web_resp( &fptr->raw_ );
+  PC_TEST_CHECK( resp.find( "HTTP/1.1 200 OK\r\n" ) == 0 );
+  PC_TEST_CHECK( resp.find( "Content-Type: text/html\r\n" ) !=
+                 std::string::npos );
+  PC_TEST_CHECK( resp.find( "\r\n\r\n" + page ) + 4 + page.size() ==
+                 resp.size() );
+
+  // compressed variant for clients accepting gzip
+  PC_TEST_CHECK( fptr->gz_.size() < fptr->raw_.size() );
+  PC_TEST_CHECK( cptr->get( "/", "gzip, deflate", str() ) == &fptr->gz_ );
+  resp = test_web_resp( &fptr->gz_ );
+  PC_TEST_CHECK( resp.find( "Content-Encoding: gzip\r\n" ) !=
+                 std::string::npos );
+
+  // matching entity tag is not modified
+  PC_TEST_CHECK( cptr->get( "/", "gzip", fptr->etag_ ) == &fptr->nm_ );
+  PC_TEST_CHECK( cptr->get( "/", str(), "\"0\"" ) == &fptr->raw_ );
+  resp = test_web_resp( &fptr->nm_ );
+  PC_TEST_CHECK( resp == "HTTP/1.1 304 Not Modified\r\nETag: " +
+    fptr->etag_ + "\r\nCache-Control: no-cache\r\n\r\n" );
+
+  // small scripts are not compressed and unknown paths are not found
+  const web_file *jptr = cptr->get_file( "/js/app.js" );
+  PC_TEST_CHECK( jptr != nullptr && jptr->gz_.size() == 0 );
+  PC_TEST_CHECK( jptr->raw_.get_fd() < 0 );
+  PC_TEST_CHECK( cptr->get( "/js/app.js", "gzip", str() ) == &jptr->raw_ );
+  resp = test_web_resp( cptr->get( "/../etc/passwd", str(), str() ) );
+  PC_TEST_CHECK( resp.find( "HTTP/1.1 404 Not Found\r\n" ) == 0 );
+
+  // large responses live in a memory file sent with sendfile
+  const web_file *bptr = cptr->get_file( "/big.bin" );
+  PC_TEST_CHECK( bptr != nullptr && bptr->raw_.get_fd() >= 0 );
+  {
+    int fd[2];
+    PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+    net_connect conn;
+    conn.set_fd( fd[0] );
+    conn.set_block( false );
+    const web_resp *rptr = &bptr->raw_;
+    conn.add_send_file( rptr->get_fd(), rptr->data(), rptr->size() );
+    conn.add_send_file( rptr->get_fd(), rptr->data(), rptr->size() );
+    PC_TEST_CHECK( conn.get_num_send_file() >= rptr->size() );
+    std::string rcv;
+    char buf[4096];
+    while( rcv.size() != 2 * rptr->size() ) {
+      conn.poll_send();
+      ssize_t rc = ::recv( fd[1], buf, sizeof( buf ), MSG_DONTWAIT );
+      if ( rc > 0 ) {
+        rcv.append( buf, rc );
+      }
+    }
+    PC_TEST_CHECK( rcv == test_web_resp( rptr ) + test_web_resp( rptr ) );
+    PC_TEST_CHECK( conn.get_send_queue() == 0 );
+    conn.close();
+    ::close( fd[1] );
+  }
+
+  // changes to the tree publish a new snapshot after the debounce
+  // period without blocking the loop
+  net_loop nl;
+  PC_TEST_CHECK( nl.init() );
+  wc.set_net_loop( &nl );
+  wc.set_debounce( 20*PC_NSECS_IN_MSEC );
+  PC_TEST_CHECK( wc.init() );
+  uint64_t nrld = wc.get_num_reload();
+  cptr = wc.get_content();
+  jptr = cptr->get_file( "/js/app.js" );
+  test_web_write( dir + "/js/app.js", "var x=2;" );
+  test_web_reload( nl, wc, nrld + 1 );
+  web_content_ptr nptr = wc.get_content();
+  PC_TEST_CHECK( nptr != cptr );
+  const web_file *nfptr = nptr->get_file( "/js/app.js" );
+  PC_TEST_CHECK( nfptr && nfptr->etag_ != jptr->etag_ );
+  PC_TEST_CHECK( test_web_resp( &jptr->raw_ ).find( "x=1" ) !=
+                 std::string::npos );
+
+  // a burst of changes is a single reload
+  for( unsigned i=0; i != 10; ++i ) {
+    test_web_write( dir + "/js/app.js", "var x=" + std::to_string(i) + ";" );
+  }
+  ::unlink( ( dir + "/big.bin" ).c_str() );
+  test_web_reload( nl, wc, nrld + 2 );
+  int64_t ts = get_now() + 5*wc.get_debounce();
+  while( get_now() < ts ) {
+    nl.poll( 10 );
+  }
+  PC_TEST_CHECK( wc.get_num_reload() == nrld + 2 );
+  PC_TEST_CHECK( wc.get_content()->get_num_file() == 2 );
+
+  // new directories are watched
+  PC_TEST_CHECK( 0 == ::mkdir( ( dir + "/css" ).c_str(), 0755 ) );
+  test_web_reload( nl, wc, nrld + 3 );
+  test_web_write( dir + "/css/app.css", "p{}" );
+  test_web_reload( nl, wc, nrld + 4 );
+  PC_TEST_CHECK( wc.get_content()->get_file( "/css/app.css" ) != nullptr );
+  wc.teardown();
+
+  ::unlink( ( dir + "/css/app.css" ).c_str() );
+  ::rmdir( ( dir + "/css" ).c_str() );
+  ::unlink( ( dir + "/js/app.js" ).c_str() );
+  ::unlink( ( dir + "/index.html" ).c_str() );
+  ::rmdir( ( dir + "/js" ).c_str() );
+  ::rmdir( dir.c_str() );
+}
+
+// read whole frames (or http response) available on socket
+static std::string test_user_recv( user& usr, int fd )
+{
+  usr.poll_send();
+  std::string rcv;
+  char buf[4096];
+  ssize_t rc;
+  while( 0 < ( rc = ::recv( fd, buf, sizeof( buf ), MSG_DONTWAIT ) ) ) {
+    rcv.append( buf, rc );
+  }
+  return rcv;
+}
+
+template<class T>
+static void test_bin_add( std::string& pay, T& msg, uint16_t type,
+                          uint32_t id )
+{
+  msg.hdr_.type_ = type;
+  msg.hdr_.size_ = sizeof( T );
+  msg.hdr_.id_   = id;
+  pay.append( (const char*)&msg, sizeof( T ) );
+}
+
+void test_user_bin()
+{
+  int fd[2];
+  PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+  manager mgr;
+  user usr;
+  usr.set_manager( &mgr );
+  usr.set_fd( fd[0] );
+  usr.set_block( false );
+
+  // binary protocol is selected from the offered sub-protocols
+  std::string req = "GET / HTTP/1.1\r\n"
+    "Connection: Upgrade\r\nUpgrade: websocket\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Protocol: chat, " PC_BIN_PROTOCOL "\r\n\r\n";
+  PC_TEST_CHECK( (ssize_t)req.size() ==
+                 ::send( fd[1], req.c_str(), req.size(), 0 ) );
+  usr.poll_recv();
+  PC_TEST_CHECK( usr.get_is_bin_protocol() );
+  std::string rsp = test_user_recv( usr, fd[1] );
+  PC_TEST_CHECK( rsp.find( "HTTP/1.1 101 " ) == 0 );
+  PC_TEST_CHECK( rsp.find( "Sec-WebSocket-Protocol: " PC_BIN_PROTOCOL
+                           "\r\n" ) != std::string::npos );
+
+  // several requests per frame are acknowledged in one binary frame
+  std::string pay;
+  bin_get_handle hreq;
+  __builtin_memset( &hreq, 0, sizeof( hreq ) );
+  test_bin_add( pay, hreq, bin_msg::e_get_handle, 1 );
+  bin_update_price ureq;
+  __builtin_memset( &ureq, 0, sizeof( ureq ) );
+  ureq.handle_ = 5;
+  test_bin_add( pay, ureq, bin_msg::e_update_price, 2 );
+  test_bin_add( pay, ureq, 99, 3 );
+  test_bin_add( pay, ureq, bin_msg::e_subscribe_price, 4 );
+  std::string frm;
+  test_ws_frame( frm, ws_wtr::binary_id, true, pay, true );
+  PC_TEST_CHECK( (ssize_t)frm.size() ==
+                 ::send( fd[1], frm.c_str(), frm.size(), 0 ) );
+  usr.poll_recv();
+  rsp = test_user_recv( usr, fd[1] );
+  PC_TEST_CHECK( rsp.size() == 2 + 4*sizeof( bin_ack ) );
+  PC_TEST_CHECK( (uint8_t)rsp[0] == 0x82 );
+  PC_TEST_CHECK( (uint8_t)rsp[1] == 4*sizeof( bin_ack ) );
+  bin_ack ack[4];
+  __builtin_memcpy( ack, &rsp[2], sizeof( ack ) );
+  int err[4] = { -32000, -32000, -32601, -32602 };
+  for( unsigned i=0; i != 4; ++i ) {
+    PC_TEST_CHECK( ack[i].hdr_.type_ == bin_msg::e_ack );
+    PC_TEST_CHECK( ack[i].hdr_.size_ == sizeof( bin_ack ) );
+    PC_TEST_CHECK( ack[i].hdr_.id_ == i + 1 );
+    PC_TEST_CHECK( ack[i].err_ == err[i] );
+  }
+  PC_TEST_CHECK( ack[1].handle_ == 5 );
+
+  // truncated message is a parse error
+  frm.clear();
+  test_ws_frame( frm, ws_wtr::binary_id, true, pay.substr( 0, 20 ), true );
+  PC_TEST_CHECK( (ssize_t)frm.size() ==
+                 ::send( fd[1], frm.c_str(), frm.size(), 0 ) );
+  usr.poll_recv();
+  rsp = test_user_recv( usr, fd[1] );
+  PC_TEST_CHECK( rsp.size() == 2 + sizeof( bin_ack ) );
+  __builtin_memcpy( ack, &rsp[2], sizeof( bin_ack ) );
+  PC_TEST_CHECK( ack[0].err_ == -32700 && ack[0].hdr_.id_ == 1 );
+
+  // text frames remain json-rpc
+  frm.clear();
+  test_ws_frame( frm, ws_wtr::text_id, true,
+      "{\"jsonrpc\":\"2.0\",\"method\":\"get_product_list\",\"id\":7}", true );
+  PC_TEST_CHECK( (ssize_t)frm.size() ==
+                 ::send( fd[1], frm.c_str(), frm.size(), 0 ) );
+  usr.poll_recv();
+  rsp = test_user_recv( usr, fd[1] );
+  PC_TEST_CHECK( (uint8_t)rsp[0] == 0x81 );
+  PC_TEST_CHECK( rsp.find( "\"result\":[]" ) != std::string::npos );
+  usr.set_manager( nullptr );
+  usr.teardown();
+  ::close( fd[1] );
+}
+
+static std::string test_wtr_str( net_wtr& msg )
+{
+  std::string res;
+  net_buf *hd, *tl;
+  msg.detach( hd, tl );
+  while( hd ) {
+    net_buf *nxt = hd->next_;
+    res.append( hd->buf_, hd->size_ );
+    hd->dealloc();
+    hd = nxt;
+  }
+  msg.reset();
+  return res;
+}
+
+class test_worker_sub : public net_wakeup_sub
+{
+public:
+  test_worker_sub() : wptr_( nullptr ), num_( 0 ) {}
+  void on_wakeup() override {
+    // as the manager: process requests then hand back responses
+    wptr_->poll_recv();
+    wptr_->flush();
+    ++num_;
+  }
+  user_worker *wptr_;
+  unsigned     num_;
+};
+
+static std::string test_worker_recv( net_loop& nl, int fd, str txt )
+{
+  // drive manager loop until worker delivers txt to client
+  std::string rcv;
+  char buf[4096];
+  int64_t ts = get_now() + PC_NSECS_IN_SEC;
+  while( rcv.find( txt.str_, 0, txt.len_ ) == std::string::npos &&
+         get_now() < ts ) {
+    nl.poll( 1 );
+    ssize_t rc = ::recv( fd, buf, sizeof( buf ), MSG_DONTWAIT );
+    if ( rc > 0 ) {
+      rcv.append( buf, rc );
+    }
+  }
+  return rcv;
+}
+
+void test_user_worker( bool use_uring )
+{
+  // manager side loop woken up by worker
+  manager mgr;
+  net_loop nl;
+  PC_TEST_CHECK( nl.init() );
+  test_worker_sub sub;
+  net_wakeup mwk;
+  mwk.set_net_loop( &nl );
+  mwk.set_sub( &sub );
+  PC_TEST_CHECK( mwk.init() );
+  user_worker wrk;
+  wrk.set_use_uring( use_uring );
+  PC_TEST_CHECK( wrk.init( &mwk ) );
+  sub.wptr_ = &wrk;
+
+  // user connection runs in the worker thread
+  int fd[2];
+  PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd ) );
+  user *usr = new user;
+  usr->set_manager( &mgr );
+  usr->set_fd( fd[0] );
+  usr->set_block( false );
+  usr->set_user_worker( &wrk );
+  wrk.add_user( usr );
+  wrk.flush();
+  PC_TEST_CHECK( wrk.get_num_user() == 1 );
+  std::string req = "GET / HTTP/1.1\r\n"
+    "Connection: Upgrade\r\nUpgrade: websocket\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n";
+  PC_TEST_CHECK( (ssize_t)req.size() ==
+                 ::send( fd[1], req.c_str(), req.size(), 0 ) );
+  std::string rsp = test_worker_recv( nl, fd[1], "\r\n\r\n" );
+  PC_TEST_CHECK( rsp.find( "HTTP/1.1 101 " ) == 0 );
+
+  // requests are queued to the manager and responses back to the
+  // worker in order
+  std::string frm;
+  for( unsigned i=0; i != 3; ++i ) {
+    test_ws_frame( frm, ws_wtr::text_id, true,
+        "{\"jsonrpc\":\"2.0\",\"method\":\"get_product_list\",\"id\":" +
+        std::to_string( 7 + i ) + "}", true );
+  }
+  PC_TEST_CHECK( (ssize_t)frm.size() ==
+                 ::send( fd[1], frm.c_str(), frm.size(), 0 ) );
+  rsp = test_worker_recv( nl, fd[1], "\"id\":9}" );
+  size_t p7 = rsp.find( "\"result\":[],\"id\":7}" );
+  size_t p8 = rsp.find( "\"result\":[],\"id\":8}" );
+  size_t p9 = rsp.find( "\"result\":[],\"id\":9}" );
+  PC_TEST_CHECK( p7 != std::string::npos );
+  PC_TEST_CHECK( p7 < p8 && p8 < p9 && p9 != std::string::npos );
+  PC_TEST_CHECK( sub.num_ > 0 );
+
+  // deleted user is released by the worker
+  wrk.del_user( usr );
+  wrk.flush();
+  PC_TEST_CHECK( wrk.get_num_user() == 0 );
+  wrk.teardown();
+  PC_TEST_CHECK( !wrk.get_is_run() );
+  ::close( fd[1] );
+  mwk.close();
+}
+
+void test_price_notify()
+{
+  key_pair kp;
+  kp.gen();
+  pub_key acc( kp );
+  price px( acc, nullptr );
+  px.set_price( 1234500 );
+  px.set_conf( 100 );
+  px.set_symbol_status( symbol_status::e_trading );
+
+  // payload is built once and only the subscription id differs
+  price_notify pn;
+  net_wtr msg;
+  std::string txt = "{\"jsonrpc\":\"2.0\",\"method\":\"notify_price\","
+    "\"params\":{\"result\":{\"price\":1234500,\"conf\":100,"
+    "\"status\":\"trading\",\"valid_slot\":0,\"pub_slot\":0},"
+    "\"subscription\":";
+  pn.add( msg, &px, 7 );
+  PC_TEST_CHECK( test_wtr_str( msg ) == txt + "7}}" );
+  pn.add( msg, &px, 0 );
+  PC_TEST_CHECK( test_wtr_str( msg ) == txt + "0}}" );
+  pn.add( msg, &px, 18446744073709551615UL );
+  PC_TEST_CHECK( test_wtr_str( msg ) == txt + "18446744073709551615}}" );
+  PC_TEST_CHECK( pn.get_num_build() == 1 );
+
+  // new aggregate is serialized again
+  px.set_price( -5 );
+  pn.add( msg, &px, 7 );
+  PC_TEST_CHECK( test_wtr_str( msg ).find(
+        "\"price\":-5,\"conf\":100" ) != std::string::npos );
+  PC_TEST_CHECK( pn.get_num_build() == 2 );
+
+  // all subscribed users of one update share the manager's payload
+  manager mgr;
+  user usr[3];
+  int fd[3][2];
+  for( unsigned i=0; i != 3; ++i ) {
+    PC_TEST_CHECK( 0 == ::socketpair( AF_UNIX, SOCK_STREAM, 0, fd[i] ) );
+    usr[i].set_manager( &mgr );
+    usr[i].set_fd( fd[i][0] );
+    usr[i].set_block( false );
+    usr[i].on_response( &px, i + 1 );
+    std::string rsp = test_user_recv( usr[i], fd[i][1] );
+    PC_TEST_CHECK( rsp.find( "\"price\":-5," ) != std::string::npos );
+    PC_TEST_CHECK( rsp.size() > 3 && rsp.compare( rsp.size() - 3, 3,
+          std::to_string( i + 1 ) + "}}" ) == 0 );
+  }
+  PC_TEST_CHECK( mgr.get_price_notify().get_num_build() == 1 );
+  for( unsigned i=0; i != 3; ++i ) {
+    usr[i].set_manager( nullptr );
+    usr[i].teardown();
+    ::close( fd[i][1] );
+  }
 }
 
 int main(int,char**)
 {
   PC_TEST_START
   test_net_buf();
+  test_net_buf_alloc();
   test_json_wtr();
+  test_jtree();
+  test_jpath();
   test_enc();
+  test_net_send();
+  test_net_ring();
+  test_net_loop( false );
+  test_net_loop( true );
+  test_net_wheel();
+  test_net_timer( false );
+  test_net_timer( true );
+  test_spsc_queue();
+  test_net_wakeup( false );
+  test_net_wakeup( true );
+  test_net_resolve();
+  test_tcp_connect( false );
+  test_tcp_connect( true );
+  test_unix_listen();
+  test_net_profile();
+  test_user_conflate();
+  test_rpc_http_pool();
+  test_rpc_tmpl();
+  test_rpc_notify();
+  test_rpc_hedge();
+  test_rpc_dedupe();
+  test_program_accounts();
+  test_snapshot_walk();
+  test_ws_deflate();
+  test_ws_mask();
+  test_ws_frag();
+  test_web_cache();
+  test_user_bin();
+  test_user_worker( false );
+  test_user_worker( true );
+  test_price_notify();
   PC_TEST_END
   return 0;
 }
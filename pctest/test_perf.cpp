@@ -0,0 +1,642 @@
+#include <pc/net_socket.hpp>
+#include <pc/misc.hpp>
+#include <pc/jtree.hpp>
+#include <pc/key_pair.hpp>
+#include <pc/rpc_client.hpp>
+#include <pc/user.hpp>
+#include <pc/user_bin.hpp>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <x86intrin.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// micro-benchmarks - not run as part of the unit tests
+
+using namespace pc;
+
+// connect pair of tcp sockets over loopback
+static bool tcp_pair( int fd[2] )
+{
+  int lfd = ::socket( AF_INET, SOCK_STREAM, 0 );
+  sockaddr_in addr;
+  socklen_t alen = sizeof( addr );
+  __builtin_memset( &addr, 0, sizeof( addr ) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  if ( 0 != ::bind( lfd, (sockaddr*)&addr, alen ) ||
+       0 != ::listen( lfd, 1 ) ||
+       0 != ::getsockname( lfd, (sockaddr*)&addr, &alen ) ) {
+    ::close( lfd );
+    return false;
+  }
+  fd[0] = ::socket( AF_INET, SOCK_STREAM, 0 );
+  if ( 0 != ::connect( fd[0], (sockaddr*)&addr, alen ) ) {
+    ::close( lfd );
+    return false;
+  }
+  fd[1] = ::accept( lfd, nullptr, nullptr );
+  ::close( lfd );
+  int flag = 1;
+  for( unsigned i=0; i != 2; ++i ) {
+    ::setsockopt( fd[i], IPPROTO_TCP, TCP_NODELAY, &flag, sizeof( flag ) );
+  }
+  return fd[1] >= 0;
+}
+
+// connect pair of unix domain sockets via abstract-namespace unix_listen
+static bool unix_pair( int fd[2] )
+{
+  class pair_accept : public net_accept
+  {
+  public:
+    void accept( int fd ) override { fd_ = fd; }
+    int fd_ = -1;
+  };
+  pair_accept ap;
+  unix_listen lsvr;
+  lsvr.set_path( "@pc_perf_" + std::to_string( ::getpid() ) );
+  lsvr.set_net_accept( &ap );
+  if ( !lsvr.init() ) {
+    return false;
+  }
+  sockaddr_un addr;
+  __builtin_memset( &addr, 0, sizeof( addr ) );
+  addr.sun_family = AF_UNIX;
+  std::string path = lsvr.get_path();
+  __builtin_memcpy( &addr.sun_path[1], &path[1], path.size() - 1 );
+  socklen_t alen = offsetof( sockaddr_un, sun_path ) + path.size();
+  fd[0] = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+  if ( 0 != ::connect( fd[0], (sockaddr*)&addr, alen ) ) {
+    return false;
+  }
+  lsvr.poll();
+  fd[1] = ap.fd_;
+  lsvr.teardown();
+  return fd[1] >= 0;
+}
+
+// fixed-size message ping-pong: the echo side sends back every message
+// it receives and the ping side times the round trip and sends the next
+class ping_parser : public net_parser
+{
+public:
+  static const size_t msg_len = 128;
+
+  ping_parser() : conn_( nullptr ), is_echo_( false ), num_( 0 ), ts_( 0 ) {}
+
+  bool parse( const char *, size_t sz, size_t& len ) override {
+    if ( sz < msg_len ) {
+      return false;
+    }
+    len = msg_len;
+    if ( is_echo_ ) {
+      send();
+    } else {
+      int64_t now = get_now();
+      lat_.push_back( now - ts_ );
+      if ( lat_.size() < num_ ) {
+        send();
+      }
+    }
+    return true;
+  }
+
+  void send() {
+    char buf[msg_len];
+    __builtin_memset( buf, 'x', msg_len );
+    net_wtr msg;
+    msg.add( str( buf, msg_len ) );
+    ts_ = get_now();
+    conn_->add_send( msg );
+  }
+
+  net_connect          *conn_;
+  bool                  is_echo_;
+  size_t                num_;
+  int64_t               ts_;
+  std::vector<int64_t>  lat_;
+};
+
+void perf_net_loop( bool use_uring, bool use_unix, size_t num_msg )
+{
+  net_loop nl;
+  nl.set_use_uring( use_uring );
+  int fd[2];
+  if ( !nl.init() || !( use_unix ? unix_pair( fd ) : tcp_pair( fd ) ) ) {
+    std::cerr << "perf_net_loop: setup failed" << std::endl;
+    return;
+  }
+  ping_parser pp[2];
+  net_connect conn[2];
+  for( unsigned i=0; i != 2; ++i ) {
+    conn[i].set_fd( fd[i] );
+    conn[i].set_block( false );
+    conn[i].set_net_parser( &pp[i] );
+    conn[i].set_net_loop( &nl );
+    conn[i].init();
+    pp[i].conn_ = &conn[i];
+    pp[i].num_ = num_msg;
+  }
+  pp[1].is_echo_ = true;
+  pp[0].lat_.reserve( num_msg );
+
+  // busy poll until all round trips complete
+  uint64_t nwait = nl.get_num_wait();
+  int64_t ts = get_now();
+  pp[0].send();
+  while( pp[0].lat_.size() != num_msg &&
+         !conn[0].get_is_err() && !conn[1].get_is_err() ) {
+    nl.poll( 0 );
+    if ( !nl.get_is_uring() ) {
+      conn[0].poll();
+      conn[1].poll();
+    }
+  }
+  ts = get_now() - ts;
+  nwait = nl.get_num_wait() - nwait;
+
+  // epoll mode services sockets with direct recv/send calls whereas
+  // io_uring submits everything via io_uring_enter
+  uint64_t nsys = nwait;
+  if ( !nl.get_is_uring() ) {
+    for( unsigned i=0; i != 2; ++i ) {
+      nsys += conn[i].get_num_recv() + conn[i].get_num_send();
+    }
+  }
+  std::vector<int64_t>& lat = pp[0].lat_;
+  std::sort( lat.begin(), lat.end() );
+  size_t num = std::max( lat.size(), (size_t)1 );
+  std::cout << "net_loop[" << (nl.get_is_uring()?"io_uring":"epoll")
+            << "," << (use_unix?"unix":"tcp")
+            << "] msgs=" << lat.size()
+            << " syscalls_per_msg=" << (double)nsys/(2*num)
+            << " avg_rtt_ns=" << ts/(int64_t)num
+            << " p50_rtt_ns=" << lat[num/2]
+            << " p99_rtt_ns=" << lat[(num*99)/100]
+            << std::endl;
+  conn[0].close();
+  conn[1].close();
+}
+
+// websocket masking throughput by kernel and payload size
+void perf_ws_mask()
+{
+  static const size_t sizes[] = { 64, 1500, 65536 };
+  static const size_t tot_bytes = 256UL*1024UL*1024UL;
+  std::vector<char> buf( 65536 + 64, 'x' );
+  ws_mask::impl_t impl = ws_mask::get_impl();
+  for( unsigned k=0; k != ws_mask::e_num_impl; ++k ) {
+    if ( !ws_mask::set_impl( (ws_mask::impl_t)k ) ) {
+      continue;
+    }
+    for( size_t len: sizes ) {
+      // payloads follow a 6-byte frame header so start misaligned
+      char *ptr = &buf[6];
+      size_t num = tot_bytes / len;
+      uint64_t cyc = __rdtsc();
+      for( size_t i=0; i != num; ++i ) {
+        ws_mask::apply( ptr, len, 0x78563412, i & 3 );
+      }
+      cyc = __rdtsc() - cyc;
+      std::cout << "ws_mask[" << ws_mask::get_impl_name( (ws_mask::impl_t)k )
+                << "] len=" << len
+                << " bytes_per_cycle=" << (double)( num * len ) / cyc
+                << std::endl;
+    }
+  }
+  ws_mask::set_impl( impl );
+}
+
+static void perf_release( net_wtr& msg )
+{
+  net_buf *hd, *tl;
+  msg.detach( hd, tl );
+  while( hd ) {
+    net_buf *nxt = hd->next_;
+    hd->dealloc();
+    hd = nxt;
+  }
+}
+
+// decode of update_price requests and encode of notify_price messages
+// as done by pythd for the json-rpc and binary protocols
+// original byte-at-a-time jtree parser for comparison
+class jtree_bytewise : public jtree
+{
+public:
+  void parse_bytewise( const char *cptr, size_t sz )
+  {
+    buf_ = cptr;
+    key_ = 0;
+    nv_.resize(1);
+    st_.clear();
+    typedef enum { e_start, e_string, e_number, e_keyword } state_t;
+    state_t st = e_start;
+    const char *txt=nullptr, *end = &cptr[sz];
+    for(;;) {
+      switch(st) {
+        case e_start: {
+          for(;;++cptr) {
+            if( cptr==end ) return;
+            if (*cptr == '{' ) {
+              parse_start_object();
+            } else if ( *cptr == '[' ) {
+              parse_start_array();
+            } else if (*cptr == '}' ) {
+              parse_end_object();
+            } else if ( *cptr == ']' ) {
+              parse_end_array();
+            } else if ( *cptr == '"' ) {
+              st = e_string; txt=cptr+1; break;
+            } else if ( *cptr == '-' || *cptr == '.' || isdigit(*cptr)) {
+              st = e_number; txt=cptr; break;
+            } else if ( *cptr == 't' || *cptr == 'f' || *cptr == 'n' ) {
+              st = e_keyword; txt=cptr; break;
+            }
+          }
+          ++cptr;
+          break;
+        }
+        case e_string: {
+          for(;;++cptr) {
+            if( cptr==end ) return;
+            if (*cptr == '"' ) {
+              st = e_start;
+              const char *etxt = cptr;
+              for(++cptr;;++cptr) {
+                if( cptr==end ) return;
+                if ( *cptr == ':' ) {
+                  parse_key( txt, etxt );
+                  break;
+                } else if ( !isspace(*cptr) ) {
+                  parse_string( txt, etxt );
+                  break;
+                }
+              }
+              break;
+            }
+          }
+          break;
+        }
+        case e_number: {
+          for(;;++cptr) {
+            if( cptr==end ) return;
+            if ( !isdigit(*cptr) && *cptr!='.' &&
+                 *cptr!='-' && *cptr!='e' && *cptr!='+' ) {
+              st = e_start; parse_number( txt, cptr );break;
+            }
+          }
+          break;
+        }
+        case e_keyword:{
+          for(;;++cptr) {
+            if ( cptr==end ) return;
+            if (!isalpha(*cptr) ) {
+              st = e_start; parse_keyword( txt, cptr ); break;
+            }
+          }
+          break;
+        }
+      }
+    }
+  }
+};
+
+// jtree parse throughput on accountNotification messages of price
+// accounts by structural index kernel
+static std::string perf_account_notify()
+{
+  std::vector<uint8_t> acc( sizeof( pc_price_t ) );
+  for( size_t i=0; i != acc.size(); ++i ) {
+    acc[i] = (uint8_t)( i * 131 + ( i >> 3 ) );
+  }
+  std::string data( enc_base64_len( acc.size() ), '\0' );
+  data.resize( enc_base64( acc.data(), acc.size(), (uint8_t*)&data[0] ) );
+  std::string msg = "{\"jsonrpc\":\"2.0\",\"method\":\"accountNotification\","
+    "\"params\":{\"result\":{\"context\":{\"slot\":118240587},"
+    "\"value\":{\"data\":[\"" + data + "\",\"base64\"],"
+    "\"executable\":false,\"lamports\":23942400,"
+    "\"owner\":\"gSbePebfvPy7tRqimPoVecS2UsBvYv46ynrzWocc92s\","
+    "\"rentEpoch\":273}},\"subscription\":42}}";
+  return msg;
+}
+
+void perf_jtree( size_t num_msg )
+{
+  std::string msg = perf_account_notify();
+  num_msg = std::max( num_msg / 10, (size_t)1 );
+
+  jtree_bytewise jt;
+  uint64_t sum = 0;
+  int64_t ts = get_now();
+  for( size_t i=0; i != num_msg; ++i ) {
+    jt.parse_bytewise( msg.c_str(), msg.size() );
+    sum += jt.get_str( jt.find_val( 1, "method" ) ).len_;
+  }
+  int64_t ns = get_now() - ts;
+  std::cout << "jtree[bytewise] msg_len=" << msg.size()
+            << " mb_per_sec=" << (int64_t)( num_msg * msg.size() * 1e3 / ns )
+            << " check=" << sum << std::endl;
+
+  jtree::impl_t impl = jtree::get_impl();
+  for( unsigned k=0; k != jtree::e_num_impl; ++k ) {
+    if ( !jtree::set_impl( (jtree::impl_t)k ) ) {
+      continue;
+    }
+    sum = 0;
+    ts = get_now();
+    for( size_t i=0; i != num_msg; ++i ) {
+      jt.parse( msg.c_str(), msg.size() );
+      sum += jt.get_str( jt.find_val( 1, "method" ) ).len_;
+    }
+    ns = get_now() - ts;
+    std::cout << "jtree[" << jtree::get_impl_name( (jtree::impl_t)k )
+              << "] msg_len=" << msg.size()
+              << " mb_per_sec=" << (int64_t)( num_msg * msg.size() * 1e3 / ns )
+              << " check=" << sum << std::endl;
+  }
+  jtree::set_impl( impl );
+}
+
+void perf_jpath( size_t num_msg )
+{
+  // extract the fields read by account_subscribe::notify
+  std::string msg = perf_account_notify();
+  jpath jp;
+  jp.add( "params.subscription" );
+  jp.add( "params.result.context.slot" );
+  jp.add( "params.result.value.data" );
+  jp.add( "params.result.value.lamports" );
+  num_msg = std::max( num_msg / 10, (size_t)1 );
+
+  for( unsigned k=0; k != 2; ++k ) {
+    jtree jt;
+    jt.set_path( k ? &jp : nullptr );
+    uint64_t sum = 0;
+    int64_t ts = get_now();
+    for( size_t i=0; i != num_msg; ++i ) {
+      jt.parse( msg.c_str(), msg.size() );
+      if ( k ) {
+        sum += jt.get_uint( jt.find_path( jp, 0 ) );
+        sum += jt.get_uint( jt.find_path( jp, 1 ) );
+        sum += jt.get_str( jt.get_first( jt.find_path( jp, 2 ) ) ).len_;
+        sum += jt.get_uint( jt.find_path( jp, 3 ) );
+      } else {
+        uint32_t ptok = jt.find_val( 1, "params" );
+        sum += jt.get_uint( jt.find_val( ptok, "subscription" ) );
+        uint32_t rtok = jt.find_val( ptok, "result" );
+        uint32_t ctok = jt.find_val( rtok, "context" );
+        sum += jt.get_uint( jt.find_val( ctok, "slot" ) );
+        uint32_t vtok = jt.find_val( rtok, "value" );
+        sum += jt.get_str( jt.get_first( jt.find_val( vtok, "data" ) ) ).len_;
+        sum += jt.get_uint( jt.find_val( vtok, "lamports" ) );
+      }
+    }
+    int64_t ns = get_now() - ts;
+    std::cout << "jpath[" << ( k ? "compiled" : "find_val" ) << "]"
+              << " ns_per_msg=" << (int64_t)( ns / num_msg )
+              << " check=" << sum << std::endl;
+  }
+}
+
+// accountNotification field extraction by jtree and by field scanner
+void perf_notify_scan( size_t num_msg )
+{
+  std::string msg = perf_account_notify();
+  jpath jp;
+  jp.add( "params.subscription" );
+  jp.add( "params.result.context.slot" );
+  jp.add( "params.result.value.data" );
+  jp.add( "params.result.value.lamports" );
+  num_msg = std::max( num_msg / 10, (size_t)1 );
+
+  for( unsigned k=0; k != 2; ++k ) {
+    jtree jt;
+    jt.set_path( &jp );
+    rpc_notify nt;
+    uint64_t sum = 0;
+    int64_t ts = get_now();
+    for( size_t i=0; i != num_msg; ++i ) {
+      if ( k ) {
+        nt.scan( msg.c_str(), msg.size() );
+        sum += nt.sub_ + nt.slot_ + nt.dlen_ + nt.lamports_;
+      } else {
+        jt.parse( msg.c_str(), msg.size() );
+        sum += jt.get_uint( jt.find_path( jp, 0 ) );
+        sum += jt.get_uint( jt.find_path( jp, 1 ) );
+        sum += jt.get_str( jt.get_first( jt.find_path( jp, 2 ) ) ).len_;
+        sum += jt.get_uint( jt.find_path( jp, 3 ) );
+      }
+    }
+    int64_t ns = get_now() - ts;
+    std::cout << "notify_scan[" << ( k ? "scan" : "jtree" ) << "]"
+              << " ns_per_msg=" << (int64_t)( ns / num_msg )
+              << " check=" << sum << std::endl;
+  }
+}
+
+// digit-per-division formatting as used before the table-driven one
+static size_t perf_uint_fmt_div( uint64_t val, char *ptr )
+{
+  char buf[24], *end = &buf[sizeof( buf )], *cptr = end;
+  do {
+    *--cptr = '0' + ( val % 10UL );
+    val /= 10UL;
+  } while( val );
+  size_t len = end - cptr;
+  __builtin_memcpy( ptr, cptr, len );
+  return len;
+}
+
+// integer formatting cost of the notify_price fields written for each
+// user::on_response( price* ) by formatter
+void perf_int_fmt( size_t num_msg )
+{
+  char buf[128];
+  for( unsigned k=0; k != 2; ++k ) {
+    uint64_t sum = 0;
+    uint64_t cyc = __rdtsc();
+    for( uint64_t i=0; i != num_msg; ++i ) {
+      // price, conf, valid_slot, pub_slot and subscription id
+      uint64_t val[5] = {
+        2771500000UL + i * 7919UL, 1250000UL + ( i & 0xffff ),
+        97412345UL + i, 97412346UL + i, i & 0xff };
+      size_t len = 0;
+      for( uint64_t v: val ) {
+        len += k ? uint_to_buf( v, &buf[len] )
+                 : perf_uint_fmt_div( v, &buf[len] );
+        buf[len++] = ',';
+      }
+      sum += len + buf[len-2];
+    }
+    cyc = __rdtsc() - cyc;
+    std::cout << "int_fmt[" << ( k ? "table" : "div" ) << "]"
+              << " cycles_per_msg=" << (double)cyc / num_msg
+              << " check=" << sum << std::endl;
+  }
+}
+
+void perf_user_proto( size_t num_msg )
+{
+  key_pair kp;
+  kp.gen();
+  pub_key acc( kp );
+  std::string acc_txt;
+  acc.enc_base58( acc_txt );
+  std::string jreq = "{\"jsonrpc\":\"2.0\",\"method\":\"update_price\","
+    "\"params\":{\"account\":\"" + acc_txt + "\",\"price\":42002,"
+    "\"conf\":3,\"status\":\"trading\"},\"id\":1}";
+  bin_update_price breq;
+  __builtin_memset( &breq, 0, sizeof( breq ) );
+  breq.hdr_.type_ = bin_msg::e_update_price;
+  breq.hdr_.size_ = sizeof( breq );
+  breq.handle_    = 1;
+  breq.price_     = 42002;
+  breq.conf_      = 3;
+  std::vector<const pub_key*> hvec( 1, &acc );
+  uint64_t sum = 0;
+
+  // json-rpc
+  jtree jp;
+  json_wtr jw;
+  int64_t ts = get_now();
+  for( size_t i=0; i != num_msg; ++i ) {
+    jp.parse( jreq.c_str(), jreq.size() );
+    uint32_t ptok = jp.find_val( 1, "params" );
+    pub_key pkey;
+    pkey.init_from_text( jp.get_str( jp.find_val( ptok, "account" ) ) );
+    int64_t px = jp.get_int( jp.find_val( ptok, "price" ) );
+    uint64_t conf = jp.get_uint( jp.find_val( ptok, "conf" ) );
+    symbol_status st = str_to_symbol_status(
+        jp.get_str( jp.find_val( ptok, "status" ) ) );
+    sum += pkey == acc;
+    jw.reset();
+    jw.add_val( json_wtr::e_obj );
+    jw.add_key( "jsonrpc", "2.0" );
+    jw.add_key( "method", "notify_price" );
+    jw.add_key( "params", json_wtr::e_obj );
+    jw.add_key( "result", json_wtr::e_obj );
+    jw.add_key( "price", px );
+    jw.add_key( "conf", conf );
+    jw.add_key( "status", symbol_status_to_str( st ) );
+    jw.add_key( "valid_slot", (uint64_t)i );
+    jw.add_key( "pub_slot", (uint64_t)i + 1 );
+    jw.pop();
+    jw.add_key( "subscription", 1UL );
+    jw.pop();
+    jw.pop();
+    perf_release( jw );
+  }
+  int64_t jns = get_now() - ts;
+
+  // binary
+  net_wtr bw;
+  ts = get_now();
+  for( size_t i=0; i != num_msg; ++i ) {
+    bin_update_price req;
+    __builtin_memcpy( &req, &breq, sizeof( req ) );
+    sum += *hvec[req.handle_-1] == acc;
+    bin_notify_price msg;
+    msg.hdr_.type_   = bin_msg::e_notify_price;
+    msg.hdr_.size_   = sizeof( msg );
+    msg.hdr_.id_     = 0;
+    msg.handle_      = req.handle_;
+    msg.status_      = req.status_;
+    msg.sub_         = 1;
+    msg.price_       = req.price_;
+    msg.conf_        = req.conf_;
+    msg.valid_slot_  = i;
+    msg.pub_slot_    = i + 1;
+    bw.reset();
+    bw.add( str( (const char*)&msg, sizeof( msg ) ) );
+    perf_release( bw );
+  }
+  int64_t bns = get_now() - ts;
+  std::cout << "user_proto[json] msgs_per_sec="
+            << (int64_t)( num_msg * 1e9 / jns ) << std::endl;
+  std::cout << "user_proto[binary] msgs_per_sec="
+            << (int64_t)( num_msg * 1e9 / bns )
+            << " check=" << sum << std::endl;
+}
+
+// notify_price fan-out of one aggregate update to many subscribers:
+// serialized per subscriber vs. shared payload with spliced-in id
+void perf_notify_fanout( size_t num_msg )
+{
+  static const uint64_t num_sub = 256;
+  key_pair kp;
+  kp.gen();
+  pub_key acc( kp );
+  price px( acc, nullptr );
+  px.set_conf( 100 );
+  px.set_symbol_status( symbol_status::e_trading );
+  size_t num_upd = std::max( num_msg / num_sub, (size_t)1 );
+
+  json_wtr jw;
+  int64_t ts = get_now();
+  for( size_t i=0; i != num_upd; ++i ) {
+    px.set_price( 1234500 + i );
+    for( uint64_t sid=0; sid != num_sub; ++sid ) {
+      jw.reset();
+      jw.add_val( json_wtr::e_obj );
+      jw.add_key( "jsonrpc", "2.0" );
+      jw.add_key( "method", "notify_price" );
+      jw.add_key( "params", json_wtr::e_obj );
+      jw.add_key( "result", json_wtr::e_obj );
+      jw.add_key( "price", px.get_price() );
+      jw.add_key( "conf", px.get_conf() );
+      jw.add_key( "status", symbol_status_to_str( px.get_status() ) );
+      jw.add_key( "valid_slot", px.get_valid_slot() );
+      jw.add_key( "pub_slot", px.get_pub_slot() );
+      jw.pop();
+      jw.add_key( "subscription", sid );
+      jw.pop();
+      jw.pop();
+      perf_release( jw );
+    }
+  }
+  int64_t sns = get_now() - ts;
+
+  price_notify pn;
+  net_wtr msg;
+  ts = get_now();
+  for( size_t i=0; i != num_upd; ++i ) {
+    px.set_price( 1234500 + i );
+    for( uint64_t sid=0; sid != num_sub; ++sid ) {
+      msg.reset();
+      pn.add( msg, &px, sid );
+      perf_release( msg );
+    }
+  }
+  int64_t pns = get_now() - ts;
+  size_t num = num_upd * num_sub;
+  std::cout << "notify_fanout[serialize] msgs_per_sec="
+            << (int64_t)( num * 1e9 / sns ) << std::endl;
+  std::cout << "notify_fanout[shared] msgs_per_sec="
+            << (int64_t)( num * 1e9 / pns )
+            << " num_build=" << pn.get_num_build() << std::endl;
+}
+
+int main( int argc, char **argv )
+{
+  size_t num_msg = argc > 1 ? ::atoi( argv[1] ) : 100000;
+  perf_net_loop( false, false, num_msg );
+  perf_net_loop( false, true, num_msg );
+  perf_net_loop( true, false, num_msg );
+  perf_net_loop( true, true, num_msg );
+  perf_ws_mask();
+  perf_jtree( num_msg );
+  perf_jpath( num_msg );
+  perf_notify_scan( num_msg );
+  perf_int_fmt( num_msg );
+  perf_user_proto( num_msg );
+  perf_notify_fanout( num_msg );
+  return 0;
+}
@@ -2,11 +2,16 @@
 #include <pc/misc.hpp>
 #include <pc/log.hpp>
 #include <pc/request.hpp>
+#include <pc/price_table.hpp>
 #include "test_error.hpp"
 #include <iostream>
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <fcntl.h>
 
 using namespace pc;
 
@@ -175,12 +180,142 @@ void test_request_sub()
   PC_TEST_CHECK( sub1.check( "r1", p1_3 ) );
 }
 
+static void test_ptab_price( pc_price_t& px, int64_t val, uint32_t num )
+{
+  px.expo_       = -5;
+  px.ptype_      = 1;
+  px.num_        = num;
+  px.valid_slot_ = val;
+  px.agg_.price_ = val;
+  px.agg_.conf_  = val;
+  px.agg_.status_ = 1;
+  px.agg_.pub_slot_ = val + 1;
+  for( unsigned i=0; i != num; ++i ) {
+    px.comp_[i].pub_.k8_[0] = i + 1;
+    px.comp_[i].agg_.price_ = val;
+    px.comp_[i].agg_.conf_  = val;
+  }
+}
+
+void test_price_table()
+{
+  std::string file = "/tmp/pc_ptab_" + std::to_string( ::getpid() );
+  pub_key acc[3];
+  for( unsigned i=0; i != 3; ++i ) {
+    key_pair kp;
+    kp.gen();
+    acc[i] = kp;
+  }
+  pc_price_t *px = new pc_price_t;
+  __builtin_memset( px, 0, sizeof( pc_price_t ) );
+  price_table ptab;
+  ptab.set_file( file );
+  ptab.set_num_slot( 2 );
+  PC_TEST_CHECK( ptab.init() );
+  test_ptab_price( *px, 100, 3 );
+  ptab.write( acc[0], "BTC/USD", px );
+  test_ptab_price( *px, 200, 2 );
+  ptab.write( acc[1], "ETH/USD", px );
+
+  // table holds at most num_slot accounts
+  ptab.write( acc[2], "SOL/USD", px );
+  PC_TEST_CHECK( ptab.get_num_used() == 2 );
+
+  price_table_reader rdr;
+  rdr.set_file( file );
+  PC_TEST_CHECK( rdr.init() );
+  PC_TEST_CHECK( !rdr.get_is_stale() );
+  PC_TEST_CHECK( rdr.get_num_price() == 2 );
+  unsigned idx;
+  PC_TEST_CHECK( rdr.find( acc[1], idx ) && idx == 1 );
+  PC_TEST_CHECK( !rdr.find( acc[2], idx ) );
+  PC_TEST_CHECK( rdr.find( "BTC/USD", idx ) && idx == 0 );
+  PC_TEST_CHECK( rdr.get_symbol( 1 ) == "ETH/USD" );
+  PC_TEST_CHECK( *rdr.get_account( 0 ) == acc[0] );
+  ptab_price rpx;
+  PC_TEST_CHECK( rdr.read( 0, rpx, true ) );
+  PC_TEST_CHECK( rpx.price_ == 100 && rpx.conf_ == 100 );
+  PC_TEST_CHECK( rpx.valid_slot_ == 100 && rpx.pub_slot_ == 101 );
+  PC_TEST_CHECK( rpx.expo_ == -5 && rpx.status_ == 1 && rpx.ptype_ == 1 );
+  PC_TEST_CHECK( rpx.num_comp_ == 3 );
+  PC_TEST_CHECK( rpx.comp_[2].price_ == 100 && rpx.comp_[2].pub_.k8_[0] == 3 );
+  PC_TEST_CHECK( !rdr.read( 2, rpx ) );
+
+  // readers never see a partially written price
+  test_ptab_price( *px, PC_COMP_SIZE, 1 );
+  ptab.write( acc[0], "BTC/USD", px );
+  std::atomic<bool> done( false );
+  std::thread thrd( [&]() {
+    pc_price_t *wpx = new pc_price_t;
+    __builtin_memset( wpx, 0, sizeof( pc_price_t ) );
+    for( int64_t i=1; i != 200000; ++i ) {
+      test_ptab_price( *wpx, i, 1 + i % PC_COMP_SIZE );
+      ptab.write( acc[0], "BTC/USD", wpx );
+    }
+    delete wpx;
+    done = true;
+  } );
+  uint64_t nread = 0, nbad = 0;
+  while( !done ) {
+    if ( !rdr.read( 0, rpx, true ) ) {
+      continue;
+    }
+    ++nread;
+    bool ok = rpx.conf_ == (uint64_t)rpx.price_ &&
+              rpx.pub_slot_ == rpx.valid_slot_ + 1 &&
+              rpx.num_comp_ == 1 + rpx.price_ % PC_COMP_SIZE;
+    for( unsigned i=0; i != rpx.num_comp_; ++i ) {
+      ok = ok && rpx.comp_[i].price_ == rpx.price_;
+    }
+    nbad += !ok;
+  }
+  thrd.join();
+  PC_TEST_CHECK( nread > 0 && nbad == 0 );
+  PC_TEST_CHECK( rdr.read( 0, rpx ) && rpx.price_ == 199999 );
+
+  // slot left locked by a writer that died mid-update
+  char hbuf[sizeof( ptab_hdr )], bbuf[sizeof( ptab_hdr )];
+  ptab_hdr *hdr = (ptab_hdr*)hbuf, *bad = (ptab_hdr*)bbuf;
+  int fd = ::open( file.c_str(), O_RDWR );
+  PC_TEST_CHECK( sizeof( hbuf ) == ::pread( fd, hbuf, sizeof( hbuf ), 0 ) );
+  uint64_t seq = 1;
+  PC_TEST_CHECK( sizeof( seq ) == ::pwrite( fd, &seq, sizeof( seq ),
+                                            hdr->slot_off_ ) );
+  PC_TEST_CHECK( !rdr.read( 0, rpx ) );
+  PC_TEST_CHECK( rdr.read( 1, rpx ) && rpx.price_ == 200 );
+
+  // corrupt or truncated tables are rejected
+  __builtin_memcpy( bbuf, hbuf, sizeof( bbuf ) );
+  bad->num_used_ = hdr->num_slot_ + 1;
+  PC_TEST_CHECK( sizeof( bbuf ) == ::pwrite( fd, bbuf, sizeof( bbuf ), 0 ) );
+  PC_TEST_CHECK( !rdr.init() );
+  __builtin_memcpy( bbuf, hbuf, sizeof( bbuf ) );
+  bad->dir_off_ = ~0UL - 8;
+  PC_TEST_CHECK( sizeof( bbuf ) == ::pwrite( fd, bbuf, sizeof( bbuf ), 0 ) );
+  PC_TEST_CHECK( !rdr.init() );
+  PC_TEST_CHECK( sizeof( hbuf ) == ::pwrite( fd, hbuf, sizeof( hbuf ), 0 ) );
+  PC_TEST_CHECK( rdr.init() );
+  PC_TEST_CHECK( 0 == ::ftruncate( fd, hdr->slot_off_ + 8 ) );
+  PC_TEST_CHECK( !rdr.init() );
+  ::close( fd );
+
+  // restarted writer replaces the table
+  price_table ptab2;
+  ptab2.set_file( file );
+  PC_TEST_CHECK( ptab2.init() );
+  PC_TEST_CHECK( rdr.get_is_stale() );
+  PC_TEST_CHECK( rdr.init() && rdr.get_num_price() == 0 );
+  delete px;
+  ::unlink( file.c_str() );
+}
+
 int main(int,char**)
 {
   PC_TEST_START
   test_key();
   test_log();
   test_request_sub();
+  test_price_table();
   PC_TEST_END
   return 0;
 }